@@ -15,66 +15,299 @@
  */
 
 #include "../util/darray.h"
+#include "../util/platform.h"
 #include "../util/threading.h"
 
 #include "decl.h"
 #include "signal.h"
 
+/* ------------------------------------------------------------------------- */
+/* Interned signal names */
+
+#define SIGNAL_ID_BUCKETS 256
+
+struct signal_id {
+	struct signal_id *next;
+	uint32_t hash;
+	size_t len;
+	char name[];
+};
+
+/* Interned names live as long as the process, like the string literals they
+ * are made from, so they are allocated outside of bmem and never show up as
+ * leaks */
+static struct signal_id *signal_ids[SIGNAL_ID_BUCKETS];
+static pthread_mutex_t signal_ids_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* FNV-1a */
+static inline uint32_t signal_name_hash(const char *name, size_t len)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (uint8_t)name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static inline bool signal_id_matches(signal_id_t id, const char *name, size_t len, uint32_t hash)
+{
+	return id->hash == hash && id->len == len && memcmp(id->name, name, len) == 0;
+}
+
+signal_id_t signal_id_intern(const char *name)
+{
+	struct signal_id *id;
+	size_t len, bucket;
+	uint32_t hash;
+
+	if (!name)
+		return NULL;
+
+	len = strlen(name);
+	hash = signal_name_hash(name, len);
+	bucket = hash % SIGNAL_ID_BUCKETS;
+
+	pthread_mutex_lock(&signal_ids_mutex);
+
+	id = signal_ids[bucket];
+	while (id && !signal_id_matches(id, name, len, hash))
+		id = id->next;
+
+	if (!id) {
+		id = malloc(sizeof(struct signal_id) + len + 1);
+		if (id) {
+			id->hash = hash;
+			id->len = len;
+			memcpy(id->name, name, len + 1);
+			id->next = signal_ids[bucket];
+			signal_ids[bucket] = id;
+		}
+	}
+
+	pthread_mutex_unlock(&signal_ids_mutex);
+	return id;
+}
+
+const char *signal_id_get_name(signal_id_t id)
+{
+	return id ? id->name : NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Callback snapshots
+ *
+ *   The callbacks of a signal are published as an immutable snapshot.  Emitting
+ * takes a reference to the current one and calls through it without holding
+ * any lock, so emitters never wait for each other or for connecting and
+ * disconnecting, which build a new snapshot and swap it in.  Disconnecting
+ * then waits for calls of the callback still running on other threads, so a
+ * callback is never called once its disconnect returned. */
+
 struct signal_callback {
 	signal_callback_t callback;
 	void *data;
-	bool remove;
+	volatile bool remove;
 	bool keep_ref;
+
+	/* snapshots containing this callback */
+	volatile long refs;
+
+	/* emitters about to call or calling it */
+	volatile long calls;
+};
+
+struct signal_snapshot {
+	volatile long refs;
+	size_t num;
+	struct signal_callback *callbacks[];
 };
 
+/* Emissions in progress on this thread, innermost first */
+struct signal_emission {
+	struct signal_snapshot *snapshot;
+	struct signal_callback *current;
+	struct signal_emission *prev;
+};
+
+static void snapshot_release(struct signal_snapshot *snapshot)
+{
+	if (!snapshot || os_atomic_dec_long(&snapshot->refs) != 0)
+		return;
+
+	for (size_t i = 0; i < snapshot->num; i++) {
+		struct signal_callback *cb = snapshot->callbacks[i];
+		if (os_atomic_dec_long(&cb->refs) == 0)
+			bfree(cb);
+	}
+	bfree(snapshot);
+}
+
+/* Copies a snapshot without skip and with append added at the end */
+static struct signal_snapshot *snapshot_copy(const struct signal_snapshot *src, const struct signal_callback *skip,
+					     struct signal_callback *append)
+{
+	struct signal_snapshot *snapshot;
+	size_t num = src ? src->num : 0;
+
+	if (skip)
+		num--;
+	if (append)
+		num++;
+	if (!num)
+		return NULL;
+
+	snapshot = bmalloc(sizeof(struct signal_snapshot) + sizeof(struct signal_callback *) * num);
+	snapshot->refs = 1;
+	snapshot->num = 0;
+
+	for (size_t i = 0; src && i < src->num; i++) {
+		struct signal_callback *cb = src->callbacks[i];
+		if (cb != skip) {
+			os_atomic_inc_long(&cb->refs);
+			snapshot->callbacks[snapshot->num++] = cb;
+		}
+	}
+
+	if (append) {
+		os_atomic_inc_long(&append->refs);
+		snapshot->callbacks[snapshot->num++] = append;
+	}
+
+	return snapshot;
+}
+
+static THREAD_LOCAL struct signal_emission *current_emission = NULL;
+
+/* Waits until no other thread is calling a callback that was flagged for
+ * removal; calls further up this thread's stack cannot finish before we
+ * return and are not waited for */
+static void signal_callback_wait(struct signal_callback *cb)
+{
+	long own = 0;
+
+	for (struct signal_emission *emission = current_emission; emission; emission = emission->prev) {
+		if (emission->current == cb)
+			own++;
+	}
+
+	while (os_atomic_load_long(&cb->calls) > own)
+		os_sleep_ms(1);
+}
+
+/* ------------------------------------------------------------------------- */
+
 struct signal_info {
 	struct decl_info func;
-	DARRAY(struct signal_callback) callbacks;
+	signal_id_t id;
+
+	/* serializes connecting and disconnecting */
 	pthread_mutex_t mutex;
-	bool signalling;
+
+	/* only held to take a reference to or swap the snapshot */
+	pthread_mutex_t snapshot_mutex;
+	struct signal_snapshot *snapshot;
+	volatile long num_callbacks;
 
 	struct signal_info *next;
+	struct signal_info *next_in_bucket;
 };
 
 static inline struct signal_info *signal_info_create(struct decl_info *info)
 {
-	struct signal_info *si = bmalloc(sizeof(struct signal_info));
+	struct signal_info *si = bzalloc(sizeof(struct signal_info));
 	si->func = *info;
-	si->next = NULL;
-	si->signalling = false;
-	da_init(si->callbacks);
+	si->id = signal_id_intern(info->name);
 
+	if (!si->id) {
+		blog(LOG_ERROR, "Could not create signal");
+		goto fail_id;
+	}
 	if (pthread_mutex_init_recursive(&si->mutex) != 0) {
 		blog(LOG_ERROR, "Could not create signal");
-
-		decl_info_free(&si->func);
-		bfree(si);
-		return NULL;
+		goto fail_id;
+	}
+	if (pthread_mutex_init(&si->snapshot_mutex, NULL) != 0) {
+		blog(LOG_ERROR, "Could not create signal");
+		pthread_mutex_destroy(&si->mutex);
+		goto fail_id;
 	}
 
 	return si;
+
+fail_id:
+	decl_info_free(&si->func);
+	bfree(si);
+	return NULL;
 }
 
 static inline void signal_info_destroy(struct signal_info *si)
 {
 	if (si) {
+		snapshot_release(si->snapshot);
+		pthread_mutex_destroy(&si->snapshot_mutex);
 		pthread_mutex_destroy(&si->mutex);
 		decl_info_free(&si->func);
-		da_free(si->callbacks);
 		bfree(si);
 	}
 }
 
-static inline size_t signal_get_callback_idx(struct signal_info *si, signal_callback_t callback, void *data)
+static struct signal_snapshot *signal_get_snapshot(struct signal_info *si)
 {
-	for (size_t i = 0; i < si->callbacks.num; i++) {
-		struct signal_callback *sc = si->callbacks.array + i;
+	struct signal_snapshot *snapshot;
+
+	pthread_mutex_lock(&si->snapshot_mutex);
+	snapshot = si->snapshot;
+	if (snapshot)
+		os_atomic_inc_long(&snapshot->refs);
+	pthread_mutex_unlock(&si->snapshot_mutex);
+
+	return snapshot;
+}
+
+/* Swaps in a new snapshot and returns the old one, whose reference now
+ * belongs to the caller; called with si->mutex held */
+static struct signal_snapshot *signal_publish(struct signal_info *si, struct signal_snapshot *snapshot)
+{
+	struct signal_snapshot *old;
+
+	pthread_mutex_lock(&si->snapshot_mutex);
+	old = si->snapshot;
+	si->snapshot = snapshot;
+	pthread_mutex_unlock(&si->snapshot_mutex);
 
-		if (sc->callback == callback && sc->data == data)
-			return i;
+	os_atomic_set_long(&si->num_callbacks, snapshot ? (long)snapshot->num : 0);
+	return old;
+}
+
+static inline struct signal_callback *signal_find_callback(struct signal_info *si, signal_callback_t callback,
+							   void *data)
+{
+	struct signal_snapshot *snapshot = si->snapshot;
+
+	for (size_t i = 0; snapshot && i < snapshot->num; i++) {
+		struct signal_callback *cb = snapshot->callbacks[i];
+
+		if (cb->callback == callback && cb->data == data && !os_atomic_load_bool(&cb->remove))
+			return cb;
 	}
 
-	return DARRAY_INVALID;
+	return NULL;
+}
+
+/* Drops a callback from the published snapshot and returns the old one, or
+ * NULL if someone else already did; called with si->mutex held */
+static struct signal_snapshot *signal_unpublish(struct signal_info *si, struct signal_callback *cb)
+{
+	struct signal_snapshot *snapshot = si->snapshot;
+
+	for (size_t i = 0; snapshot && i < snapshot->num; i++) {
+		if (snapshot->callbacks[i] == cb)
+			return signal_publish(si, snapshot_copy(snapshot, cb, NULL));
+	}
+
+	return NULL;
 }
 
 struct global_callback_info {
@@ -85,32 +318,83 @@ struct global_callback_info {
 };
 
 struct signal_handler {
-	struct signal_info *first;
+	struct signal_info *first, *last;
+	struct signal_info **buckets;
+	size_t num_buckets;
+	size_t num_signals;
 	pthread_mutex_t mutex;
 	volatile long refs;
 
 	DARRAY(struct global_callback_info) global_callbacks;
 	pthread_mutex_t global_callbacks_mutex;
+	volatile long num_global_callbacks;
 };
 
-static struct signal_info *getsignal(signal_handler_t *handler, const char *name, struct signal_info **p_last)
+/* Signals are looked up in a hash table keyed by the hash of their interned
+ * name; called with handler->mutex held */
+static struct signal_info *getsignal(signal_handler_t *handler, const char *name)
 {
-	struct signal_info *signal, *last = NULL;
+	struct signal_info *signal;
+	size_t len;
+	uint32_t hash;
+
+	if (!handler->num_buckets)
+		return NULL;
 
-	signal = handler->first;
-	while (signal != NULL) {
-		if (strcmp(signal->func.name, name) == 0)
-			break;
+	len = strlen(name);
+	hash = signal_name_hash(name, len);
 
-		last = signal;
-		signal = signal->next;
-	}
+	signal = handler->buckets[hash % handler->num_buckets];
+	while (signal && !signal_id_matches(signal->id, name, len, hash))
+		signal = signal->next_in_bucket;
+
+	return signal;
+}
+
+static struct signal_info *getsignal_id(signal_handler_t *handler, signal_id_t id)
+{
+	struct signal_info *signal;
+
+	if (!handler->num_buckets)
+		return NULL;
+
+	signal = handler->buckets[id->hash % handler->num_buckets];
+	while (signal && signal->id != id)
+		signal = signal->next_in_bucket;
 
-	if (p_last)
-		*p_last = last;
 	return signal;
 }
 
+static void signal_handler_insert(signal_handler_t *handler, struct signal_info *sig)
+{
+	size_t bucket;
+
+	if (!handler->last)
+		handler->first = sig;
+	else
+		handler->last->next = sig;
+	handler->last = sig;
+
+	/* keep chains short by growing the table with the signal count */
+	if (++handler->num_signals > handler->num_buckets) {
+		size_t num_buckets = handler->num_buckets ? handler->num_buckets * 2 : 16;
+
+		bfree(handler->buckets);
+		handler->buckets = bzalloc(sizeof(struct signal_info *) * num_buckets);
+		handler->num_buckets = num_buckets;
+
+		for (struct signal_info *si = handler->first; si != sig; si = si->next) {
+			bucket = si->id->hash % num_buckets;
+			si->next_in_bucket = handler->buckets[bucket];
+			handler->buckets[bucket] = si;
+		}
+	}
+
+	bucket = sig->id->hash % handler->num_buckets;
+	sig->next_in_bucket = handler->buckets[bucket];
+	handler->buckets[bucket] = sig;
+}
+
 /* ------------------------------------------------------------------------- */
 
 signal_handler_t *signal_handler_create(void)
@@ -144,6 +428,7 @@ static void signal_handler_actually_destroy(signal_handler_t *handler)
 		sig = next;
 	}
 
+	bfree(handler->buckets);
 	da_free(handler->global_callbacks);
 	pthread_mutex_destroy(&handler->global_callbacks_mutex);
 	pthread_mutex_destroy(&handler->mutex);
@@ -160,7 +445,7 @@ void signal_handler_destroy(signal_handler_t *handler)
 bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
 {
 	struct decl_info func = {0};
-	struct signal_info *sig, *last;
+	struct signal_info *sig;
 	bool success = true;
 
 	if (!parse_decl_string(&func, signal_decl)) {
@@ -170,17 +455,17 @@ bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
 
 	pthread_mutex_lock(&handler->mutex);
 
-	sig = getsignal(handler, func.name, &last);
+	sig = getsignal(handler, func.name);
 	if (sig) {
 		blog(LOG_WARNING, "Signal declaration '%s' exists", func.name);
 		decl_info_free(&func);
 		success = false;
 	} else {
 		sig = signal_info_create(&func);
-		if (!last)
-			handler->first = sig;
+		if (sig)
+			signal_handler_insert(handler, sig);
 		else
-			last->next = sig;
+			success = false;
 	}
 
 	pthread_mutex_unlock(&handler->mutex);
@@ -188,20 +473,44 @@ bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
 	return success;
 }
 
+static inline struct signal_info *getsignal_locked(signal_handler_t *handler, const char *name)
+{
+	struct signal_info *sig;
+
+	if (!handler || !name)
+		return NULL;
+
+	pthread_mutex_lock(&handler->mutex);
+	sig = getsignal(handler, name);
+	pthread_mutex_unlock(&handler->mutex);
+
+	return sig;
+}
+
+static inline struct signal_info *getsignal_id_locked(signal_handler_t *handler, signal_id_t id)
+{
+	struct signal_info *sig;
+
+	if (!handler || !id)
+		return NULL;
+
+	pthread_mutex_lock(&handler->mutex);
+	sig = getsignal_id(handler, id);
+	pthread_mutex_unlock(&handler->mutex);
+
+	return sig;
+}
+
 static void signal_handler_connect_internal(signal_handler_t *handler, const char *signal, signal_callback_t callback,
 					    void *data, bool keep_ref)
 {
-	struct signal_info *sig, *last;
-	struct signal_callback cb_data = {callback, data, false, keep_ref};
-	size_t idx;
+	struct signal_info *sig;
+	struct signal_snapshot *old = NULL;
 
 	if (!handler)
 		return;
 
-	pthread_mutex_lock(&handler->mutex);
-	sig = getsignal(handler, signal, &last);
-	pthread_mutex_unlock(&handler->mutex);
-
+	sig = getsignal_locked(handler, signal);
 	if (!sig) {
 		blog(LOG_WARNING,
 		     "signal_handler_connect: "
@@ -217,11 +526,18 @@ static void signal_handler_connect_internal(signal_handler_t *handler, const cha
 	if (keep_ref)
 		os_atomic_inc_long(&handler->refs);
 
-	idx = signal_get_callback_idx(sig, callback, data);
-	if (keep_ref || idx == DARRAY_INVALID)
-		da_push_back(sig->callbacks, &cb_data);
+	if (keep_ref || !signal_find_callback(sig, callback, data)) {
+		struct signal_callback *cb = bzalloc(sizeof(struct signal_callback));
+		cb->callback = callback;
+		cb->data = data;
+		cb->keep_ref = keep_ref;
+		old = signal_publish(sig, snapshot_copy(sig->snapshot, NULL, cb));
+	}
 
 	pthread_mutex_unlock(&sig->mutex);
+
+	/* emitters still using the old snapshot simply miss the new callback */
+	snapshot_release(old);
 }
 
 void signal_handler_connect(signal_handler_t *handler, const char *signal, signal_callback_t callback, void *data)
@@ -234,102 +550,114 @@ void signal_handler_connect_ref(signal_handler_t *handler, const char *signal, s
 	signal_handler_connect_internal(handler, signal, callback, data, true);
 }
 
-static inline struct signal_info *getsignal_locked(signal_handler_t *handler, const char *name)
-{
-	struct signal_info *sig;
-
-	if (!handler)
-		return NULL;
-
-	pthread_mutex_lock(&handler->mutex);
-	sig = getsignal(handler, name, NULL);
-	pthread_mutex_unlock(&handler->mutex);
-
-	return sig;
-}
-
 void signal_handler_disconnect(signal_handler_t *handler, const char *signal, signal_callback_t callback, void *data)
 {
 	struct signal_info *sig = getsignal_locked(handler, signal);
+	struct signal_snapshot *old = NULL;
+	struct signal_callback *cb;
 	bool keep_ref = false;
-	size_t idx;
 
 	if (!sig)
 		return;
 
 	pthread_mutex_lock(&sig->mutex);
 
-	idx = signal_get_callback_idx(sig, callback, data);
-	if (idx != DARRAY_INVALID) {
-		if (sig->signalling) {
-			sig->callbacks.array[idx].remove = true;
-		} else {
-			keep_ref = sig->callbacks.array[idx].keep_ref;
-			da_erase(sig->callbacks, idx);
-		}
+	cb = signal_find_callback(sig, callback, data);
+	if (cb) {
+		/* emitters already past the snapshot check skip it too */
+		os_atomic_set_bool(&cb->remove, true);
+		keep_ref = cb->keep_ref;
+		old = signal_unpublish(sig, cb);
 	}
 
 	pthread_mutex_unlock(&sig->mutex);
 
+	/* the old snapshot keeps cb alive while waiting */
+	if (old) {
+		signal_callback_wait(cb);
+		snapshot_release(old);
+	}
+
 	if (keep_ref && os_atomic_dec_long(&handler->refs) == 0) {
 		signal_handler_actually_destroy(handler);
 	}
 }
 
-static THREAD_LOCAL struct signal_callback *current_signal_cb = NULL;
 static THREAD_LOCAL struct global_callback_info *current_global_cb = NULL;
 
 void signal_handler_remove_current(void)
 {
-	if (current_signal_cb)
-		current_signal_cb->remove = true;
+	if (current_emission && current_emission->current)
+		os_atomic_set_bool(&current_emission->current->remove, true);
 	else if (current_global_cb)
 		current_global_cb->remove = true;
 }
 
-void signal_handler_signal(signal_handler_t *handler, const char *signal, calldata_t *params)
+/* Unpublishes the callbacks of a snapshot that removed themselves during
+ * the emission; returns how many of them held a handler reference */
+static long signal_remove_flagged(struct signal_info *sig, struct signal_snapshot *snapshot)
 {
-	struct signal_info *sig = getsignal_locked(handler, signal);
 	long remove_refs = 0;
 
-	if (!sig)
-		return;
+	for (size_t i = 0; i < snapshot->num; i++) {
+		struct signal_callback *cb = snapshot->callbacks[i];
+		struct signal_snapshot *old;
 
-	pthread_mutex_lock(&sig->mutex);
-	sig->signalling = true;
-
-	for (size_t i = 0; i < sig->callbacks.num; i++) {
-		struct signal_callback *cb = sig->callbacks.array + i;
-		if (!cb->remove) {
-			current_signal_cb = cb;
-			cb->callback(cb->data, params);
-			current_signal_cb = NULL;
-		}
-	}
+		if (!os_atomic_load_bool(&cb->remove))
+			continue;
+
+		pthread_mutex_lock(&sig->mutex);
+		old = signal_unpublish(sig, cb);
+		pthread_mutex_unlock(&sig->mutex);
 
-	for (size_t i = sig->callbacks.num; i > 0; i--) {
-		struct signal_callback *cb = sig->callbacks.array + i - 1;
-		if (cb->remove) {
+		if (old) {
 			if (cb->keep_ref)
 				remove_refs++;
-
-			da_erase(sig->callbacks, i - 1);
+			snapshot_release(old);
 		}
 	}
 
-	sig->signalling = false;
-	pthread_mutex_unlock(&sig->mutex);
+	return remove_refs;
+}
 
-	pthread_mutex_lock(&handler->global_callbacks_mutex);
+static void signal_emit(signal_handler_t *handler, struct signal_info *sig, calldata_t *params)
+{
+	struct signal_emission emission = {NULL, NULL, current_emission};
+	long remove_refs = 0;
+
+	if (os_atomic_load_long(&sig->num_callbacks))
+		emission.snapshot = signal_get_snapshot(sig);
+
+	current_emission = &emission;
+
+	if (emission.snapshot) {
+		for (size_t i = 0; i < emission.snapshot->num; i++) {
+			struct signal_callback *cb = emission.snapshot->callbacks[i];
+
+			/* counted before checking the flag, so a disconnect either
+			 * sees the call or the call sees the flag */
+			os_atomic_inc_long(&cb->calls);
+			if (!os_atomic_load_bool(&cb->remove)) {
+				emission.current = cb;
+				cb->callback(cb->data, params);
+				emission.current = NULL;
+			}
+			os_atomic_dec_long(&cb->calls);
+		}
+
+		remove_refs = signal_remove_flagged(sig, emission.snapshot);
+	}
+
+	if (os_atomic_load_long(&handler->num_global_callbacks)) {
+		pthread_mutex_lock(&handler->global_callbacks_mutex);
 
-	if (handler->global_callbacks.num) {
 		for (size_t i = 0; i < handler->global_callbacks.num; i++) {
 			struct global_callback_info *cb = handler->global_callbacks.array + i;
 
 			if (!cb->remove) {
 				cb->signaling++;
 				current_global_cb = cb;
-				cb->callback(cb->data, signal, params);
+				cb->callback(cb->data, sig->func.name, params);
 				current_global_cb = NULL;
 				cb->signaling--;
 			}
@@ -341,15 +669,50 @@ void signal_handler_signal(signal_handler_t *handler, const char *signal, callda
 			if (cb->remove && !cb->signaling)
 				da_erase(handler->global_callbacks, i - 1);
 		}
+
+		os_atomic_set_long(&handler->num_global_callbacks, (long)handler->global_callbacks.num);
+		pthread_mutex_unlock(&handler->global_callbacks_mutex);
 	}
 
-	pthread_mutex_unlock(&handler->global_callbacks_mutex);
+	current_emission = emission.prev;
+	snapshot_release(emission.snapshot);
 
 	if (remove_refs) {
 		os_atomic_set_long(&handler->refs, os_atomic_load_long(&handler->refs) - remove_refs);
 	}
 }
 
+void signal_handler_signal(signal_handler_t *handler, const char *signal, calldata_t *params)
+{
+	struct signal_info *sig = getsignal_locked(handler, signal);
+
+	if (sig)
+		signal_emit(handler, sig, params);
+}
+
+void signal_handler_signal_id(signal_handler_t *handler, signal_id_t id, calldata_t *params)
+{
+	struct signal_info *sig = getsignal_id_locked(handler, id);
+
+	if (sig)
+		signal_emit(handler, sig, params);
+}
+
+static inline bool signal_has_callbacks(signal_handler_t *handler, struct signal_info *sig)
+{
+	return sig && (os_atomic_load_long(&sig->num_callbacks) || os_atomic_load_long(&handler->num_global_callbacks));
+}
+
+bool signal_handler_has_callbacks(signal_handler_t *handler, const char *signal)
+{
+	return signal_has_callbacks(handler, getsignal_locked(handler, signal));
+}
+
+bool signal_handler_has_callbacks_id(signal_handler_t *handler, signal_id_t id)
+{
+	return signal_has_callbacks(handler, getsignal_id_locked(handler, id));
+}
+
 void signal_handler_connect_global(signal_handler_t *handler, global_signal_callback_t callback, void *data)
 {
 	struct global_callback_info cb_data = {callback, data, 0, false};
@@ -364,6 +727,7 @@ void signal_handler_connect_global(signal_handler_t *handler, global_signal_call
 	if (idx == DARRAY_INVALID)
 		da_push_back(handler->global_callbacks, &cb_data);
 
+	os_atomic_set_long(&handler->num_global_callbacks, (long)handler->global_callbacks.num);
 	pthread_mutex_unlock(&handler->global_callbacks_mutex);
 }
 
@@ -387,5 +751,6 @@ void signal_handler_disconnect_global(signal_handler_t *handler, global_signal_c
 			da_erase(handler->global_callbacks, idx);
 	}
 
+	os_atomic_set_long(&handler->num_global_callbacks, (long)handler->global_callbacks.num);
 	pthread_mutex_unlock(&handler->global_callbacks_mutex);
 }
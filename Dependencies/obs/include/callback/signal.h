@@ -68,6 +68,29 @@ EXPORT void signal_handler_remove_current(void);
 
 EXPORT void signal_handler_signal(signal_handler_t *handler, const char *signal, calldata_t *params);
 
+/*
+ * Interned signal names
+ *
+ *   signal_id_intern() returns the same ID for the same name for the life of
+ * the process.  Checking or emitting a signal by ID skips hashing and
+ * comparing its name, so code that emits a signal often can intern it once
+ * and keep the ID.
+ */
+
+struct signal_id;
+typedef const struct signal_id *signal_id_t;
+
+EXPORT signal_id_t signal_id_intern(const char *name);
+EXPORT const char *signal_id_get_name(signal_id_t id);
+
+EXPORT void signal_handler_signal_id(signal_handler_t *handler, signal_id_t id, calldata_t *params);
+
+/* Whether emitting the signal would reach any callback, global callbacks
+ * included; lets frequent signals skip building their calldata when nobody
+ * is connected */
+EXPORT bool signal_handler_has_callbacks(signal_handler_t *handler, const char *signal);
+EXPORT bool signal_handler_has_callbacks_id(signal_handler_t *handler, signal_id_t id);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,524 @@
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "../util/platform.h"
+#include "../util/threading.h"
+#include "../util/array-serializer.h"
+#include "effect-cache.h"
+
+/*
+ * Entry layout, all integers little endian, strings as a 32-bit length
+ * followed by the bytes (no terminator):
+ *
+ *   u32 magic, u32 version, u64 checksum of everything that follows
+ *   str backend, u32 device type, str file, u64 content hash, u64 size
+ *   u32 dependency count, { str file, u64 content hash, u64 size }
+ *   u32 param count, { param }
+ *   u32 technique count, { str name, u32 pass count, { str name,
+ *       vertex shader, pixel shader } }
+ *
+ *   param:  str name, u32 type, u32 size, default value,
+ *           u32 annotation count, { param }
+ *   shader: str code, u32 param count, { str param name }
+ *
+ * Bump EFFECT_CACHE_VERSION whenever the layout or the code generated by
+ * the effect parser changes.
+ */
+
+#define EFFECT_CACHE_MAGIC 0x43584647 /* "GFXC" */
+#define EFFECT_CACHE_VERSION 1
+#define EFFECT_CACHE_EXT ".effect-cache"
+
+extern const char *gs_preprocessor_name(void);
+
+/* malloc'd rather than bmalloc'd: it is process-wide and outlives the
+ * graphics subsystem, so it would show up as a leak on shutdown */
+static pthread_mutex_t cache_path_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char *cache_path = NULL;
+
+void gs_effect_set_cache_path(const char *path)
+{
+	char *new_path = NULL;
+
+	if (path && *path) {
+		size_t len = strlen(path);
+		new_path = malloc(len + 1);
+		if (new_path)
+			memcpy(new_path, path, len + 1);
+		os_mkdirs(path);
+	}
+
+	pthread_mutex_lock(&cache_path_mutex);
+	free(cache_path);
+	cache_path = new_path;
+	pthread_mutex_unlock(&cache_path_mutex);
+}
+
+bool effect_cache_enabled(void)
+{
+	bool enabled;
+
+	pthread_mutex_lock(&cache_path_mutex);
+	enabled = cache_path != NULL;
+	pthread_mutex_unlock(&cache_path_mutex);
+	return enabled;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* FNV-1a */
+static inline uint64_t hash_data(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+#define HASH_INIT 0xcbf29ce484222325ULL
+
+static inline uint64_t hash_str(uint64_t hash, const char *str)
+{
+	return hash_data(hash, str, strlen(str) + 1);
+}
+
+static inline const char *backend_name(void)
+{
+	const char *name = gs_preprocessor_name();
+	return name ? name : "";
+}
+
+static bool get_entry_path(struct dstr *path, uint64_t content_hash, const char *file)
+{
+	uint32_t version = EFFECT_CACHE_VERSION;
+	int32_t device_type = gs_get_device_type();
+	uint64_t key = HASH_INIT;
+
+	key = hash_data(key, &version, sizeof(version));
+	key = hash_str(key, backend_name());
+	key = hash_data(key, &device_type, sizeof(device_type));
+	key = hash_str(key, file);
+	key = hash_data(key, &content_hash, sizeof(content_hash));
+
+	pthread_mutex_lock(&cache_path_mutex);
+	if (cache_path)
+		dstr_printf(path, "%s/%016" PRIx64 EFFECT_CACHE_EXT, cache_path, key);
+	pthread_mutex_unlock(&cache_path_mutex);
+
+	return !dstr_is_empty(path);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline void w_str(struct serializer *s, const char *str)
+{
+	size_t len = str ? strlen(str) : 0;
+	s_wl32(s, (uint32_t)len);
+	s_write(s, str, len);
+}
+
+static inline void w_content(struct serializer *s, const char *file, const char *content)
+{
+	size_t size = content ? strlen(content) : 0;
+	w_str(s, file);
+	s_wl64(s, hash_data(HASH_INIT, content, size));
+	s_wl64(s, size);
+}
+
+static void w_param(struct serializer *s, const struct gs_effect_param *param)
+{
+	w_str(s, param->name);
+	s_wl32(s, (uint32_t)param->type);
+	s_wl32(s, (uint32_t)param->default_val.num);
+	s_write(s, param->default_val.array, param->default_val.num);
+
+	s_wl32(s, (uint32_t)param->annotations.num);
+	for (size_t i = 0; i < param->annotations.num; i++)
+		w_param(s, param->annotations.array + i);
+}
+
+static bool w_shader(struct serializer *s, const struct dstr *code, const pass_shaderparam_array_t *params)
+{
+	w_str(s, code->array);
+	s_wl32(s, (uint32_t)params->num);
+
+	for (size_t i = 0; i < params->num; i++) {
+		const struct gs_effect_param *eparam = params->array[i].eparam;
+		if (!eparam)
+			return false;
+		w_str(s, eparam->name);
+	}
+
+	return true;
+}
+
+static bool w_effect(struct serializer *s, const gs_effect_t *effect, const struct effect_parser *ep)
+{
+	const struct dstr *code = ep->shader_strings.array;
+	size_t num_passes = 0;
+
+	for (size_t i = 0; i < effect->techniques.num; i++)
+		num_passes += effect->techniques.array[i].passes.num;
+	if (ep->shader_strings.num != num_passes * 2)
+		return false;
+
+	s_wl32(s, (uint32_t)effect->params.num);
+	for (size_t i = 0; i < effect->params.num; i++)
+		w_param(s, effect->params.array + i);
+
+	s_wl32(s, (uint32_t)effect->techniques.num);
+	for (size_t i = 0; i < effect->techniques.num; i++) {
+		const struct gs_effect_technique *tech = effect->techniques.array + i;
+
+		w_str(s, tech->name);
+		s_wl32(s, (uint32_t)tech->passes.num);
+
+		for (size_t j = 0; j < tech->passes.num; j++) {
+			const struct gs_effect_pass *pass = tech->passes.array + j;
+
+			w_str(s, pass->name);
+			if (!w_shader(s, code++, &pass->vertshader_params) ||
+			    !w_shader(s, code++, &pass->pixelshader_params))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+void effect_cache_store(const gs_effect_t *effect, const struct effect_parser *ep, const char *effect_string,
+			const char *file)
+{
+	const struct cf_preprocessor *pp = &ep->cfp.pp;
+	struct array_output_data payload;
+	struct array_output_data entry;
+	struct serializer s;
+	struct dstr path = {0};
+
+	if (!file || !ep->keep_shader_strings)
+		return;
+
+	array_output_serializer_init(&s, &payload);
+	w_str(&s, backend_name());
+	s_wl32(&s, (uint32_t)gs_get_device_type());
+	w_content(&s, file, effect_string);
+
+	s_wl32(&s, (uint32_t)pp->dependencies.num);
+	for (size_t i = 0; i < pp->dependencies.num; i++) {
+		const struct cf_lexer *dep = pp->dependencies.array + i;
+		w_content(&s, dep->file, dep->base_lexer.text);
+	}
+
+	if (!w_effect(&s, effect, ep)) {
+		blog(LOG_DEBUG, "Effect '%s' cannot be cached", file);
+		goto exit;
+	}
+
+	array_output_serializer_init(&s, &entry);
+	s_wl32(&s, EFFECT_CACHE_MAGIC);
+	s_wl32(&s, EFFECT_CACHE_VERSION);
+	s_wl64(&s, hash_data(HASH_INIT, payload.bytes.array, payload.bytes.num));
+	s_write(&s, payload.bytes.array, payload.bytes.num);
+
+	if (get_entry_path(&path, hash_data(HASH_INIT, effect_string, strlen(effect_string)), file) &&
+	    !os_quick_write_utf8_file_safe(path.array, (const char *)entry.bytes.array, entry.bytes.num, false, "tmp",
+					   NULL))
+		blog(LOG_WARNING, "Failed to write effect cache '%s'", path.array);
+
+	array_output_serializer_free(&entry);
+	dstr_free(&path);
+exit:
+	array_output_serializer_free(&payload);
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct cache_reader {
+	const uint8_t *data;
+	size_t size;
+	size_t pos;
+	bool error;
+};
+
+static inline const uint8_t *r_bytes(struct cache_reader *r, size_t size)
+{
+	const uint8_t *bytes = r->data + r->pos;
+
+	if (r->error || size > r->size - r->pos) {
+		r->error = true;
+		return NULL;
+	}
+
+	r->pos += size;
+	return bytes;
+}
+
+static inline uint32_t r_u32(struct cache_reader *r)
+{
+	const uint8_t *b = r_bytes(r, 4);
+	return b ? (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24) : 0;
+}
+
+static inline uint64_t r_u64(struct cache_reader *r)
+{
+	uint64_t lo = r_u32(r);
+	uint64_t hi = r_u32(r);
+	return lo | (hi << 32);
+}
+
+/* item counts are checked against the bytes left so that a bad count cannot
+ * make us allocate much */
+static inline uint32_t r_count(struct cache_reader *r)
+{
+	uint32_t count = r_u32(r);
+	if ((size_t)count > (r->size - r->pos) / 4) {
+		r->error = true;
+		return 0;
+	}
+	return count;
+}
+
+static inline char *r_str(struct cache_reader *r)
+{
+	uint32_t len = r_u32(r);
+	const uint8_t *str = r_bytes(r, len);
+	return str ? bstrdup_n((const char *)str, len) : NULL;
+}
+
+static inline bool r_str_is(struct cache_reader *r, const char *expected)
+{
+	uint32_t len = r_u32(r);
+	const uint8_t *str = r_bytes(r, len);
+	return str && len == strlen(expected) && memcmp(str, expected, len) == 0;
+}
+
+static bool r_content_matches(struct cache_reader *r, const char *content)
+{
+	size_t size = content ? strlen(content) : 0;
+	uint64_t hash = r_u64(r);
+	return r_u64(r) == size && hash == hash_data(HASH_INIT, content, size) && !r->error;
+}
+
+/* Included files are not part of the key; re-read and compare them */
+static bool r_dependencies_match(struct cache_reader *r)
+{
+	uint32_t count = r_count(r);
+
+	for (uint32_t i = 0; i < count; i++) {
+		char *file = r_str(r);
+		char *content = file ? os_quick_read_utf8_file(file) : NULL;
+		bool match = content && r_content_matches(r, content);
+
+		bfree(content);
+		bfree(file);
+
+		if (!match)
+			return false;
+	}
+
+	return !r->error;
+}
+
+static bool r_param(struct cache_reader *r, gs_effect_t *effect, struct gs_effect_param *param,
+		    enum effect_section section)
+{
+	uint32_t size;
+	const uint8_t *default_val;
+
+	param->name = r_str(r);
+	param->section = section;
+	param->effect = effect;
+	param->type = (enum gs_shader_param_type)r_u32(r);
+
+	size = r_u32(r);
+	default_val = r_bytes(r, size);
+	if (default_val)
+		da_push_back_array(param->default_val, default_val, size);
+
+	da_resize(param->annotations, r_count(r));
+	if (param->annotations.num && section != EFFECT_PARAM)
+		return false;
+
+	for (size_t i = 0; i < param->annotations.num; i++) {
+		if (!r_param(r, effect, param->annotations.array + i, EFFECT_ANNOTATION))
+			return false;
+	}
+
+	return !r->error;
+}
+
+static bool r_shader(struct cache_reader *r, gs_effect_t *effect, struct gs_effect_technique *tech,
+		     struct gs_effect_pass *pass, size_t pass_idx, enum gs_shader_type type)
+{
+	pass_shaderparam_array_t *params;
+	gs_shader_t *shader = NULL;
+	struct dstr location = {0};
+	char *errors = NULL;
+	char *code;
+
+	code = r_str(r);
+	if (!code)
+		return false;
+
+	/* same location as the effect parser gives it, for backend messages */
+	dstr_printf(&location, "%s (%s shader, technique %s, pass %u)", effect->effect_path,
+		    type == GS_SHADER_VERTEX ? "Vertex" : "Pixel", tech->name, (unsigned)pass_idx);
+
+	if (type == GS_SHADER_VERTEX) {
+		shader = pass->vertshader = gs_vertexshader_create(code, location.array, &errors);
+		params = &pass->vertshader_params;
+	} else {
+		shader = pass->pixelshader = gs_pixelshader_create(code, location.array, &errors);
+		params = &pass->pixelshader_params;
+	}
+
+	if (errors && *errors)
+		blog(LOG_WARNING, "Error creating shader from effect cache: %s", errors);
+
+	bfree(errors);
+	bfree(code);
+	dstr_free(&location);
+
+	if (!shader)
+		return false;
+
+	da_resize(*params, r_count(r));
+	for (size_t i = 0; i < params->num; i++) {
+		struct pass_shaderparam *param = params->array + i;
+		char *name = r_str(r);
+
+		if (name) {
+			param->eparam = gs_effect_get_param_by_name(effect, name);
+			param->sparam = gs_shader_get_param_by_name(shader, name);
+		}
+
+		bfree(name);
+
+		if (!param->eparam || !param->sparam)
+			return false;
+	}
+
+	return !r->error;
+}
+
+static bool r_effect(struct cache_reader *r, gs_effect_t *effect)
+{
+	da_resize(effect->params, r_count(r));
+	for (size_t i = 0; i < effect->params.num; i++) {
+		struct gs_effect_param *param = effect->params.array + i;
+
+		if (!r_param(r, effect, param, EFFECT_PARAM))
+			return false;
+
+		if (strcmp(param->name, "ViewProj") == 0)
+			effect->view_proj = param;
+		else if (strcmp(param->name, "World") == 0)
+			effect->world = param;
+	}
+
+	da_resize(effect->techniques, r_count(r));
+	for (size_t i = 0; i < effect->techniques.num; i++) {
+		struct gs_effect_technique *tech = effect->techniques.array + i;
+
+		tech->name = r_str(r);
+		tech->section = EFFECT_TECHNIQUE;
+		tech->effect = effect;
+		if (!tech->name)
+			return false;
+
+		da_resize(tech->passes, r_count(r));
+		for (size_t j = 0; j < tech->passes.num; j++) {
+			struct gs_effect_pass *pass = tech->passes.array + j;
+
+			pass->name = r_str(r);
+			pass->section = EFFECT_PASS;
+
+			if (!r_shader(r, effect, tech, pass, j, GS_SHADER_VERTEX) ||
+			    !r_shader(r, effect, tech, pass, j, GS_SHADER_PIXEL))
+				return false;
+		}
+	}
+
+	return !r->error && r->pos == r->size;
+}
+
+static uint8_t *read_entry(const char *path, size_t *size)
+{
+	FILE *file = os_fopen(path, "rb");
+	uint8_t *data = NULL;
+	int64_t file_size;
+
+	if (!file)
+		return NULL;
+
+	file_size = os_fgetsize(file);
+	if (file_size > 0) {
+		data = bmalloc((size_t)file_size);
+		*size = fread(data, 1, (size_t)file_size, file);
+		if (*size != (size_t)file_size) {
+			bfree(data);
+			data = NULL;
+		}
+	}
+
+	fclose(file);
+	return data;
+}
+
+static inline void reset_effect(gs_effect_t *effect)
+{
+	for (size_t i = 0; i < effect->params.num; i++)
+		effect_param_free(effect->params.array + i);
+	for (size_t i = 0; i < effect->techniques.num; i++)
+		effect_technique_free(effect->techniques.array + i);
+
+	da_free(effect->params);
+	da_free(effect->techniques);
+	effect->view_proj = NULL;
+	effect->world = NULL;
+}
+
+bool effect_cache_load(gs_effect_t *effect, const char *effect_string, const char *file)
+{
+	uint64_t content_hash, checksum;
+	struct cache_reader r = {0};
+	struct dstr path = {0};
+	uint8_t *data = NULL;
+	bool success = false;
+
+	if (!file)
+		return false;
+
+	content_hash = hash_data(HASH_INIT, effect_string, strlen(effect_string));
+	if (!get_entry_path(&path, content_hash, file))
+		return false;
+
+	data = read_entry(path.array, &r.size);
+	if (!data)
+		goto exit;
+
+	r.data = data;
+	if (r_u32(&r) != EFFECT_CACHE_MAGIC || r_u32(&r) != EFFECT_CACHE_VERSION)
+		goto exit;
+
+	checksum = r_u64(&r);
+	if (r.error || checksum != hash_data(HASH_INIT, data + r.pos, r.size - r.pos))
+		goto exit;
+
+	if (!r_str_is(&r, backend_name()) || r_u32(&r) != (uint32_t)gs_get_device_type() || !r_str_is(&r, file) ||
+	    !r_content_matches(&r, effect_string) || !r_dependencies_match(&r))
+		goto exit;
+
+	success = r_effect(&r, effect);
+	if (!success) {
+		blog(LOG_WARNING, "Effect cache '%s' of '%s' is invalid", path.array, file);
+		reset_effect(effect);
+	}
+
+exit:
+	bfree(data);
+	dstr_free(&path);
+	return success;
+}
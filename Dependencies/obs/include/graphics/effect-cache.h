@@ -0,0 +1,40 @@
+#pragma once
+
+#include "effect-parser.h"
+#include "effect.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * On-disk cache of parsed effects (see gs_effect_set_cache_path).
+ *
+ * An entry holds what the effect parser produces for one effect file: the
+ * parameters with their default values and annotations, the techniques and
+ * passes, and the generated code and parameter list of every pass shader.
+ * Loading it rebuilds the effect and hands the stored shader code straight to
+ * the graphics backend, without lexing, preprocessing or parsing.
+ *
+ * Entries are keyed by a hash of the file path, the file contents, the
+ * graphics backend and the cache format.  Files pulled in with #include are
+ * recorded with their content hash and checked on load, and every entry
+ * carries a checksum, so stale or damaged entries are ignored and
+ * overwritten.
+ */
+
+/* Whether a cache path is set */
+extern bool effect_cache_enabled(void);
+
+/* Fills an empty effect from its cache entry.  Returns false, leaving the
+ * effect empty, if there is no valid entry. */
+extern bool effect_cache_load(gs_effect_t *effect, const char *effect_string, const char *file);
+
+/* Writes the cache entry of an effect just parsed by ep with
+ * keep_shader_strings set */
+extern void effect_cache_store(const gs_effect_t *effect, const struct effect_parser *ep, const char *effect_string,
+			       const char *file);
+
+#ifdef __cplusplus
+}
+#endif
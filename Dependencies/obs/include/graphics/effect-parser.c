@@ -68,6 +68,8 @@ void ep_free(struct effect_parser *ep)
 		ep_sampler_free(ep->samplers.array + i);
 	for (i = 0; i < ep->techniques.num; i++)
 		ep_technique_free(ep->techniques.array + i);
+	for (i = 0; i < ep->shader_strings.num; i++)
+		dstr_free(ep->shader_strings.array + i);
 
 	ep->cur_pass = NULL;
 	cf_parser_free(&ep->cfp);
@@ -76,6 +78,7 @@ void ep_free(struct effect_parser *ep)
 	da_free(ep->funcs);
 	da_free(ep->samplers);
 	da_free(ep->techniques);
+	da_free(ep->shader_strings);
 }
 
 static inline struct ep_func *ep_getfunc(struct effect_parser *ep, const char *name)
@@ -1867,7 +1870,11 @@ static inline bool ep_compile_pass_shader(struct effect_parser *ep, struct gs_ef
 	dstr_free(&location);
 	dstr_array_free(used_params.array, used_params.num);
 	da_free(used_params);
-	dstr_free(&shader_str);
+
+	if (ep->keep_shader_strings)
+		da_push_back(ep->shader_strings, &shader_str);
+	else
+		dstr_free(&shader_str);
 
 	return success;
 }
@@ -264,6 +264,11 @@ struct effect_parser {
 	cf_token_array_t tokens;
 	struct gs_effect_pass *cur_pass;
 
+	/* generated shader code of every pass (vertex, pixel), kept for the
+	 * effect cache when set */
+	bool keep_shader_strings;
+	DARRAY(struct dstr) shader_strings;
+
 	struct cf_parser cfp;
 };
 
@@ -276,7 +281,9 @@ static inline void ep_init(struct effect_parser *ep)
 	da_init(ep->techniques);
 	da_init(ep->files);
 	da_init(ep->tokens);
+	da_init(ep->shader_strings);
 
+	ep->keep_shader_strings = false;
 	ep->cur_pass = NULL;
 	cf_parser_init(&ep->cfp);
 }
@@ -26,6 +26,7 @@
 #include "quat.h"
 #include "axisang.h"
 #include "effect-parser.h"
+#include "effect-cache.h"
 #include "effect.h"
 
 #ifdef near
@@ -814,7 +815,16 @@ gs_effect_t *gs_effect_create(const char *effect_string, const char *filename, c
 	effect->effect_path = bstrdup(filename);
 
 	ep_init(&parser);
-	success = ep_parse(&parser, effect, effect_string, filename);
+
+	if (effect_cache_load(effect, effect_string, filename)) {
+		success = true;
+	} else {
+		parser.keep_shader_strings = filename && effect_cache_enabled();
+		success = ep_parse(&parser, effect, effect_string, filename);
+		if (success)
+			effect_cache_store(effect, &parser, effect_string, filename);
+	}
+
 	if (!success) {
 		if (error_string)
 			*error_string = error_data_buildstring(&parser.cfp.error_list);
@@ -548,6 +548,12 @@ EXPORT gs_effect_t *gs_get_effect(void);
 EXPORT gs_effect_t *gs_effect_create_from_file(const char *file, char **error_string);
 EXPORT gs_effect_t *gs_effect_create(const char *effect_string, const char *filename, char **error_string);
 
+/** Caches parsed effect files in the given directory, keyed by file contents
+ * and graphics backend, so that later runs skip lexing and parsing them.
+ * NULL (the default) disables the cache.  Set before obs_reset_video to cover
+ * the libobs effects. */
+EXPORT void gs_effect_set_cache_path(const char *path);
+
 EXPORT gs_shader_t *gs_vertexshader_create_from_file(const char *file, char **error_string);
 EXPORT gs_shader_t *gs_pixelshader_create_from_file(const char *file, char **error_string);
 
@@ -26,6 +26,7 @@
 #include "../util/util_uint64.h"
 
 #include "audio-io.h"
+#include "audio-math.h"
 #include "audio-resampler.h"
 
 #ifdef _WIN32
@@ -140,20 +141,9 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 		if (!mix->inputs.num)
 			continue;
 
-		for (size_t plane = 0; plane < audio->planes; plane++) {
-			float *mix_data = mix->buffer[plane];
-			float *mix_end = &mix_data[float_size];
-			/* Unclamped mix is copied directly. */
-			memcpy(mix->buffer_unclamped[plane], mix_data, bytes);
-
-			while (mix_data < mix_end) {
-				float val = *mix_data;
-				val = (val == val) ? val : 0.0f;
-				val = (val > 1.0f) ? 1.0f : val;
-				val = (val < -1.0f) ? -1.0f : val;
-				*(mix_data++) = val;
-			}
-		}
+		/* the unclamped mix is copied out in the same pass */
+		for (size_t plane = 0; plane < audio->planes; plane++)
+			copy_clamp_float_samples(mix->buffer[plane], mix->buffer_unclamped[plane], float_size);
 	}
 }
 
@@ -18,6 +18,7 @@
 #pragma once
 
 #include "../util/c99defs.h"
+#include "../util/sse-intrin.h"
 #include <math.h>
 
 #ifdef _MSC_VER
@@ -41,3 +42,58 @@ static inline float db_to_mul(const float db)
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
+
+/* dst[i] += src[i], 16 floats per iteration; no alignment requirements */
+static inline void mix_float_samples(float *dst, const float *src, size_t count)
+{
+	const size_t vec_count = count & ~(size_t)15;
+	size_t i = 0;
+
+	for (; i < vec_count; i += 16) {
+		__m128 d0 = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i));
+		__m128 d1 = _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_loadu_ps(src + i + 4));
+		__m128 d2 = _mm_add_ps(_mm_loadu_ps(dst + i + 8), _mm_loadu_ps(src + i + 8));
+		__m128 d3 = _mm_add_ps(_mm_loadu_ps(dst + i + 12), _mm_loadu_ps(src + i + 12));
+		_mm_storeu_ps(dst + i, d0);
+		_mm_storeu_ps(dst + i + 4, d1);
+		_mm_storeu_ps(dst + i + 8, d2);
+		_mm_storeu_ps(dst + i + 12, d3);
+	}
+
+	for (; i < count; i++)
+		dst[i] += src[i];
+}
+
+static inline __m128 clamp_float_vec(__m128 val)
+{
+	/* NaN compares unordered with itself, mask it to 0 first */
+	val = _mm_and_ps(val, _mm_cmpord_ps(val, val));
+	val = _mm_min_ps(val, _mm_set1_ps(1.0f));
+	return _mm_max_ps(val, _mm_set1_ps(-1.0f));
+}
+
+/* Copies samples to unclamped, then clamps them in place to -1.0..1.0 with
+ * NaN replaced by 0, in a single pass over the data. */
+static inline void copy_clamp_float_samples(float *samples, float *unclamped, size_t count)
+{
+	const size_t vec_count = count & ~(size_t)7;
+	size_t i = 0;
+
+	for (; i < vec_count; i += 8) {
+		__m128 v0 = _mm_loadu_ps(samples + i);
+		__m128 v1 = _mm_loadu_ps(samples + i + 4);
+		_mm_storeu_ps(unclamped + i, v0);
+		_mm_storeu_ps(unclamped + i + 4, v1);
+		_mm_storeu_ps(samples + i, clamp_float_vec(v0));
+		_mm_storeu_ps(samples + i + 4, clamp_float_vec(v1));
+	}
+
+	for (; i < count; i++) {
+		float val = samples[i];
+		unclamped[i] = val;
+		val = (val == val) ? val : 0.0f;
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		samples[i] = val;
+	}
+}
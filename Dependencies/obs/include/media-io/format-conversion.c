@@ -17,7 +17,25 @@
 
 #include "format-conversion.h"
 
+/* the wide intrinsics go first, simde's native aliases would otherwise
+ * clash with their declarations */
+#if defined(__x86_64__) || (defined(_M_X64) && !defined(_M_ARM64EC))
+#define HAVE_WIDE_KERNELS 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define TARGET_AVX2
+#define TARGET_AVX512
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw")))
+#endif
+#endif
+
 #include "../util/sse-intrin.h"
+#include "../util/threading.h"
+
+#include <math.h>
 
 /* ...surprisingly, if I don't use a macro to force inlining, it causes the
  * CPU usage to boost by a tremendous amount in debug builds. */
@@ -77,6 +95,391 @@ static FORCE_INLINE uint32_t min_uint32(uint32_t a, uint32_t b)
 	return a < b ? a : b;
 }
 
+/* ------------------------------------------------------------------------- */
+/* Wider kernels
+ *
+ * Each one handles a single row (or row pair) as far as its vector width
+ * allows and returns how far it got; the SSE2/scalar loops below finish the
+ * rest of the row.  Results are bit-identical to the SSE2/scalar versions. */
+
+typedef uint32_t (*compress_i420_row_t)(const uint8_t *img, uint32_t in_linesize, uint8_t *lum, uint32_t lum_linesize,
+					uint8_t *u, uint8_t *v, uint32_t width);
+typedef uint32_t (*compress_nv12_row_t)(const uint8_t *img, uint32_t in_linesize, uint8_t *lum, uint32_t lum_linesize,
+					uint8_t *uv, uint32_t width);
+typedef uint32_t (*convert_i444_row_t)(const uint8_t *img, uint32_t in_linesize, uint8_t *lum, uint8_t *u, uint8_t *v,
+				       uint32_t out_linesize, uint32_t width);
+typedef uint32_t (*decompress_420_row_t)(const uint8_t *lum0, const uint8_t *lum1, const uint8_t *chroma0,
+					 const uint8_t *chroma1, uint32_t *output0, uint32_t *output1,
+					 uint32_t width_d2);
+typedef uint32_t (*decompress_nv12_row_t)(const uint8_t *lum0, const uint8_t *lum1, const uint16_t *chroma,
+					  uint32_t *output0, uint32_t *output1, uint32_t width_d2);
+
+struct wide_kernels {
+	compress_i420_row_t compress_i420;
+	compress_nv12_row_t compress_nv12;
+	convert_i444_row_t convert_i444;
+	decompress_420_row_t decompress_420;
+	decompress_nv12_row_t decompress_nv12;
+};
+
+static const struct wide_kernels sse2_kernels = {0};
+
+#ifdef HAVE_WIDE_KERNELS
+
+/* picks byte n of every pixel into the first dword of each 128-bit lane */
+#define pixel_byte_shuffle(n)                                                                                       \
+	_mm_setr_epi8(n, n + 4, n + 8, n + 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)
+
+/* ---------------------------- AVX2, 8 pixels ----------------------------- */
+
+/* gathers byte n of 8 pixels of both lines: row 1 in the low 8 bytes, row 2
+ * in the high 8 bytes */
+TARGET_AVX2 static inline __m128i gather_plane_avx2(__m256i line1, __m256i line2, __m256i shuf)
+{
+	const __m256i lane_idx = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	__m256i val = _mm256_unpacklo_epi32(_mm256_shuffle_epi8(line1, shuf), _mm256_shuffle_epi8(line2, shuf));
+	return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(val, lane_idx));
+}
+
+TARGET_AVX2 static inline void store_rows_avx2(uint8_t *row0, uint8_t *row1, __m128i val)
+{
+	_mm_storel_epi64((__m128i *)row0, val);
+	_mm_storel_epi64((__m128i *)row1, _mm_unpackhi_epi64(val, val));
+}
+
+/* 2x2 chroma average, truncated like pack_ch_*; the shuffle selects the order
+ * of the four U/V results of each lane */
+TARGET_AVX2 static inline __m128i average_chroma_avx2(__m256i line1, __m256i line2, __m256i shuf)
+{
+	const __m256i uv_mask = _mm256_set1_epi16(0x00FF);
+	const __m256i lane_idx = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	__m256i sum = _mm256_add_epi16(_mm256_and_si256(line1, uv_mask), _mm256_and_si256(line2, uv_mask));
+	sum = _mm256_add_epi16(sum, _mm256_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	sum = _mm256_srli_epi16(sum, 2);
+	sum = _mm256_shuffle_epi8(sum, shuf);
+	return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(sum, lane_idx));
+}
+
+TARGET_AVX2 static uint32_t compress_i420_row_avx2(const uint8_t *img, uint32_t in_linesize, uint8_t *lum,
+						   uint32_t lum_linesize, uint8_t *u, uint8_t *v, uint32_t width)
+{
+	const __m256i lum_shuf = _mm256_broadcastsi128_si256(pixel_byte_shuffle(1));
+	const __m256i chroma_shuf = _mm256_broadcastsi128_si256(
+		_mm_setr_epi8(0, 8, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+	const __m128i split_uv = _mm_setr_epi8(0, 1, 4, 5, 2, 3, 6, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+	uint32_t wide_width = width & ~7U;
+
+	for (uint32_t x = 0; x < wide_width; x += 8) {
+		__m256i line1 = _mm256_loadu_si256((const __m256i *)(img + x * 4));
+		__m256i line2 = _mm256_loadu_si256((const __m256i *)(img + x * 4 + in_linesize));
+
+		store_rows_avx2(lum + x, lum + x + lum_linesize, gather_plane_avx2(line1, line2, lum_shuf));
+
+		__m128i uv = _mm_shuffle_epi8(average_chroma_avx2(line1, line2, chroma_shuf), split_uv);
+		_mm_storeu_si32(u + (x >> 1), uv);
+		_mm_storeu_si32(v + (x >> 1), _mm_srli_si128(uv, 4));
+	}
+
+	return wide_width;
+}
+
+TARGET_AVX2 static uint32_t compress_nv12_row_avx2(const uint8_t *img, uint32_t in_linesize, uint8_t *lum,
+						   uint32_t lum_linesize, uint8_t *uv, uint32_t width)
+{
+	const __m256i lum_shuf = _mm256_broadcastsi128_si256(pixel_byte_shuffle(1));
+	const __m256i chroma_shuf = _mm256_broadcastsi128_si256(
+		_mm_setr_epi8(0, 2, 8, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+	uint32_t wide_width = width & ~7U;
+
+	for (uint32_t x = 0; x < wide_width; x += 8) {
+		__m256i line1 = _mm256_loadu_si256((const __m256i *)(img + x * 4));
+		__m256i line2 = _mm256_loadu_si256((const __m256i *)(img + x * 4 + in_linesize));
+
+		store_rows_avx2(lum + x, lum + x + lum_linesize, gather_plane_avx2(line1, line2, lum_shuf));
+		_mm_storel_epi64((__m128i *)(uv + x), average_chroma_avx2(line1, line2, chroma_shuf));
+	}
+
+	return wide_width;
+}
+
+TARGET_AVX2 static uint32_t convert_i444_row_avx2(const uint8_t *img, uint32_t in_linesize, uint8_t *lum, uint8_t *u,
+						  uint8_t *v, uint32_t out_linesize, uint32_t width)
+{
+	const __m256i lum_shuf = _mm256_broadcastsi128_si256(pixel_byte_shuffle(1));
+	const __m256i u_shuf = _mm256_broadcastsi128_si256(pixel_byte_shuffle(0));
+	const __m256i v_shuf = _mm256_broadcastsi128_si256(pixel_byte_shuffle(2));
+	uint32_t wide_width = width & ~7U;
+
+	for (uint32_t x = 0; x < wide_width; x += 8) {
+		__m256i line1 = _mm256_loadu_si256((const __m256i *)(img + x * 4));
+		__m256i line2 = _mm256_loadu_si256((const __m256i *)(img + x * 4 + in_linesize));
+
+		store_rows_avx2(lum + x, lum + x + out_linesize, gather_plane_avx2(line1, line2, lum_shuf));
+		store_rows_avx2(u + x, u + x + out_linesize, gather_plane_avx2(line1, line2, u_shuf));
+		store_rows_avx2(v + x, v + x + out_linesize, gather_plane_avx2(line1, line2, v_shuf));
+	}
+
+	return wide_width;
+}
+
+/* 8 chroma dwords, each repeated for the two pixels it covers */
+TARGET_AVX2 static inline void duplicate_chroma_avx2(__m256i chroma, __m256i *first, __m256i *second)
+{
+	__m256i lo = _mm256_unpacklo_epi32(chroma, chroma);
+	__m256i hi = _mm256_unpackhi_epi32(chroma, chroma);
+	*first = _mm256_permute2x128_si256(lo, hi, 0x20);
+	*second = _mm256_permute2x128_si256(lo, hi, 0x31);
+}
+
+TARGET_AVX2 static inline void store_packed_row_avx2(uint32_t *output, const uint8_t *lum, int lum_shift,
+						     __m256i chroma0, __m256i chroma1)
+{
+	__m256i lum0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)lum));
+	__m256i lum1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(lum + 8)));
+
+	if (lum_shift) {
+		lum0 = _mm256_slli_epi32(lum0, 16);
+		lum1 = _mm256_slli_epi32(lum1, 16);
+	}
+
+	_mm256_storeu_si256((__m256i *)output, _mm256_or_si256(lum0, chroma0));
+	_mm256_storeu_si256((__m256i *)(output + 8), _mm256_or_si256(lum1, chroma1));
+}
+
+TARGET_AVX2 static uint32_t decompress_420_row_avx2(const uint8_t *lum0, const uint8_t *lum1, const uint8_t *chroma0,
+						    const uint8_t *chroma1, uint32_t *output0, uint32_t *output1,
+						    uint32_t width_d2)
+{
+	uint32_t wide_width = width_d2 & ~7U;
+
+	for (uint32_t x = 0; x < wide_width; x += 8) {
+		__m256i u = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(chroma0 + x)));
+		__m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(chroma1 + x)));
+		__m256i first, second;
+
+		duplicate_chroma_avx2(_mm256_or_si256(_mm256_slli_epi32(u, 8), v), &first, &second);
+
+		store_packed_row_avx2(output0 + x * 2, lum0 + x * 2, 16, first, second);
+		store_packed_row_avx2(output1 + x * 2, lum1 + x * 2, 16, first, second);
+	}
+
+	return wide_width;
+}
+
+TARGET_AVX2 static uint32_t decompress_nv12_row_avx2(const uint8_t *lum0, const uint8_t *lum1, const uint16_t *chroma,
+						     uint32_t *output0, uint32_t *output1, uint32_t width_d2)
+{
+	uint32_t wide_width = width_d2 & ~7U;
+
+	for (uint32_t x = 0; x < wide_width; x += 8) {
+		__m256i uv = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(chroma + x)));
+		__m256i first, second;
+
+		duplicate_chroma_avx2(_mm256_slli_epi32(uv, 8), &first, &second);
+
+		store_packed_row_avx2(output0 + x * 2, lum0 + x * 2, 0, first, second);
+		store_packed_row_avx2(output1 + x * 2, lum1 + x * 2, 0, first, second);
+	}
+
+	return wide_width;
+}
+
+static const struct wide_kernels avx2_kernels = {
+	.compress_i420 = compress_i420_row_avx2,
+	.compress_nv12 = compress_nv12_row_avx2,
+	.convert_i444 = convert_i444_row_avx2,
+	.decompress_420 = decompress_420_row_avx2,
+	.decompress_nv12 = decompress_nv12_row_avx2,
+};
+
+/* -------------------------- AVX-512, 16 pixels --------------------------- */
+
+TARGET_AVX512 static inline __m256i gather_plane_avx512(__m512i line1, __m512i line2, __m512i shuf)
+{
+	const __m512i lane_idx = _mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+	__m512i val = _mm512_unpacklo_epi32(_mm512_shuffle_epi8(line1, shuf), _mm512_shuffle_epi8(line2, shuf));
+	return _mm512_castsi512_si256(_mm512_permutexvar_epi32(lane_idx, val));
+}
+
+TARGET_AVX512 static inline void store_rows_avx512(uint8_t *row0, uint8_t *row1, __m256i val)
+{
+	_mm_storeu_si128((__m128i *)row0, _mm256_castsi256_si128(val));
+	_mm_storeu_si128((__m128i *)row1, _mm256_extracti128_si256(val, 1));
+}
+
+TARGET_AVX512 static inline __m128i average_chroma_avx512(__m512i line1, __m512i line2, __m512i shuf)
+{
+	const __m512i uv_mask = _mm512_set1_epi16(0x00FF);
+	const __m512i lane_idx = _mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+
+	__m512i sum = _mm512_add_epi16(_mm512_and_si512(line1, uv_mask), _mm512_and_si512(line2, uv_mask));
+	sum = _mm512_add_epi16(sum, _mm512_shuffle_epi32(sum, (_MM_PERM_ENUM)_MM_SHUFFLE(2, 3, 0, 1)));
+	sum = _mm512_srli_epi16(sum, 2);
+	sum = _mm512_shuffle_epi8(sum, shuf);
+	return _mm512_castsi512_si128(_mm512_permutexvar_epi32(lane_idx, sum));
+}
+
+TARGET_AVX512 static uint32_t compress_i420_row_avx512(const uint8_t *img, uint32_t in_linesize, uint8_t *lum,
+						       uint32_t lum_linesize, uint8_t *u, uint8_t *v, uint32_t width)
+{
+	const __m512i lum_shuf = _mm512_broadcast_i32x4(pixel_byte_shuffle(1));
+	const __m512i chroma_shuf =
+		_mm512_broadcast_i32x4(_mm_setr_epi8(0, 8, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+	const __m128i split_uv = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+	uint32_t wide_width = width & ~15U;
+
+	for (uint32_t x = 0; x < wide_width; x += 16) {
+		__m512i line1 = _mm512_loadu_si512((const void *)(img + x * 4));
+		__m512i line2 = _mm512_loadu_si512((const void *)(img + x * 4 + in_linesize));
+
+		store_rows_avx512(lum + x, lum + x + lum_linesize, gather_plane_avx512(line1, line2, lum_shuf));
+
+		__m128i uv = _mm_shuffle_epi8(average_chroma_avx512(line1, line2, chroma_shuf), split_uv);
+		_mm_storel_epi64((__m128i *)(u + (x >> 1)), uv);
+		_mm_storel_epi64((__m128i *)(v + (x >> 1)), _mm_unpackhi_epi64(uv, uv));
+	}
+
+	return wide_width;
+}
+
+TARGET_AVX512 static uint32_t compress_nv12_row_avx512(const uint8_t *img, uint32_t in_linesize, uint8_t *lum,
+						       uint32_t lum_linesize, uint8_t *uv, uint32_t width)
+{
+	const __m512i lum_shuf = _mm512_broadcast_i32x4(pixel_byte_shuffle(1));
+	const __m512i chroma_shuf =
+		_mm512_broadcast_i32x4(_mm_setr_epi8(0, 2, 8, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+	uint32_t wide_width = width & ~15U;
+
+	for (uint32_t x = 0; x < wide_width; x += 16) {
+		__m512i line1 = _mm512_loadu_si512((const void *)(img + x * 4));
+		__m512i line2 = _mm512_loadu_si512((const void *)(img + x * 4 + in_linesize));
+
+		store_rows_avx512(lum + x, lum + x + lum_linesize, gather_plane_avx512(line1, line2, lum_shuf));
+		_mm_storeu_si128((__m128i *)(uv + x), average_chroma_avx512(line1, line2, chroma_shuf));
+	}
+
+	return wide_width;
+}
+
+TARGET_AVX512 static uint32_t convert_i444_row_avx512(const uint8_t *img, uint32_t in_linesize, uint8_t *lum,
+						      uint8_t *u, uint8_t *v, uint32_t out_linesize, uint32_t width)
+{
+	const __m512i lum_shuf = _mm512_broadcast_i32x4(pixel_byte_shuffle(1));
+	const __m512i u_shuf = _mm512_broadcast_i32x4(pixel_byte_shuffle(0));
+	const __m512i v_shuf = _mm512_broadcast_i32x4(pixel_byte_shuffle(2));
+	uint32_t wide_width = width & ~15U;
+
+	for (uint32_t x = 0; x < wide_width; x += 16) {
+		__m512i line1 = _mm512_loadu_si512((const void *)(img + x * 4));
+		__m512i line2 = _mm512_loadu_si512((const void *)(img + x * 4 + in_linesize));
+
+		store_rows_avx512(lum + x, lum + x + out_linesize, gather_plane_avx512(line1, line2, lum_shuf));
+		store_rows_avx512(u + x, u + x + out_linesize, gather_plane_avx512(line1, line2, u_shuf));
+		store_rows_avx512(v + x, v + x + out_linesize, gather_plane_avx512(line1, line2, v_shuf));
+	}
+
+	return wide_width;
+}
+
+/* there are no AVX-512 decompress kernels: they are bound by their stores,
+ * and 512-bit versions measured no faster than the AVX2 ones, so those stay */
+static const struct wide_kernels avx512_kernels = {
+	.compress_i420 = compress_i420_row_avx512,
+	.compress_nv12 = compress_nv12_row_avx512,
+	.convert_i444 = convert_i444_row_avx512,
+	.decompress_420 = decompress_420_row_avx2,
+	.decompress_nv12 = decompress_nv12_row_avx2,
+};
+
+static enum format_conversion_simd detect_simd(void)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int regs[4];
+	unsigned long long xcr0;
+
+	__cpuid(regs, 0);
+	if (regs[0] < 7)
+		return FORMAT_CONVERSION_SIMD_SSE2;
+
+	/* OSXSAVE and AVX, and the OS saving the YMM state */
+	__cpuid(regs, 1);
+	if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0)
+		return FORMAT_CONVERSION_SIMD_SSE2;
+	xcr0 = _xgetbv(0);
+	if ((xcr0 & 0x6) != 0x6)
+		return FORMAT_CONVERSION_SIMD_SSE2;
+
+	__cpuidex(regs, 7, 0);
+	if ((regs[1] & (1 << 16)) && (regs[1] & (1 << 30)) && (xcr0 & 0xE6) == 0xE6)
+		return FORMAT_CONVERSION_SIMD_AVX512;
+	if (regs[1] & (1 << 5))
+		return FORMAT_CONVERSION_SIMD_AVX2;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+		return FORMAT_CONVERSION_SIMD_AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return FORMAT_CONVERSION_SIMD_AVX2;
+#endif
+	return FORMAT_CONVERSION_SIMD_SSE2;
+}
+
+#else
+
+static enum format_conversion_simd detect_simd(void)
+{
+	return FORMAT_CONVERSION_SIMD_SSE2;
+}
+
+#endif
+
+static volatile long supported_simd = FORMAT_CONVERSION_SIMD_AUTO;
+static volatile long forced_simd = FORMAT_CONVERSION_SIMD_AUTO;
+
+static enum format_conversion_simd get_supported_simd(void)
+{
+	long simd = os_atomic_load_long(&supported_simd);
+	if (simd == FORMAT_CONVERSION_SIMD_AUTO) {
+		simd = (long)detect_simd();
+		os_atomic_set_long(&supported_simd, simd);
+	}
+
+	return (enum format_conversion_simd)simd;
+}
+
+enum format_conversion_simd format_conversion_get_simd(void)
+{
+	enum format_conversion_simd supported = get_supported_simd();
+	enum format_conversion_simd forced = (enum format_conversion_simd)os_atomic_load_long(&forced_simd);
+
+	if (forced != FORMAT_CONVERSION_SIMD_AUTO && forced < supported)
+		return forced;
+	return supported;
+}
+
+void format_conversion_set_simd(enum format_conversion_simd simd)
+{
+	os_atomic_set_long(&forced_simd, (long)simd);
+}
+
+static inline const struct wide_kernels *get_wide_kernels(void)
+{
+#ifdef HAVE_WIDE_KERNELS
+	switch (format_conversion_get_simd()) {
+	case FORMAT_CONVERSION_SIMD_AVX512:
+		return &avx512_kernels;
+	case FORMAT_CONVERSION_SIMD_AVX2:
+		return &avx2_kernels;
+	default:
+		break;
+	}
+#endif
+	return &sse2_kernels;
+}
+
+/* ------------------------------------------------------------------------- */
+
 void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
 			   uint8_t *output[], const uint32_t out_linesize[])
 {
@@ -86,6 +489,8 @@ void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize, uint32_t
 	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
 	uint32_t y;
 
+	compress_i420_row_t wide_row = get_wide_kernels()->compress_i420;
+
 	__m128i lum_mask = _mm_set1_epi32(0x0000FF00);
 	__m128i uv_mask = _mm_set1_epi16(0x00FF);
 
@@ -93,9 +498,13 @@ void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize, uint32_t
 		uint32_t y_pos = y * in_linesize;
 		uint32_t chroma_y_pos = (y >> 1) * out_linesize[1];
 		uint32_t lum_y_pos = y * out_linesize[0];
-		uint32_t x;
+		uint32_t x = 0;
 
-		for (x = 0; x < width; x += 4) {
+		if (wide_row)
+			x = wide_row(input + y_pos, in_linesize, lum_plane + lum_y_pos, out_linesize[0],
+				     u_plane + chroma_y_pos, v_plane + chroma_y_pos, width);
+
+		for (; x < width; x += 4) {
 			const uint8_t *img = input + y_pos + x * 4;
 			uint32_t lum_pos0 = lum_y_pos + x;
 			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
@@ -117,6 +526,8 @@ void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize, uint32_t
 	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
 	uint32_t y;
 
+	compress_nv12_row_t wide_row = get_wide_kernels()->compress_nv12;
+
 	__m128i lum_mask = _mm_set1_epi32(0x0000FF00);
 	__m128i uv_mask = _mm_set1_epi16(0x00FF);
 
@@ -124,9 +535,13 @@ void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize, uint32_t
 		uint32_t y_pos = y * in_linesize;
 		uint32_t chroma_y_pos = (y >> 1) * out_linesize[1];
 		uint32_t lum_y_pos = y * out_linesize[0];
-		uint32_t x;
+		uint32_t x = 0;
+
+		if (wide_row)
+			x = wide_row(input + y_pos, in_linesize, lum_plane + lum_y_pos, out_linesize[0],
+				     chroma_plane + chroma_y_pos, width);
 
-		for (x = 0; x < width; x += 4) {
+		for (; x < width; x += 4) {
 			const uint8_t *img = input + y_pos + x * 4;
 			uint32_t lum_pos0 = lum_y_pos + x;
 			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
@@ -153,12 +568,18 @@ void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize, uint32_t s
 	__m128i u_mask = _mm_set1_epi32(0x000000FF);
 	__m128i v_mask = _mm_set1_epi32(0x00FF0000);
 
+	convert_i444_row_t wide_row = get_wide_kernels()->convert_i444;
+
 	for (y = start_y; y < end_y; y += 2) {
 		uint32_t y_pos = y * in_linesize;
 		uint32_t lum_y_pos = y * out_linesize[0];
-		uint32_t x;
+		uint32_t x = 0;
+
+		if (wide_row)
+			x = wide_row(input + y_pos, in_linesize, lum_plane + lum_y_pos, u_plane + lum_y_pos,
+				     v_plane + lum_y_pos, out_linesize[0], width);
 
-		for (x = 0; x < width; x += 4) {
+		for (; x < width; x += 4) {
 			const uint8_t *img = input + y_pos + x * 4;
 			uint32_t lum_pos0 = lum_y_pos + x;
 			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
@@ -181,19 +602,31 @@ void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[],
 	uint32_t height_d2 = end_y / 2;
 	uint32_t y;
 
+	decompress_420_row_t wide_row = get_wide_kernels()->decompress_420;
+
 	for (y = start_y_d2; y < height_d2; y++) {
 		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
 		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
 		register const uint8_t *lum0, *lum1;
 		register uint32_t *output0, *output1;
-		uint32_t x;
+		uint32_t x = 0;
 
 		lum0 = input[0] + y * 2 * in_linesize[0];
 		lum1 = lum0 + in_linesize[0];
 		output0 = (uint32_t *)(output + y * 2 * out_linesize);
 		output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
 
-		for (x = 0; x < width_d2; x++) {
+		if (wide_row) {
+			x = wide_row(lum0, lum1, chroma0, chroma1, output0, output1, width_d2);
+			chroma0 += x;
+			chroma1 += x;
+			lum0 += x * 2;
+			lum1 += x * 2;
+			output0 += x * 2;
+			output1 += x * 2;
+		}
+
+		for (; x < width_d2; x++) {
 			uint32_t out;
 			out = (*(chroma0++) << 8) | *(chroma1++);
 
@@ -214,11 +647,13 @@ void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
 	uint32_t height_d2 = end_y / 2;
 	uint32_t y;
 
+	decompress_nv12_row_t wide_row = get_wide_kernels()->decompress_nv12;
+
 	for (y = start_y_d2; y < height_d2; y++) {
 		const uint16_t *chroma;
 		register const uint8_t *lum0, *lum1;
 		register uint32_t *output0, *output1;
-		uint32_t x;
+		uint32_t x = 0;
 
 		chroma = (const uint16_t *)(input[1] + y * in_linesize[1]);
 		lum0 = input[0] + y * 2 * in_linesize[0];
@@ -226,7 +661,16 @@ void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
 		output0 = (uint32_t *)(output + y * 2 * out_linesize);
 		output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
 
-		for (x = 0; x < width_d2; x++) {
+		if (wide_row) {
+			x = wide_row(lum0, lum1, chroma, output0, output1, width_d2);
+			chroma += x;
+			lum0 += x * 2;
+			lum1 += x * 2;
+			output0 += x * 2;
+			output1 += x * 2;
+		}
+
+		for (; x < width_d2; x++) {
 			uint32_t out = *(chroma++) << 8;
 
 			*(output0++) = *(lum0++) | out;
@@ -286,3 +730,141 @@ void decompress_422(const uint8_t *input, uint32_t in_linesize, uint32_t start_y
 		}
 	}
 }
+
+/* ------------------------------------------------------------------------- */
+/* BGRX to YUV, used when the output is not converted on the GPU.
+ *
+ * The color matrix is applied in fixed point with 16 fractional bits.  For
+ * 4:2:0 chroma the 2x2 block is averaged first, which is what the bilinear
+ * sample in the GPU conversion shaders amounts to.  start_y/end_y must be
+ * even for the 4:2:0 formats. */
+
+#define BGRX_FRAC_BITS 16
+
+struct bgrx_row_coeffs {
+	int32_t b, g, r;
+	int32_t offset;
+};
+
+struct bgrx_coeffs {
+	struct bgrx_row_coeffs y, u, v;
+};
+
+static inline void set_bgrx_row_coeffs(struct bgrx_row_coeffs *row, const float *m)
+{
+	const double scale = (double)(1 << BGRX_FRAC_BITS);
+
+	row->r = (int32_t)floor(m[0] * scale + 0.5);
+	row->g = (int32_t)floor(m[1] * scale + 0.5);
+	row->b = (int32_t)floor(m[2] * scale + 0.5);
+	row->offset = (int32_t)floor(m[3] * 255.0 * scale + 0.5);
+}
+
+static void init_bgrx_coeffs(struct bgrx_coeffs *coeffs, const float color_matrix[16])
+{
+	set_bgrx_row_coeffs(&coeffs->u, color_matrix);
+	set_bgrx_row_coeffs(&coeffs->y, color_matrix + 4);
+	set_bgrx_row_coeffs(&coeffs->v, color_matrix + 8);
+}
+
+static FORCE_INLINE uint8_t clamp_bgrx_sample(int32_t val)
+{
+	return (uint8_t)(val < 0 ? 0 : (val > 255 ? 255 : val));
+}
+
+/* b, g and r are sums of (1 << shift) pixels */
+static FORCE_INLINE uint8_t bgrx_apply(const struct bgrx_row_coeffs *row, int32_t b, int32_t g, int32_t r,
+				       int shift)
+{
+	const int32_t round = 1 << (BGRX_FRAC_BITS - 1);
+	int32_t val = ((row->b * b + row->g * g + row->r * r) >> shift) + row->offset + round;
+	return clamp_bgrx_sample(val >> BGRX_FRAC_BITS);
+}
+
+static void bgrx_to_luma_row(const struct bgrx_coeffs *coeffs, const uint8_t *img, uint8_t *lum, uint32_t width)
+{
+	for (uint32_t x = 0; x < width; x++) {
+		const uint8_t *px = img + x * 4;
+		lum[x] = bgrx_apply(&coeffs->y, px[0], px[1], px[2], 0);
+	}
+}
+
+/* Averages two rows into one chroma row; NV12 interleaves U and V with a
+ * pixel stride of 2, the planar formats write them to separate planes. */
+static void bgrx_to_chroma_420_row(const struct bgrx_coeffs *coeffs, const uint8_t *line1, const uint8_t *line2,
+				   uint8_t *u, uint8_t *v, uint32_t stride, uint32_t width)
+{
+	const uint32_t width_d2 = width / 2;
+
+	for (uint32_t x = 0; x < width_d2; x++) {
+		const uint8_t *p1 = line1 + x * 8;
+		const uint8_t *p2 = line2 + x * 8;
+		int32_t b = p1[0] + p1[4] + p2[0] + p2[4];
+		int32_t g = p1[1] + p1[5] + p2[1] + p2[5];
+		int32_t r = p1[2] + p1[6] + p2[2] + p2[6];
+
+		u[x * stride] = bgrx_apply(&coeffs->u, b, g, r, 2);
+		v[x * stride] = bgrx_apply(&coeffs->v, b, g, r, 2);
+	}
+}
+
+void compress_bgrx_to_i420(const uint8_t *input, uint32_t in_linesize, uint32_t width, uint32_t start_y,
+			   uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[],
+			   const float color_matrix[16])
+{
+	struct bgrx_coeffs coeffs;
+	init_bgrx_coeffs(&coeffs, color_matrix);
+
+	for (uint32_t y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + (size_t)y * in_linesize;
+		const uint8_t *line2 = line1 + in_linesize;
+		uint8_t *lum = output[0] + (size_t)y * out_linesize[0];
+		uint8_t *u = output[1] + (size_t)(y / 2) * out_linesize[1];
+		uint8_t *v = output[2] + (size_t)(y / 2) * out_linesize[2];
+
+		bgrx_to_luma_row(&coeffs, line1, lum, width);
+		bgrx_to_luma_row(&coeffs, line2, lum + out_linesize[0], width);
+		bgrx_to_chroma_420_row(&coeffs, line1, line2, u, v, 1, width);
+	}
+}
+
+void compress_bgrx_to_nv12(const uint8_t *input, uint32_t in_linesize, uint32_t width, uint32_t start_y,
+			   uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[],
+			   const float color_matrix[16])
+{
+	struct bgrx_coeffs coeffs;
+	init_bgrx_coeffs(&coeffs, color_matrix);
+
+	for (uint32_t y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + (size_t)y * in_linesize;
+		const uint8_t *line2 = line1 + in_linesize;
+		uint8_t *lum = output[0] + (size_t)y * out_linesize[0];
+		uint8_t *uv = output[1] + (size_t)(y / 2) * out_linesize[1];
+
+		bgrx_to_luma_row(&coeffs, line1, lum, width);
+		bgrx_to_luma_row(&coeffs, line2, lum + out_linesize[0], width);
+		bgrx_to_chroma_420_row(&coeffs, line1, line2, uv, uv + 1, 2, width);
+	}
+}
+
+void convert_bgrx_to_i444(const uint8_t *input, uint32_t in_linesize, uint32_t width, uint32_t start_y,
+			  uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[],
+			  const float color_matrix[16])
+{
+	struct bgrx_coeffs coeffs;
+	init_bgrx_coeffs(&coeffs, color_matrix);
+
+	for (uint32_t y = start_y; y < end_y; y++) {
+		const uint8_t *img = input + (size_t)y * in_linesize;
+		uint8_t *lum = output[0] + (size_t)y * out_linesize[0];
+		uint8_t *u = output[1] + (size_t)y * out_linesize[1];
+		uint8_t *v = output[2] + (size_t)y * out_linesize[2];
+
+		for (uint32_t x = 0; x < width; x++) {
+			const uint8_t *px = img + x * 4;
+			lum[x] = bgrx_apply(&coeffs.y, px[0], px[1], px[2], 0);
+			u[x] = bgrx_apply(&coeffs.u, px[0], px[1], px[2], 0);
+			v[x] = bgrx_apply(&coeffs.v, px[0], px[1], px[2], 0);
+		}
+	}
+}
@@ -45,6 +45,44 @@ EXPORT void decompress_420(const uint8_t *const input[], const uint32_t in_lines
 EXPORT void decompress_422(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
 			   uint8_t *output, uint32_t out_linesize, bool leading_lum);
 
+/*
+ * On x86-64 the functions above use AVX2 or AVX-512 kernels when the CPU and
+ * OS support them, picked at runtime; the SSE2 code is used otherwise and for
+ * the columns left over at the end of each row.  The decompress functions only
+ * have AVX2 kernels, and decompress_422 has none.  Forcing a level is meant for
+ * benchmarks and debugging; a level the CPU lacks falls back to the best one
+ * it has.
+ */
+
+enum format_conversion_simd {
+	FORMAT_CONVERSION_SIMD_AUTO,
+	FORMAT_CONVERSION_SIMD_SSE2,
+	FORMAT_CONVERSION_SIMD_AVX2,
+	FORMAT_CONVERSION_SIMD_AVX512,
+};
+
+EXPORT enum format_conversion_simd format_conversion_get_simd(void);
+EXPORT void format_conversion_set_simd(enum format_conversion_simd simd);
+
+/*
+ * Functions for converting 8-bit BGRX (BGRA with alpha ignored) to YUV.
+ * color_matrix is laid out like the GPU conversion matrix: rows for U, Y and
+ * V, each with an offset in the fourth column.  Rows can be converted in
+ * independent bands; for the 4:2:0 formats start_y and end_y must be even.
+ */
+
+EXPORT void compress_bgrx_to_i420(const uint8_t *input, uint32_t in_linesize, uint32_t width, uint32_t start_y,
+				  uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[],
+				  const float color_matrix[16]);
+
+EXPORT void compress_bgrx_to_nv12(const uint8_t *input, uint32_t in_linesize, uint32_t width, uint32_t start_y,
+				  uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[],
+				  const float color_matrix[16]);
+
+EXPORT void convert_bgrx_to_i444(const uint8_t *input, uint32_t in_linesize, uint32_t width, uint32_t start_y,
+				 uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[],
+				 const float color_matrix[16]);
+
 #ifdef __cplusplus
 }
 #endif
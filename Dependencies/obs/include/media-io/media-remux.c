@@ -19,18 +19,105 @@
 
 #include "../util/base.h"
 #include "../util/bmem.h"
+#include "../util/darray.h"
 #include "../util/platform.h"
+#include "../util/threading.h"
 
 #include <libavformat/avformat.h>
 #include <libavcodec/version.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
+
+/* Files are read and written through our own AVIO contexts with a large
+ * buffer: remuxing is I/O bound, and lavf's default 32 KiB requests cost
+ * throughput once several jobs share a disk */
+#define MEDIA_REMUX_IO_BUFFER_SIZE (1024 * 1024)
 
 struct media_remux_job {
 	int64_t in_size;
 	AVFormatContext *ifmt_ctx, *ofmt_ctx;
+
+	FILE *in_file, *out_file;
+	AVIOContext *in_io, *out_io;
+
+	/* streams whose packets need their timestamps rescaled; the others
+	 * are stream copied untouched */
+	bool *rescale;
 };
 
+static int file_read(void *opaque, uint8_t *buf, int size)
+{
+	size_t read = fread(buf, 1, size, opaque);
+	if (read == 0)
+		return feof((FILE *)opaque) ? AVERROR_EOF : AVERROR(EIO);
+	return (int)read;
+}
+
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+static int file_write(void *opaque, const uint8_t *buf, int size)
+#else
+static int file_write(void *opaque, uint8_t *buf, int size)
+#endif
+{
+	return fwrite(buf, 1, size, opaque) == (size_t)size ? size : AVERROR(EIO);
+}
+
+static int64_t file_seek(void *opaque, int64_t offset, int whence)
+{
+	FILE *file = opaque;
+
+	if (whence & AVSEEK_SIZE)
+		return os_fgetsize(file);
+
+	if (os_fseeki64(file, offset, whence & ~AVSEEK_FORCE) != 0)
+		return AVERROR(EIO);
+	return os_ftelli64(file);
+}
+
+static AVIOContext *open_io(FILE **file, const char *filename, bool write)
+{
+	uint8_t *buffer;
+	AVIOContext *io;
+
+	*file = os_fopen(filename, write ? "wb" : "rb");
+	if (!*file)
+		return NULL;
+
+	/* the AVIO buffer already batches the requests */
+	setvbuf(*file, NULL, _IONBF, 0);
+#if !defined(_WIN32) && defined(POSIX_FADV_SEQUENTIAL)
+	if (!write)
+		posix_fadvise(fileno(*file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	buffer = av_malloc(MEDIA_REMUX_IO_BUFFER_SIZE);
+	io = buffer ? avio_alloc_context(buffer, MEDIA_REMUX_IO_BUFFER_SIZE, write, *file, write ? NULL : file_read,
+					 write ? file_write : NULL, file_seek)
+		    : NULL;
+	if (!io) {
+		av_free(buffer);
+		fclose(*file);
+		*file = NULL;
+	}
+	return io;
+}
+
+static void close_io(FILE **file, AVIOContext **io)
+{
+	if (*io) {
+		/* lavf may have swapped the buffer for one of its own */
+		av_freep(&(*io)->buffer);
+		avio_context_free(io);
+	}
+	if (*file) {
+		fclose(*file);
+		*file = NULL;
+	}
+}
+
 static inline void init_size(media_remux_job_t job, const char *in_filename)
 {
 #ifdef _MSC_VER
@@ -45,7 +132,17 @@ static inline void init_size(media_remux_job_t job, const char *in_filename)
 
 static inline bool init_input(media_remux_job_t job, const char *in_filename)
 {
-	int ret = avformat_open_input(&job->ifmt_ctx, in_filename, NULL, NULL);
+	int ret;
+
+	job->in_io = open_io(&job->in_file, in_filename, false);
+	job->ifmt_ctx = job->in_io ? avformat_alloc_context() : NULL;
+	if (!job->ifmt_ctx) {
+		blog(LOG_ERROR, "media_remux: Could not open input file '%s'", in_filename);
+		return false;
+	}
+	job->ifmt_ctx->pb = job->in_io;
+
+	ret = avformat_open_input(&job->ifmt_ctx, in_filename, NULL, NULL);
 	if (ret < 0) {
 		blog(LOG_ERROR, "media_remux: Could not open input file '%s'", in_filename);
 		return false;
@@ -120,8 +217,9 @@ static inline bool init_output(media_remux_job_t job, const char *out_filename)
 #endif
 
 	if (!(job->ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
-		ret = avio_open(&job->ofmt_ctx->pb, out_filename, AVIO_FLAG_WRITE);
-		if (ret < 0) {
+		job->out_io = open_io(&job->out_file, out_filename, true);
+		job->ofmt_ctx->pb = job->out_io;
+		if (!job->out_io) {
 			blog(LOG_ERROR,
 			     "media_remux: Failed to open output"
 			     " file '%s'",
@@ -174,6 +272,22 @@ static inline void process_packet(AVPacket *pkt, AVStream *in_stream, AVStream *
 	pkt->pos = -1;
 }
 
+/* Timestamps only need rescaling where the muxer picked a different time base
+ * than the input stream has, which avformat_write_header() settles */
+static inline bool init_rescale(media_remux_job_t job)
+{
+	job->rescale = bzalloc(sizeof(bool) * job->ifmt_ctx->nb_streams);
+	if (!job->rescale)
+		return false;
+
+	for (unsigned i = 0; i < job->ifmt_ctx->nb_streams; i++) {
+		AVStream *in_stream = job->ifmt_ctx->streams[i];
+		AVStream *out_stream = job->ofmt_ctx->streams[i];
+		job->rescale[i] = av_cmp_q(in_stream->time_base, out_stream->time_base) != 0;
+	}
+	return true;
+}
+
 static inline int process_packets(media_remux_job_t job, media_remux_progress_callback callback, void *data)
 {
 	AVPacket pkt;
@@ -197,8 +311,18 @@ static inline int process_packets(media_remux_job_t job, media_remux_progress_ca
 			throttle = 0;
 		}
 
-		process_packet(&pkt, job->ifmt_ctx->streams[pkt.stream_index],
-			       job->ofmt_ctx->streams[pkt.stream_index]);
+		/* streams that only showed up after the header have no
+		 * output stream to go to */
+		if ((unsigned)pkt.stream_index >= job->ofmt_ctx->nb_streams) {
+			av_packet_unref(&pkt);
+			continue;
+		}
+
+		if (job->rescale[pkt.stream_index])
+			process_packet(&pkt, job->ifmt_ctx->streams[pkt.stream_index],
+				       job->ofmt_ctx->streams[pkt.stream_index]);
+		else
+			pkt.pos = -1;
 
 		ret = av_interleaved_write_frame(job->ofmt_ctx, &pkt);
 		av_packet_unref(&pkt);
@@ -232,6 +356,9 @@ bool media_remux_job_process(media_remux_job_t job, media_remux_progress_callbac
 		return success;
 	}
 
+	if (!init_rescale(job))
+		return success;
+
 	if (callback != NULL)
 		callback(data, 0.f);
 
@@ -256,11 +383,251 @@ void media_remux_job_destroy(media_remux_job_t job)
 		return;
 
 	avformat_close_input(&job->ifmt_ctx);
-
-	if (job->ofmt_ctx && !(job->ofmt_ctx->oformat->flags & AVFMT_NOFILE))
-		avio_close(job->ofmt_ctx->pb);
+	close_io(&job->in_file, &job->in_io);
 
 	avformat_free_context(job->ofmt_ctx);
+	close_io(&job->out_file, &job->out_io);
 
+	bfree(job->rescale);
 	bfree(job);
 }
+
+/* ------------------------------------------------------------------------- */
+/* Batch remuxing */
+
+struct media_remux_batch_entry {
+	char *in_filename;
+	char *out_filename;
+	int64_t in_size;
+	int64_t bytes_done;
+	bool success;
+};
+
+struct media_remux_batch {
+	DARRAY(struct media_remux_batch_entry) entries;
+	size_t max_jobs;
+
+	pthread_mutex_t mutex;
+	os_event_t *job_finished;
+	size_t next;
+	size_t active;
+	size_t done;
+	size_t failed;
+	size_t workers;
+	volatile bool cancel;
+};
+
+struct media_remux_batch_job {
+	media_remux_batch_t batch;
+	struct media_remux_batch_entry *entry;
+	bool cancelled;
+};
+
+media_remux_batch_t media_remux_batch_create(size_t max_jobs)
+{
+	media_remux_batch_t batch = bzalloc(sizeof(struct media_remux_batch));
+
+	if (pthread_mutex_init(&batch->mutex, NULL) != 0)
+		goto fail_mutex;
+	if (os_event_init(&batch->job_finished, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail_event;
+
+	batch->max_jobs = max_jobs ? max_jobs : (size_t)os_get_logical_cores();
+	if (!batch->max_jobs)
+		batch->max_jobs = 1;
+	return batch;
+
+fail_event:
+	pthread_mutex_destroy(&batch->mutex);
+fail_mutex:
+	bfree(batch);
+	return NULL;
+}
+
+void media_remux_batch_add(media_remux_batch_t batch, const char *in_filename, const char *out_filename)
+{
+	struct media_remux_batch_entry *entry;
+
+	if (!batch)
+		return;
+
+	entry = da_push_back_new(batch->entries);
+	entry->in_filename = bstrdup(in_filename);
+	entry->out_filename = bstrdup(out_filename);
+	entry->in_size = os_get_file_size(in_filename);
+	if (entry->in_size < 0)
+		entry->in_size = 0;
+}
+
+static bool batch_job_progress(void *data, float percent)
+{
+	struct media_remux_batch_job *job = data;
+	media_remux_batch_t batch = job->batch;
+
+	pthread_mutex_lock(&batch->mutex);
+	job->entry->bytes_done = (int64_t)((double)job->entry->in_size * percent / 100.0);
+	pthread_mutex_unlock(&batch->mutex);
+
+	/* a cancelled job still writes its trailer, but does not count as
+	 * remuxed */
+	job->cancelled = os_atomic_load_bool(&batch->cancel);
+	return !job->cancelled;
+}
+
+static void *batch_thread(void *param)
+{
+	media_remux_batch_t batch = param;
+
+	os_set_thread_name("media-remux-batch");
+
+	for (;;) {
+		struct media_remux_batch_job job = {batch, NULL, false};
+		media_remux_job_t remux;
+		bool success;
+
+		pthread_mutex_lock(&batch->mutex);
+		if (os_atomic_load_bool(&batch->cancel) || batch->next == batch->entries.num) {
+			pthread_mutex_unlock(&batch->mutex);
+			break;
+		}
+		job.entry = &batch->entries.array[batch->next++];
+		batch->active++;
+		pthread_mutex_unlock(&batch->mutex);
+
+		success = media_remux_job_create(&remux, job.entry->in_filename, job.entry->out_filename) &&
+			  media_remux_job_process(remux, batch_job_progress, &job) && !job.cancelled;
+		media_remux_job_destroy(remux);
+
+		if (!success && !job.cancelled)
+			blog(LOG_WARNING, "media_remux: Failed to remux '%s'", job.entry->in_filename);
+
+		pthread_mutex_lock(&batch->mutex);
+		job.entry->bytes_done = job.entry->in_size;
+		job.entry->success = success;
+		batch->active--;
+		batch->done++;
+		if (!success)
+			batch->failed++;
+		pthread_mutex_unlock(&batch->mutex);
+
+		os_event_signal(batch->job_finished);
+	}
+
+	pthread_mutex_lock(&batch->mutex);
+	batch->workers--;
+	pthread_mutex_unlock(&batch->mutex);
+	os_event_signal(batch->job_finished);
+	return NULL;
+}
+
+static bool batch_get_progress(media_remux_batch_t batch, uint64_t start_time,
+			       struct media_remux_batch_progress *progress)
+{
+	bool running;
+
+	memset(progress, 0, sizeof(*progress));
+
+	pthread_mutex_lock(&batch->mutex);
+	progress->jobs = batch->entries.num;
+	progress->jobs_done = batch->done;
+	progress->jobs_failed = batch->failed;
+	progress->jobs_active = batch->active;
+	for (size_t i = 0; i < batch->entries.num; i++) {
+		progress->bytes += batch->entries.array[i].in_size;
+		progress->bytes_done += batch->entries.array[i].bytes_done;
+	}
+	running = batch->workers > 0;
+	pthread_mutex_unlock(&batch->mutex);
+
+	if (progress->bytes)
+		progress->percent = (float)((double)progress->bytes_done / (double)progress->bytes * 100.0);
+	else
+		progress->percent = progress->jobs ? progress->jobs_done * 100.f / progress->jobs : 100.f;
+
+	progress->elapsed_sec = (double)(os_gettime_ns() - start_time) / 1000000000.0;
+	if (progress->elapsed_sec > 0.0)
+		progress->bytes_per_sec = (double)progress->bytes_done / progress->elapsed_sec;
+	return running;
+}
+
+bool media_remux_batch_process(media_remux_batch_t batch, media_remux_batch_progress_callback callback, void *data)
+{
+	struct media_remux_batch_progress progress;
+	pthread_t *threads;
+	size_t num_threads;
+	size_t started = 0;
+	uint64_t start_time;
+	bool running;
+
+	if (!batch || !batch->entries.num)
+		return false;
+
+	batch->next = 0;
+	batch->done = 0;
+	batch->failed = 0;
+	batch->cancel = false;
+	for (size_t i = 0; i < batch->entries.num; i++) {
+		batch->entries.array[i].bytes_done = 0;
+		batch->entries.array[i].success = false;
+	}
+
+	num_threads = batch->max_jobs < batch->entries.num ? batch->max_jobs : batch->entries.num;
+	threads = bzalloc(sizeof(pthread_t) * num_threads);
+	start_time = os_gettime_ns();
+
+	pthread_mutex_lock(&batch->mutex);
+	for (size_t i = 0; i < num_threads; i++) {
+		if (pthread_create(&threads[started], NULL, batch_thread, batch) != 0)
+			break;
+		started++;
+	}
+	batch->workers = started;
+	pthread_mutex_unlock(&batch->mutex);
+
+	if (!started) {
+		blog(LOG_ERROR, "media_remux: Failed to start batch threads");
+		bfree(threads);
+		return false;
+	}
+
+	blog(LOG_INFO, "media_remux: Remuxing %zu files, %zu at a time", batch->entries.num, started);
+
+	do {
+		os_event_timedwait(batch->job_finished, 250);
+		running = batch_get_progress(batch, start_time, &progress);
+
+		if (callback && !callback(data, &progress))
+			os_atomic_set_bool(&batch->cancel, true);
+	} while (running);
+
+	for (size_t i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	bfree(threads);
+
+	blog(LOG_INFO, "media_remux: Remuxed %zu of %zu files (%zu failed) in %.1f s, %.1f MiB/s",
+	     progress.jobs_done - progress.jobs_failed, progress.jobs, progress.jobs_failed, progress.elapsed_sec,
+	     progress.bytes_per_sec / (1024.0 * 1024.0));
+
+	return progress.jobs_done == progress.jobs && !progress.jobs_failed;
+}
+
+bool media_remux_batch_succeeded(media_remux_batch_t batch, size_t idx)
+{
+	return batch && idx < batch->entries.num && batch->entries.array[idx].success;
+}
+
+void media_remux_batch_destroy(media_remux_batch_t batch)
+{
+	if (!batch)
+		return;
+
+	for (size_t i = 0; i < batch->entries.num; i++) {
+		bfree(batch->entries.array[i].in_filename);
+		bfree(batch->entries.array[i].out_filename);
+	}
+	da_free(batch->entries);
+
+	os_event_destroy(batch->job_finished);
+	pthread_mutex_destroy(&batch->mutex);
+	bfree(batch);
+}
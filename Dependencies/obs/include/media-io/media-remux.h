@@ -24,6 +24,25 @@ typedef struct media_remux_job *media_remux_job_t;
 
 typedef bool(media_remux_progress_callback)(void *data, float percent);
 
+/* Batch remuxing: runs many jobs on a pool of worker threads, at most
+ * max_jobs at a time, and reports their combined progress */
+struct media_remux_batch;
+typedef struct media_remux_batch *media_remux_batch_t;
+
+struct media_remux_batch_progress {
+	size_t jobs;
+	size_t jobs_done;
+	size_t jobs_failed;
+	size_t jobs_active;
+	uint64_t bytes;
+	uint64_t bytes_done;
+	float percent;
+	double elapsed_sec;
+	double bytes_per_sec;
+};
+
+typedef bool(media_remux_batch_progress_callback)(void *data, const struct media_remux_batch_progress *progress);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -32,6 +51,17 @@ EXPORT bool media_remux_job_create(media_remux_job_t *job, const char *in_filena
 EXPORT bool media_remux_job_process(media_remux_job_t job, media_remux_progress_callback callback, void *data);
 EXPORT void media_remux_job_destroy(media_remux_job_t job);
 
+/* max_jobs 0 runs as many jobs at once as there are logical cores */
+EXPORT media_remux_batch_t media_remux_batch_create(size_t max_jobs);
+EXPORT void media_remux_batch_add(media_remux_batch_t batch, const char *in_filename, const char *out_filename);
+/* Blocks until every job has finished, calling back with the progress a few
+ * times a second on the calling thread; returning false from the callback
+ * cancels the jobs that are still running.  Returns true if all succeeded. */
+EXPORT bool media_remux_batch_process(media_remux_batch_t batch, media_remux_batch_progress_callback callback,
+				      void *data);
+EXPORT bool media_remux_batch_succeeded(media_remux_batch_t batch, size_t idx);
+EXPORT void media_remux_batch_destroy(media_remux_batch_t batch);
+
 #ifdef __cplusplus
 }
 #endif
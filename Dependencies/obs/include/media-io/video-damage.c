@@ -0,0 +1,138 @@
+#include "video-io.h"
+
+static inline uint64_t rect_area(const struct video_damage_rect *rect)
+{
+	return (uint64_t)rect->cx * (uint64_t)rect->cy;
+}
+
+static inline bool rects_overlap(const struct video_damage_rect *a, const struct video_damage_rect *b)
+{
+	return a->x < b->x + b->cx && b->x < a->x + a->cx && a->y < b->y + b->cy && b->y < a->y + a->cy;
+}
+
+static void rect_union(struct video_damage_rect *dst, const struct video_damage_rect *a,
+		       const struct video_damage_rect *b)
+{
+	uint32_t right = a->x + a->cx > b->x + b->cx ? a->x + a->cx : b->x + b->cx;
+	uint32_t bottom = a->y + a->cy > b->y + b->cy ? a->y + a->cy : b->y + b->cy;
+
+	dst->x = a->x < b->x ? a->x : b->x;
+	dst->y = a->y < b->y ? a->y : b->y;
+	dst->cx = right - dst->x;
+	dst->cy = bottom - dst->y;
+}
+
+static inline void remove_rect(struct video_damage *damage, uint32_t idx)
+{
+	damage->rects[idx] = damage->rects[--damage->num];
+}
+
+void video_damage_add(struct video_damage *damage, uint32_t x, uint32_t y, uint32_t cx, uint32_t cy)
+{
+	struct video_damage_rect rect = {x, y, cx, cy};
+
+	if (!cx || !cy)
+		return;
+
+	for (;;) {
+		/* a merged rect can overlap rects the original did not */
+		for (uint32_t i = 0; i < damage->num;) {
+			if (rects_overlap(&damage->rects[i], &rect)) {
+				rect_union(&rect, &rect, &damage->rects[i]);
+				remove_rect(damage, i);
+				i = 0;
+			} else {
+				i++;
+			}
+		}
+
+		if (damage->num < MAX_VIDEO_DAMAGE_RECTS)
+			break;
+
+		/* out of rects, merge with the one that adds the least area
+		 * that did not change */
+		uint64_t least_growth = UINT64_MAX;
+		uint32_t merge_idx = 0;
+
+		for (uint32_t i = 0; i < damage->num; i++) {
+			struct video_damage_rect merged;
+			rect_union(&merged, &rect, &damage->rects[i]);
+
+			uint64_t growth = rect_area(&merged) - rect_area(&rect) - rect_area(&damage->rects[i]);
+			if (growth < least_growth) {
+				least_growth = growth;
+				merge_idx = i;
+			}
+		}
+
+		rect_union(&rect, &rect, &damage->rects[merge_idx]);
+		remove_rect(damage, merge_idx);
+	}
+
+	damage->rects[damage->num++] = rect;
+}
+
+void video_damage_merge(struct video_damage *dst, const struct video_damage *src)
+{
+	for (uint32_t i = 0; i < src->num; i++) {
+		const struct video_damage_rect *rect = &src->rects[i];
+		video_damage_add(dst, rect->x, rect->y, rect->cx, rect->cy);
+	}
+}
+
+void video_damage_get_bounds(const struct video_damage *damage, struct video_damage_rect *bounds)
+{
+	if (!damage->num) {
+		bounds->x = bounds->y = bounds->cx = bounds->cy = 0;
+		return;
+	}
+
+	*bounds = damage->rects[0];
+	for (uint32_t i = 1; i < damage->num; i++)
+		rect_union(bounds, bounds, &damage->rects[i]);
+}
+
+uint64_t video_damage_get_area(const struct video_damage *damage)
+{
+	uint64_t area = 0;
+
+	for (uint32_t i = 0; i < damage->num; i++)
+		area += rect_area(&damage->rects[i]);
+	return area;
+}
+
+static inline uint32_t scale_floor(uint32_t val, uint32_t from, uint32_t to, uint32_t margin)
+{
+	uint64_t scaled = (uint64_t)val * to / from;
+	return scaled > margin ? (uint32_t)scaled - margin : 0;
+}
+
+static inline uint32_t scale_ceil(uint32_t val, uint32_t from, uint32_t to, uint32_t margin)
+{
+	uint64_t scaled = ((uint64_t)val * to + from - 1) / from + margin;
+	return scaled < to ? (uint32_t)scaled : to;
+}
+
+void video_damage_scale(struct video_damage *damage, uint32_t from_cx, uint32_t from_cy, uint32_t to_cx,
+			uint32_t to_cy, uint32_t margin)
+{
+	struct video_damage scaled = {0};
+
+	if (!from_cx || !from_cy || !to_cx || !to_cy) {
+		damage->num = 0;
+		return;
+	}
+
+	for (uint32_t i = 0; i < damage->num; i++) {
+		const struct video_damage_rect *rect = &damage->rects[i];
+		uint32_t left = scale_floor(rect->x, from_cx, to_cx, margin);
+		uint32_t top = scale_floor(rect->y, from_cy, to_cy, margin);
+		uint32_t right = scale_ceil(rect->x + rect->cx, from_cx, to_cx, margin);
+		uint32_t bottom = scale_ceil(rect->y + rect->cy, from_cy, to_cy, margin);
+
+		if (left < right && top < bottom)
+			video_damage_add(&scaled, left, top, right - left, bottom - top);
+	}
+
+	*damage = scaled;
+}
@@ -21,6 +21,7 @@
 #include "../util/platform.h"
 #include "../util/profiler.h"
 #include "../util/threading.h"
+#include "../util/task.h"
 #include "../util/darray.h"
 #include "../util/util_uint64.h"
 
@@ -34,13 +35,38 @@ extern profiler_name_store_t *obs_get_profiler_name_store(void);
 #define MAX_CONVERT_BUFFERS 3
 #define MAX_CACHE_SIZE 16
 
+/* Frames are handed from the producer (the graphics thread, through
+ * video_output_lock_frame/video_output_unlock_frame) to the connected inputs
+ * through a single-producer/multi-consumer ring.  Each slot carries a
+ * reference count:
+ *
+ *   -1  the producer is writing the slot
+ *    0  the slot is free to be reused
+ *   >0  that many inputs are currently reading the slot
+ *
+ * The producer only ever claims a slot with refs == 0, and readers only pin a
+ * slot that is not being written, then check that it still holds the sequence
+ * number they were looking for.  Every input runs on its own thread with its
+ * own read cursor, so a slow input only ever drops its own frames instead of
+ * stalling the producer or the other inputs. */
 struct cached_frame_info {
 	struct video_data frame;
-	int skipped;
+	volatile long refs;
+	volatile long seq;
+
+	/* first composition tick this frame covers, and how many ticks it
+	 * covers (more than one if the graphics thread lagged) */
+	uint64_t first_tick;
 	int count;
+
+	/* first tick of the picture in the slot; earlier than first_tick if
+	 * the slot was published again because the picture did not change */
+	uint64_t start_tick;
 };
 
 struct video_input {
+	struct video_output *video;
+
 	struct video_scale_info conversion;
 	video_scaler_t *scaler;
 	struct video_frame frame[MAX_CONVERT_BUFFERS];
@@ -58,33 +84,93 @@ struct video_input {
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
+
+	/* frames are read either on the input's own thread or, when the
+	 * output has a worker pool, by pool tasks; scheduled counts the frames
+	 * published since the task last caught up, so that at most one task
+	 * runs per input and frames stay in order */
+	pthread_t thread;
+	os_sem_t *update_semaphore;
+	bool thread_created;
+	volatile long scheduled;
+	const char *profile_name;
+
+	/* set under input_mutex while a thread waits for the input to go
+	 * idle, and once it has */
+	bool join_claimed;
+	bool joined;
+	volatile bool stop;
+	volatile bool exited;
+
+	/* read cursor, only touched by the input's own thread */
+	long next_seq;
+	uint64_t next_tick;
+	bool started;
+
+	/* what changed since the last frame the callback got, gathered from
+	 * the frames it skipped since; not known before its first frame or
+	 * after frames were missed */
+	struct video_damage damage;
+	bool damage_known;
+
+	/* frames the input may fall behind the producer before it jumps
+	 * ahead to the newest frame, and what it does about the ticks it
+	 * missed (enum video_input_drop_policy) */
+	volatile long max_lag;
+	volatile long drop_policy;
+	volatile long skipped_frames;
+
+	pthread_mutex_t stats_mutex;
+	uint64_t frames;
+	uint64_t scale_time_ns;
+	uint64_t max_scale_time_ns;
+	uint64_t callback_time_ns;
 };
 
+typedef DARRAY(struct video_input *) video_input_array_t;
+
 static inline void video_input_free(struct video_input *input)
 {
 	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
 		video_frame_free(&input->frame[i]);
 	video_scaler_destroy(input->scaler);
+	os_sem_destroy(input->update_semaphore);
+	pthread_mutex_destroy(&input->stats_mutex);
+	bfree(input);
 }
 
 struct video_output {
 	struct video_output_info info;
 
-	pthread_t thread;
-	pthread_mutex_t data_mutex;
 	bool stop;
 
-	os_sem_t *update_semaphore;
 	uint64_t frame_time;
 	volatile long skipped_frames;
 	volatile long total_frames;
 
+	/* most ticks any one input fell behind on since the last reset; the
+	 * ticks dropped by the producer show up in every input as well */
+	volatile long input_skipped_frames;
+
 	pthread_mutex_t input_mutex;
-	DARRAY(struct video_input) inputs;
+	video_input_array_t inputs;
 
-	size_t available_frames;
-	size_t first_added;
-	size_t last_added;
+	/* inputs that disconnected themselves from within their own callback,
+	 * or while video_output_stop was waiting on them; freed once idle */
+	video_input_array_t retired;
+
+	/* optional shared workers for the inputs, see
+	 * video_output_set_worker_threads */
+	os_task_pool_t *pool;
+
+	/* producer state, only touched by the thread locking frames */
+	size_t next_slot;
+	size_t write_slot;
+	uint64_t next_tick;
+	bool frame_written;
+
+	volatile long write_seq;
+	volatile long seq_slots[MAX_CACHE_SIZE];
 	struct cached_frame_info cache[MAX_CACHE_SIZE];
 
 	struct video_output *parent;
@@ -95,6 +181,26 @@ struct video_output {
 
 /* ------------------------------------------------------------------------- */
 
+/* sequence numbers are allowed to wrap */
+static inline long seq_diff(long a, long b)
+{
+	return (long)((unsigned long)a - (unsigned long)b);
+}
+
+static inline void atomic_add_long(volatile long *val, long add)
+{
+	long old_val = os_atomic_load_long(val);
+	while (!os_atomic_compare_exchange_long(val, &old_val, old_val + add))
+		;
+}
+
+static inline void atomic_max_long(volatile long *val, long new_val)
+{
+	long old_val = os_atomic_load_long(val);
+	while (old_val < new_val && !os_atomic_compare_exchange_long(val, &old_val, new_val))
+		;
+}
+
 static inline bool scale_video_output(struct video_input *input, struct video_data *data)
 {
 	bool success = true;
@@ -123,27 +229,79 @@ static inline bool scale_video_output(struct video_input *input, struct video_da
 	return success;
 }
 
-static inline bool video_output_cur_frame(struct video_output *video)
+static struct cached_frame_info *pin_frame(struct video_output *video, long seq)
 {
-	struct cached_frame_info *frame_info;
-	bool complete;
-	bool skipped;
+	size_t slot = (size_t)os_atomic_load_long(&video->seq_slots[(unsigned long)seq % video->info.cache_size]);
+	struct cached_frame_info *cfi = &video->cache[slot];
+	long refs = os_atomic_load_long(&cfi->refs);
 
-	/* -------------------------------- */
+	while (refs >= 0) {
+		if (os_atomic_compare_exchange_long(&cfi->refs, &refs, refs + 1)) {
+			if (os_atomic_load_long(&cfi->seq) == seq)
+				return cfi;
 
-	pthread_mutex_lock(&video->data_mutex);
+			/* slot was recycled for a newer frame */
+			os_atomic_dec_long(&cfi->refs);
+			break;
+		}
+	}
 
-	frame_info = &video->cache[video->first_added];
+	return NULL;
+}
 
-	pthread_mutex_unlock(&video->data_mutex);
+static inline void unpin_frame(struct cached_frame_info *cfi)
+{
+	os_atomic_dec_long(&cfi->refs);
+}
 
-	/* -------------------------------- */
+static inline void video_input_add_stats(struct video_input *input, uint64_t scale_time, uint64_t callback_time)
+{
+	pthread_mutex_lock(&input->stats_mutex);
+	input->frames++;
+	input->scale_time_ns += scale_time;
+	input->callback_time_ns += callback_time;
+	if (scale_time > input->max_scale_time_ns)
+		input->max_scale_time_ns = scale_time;
+	pthread_mutex_unlock(&input->stats_mutex);
+}
 
-	pthread_mutex_lock(&video->input_mutex);
+static void video_input_output_frame(struct video_input *input, const struct cached_frame_info *cfi)
+{
+	uint64_t frame_time = input->video->frame_time;
+	uint64_t end_tick = cfi->first_tick + (uint64_t)cfi->count;
+	bool new_picture = !input->started || input->next_tick <= cfi->start_tick;
+	uint64_t tick;
+
+	/* a slot published again covers the ticks of its earlier publications
+	 * too, an input that missed those gets them from this one.  ticks
+	 * before the picture were either dropped by this input or never
+	 * produced.  they are either filled by repeating this frame, so that
+	 * the callback still runs exactly once per tick, or skipped outright */
+	if (!input->started) {
+		tick = cfi->first_tick;
+		input->started = true;
+	} else if (cfi->start_tick > input->next_tick) {
+		uint64_t gap = cfi->start_tick - input->next_tick;
+		atomic_add_long(&input->skipped_frames, (long)gap);
+		atomic_max_long(&input->video->input_skipped_frames, os_atomic_load_long(&input->skipped_frames));
+		input->damage_known = false;
+
+		if (os_atomic_load_long(&input->drop_policy) == VIDEO_INPUT_DROP_SKIP) {
+			input->frame_rate_divisor_counter =
+				(uint32_t)((input->frame_rate_divisor_counter + gap) % input->frame_rate_divisor);
+			tick = cfi->start_tick;
+		} else {
+			tick = input->next_tick;
+		}
+	} else {
+		tick = input->next_tick;
+	}
 
-	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array + i;
-		struct video_data frame = frame_info->frame;
+	for (bool first = true; tick < end_tick && !input->stop; tick++, first = false) {
+		struct video_data frame = cfi->frame;
+		/* wraps around for the ticks before first_tick, which still
+		 * gives their timestamps */
+		frame.timestamp = cfi->frame.timestamp + (tick - cfi->first_tick) * frame_time;
 
 		// an explicit counter is used instead of remainder calculation
 		// to allow multiple encoders started at the same time to start on
@@ -152,68 +310,158 @@ static inline bool video_output_cur_frame(struct video_output *video)
 		if (input->frame_rate_divisor_counter == input->frame_rate_divisor)
 			input->frame_rate_divisor_counter = 0;
 
+		/* later ticks of a frame repeat its picture */
+		if (first && new_picture && !cfi->frame.repeat) {
+			if (cfi->frame.damage.num)
+				video_damage_merge(&input->damage, &cfi->frame.damage);
+			else
+				input->damage_known = false;
+		}
+
 		if (skip)
 			continue;
 
-		if (scale_video_output(input, &frame))
+		frame.repeat = input->damage_known && !input->damage.num;
+		frame.damage = input->damage;
+		if (!input->damage_known)
+			frame.damage.num = 0;
+
+		uint64_t scale_start = os_gettime_ns();
+		bool scaled = scale_video_output(input, &frame);
+		uint64_t scale_end = os_gettime_ns();
+
+		if (scaled) {
+			if (input->scaler)
+				video_damage_scale(&frame.damage, input->video->info.width, input->video->info.height,
+						   input->conversion.width, input->conversion.height, 2);
+
 			input->callback(input->param, &frame);
+			input->damage.num = 0;
+			input->damage_known = true;
+		}
+
+		video_input_add_stats(input, input->scaler ? scale_end - scale_start : 0, os_gettime_ns() - scale_end);
 	}
 
-	pthread_mutex_unlock(&video->input_mutex);
+	input->next_tick = end_tick;
+}
+
+static void video_input_process(struct video_input *input)
+{
+	struct video_output *video = input->video;
 
-	/* -------------------------------- */
+	while (!input->stop) {
+		long newest = os_atomic_load_long(&video->write_seq);
+		long pending = seq_diff(newest, input->next_seq) + 1;
+		struct cached_frame_info *cfi;
 
-	pthread_mutex_lock(&video->data_mutex);
+		if (pending <= 0)
+			break;
 
-	frame_info->frame.timestamp += video->frame_time;
-	complete = --frame_info->count == 0;
-	skipped = frame_info->skipped > 0;
+		/* frames this input jumps over show up as a tick gap in
+		 * video_input_output_frame and are counted per input there,
+		 * video->skipped_frames only counts ticks nobody got */
+		if (pending > os_atomic_load_long(&input->max_lag))
+			input->next_seq = newest;
+
+		cfi = pin_frame(video, input->next_seq);
+		if (!cfi) {
+			/* the frame was overwritten before this input got to
+			 * it, catch up with the newest one */
+			newest = os_atomic_load_long(&video->write_seq);
+			if (newest != input->next_seq)
+				input->next_seq = newest;
+
+			cfi = pin_frame(video, input->next_seq);
+			if (!cfi)
+				continue;
+		}
 
-	if (complete) {
-		if (++video->first_added == video->info.cache_size)
-			video->first_added = 0;
+		video_input_output_frame(input, cfi);
+		unpin_frame(cfi);
 
-		if (++video->available_frames == video->info.cache_size)
-			video->last_added = video->first_added;
-	} else if (skipped) {
-		--frame_info->skipped;
-		os_atomic_inc_long(&video->skipped_frames);
+		input->next_seq++;
 	}
+}
 
-	pthread_mutex_unlock(&video->data_mutex);
+/* lets video_output_disconnect tell when a callback disconnects itself */
+static THREAD_LOCAL struct video_input *current_input = NULL;
 
-	/* -------------------------------- */
+static void video_input_run(struct video_input *input)
+{
+	current_input = input;
+
+	profile_start(input->profile_name);
+	video_input_process(input);
+	profile_end(input->profile_name);
 
-	return complete;
+	profile_reenable_thread();
+
+	current_input = NULL;
 }
 
-static void *video_thread(void *param)
+static void *video_input_thread(void *param)
 {
-	struct video_output *video = param;
+	struct video_input *input = param;
+	struct video_output *video = input->video;
 
 	os_set_thread_name("video-io: video thread");
 
-	const char *video_thread_name =
-		profile_store_name(obs_get_profiler_name_store(), "video_thread(%s)", video->info.name);
-
-	while (os_sem_wait(video->update_semaphore) == 0) {
-		if (video->stop)
+	while (os_sem_wait(input->update_semaphore) == 0) {
+		if (input->stop || video->stop)
 			break;
 
-		profile_start(video_thread_name);
-		while (!video->stop && !video_output_cur_frame(video)) {
-			os_atomic_inc_long(&video->total_frames);
-		}
-
-		os_atomic_inc_long(&video->total_frames);
-		profile_end(video_thread_name);
-
-		profile_reenable_thread();
+		video_input_run(input);
 	}
 
+	os_atomic_set_bool(&input->exited, true);
 	return NULL;
 }
 
+static void video_input_task(void *param)
+{
+	struct video_input *input = param;
+	long scheduled = os_atomic_load_long(&input->scheduled);
+
+	/* keep going while frames were published during the run; once the
+	 * count drops back to zero the input may be freed at any time */
+	do {
+		if (!input->stop)
+			video_input_run(input);
+	} while (!os_atomic_compare_exchange_long(&input->scheduled, &scheduled, 0));
+}
+
+/* called with input_mutex held */
+static inline void video_input_notify(struct video_output *video, struct video_input *input)
+{
+	if (input->stop)
+		return;
+
+	if (input->thread_created)
+		os_sem_post(input->update_semaphore);
+	else if (os_atomic_inc_long(&input->scheduled) == 1)
+		os_task_pool_queue_task(video->pool, video_input_task, input);
+}
+
+static inline bool video_input_idle(struct video_input *input)
+{
+	if (input->thread_created)
+		return os_atomic_load_bool(&input->exited);
+	return os_atomic_load_long(&input->scheduled) == 0;
+}
+
+/* must only be called on stopped inputs */
+static void video_input_join(struct video_input *input)
+{
+	if (input->thread_created) {
+		void *thread_ret;
+		pthread_join(input->thread, &thread_ret);
+	} else {
+		while (!video_input_idle(input))
+			os_sleep_ms(1);
+	}
+}
+
 /* ------------------------------------------------------------------------- */
 
 static inline bool valid_video_params(const struct video_output_info *info)
@@ -225,6 +473,8 @@ static inline void init_cache(struct video_output *video)
 {
 	if (video->info.cache_size > MAX_CACHE_SIZE)
 		video->info.cache_size = MAX_CACHE_SIZE;
+	if (video->info.cache_size == 0)
+		video->info.cache_size = 1;
 
 	for (size_t i = 0; i < video->info.cache_size; i++) {
 		struct video_frame *frame;
@@ -232,8 +482,6 @@ static inline void init_cache(struct video_output *video)
 
 		video_frame_init(frame, video->info.format, video->info.width, video->info.height);
 	}
-
-	video->available_frames = video->info.cache_size;
 }
 
 int video_output_open(video_t **video, struct video_output_info *info)
@@ -250,31 +498,72 @@ int video_output_open(video_t **video, struct video_output_info *info)
 	memcpy(&out->info, info, sizeof(struct video_output_info));
 	out->frame_time = util_mul_div64(1000000000ULL, info->fps_den, info->fps_num);
 
-	if (pthread_mutex_init_recursive(&out->data_mutex) != 0)
-		goto fail0;
 	if (pthread_mutex_init_recursive(&out->input_mutex) != 0)
-		goto fail1;
-	if (os_sem_init(&out->update_semaphore, 0) != 0)
-		goto fail2;
-	if (pthread_create(&out->thread, NULL, video_thread, out) != 0)
-		goto fail3;
+		goto fail0;
 
 	init_cache(out);
 
 	*video = out;
 	return VIDEO_OUTPUT_SUCCESS;
 
-fail3:
-	os_sem_destroy(out->update_semaphore);
-fail2:
-	pthread_mutex_destroy(&out->input_mutex);
-fail1:
-	pthread_mutex_destroy(&out->data_mutex);
 fail0:
 	bfree(out);
 	return VIDEO_OUTPUT_FAIL;
 }
 
+/* Claims the inputs nobody is waiting on yet.  Must be called with input_mutex
+ * held; the inputs themselves are waited on afterwards without it, as a
+ * callback may disconnect its own input in the meantime. */
+static void claim_inputs(video_input_array_t *inputs, bool only_idle, video_input_array_t *claimed)
+{
+	for (size_t i = 0; i < inputs->num; i++) {
+		struct video_input *input = inputs->array[i];
+
+		if (input->join_claimed)
+			continue;
+		if (only_idle && !video_input_idle(input))
+			continue;
+
+		input->join_claimed = true;
+		da_push_back(*claimed, &input);
+	}
+}
+
+static void join_inputs(struct video_output *video, video_input_array_t *claimed)
+{
+	for (size_t i = 0; i < claimed->num; i++)
+		video_input_join(claimed->array[i]);
+
+	pthread_mutex_lock(&video->input_mutex);
+	for (size_t i = 0; i < claimed->num; i++)
+		claimed->array[i]->joined = true;
+	pthread_mutex_unlock(&video->input_mutex);
+
+	da_free(*claimed);
+}
+
+/* frees disconnected inputs once they have gone idle */
+static void reap_retired_inputs(struct video_output *video)
+{
+	video_input_array_t claimed = {0};
+
+	pthread_mutex_lock(&video->input_mutex);
+	claim_inputs(&video->retired, true, &claimed);
+	pthread_mutex_unlock(&video->input_mutex);
+
+	join_inputs(video, &claimed);
+
+	pthread_mutex_lock(&video->input_mutex);
+	for (size_t i = video->retired.num; i > 0; i--) {
+		struct video_input *input = video->retired.array[i - 1];
+		if (input->joined) {
+			video_input_free(input);
+			da_erase(video->retired, i - 1);
+		}
+	}
+	pthread_mutex_unlock(&video->input_mutex);
+}
+
 void video_output_close(video_t *video)
 {
 	if (!video)
@@ -285,15 +574,19 @@ void video_output_close(video_t *video)
 	pthread_mutex_lock(&video->input_mutex);
 
 	for (size_t i = 0; i < video->inputs.num; i++)
-		video_input_free(&video->inputs.array[i]);
+		video_input_free(video->inputs.array[i]);
 	da_free(video->inputs);
 
+	for (size_t i = 0; i < video->retired.num; i++)
+		video_input_free(video->retired.array[i]);
+	da_free(video->retired);
+
 	for (size_t i = 0; i < video->info.cache_size; i++)
 		video_frame_free((struct video_frame *)&video->cache[i]);
 
 	pthread_mutex_unlock(&video->input_mutex);
-	os_sem_destroy(video->update_semaphore);
-	pthread_mutex_destroy(&video->data_mutex);
+
+	os_task_pool_destroy(video->pool);
 	pthread_mutex_destroy(&video->input_mutex);
 
 	bfree(video);
@@ -303,7 +596,7 @@ static size_t video_get_input_idx(const video_t *video, void (*callback)(void *p
 				  void *param)
 {
 	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array + i;
+		struct video_input *input = video->inputs.array[i];
 		if (input->callback == callback && input->param == param)
 			return i;
 	}
@@ -373,6 +666,17 @@ static inline void reset_frames(video_t *video)
 {
 	os_atomic_set_long(&video->skipped_frames, 0);
 	os_atomic_set_long(&video->total_frames, 0);
+	os_atomic_set_long(&video->input_skipped_frames, 0);
+}
+
+/* an input that falls behind only skips its own frames, but that is still
+ * encoding lag; the slowest input has missed every frame nobody got as well */
+static inline long get_skipped_frames(const struct video_output *video)
+{
+	long skipped = os_atomic_load_long(&video->skipped_frames);
+	long input_skipped = os_atomic_load_long(&video->input_skipped_frames);
+
+	return skipped > input_skipped ? skipped : input_skipped;
 }
 
 static const video_t *get_const_root(const video_t *video)
@@ -395,6 +699,11 @@ bool video_output_connect(video_t *video, const struct video_scale_info *convers
 	return video_output_connect2(video, conversion, 1, callback, param);
 }
 
+static inline long default_max_lag(const struct video_output *video)
+{
+	return (long)video->info.cache_size;
+}
+
 bool video_output_connect2(video_t *video, const struct video_scale_info *conversion, uint32_t frame_rate_divisor,
 			   void (*callback)(void *param, struct video_data *frame), void *param)
 {
@@ -405,33 +714,55 @@ bool video_output_connect2(video_t *video, const struct video_scale_info *conver
 	if (!video || !callback || frame_rate_divisor == 0)
 		return false;
 
+	reap_retired_inputs(video);
+
 	pthread_mutex_lock(&video->input_mutex);
 
 	if (video_get_input_idx(video, callback, param) == DARRAY_INVALID) {
-		struct video_input input;
-		memset(&input, 0, sizeof(input));
+		struct video_input *input = bzalloc(sizeof(struct video_input));
+		pthread_mutex_init(&input->stats_mutex, NULL);
 
-		input.callback = callback;
-		input.param = param;
+		input->video = video;
+		input->callback = callback;
+		input->param = param;
 
-		input.frame_rate_divisor = frame_rate_divisor;
+		input->frame_rate_divisor = frame_rate_divisor;
+		input->max_lag = default_max_lag(video);
 
 		if (conversion) {
-			input.conversion = *conversion;
+			input->conversion = *conversion;
 		} else {
-			input.conversion.format = video->info.format;
-			input.conversion.width = video->info.width;
-			input.conversion.height = video->info.height;
-			input.conversion.range = video->info.range;
-			input.conversion.colorspace = video->info.colorspace;
+			input->conversion.format = video->info.format;
+			input->conversion.width = video->info.width;
+			input->conversion.height = video->info.height;
+			input->conversion.range = video->info.range;
+			input->conversion.colorspace = video->info.colorspace;
 		}
 
-		if (input.conversion.width == 0)
-			input.conversion.width = video->info.width;
-		if (input.conversion.height == 0)
-			input.conversion.height = video->info.height;
+		if (input->conversion.width == 0)
+			input->conversion.width = video->info.width;
+		if (input->conversion.height == 0)
+			input->conversion.height = video->info.height;
+
+		/* only frames published after connecting are read */
+		input->next_seq = os_atomic_load_long(&video->write_seq) + 1;
+		input->stop = video->stop;
+		input->profile_name =
+			profile_store_name(obs_get_profiler_name_store(), "video_thread(%s)", video->info.name);
+
+		success = video_input_init(input, video);
+		if (success && !video->pool) {
+			if (os_sem_init(&input->update_semaphore, 0) != 0) {
+				blog(LOG_ERROR, "video_output_connect: Failed to create semaphore");
+				success = false;
+			} else if (pthread_create(&input->thread, NULL, video_input_thread, input) != 0) {
+				blog(LOG_ERROR, "video_output_connect: Failed to create input thread");
+				success = false;
+			} else {
+				input->thread_created = true;
+			}
+		}
 
-		success = video_input_init(&input, video);
 		if (success) {
 			if (video->inputs.num == 0) {
 				if (!os_atomic_load_long(&video->gpu_refs)) {
@@ -440,6 +771,8 @@ bool video_output_connect2(video_t *video, const struct video_scale_info *conver
 				os_atomic_set_bool(&video->raw_active, true);
 			}
 			da_push_back(video->inputs, &input);
+		} else {
+			video_input_free(input);
 		}
 	}
 
@@ -450,8 +783,9 @@ bool video_output_connect2(video_t *video, const struct video_scale_info *conver
 
 static void log_skipped(video_t *video)
 {
-	long skipped = os_atomic_load_long(&video->skipped_frames);
-	double percentage_skipped = (double)skipped / (double)os_atomic_load_long(&video->total_frames) * 100.0;
+	long skipped = get_skipped_frames(video);
+	long total = os_atomic_load_long(&video->total_frames);
+	double percentage_skipped = (double)skipped / (double)total * 100.0;
 
 	if (skipped)
 		blog(LOG_INFO,
@@ -459,11 +793,36 @@ static void log_skipped(video_t *video)
 		     "skipped frames due "
 		     "to encoding lag: "
 		     "%ld/%ld (%0.1f%%)",
-		     video->skipped_frames, video->total_frames, percentage_skipped);
+		     skipped, total, percentage_skipped);
+}
+
+static void log_input_stats(const struct video_output *video, struct video_input *input)
+{
+	pthread_mutex_lock(&input->stats_mutex);
+	uint64_t frames = input->frames;
+	uint64_t scale_time = input->scale_time_ns;
+	uint64_t max_scale_time = input->max_scale_time_ns;
+	pthread_mutex_unlock(&input->stats_mutex);
+
+	long skipped = os_atomic_load_long(&input->skipped_frames);
+	if (skipped)
+		blog(LOG_INFO, "video-io: %s input fell behind on %ld ticks, output %" PRIu64 " frames",
+		     video->info.name, skipped, frames);
+
+	if (input->scaler && frames)
+		blog(LOG_INFO,
+		     "video-io: %s input %" PRIu32 "x%" PRIu32 " scaled %" PRIu64 " frames, "
+		     "average %.3f ms, max %.3f ms",
+		     video->info.name, input->conversion.width, input->conversion.height, frames,
+		     (double)scale_time / (double)frames / 1000000.0, (double)max_scale_time / 1000000.0);
 }
 
 void video_output_disconnect(video_t *video, void (*callback)(void *param, struct video_data *frame), void *param)
 {
+	struct video_input *input = NULL;
+	bool join = false;
+	bool free_input = false;
+
 	if (!video || !callback)
 		return;
 
@@ -473,8 +832,25 @@ void video_output_disconnect(video_t *video, void (*callback)(void *param, struc
 
 	size_t idx = video_get_input_idx(video, callback, param);
 	if (idx != DARRAY_INVALID) {
-		video_input_free(video->inputs.array + idx);
+		input = video->inputs.array[idx];
 		da_erase(video->inputs, idx);
+		log_input_stats(video, input);
+
+		os_atomic_set_bool(&input->stop, true);
+		if (input->thread_created)
+			os_sem_post(input->update_semaphore);
+
+		/* an input disconnecting itself from within its callback (e.g.
+		 * an encoder shutting down after an error) cannot wait for
+		 * itself, and an input video_output_stop is still waiting on
+		 * must stay alive until that is done */
+		if (current_input == input || (input->join_claimed && !input->joined)) {
+			da_push_back(video->retired, &input);
+		} else {
+			join = !input->join_claimed;
+			input->join_claimed = true;
+			free_input = true;
+		}
 
 		if (video->inputs.num == 0) {
 			os_atomic_set_bool(&video->raw_active, false);
@@ -485,6 +861,11 @@ void video_output_disconnect(video_t *video, void (*callback)(void *param, struc
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
+
+	if (join)
+		video_input_join(input);
+	if (free_input)
+		video_input_free(input);
 }
 
 bool video_output_active(const video_t *video)
@@ -499,57 +880,159 @@ const struct video_output_info *video_output_get_info(const video_t *video)
 	return video ? &video->info : NULL;
 }
 
+static struct cached_frame_info *claim_frame(struct video_output *video, int count, uint64_t timestamp)
+{
+	struct cached_frame_info *cfi = NULL;
+	size_t cache_size = video->info.cache_size;
+
+	/* oldest slots first; any slot no input is still reading can be
+	 * reused */
+	for (size_t i = 0; i < cache_size; i++) {
+		size_t idx = (video->next_slot + i) % cache_size;
+
+		if (os_atomic_compare_swap_long(&video->cache[idx].refs, 0, -1)) {
+			cfi = &video->cache[idx];
+			video->write_slot = idx;
+			video->next_slot = (idx + 1) % cache_size;
+			break;
+		}
+	}
+
+	atomic_add_long(&video->total_frames, count);
+
+	if (!cfi) {
+		/* every slot is pinned by a reader; the inputs will repeat
+		 * their last frame for these ticks */
+		video->next_tick += (uint64_t)count;
+		atomic_add_long(&video->skipped_frames, count);
+		return NULL;
+	}
+
+	cfi->frame.timestamp = timestamp;
+	cfi->frame.repeat = false;
+	cfi->frame.damage.num = 0;
+	cfi->first_tick = video->next_tick;
+	cfi->start_tick = video->next_tick;
+	cfi->count = count;
+	video->next_tick += (uint64_t)count;
+	return cfi;
+}
+
 bool video_output_lock_frame(video_t *video, struct video_frame *frame, int count, uint64_t timestamp)
 {
 	struct cached_frame_info *cfi;
-	bool locked;
 
 	if (!video)
 		return false;
 
 	video = get_root(video);
+	cfi = claim_frame(video, count, timestamp);
+	if (!cfi) {
+		/* the last frame written is no longer the current picture */
+		video->frame_written = false;
+		return false;
+	}
 
-	pthread_mutex_lock(&video->data_mutex);
-
-	if (video->available_frames == 0) {
-		video->cache[video->last_added].count += count;
-		video->cache[video->last_added].skipped += count;
-		locked = false;
+	memcpy(frame, &cfi->frame, sizeof(*frame));
+	return true;
+}
 
-	} else {
-		if (video->available_frames != video->info.cache_size) {
-			if (++video->last_added == video->info.cache_size)
-				video->last_added = 0;
-		}
+bool video_output_repeat_frame(video_t *video, int count, uint64_t timestamp)
+{
+	struct cached_frame_info *prev;
+	struct cached_frame_info *cfi;
 
-		cfi = &video->cache[video->last_added];
-		cfi->frame.timestamp = timestamp;
-		cfi->count = count;
-		cfi->skipped = 0;
+	if (!video)
+		return false;
 
-		memcpy(frame, &cfi->frame, sizeof(*frame));
+	video = get_root(video);
+	if (!video->frame_written)
+		return false;
 
-		locked = true;
+	/* if no input is reading the last frame, publish the same slot again
+	 * under a new sequence number instead of copying it; it then covers
+	 * the ticks of both, so an input that never read the last one does
+	 * not miss anything.  this only works if no ticks were dropped since */
+	prev = &video->cache[video->write_slot];
+	if (prev->first_tick + (uint64_t)prev->count == video->next_tick &&
+	    os_atomic_compare_swap_long(&prev->refs, 0, -1)) {
+		atomic_add_long(&video->total_frames, count);
+		prev->frame.timestamp = timestamp;
+		prev->first_tick = video->next_tick;
+		prev->count = count;
+		video->next_tick += (uint64_t)count;
+		video_output_unlock_frame(video);
+		return true;
 	}
 
-	pthread_mutex_unlock(&video->data_mutex);
+	/* the producer is the only writer, so the last frame stays as it is
+	 * while it is copied, even if inputs are reading it */
+	cfi = claim_frame(video, count, timestamp);
+	if (!cfi)
+		return true;
+
+	if (cfi != prev)
+		video_frame_copy((struct video_frame *)&cfi->frame, (const struct video_frame *)&prev->frame,
+				 video->info.format, video->info.height);
 
-	return locked;
+	cfi->frame.repeat = true;
+	video_output_unlock_frame(video);
+	return true;
+}
+
+bool video_output_lock_frame_damaged(video_t *video, struct video_frame *frame, int count, uint64_t timestamp,
+				     struct video_damage *damage, bool copy_undamaged)
+{
+	struct cached_frame_info *prev;
+	struct cached_frame_info *cfi;
+	bool had_frame;
+
+	if (!video)
+		return false;
+
+	video = get_root(video);
+	had_frame = video->frame_written;
+	prev = &video->cache[video->write_slot];
+
+	if (!video_output_lock_frame(video, frame, count, timestamp))
+		return false;
+
+	/* the damage is relative to the last frame, which the inputs may
+	 * not have if it was never written */
+	if (!had_frame)
+		damage->num = 0;
+
+	cfi = &video->cache[video->write_slot];
+	if (copy_undamaged && damage->num && cfi != prev)
+		video_frame_copy(frame, (const struct video_frame *)&prev->frame, video->info.format,
+				 video->info.height);
+
+	cfi->frame.damage = *damage;
+	return true;
 }
 
 void video_output_unlock_frame(video_t *video)
 {
+	struct cached_frame_info *cfi;
+	long seq;
+
 	if (!video)
 		return;
 
 	video = get_root(video);
+	cfi = &video->cache[video->write_slot];
+	seq = os_atomic_load_long(&video->write_seq) + 1;
 
-	pthread_mutex_lock(&video->data_mutex);
-
-	video->available_frames--;
-	os_sem_post(video->update_semaphore);
+	os_atomic_store_long(&cfi->seq, seq);
+	os_atomic_store_long(&video->seq_slots[(unsigned long)seq % video->info.cache_size], (long)video->write_slot);
+	os_atomic_store_long(&cfi->refs, 0);
+	os_atomic_store_long(&video->write_seq, seq);
+	video->frame_written = true;
 
-	pthread_mutex_unlock(&video->data_mutex);
+	pthread_mutex_lock(&video->input_mutex);
+	for (size_t i = 0; i < video->inputs.num; i++)
+		video_input_notify(video, video->inputs.array[i]);
+	pthread_mutex_unlock(&video->input_mutex);
 }
 
 uint64_t video_output_get_frame_time(const video_t *video)
@@ -559,18 +1042,30 @@ uint64_t video_output_get_frame_time(const video_t *video)
 
 void video_output_stop(video_t *video)
 {
-	void *thread_ret;
+	video_input_array_t claimed = {0};
 
 	if (!video)
 		return;
 
 	video = get_root(video);
 
-	if (!video->stop) {
-		video->stop = true;
-		os_sem_post(video->update_semaphore);
-		pthread_join(video->thread, &thread_ret);
+	pthread_mutex_lock(&video->input_mutex);
+
+	video->stop = true;
+
+	for (size_t i = 0; i < video->inputs.num; i++) {
+		struct video_input *input = video->inputs.array[i];
+		os_atomic_set_bool(&input->stop, true);
+		if (input->thread_created)
+			os_sem_post(input->update_semaphore);
 	}
+
+	claim_inputs(&video->inputs, false, &claimed);
+	claim_inputs(&video->retired, false, &claimed);
+
+	pthread_mutex_unlock(&video->input_mutex);
+
+	join_inputs(video, &claimed);
 }
 
 bool video_output_stopped(video_t *video)
@@ -608,7 +1103,7 @@ double video_output_get_frame_rate(const video_t *video)
 
 uint32_t video_output_get_skipped_frames(const video_t *video)
 {
-	return (uint32_t)os_atomic_load_long(&get_const_root(video)->skipped_frames);
+	return (uint32_t)get_skipped_frames(get_const_root(video));
 }
 
 uint32_t video_output_get_total_frames(const video_t *video)
@@ -616,6 +1111,90 @@ uint32_t video_output_get_total_frames(const video_t *video)
 	return (uint32_t)os_atomic_load_long(&get_const_root(video)->total_frames);
 }
 
+void video_output_set_input_drop_policy(video_t *video, void (*callback)(void *param, struct video_data *frame),
+					void *param, enum video_input_drop_policy policy, uint32_t max_lag)
+{
+	if (!video || !callback)
+		return;
+
+	video = get_root(video);
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	size_t idx = video_get_input_idx(video, callback, param);
+	if (idx != DARRAY_INVALID) {
+		struct video_input *input = video->inputs.array[idx];
+		long lag = max_lag ? (long)max_lag : default_max_lag(video);
+
+		os_atomic_set_long(&input->drop_policy, (long)policy);
+		os_atomic_set_long(&input->max_lag, lag);
+	}
+
+	pthread_mutex_unlock(&video->input_mutex);
+}
+
+bool video_output_set_worker_threads(video_t *video, size_t threads)
+{
+	bool success = false;
+
+	if (!video)
+		return false;
+
+	video = get_root(video);
+
+	reap_retired_inputs(video);
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	if (!video->inputs.num && !video->retired.num) {
+		os_task_pool_destroy(video->pool);
+		video->pool = NULL;
+
+		if (threads) {
+			video->pool = os_task_pool_create(threads, "video-io: worker");
+			success = video->pool != NULL;
+		} else {
+			success = true;
+		}
+	}
+
+	pthread_mutex_unlock(&video->input_mutex);
+
+	return success;
+}
+
+bool video_output_get_input_stats(video_t *video, void (*callback)(void *param, struct video_data *frame), void *param,
+				  struct video_input_stats *stats)
+{
+	bool found = false;
+
+	if (!video || !callback || !stats)
+		return false;
+
+	video = get_root(video);
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	size_t idx = video_get_input_idx(video, callback, param);
+	if (idx != DARRAY_INVALID) {
+		struct video_input *input = video->inputs.array[idx];
+
+		pthread_mutex_lock(&input->stats_mutex);
+		stats->frames = input->frames;
+		stats->scale_time_ns = input->scale_time_ns;
+		stats->max_scale_time_ns = input->max_scale_time_ns;
+		stats->callback_time_ns = input->callback_time_ns;
+		pthread_mutex_unlock(&input->stats_mutex);
+
+		stats->skipped_frames = (uint32_t)os_atomic_load_long(&input->skipped_frames);
+		found = true;
+	}
+
+	pthread_mutex_unlock(&video->input_mutex);
+
+	return found;
+}
+
 /* Note: These four functions below are a very slight bit of a hack.  If the
  * texture encoder thread is active while the raw encoder thread is active, the
  * total frame count will just be doubled while they're both active.  Which is
@@ -118,10 +118,34 @@ enum video_range_type {
 	VIDEO_RANGE_FULL,
 };
 
+#define MAX_VIDEO_DAMAGE_RECTS 8
+
+struct video_damage_rect {
+	uint32_t x;
+	uint32_t y;
+	uint32_t cx;
+	uint32_t cy;
+};
+
+/* the parts of a frame that changed since the frame before it, as up to
+ * MAX_VIDEO_DAMAGE_RECTS rects that do not overlap.  with no rects the whole
+ * frame may have changed. */
+struct video_damage {
+	uint32_t num;
+	struct video_damage_rect rects[MAX_VIDEO_DAMAGE_RECTS];
+};
+
 struct video_data {
 	uint8_t *data[MAX_AV_PLANES];
 	uint32_t linesize[MAX_AV_PLANES];
 	uint64_t timestamp;
+
+	/* same picture as the frame this input received before it */
+	bool repeat;
+
+	/* what changed since the frame this input received before it, not
+	 * set for repeats */
+	struct video_damage damage;
 };
 
 struct video_output_info {
@@ -285,6 +309,18 @@ struct video_scale_info {
 
 EXPORT enum video_format video_format_from_fourcc(uint32_t fourcc);
 
+/* Adds a rect to the damage, merging it with the rects it touches.  Past
+ * MAX_VIDEO_DAMAGE_RECTS rects the ones that grow the least are merged. */
+EXPORT void video_damage_add(struct video_damage *damage, uint32_t x, uint32_t y, uint32_t cx, uint32_t cy);
+EXPORT void video_damage_merge(struct video_damage *dst, const struct video_damage *src);
+EXPORT void video_damage_get_bounds(const struct video_damage *damage, struct video_damage_rect *bounds);
+EXPORT uint64_t video_damage_get_area(const struct video_damage *damage);
+
+/* Scales the damage of a frame of one size to a frame of another, growing
+ * each rect outward by margin pixels for the filter taps of the scaler */
+EXPORT void video_damage_scale(struct video_damage *damage, uint32_t from_cx, uint32_t from_cy, uint32_t to_cx,
+			       uint32_t to_cy, uint32_t margin);
+
 EXPORT bool video_format_get_parameters(enum video_colorspace color_space, enum video_range_type range,
 					float matrix[16], float min_range[3], float max_range[3]);
 EXPORT bool video_format_get_parameters_for_format(enum video_colorspace color_space, enum video_range_type range,
@@ -311,6 +347,23 @@ EXPORT bool video_output_active(const video_t *video);
 EXPORT const struct video_output_info *video_output_get_info(const video_t *video);
 EXPORT bool video_output_lock_frame(video_t *video, struct video_frame *frame, int count, uint64_t timestamp);
 EXPORT void video_output_unlock_frame(video_t *video);
+
+/**
+ * Outputs the last frame again for count ticks, marked as a repeat, for when
+ * the picture has not changed.  Returns false if no frame was output yet.
+ */
+EXPORT bool video_output_repeat_frame(video_t *video, int count, uint64_t timestamp);
+
+/**
+ * Locks a frame like video_output_lock_frame, for a producer that knows which
+ * parts of the picture changed since the last frame.  The damage is passed on
+ * to the inputs with the frame.  With copy_undamaged set the last frame is
+ * copied into the new one first, so only the damaged rects need writing.
+ * Without a last frame the damage is cleared: the whole frame has to be
+ * written.
+ */
+EXPORT bool video_output_lock_frame_damaged(video_t *video, struct video_frame *frame, int count, uint64_t timestamp,
+					    struct video_damage *damage, bool copy_undamaged);
 EXPORT uint64_t video_output_get_frame_time(const video_t *video);
 EXPORT void video_output_stop(video_t *video);
 EXPORT bool video_output_stopped(video_t *video);
@@ -323,6 +376,41 @@ EXPORT double video_output_get_frame_rate(const video_t *video);
 EXPORT uint32_t video_output_get_skipped_frames(const video_t *video);
 EXPORT uint32_t video_output_get_total_frames(const video_t *video);
 
+enum video_input_drop_policy {
+	/* repeat the last frame for every tick the input fell behind on, the
+	 * callback keeps running exactly once per tick (default) */
+	VIDEO_INPUT_DROP_REPEAT,
+
+	/* skip those ticks entirely; the timestamps of the frames the callback
+	 * receives jump forward by the number of ticks skipped */
+	VIDEO_INPUT_DROP_SKIP,
+};
+
+/* Every connected input reads frames on its own thread.  An input that falls
+ * more than max_lag frames behind jumps ahead to the newest frame without
+ * holding up the producer or the other inputs, and handles the ticks it missed
+ * according to its drop policy.  A max_lag of 0 uses the default (the frame
+ * cache size). */
+EXPORT void video_output_set_input_drop_policy(video_t *video,
+					       void (*callback)(void *param, struct video_data *frame), void *param,
+					       enum video_input_drop_policy policy, uint32_t max_lag);
+/* Runs the scaling and callbacks of all inputs on a shared pool of worker
+ * threads instead of one thread per input.  Inputs still scale in parallel and
+ * each one still receives its frames in order.  Can only be changed while no
+ * inputs are connected; 0 goes back to one thread per input. */
+EXPORT bool video_output_set_worker_threads(video_t *video, size_t threads);
+
+struct video_input_stats {
+	uint64_t frames;            /* frames passed to the callback */
+	uint32_t skipped_frames;    /* ticks this input fell behind on */
+	uint64_t scale_time_ns;     /* total time spent scaling/converting */
+	uint64_t max_scale_time_ns; /* slowest single frame */
+	uint64_t callback_time_ns;  /* total time spent in the callback */
+};
+
+EXPORT bool video_output_get_input_stats(video_t *video, void (*callback)(void *param, struct video_data *frame),
+					 void *param, struct video_input_stats *stats);
+
 extern void video_output_inc_texture_encoders(video_t *video);
 extern void video_output_dec_texture_encoders(video_t *video);
 extern void video_output_inc_texture_frames(video_t *video);
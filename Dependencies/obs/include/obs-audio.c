@@ -17,6 +17,7 @@
 
 #include <inttypes.h>
 #include "obs-internal.h"
+#include "media-io/audio-math.h"
 #include "util/util_uint64.h"
 
 struct ts_info {
@@ -45,8 +46,8 @@ static inline size_t convert_time_to_frames(size_t sample_rate, uint64_t t)
 	return (size_t)util_mul_div64(t, sample_rate, 1000000000ULL);
 }
 
-static inline void mix_audio(struct audio_output_data *mixes, obs_source_t *source, size_t channels, size_t sample_rate,
-			     struct ts_info *ts)
+static inline void mix_audio(struct audio_output_data *mixes, obs_source_t *source, uint32_t mixers, size_t channels,
+			     size_t sample_rate, struct ts_info *ts)
 {
 	size_t total_floats = AUDIO_OUTPUT_FRAMES;
 	size_t start_point = 0;
@@ -63,17 +64,13 @@ static inline void mix_audio(struct audio_output_data *mixes, obs_source_t *sour
 	}
 
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
-		for (size_t ch = 0; ch < channels; ch++) {
-			register float *mix = mixes[mix_idx].data[ch];
-			register float *aud = source->audio_output_buf[mix_idx][ch];
-			register float *end;
-
-			mix += start_point;
-			end = aud + total_floats;
+		/* nothing reads mixes without outputs */
+		if ((mixers & (1 << mix_idx)) == 0)
+			continue;
 
-			while (aud < end)
-				*(mix++) += *(aud++);
-		}
+		for (size_t ch = 0; ch < channels; ch++)
+			mix_float_samples(mixes[mix_idx].data[ch] + start_point, source->audio_output_buf[mix_idx][ch],
+					  total_floats);
 	}
 }
 
@@ -590,7 +587,7 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 			pthread_mutex_lock(&source->audio_buf_mutex);
 
 			if (source->audio_output_buf[0][0] && source->audio_ts)
-				mix_audio(mixes, source, channels, sample_rate, &ts);
+				mix_audio(mixes, source, mixers, channels, sample_rate, &ts);
 
 			pthread_mutex_unlock(&source->audio_buf_mutex);
 		}
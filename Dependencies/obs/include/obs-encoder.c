@@ -26,16 +26,31 @@
 
 static void encoder_set_video(obs_encoder_t *encoder, video_t *video);
 
-struct obs_encoder_info *find_encoder(const char *id)
+/* module_mutex: obs_init_modules registers types from several threads */
+static struct obs_encoder_info *find_encoder_info(const char *id)
 {
+	struct obs_encoder_info *found = NULL;
+
+	pthread_mutex_lock(&obs->module_mutex);
 	for (size_t i = 0; i < obs->encoder_types.num; i++) {
 		struct obs_encoder_info *info = obs->encoder_types.array + i;
 
-		if (strcmp(info->id, id) == 0)
-			return info;
+		if (strcmp(info->id, id) == 0) {
+			found = info;
+			break;
+		}
 	}
+	pthread_mutex_unlock(&obs->module_mutex);
 
-	return NULL;
+	return found;
+}
+
+struct obs_encoder_info *find_encoder(const char *id)
+{
+	struct obs_encoder_info *info = find_encoder_info(id);
+	if (!info && load_deferred_module_for_type(id))
+		info = find_encoder_info(id);
+	return info;
 }
 
 const char *obs_encoder_get_display_name(const char *id)
@@ -308,6 +323,12 @@ static void add_connection(struct obs_encoder *encoder)
 			start_gpu_encode(encoder);
 		} else {
 			start_raw_video(encoder->media, &info, encoder->frame_rate_divisor, receive_video, encoder);
+
+			/* receive_video keeps pts in step with the timestamps
+			 * across the frames skipped */
+			if (encoder->skip_late_frames)
+				video_output_set_input_drop_policy(encoder->media, receive_video, encoder,
+								   VIDEO_INPUT_DROP_SKIP, 0);
 		}
 	}
 
@@ -323,9 +344,53 @@ static void add_connection(struct obs_encoder *encoder)
 	set_encoder_active(encoder, true);
 }
 
+static void set_suspended(struct obs_encoder *encoder, bool suspend)
+{
+	if (encoder->suspended == suspend)
+		return;
+
+	if (encoder->info.type == OBS_ENCODER_AUDIO) {
+		if (suspend) {
+			audio_output_disconnect(encoder->media, encoder->mixer_idx, receive_audio, encoder);
+		} else {
+			struct audio_convert_info audio_info = {0};
+			get_audio_info(encoder, &audio_info);
+
+			audio_output_connect(encoder->media, encoder->mixer_idx, &audio_info, receive_audio, encoder);
+		}
+	} else if (gpu_encode_available(encoder)) {
+		/* texture encoders keep their frames on the GPU, leave them be */
+		return;
+	} else {
+		/* the frames missed while suspended were paused, not skipped */
+		if (!suspend)
+			encoder->last_raw_video_ts = 0;
+		encoder->last_raw_video_encoded = false;
+		suspend_raw_video(encoder->media, suspend);
+	}
+
+	encoder->suspended = suspend;
+}
+
+/* While an encoder is paused nothing it would be fed is used, so it can stop
+ * counting as a consumer: a mix whose only raw video consumers are paused
+ * encoders stops converting and downloading frames, and an audio mix without
+ * connections is not mixed.  The pause state itself still decides which
+ * frames are dropped once data flows again. */
+void obs_encoder_set_suspended(obs_encoder_t *encoder, bool suspend)
+{
+	pthread_mutex_lock(&encoder->init_mutex);
+	if (encoder_active(encoder))
+		set_suspended(encoder, suspend);
+	pthread_mutex_unlock(&encoder->init_mutex);
+}
+
 void obs_encoder_group_actually_destroy(obs_encoder_group_t *group);
 static void remove_connection(struct obs_encoder *encoder, bool shutdown)
 {
+	/* restore what remove_connection expects to undo */
+	set_suspended(encoder, false);
+
 	if (encoder->info.type == OBS_ENCODER_AUDIO) {
 		audio_output_disconnect(encoder->media, encoder->mixer_idx, receive_audio, encoder);
 	} else {
@@ -387,7 +452,8 @@ void obs_encoder_destroy(obs_encoder_t *encoder)
 			encoder->info.destroy(encoder->context.data);
 		da_free(encoder->callbacks);
 		da_free(encoder->roi);
-		da_free(encoder->encoder_packet_times);
+		da_free(encoder->damage_roi);
+		packet_time_index_free(&encoder->encoder_packet_times);
 		pthread_mutex_destroy(&encoder->init_mutex);
 		pthread_mutex_destroy(&encoder->callbacks_mutex);
 		pthread_mutex_destroy(&encoder->outputs_mutex);
@@ -657,6 +723,8 @@ void obs_encoder_shutdown(obs_encoder_t *encoder)
 		encoder->first_received = false;
 		encoder->offset_usec = 0;
 		encoder->start_ts = 0;
+		encoder->last_raw_video_ts = 0;
+		encoder->last_raw_video_encoded = false;
 		encoder->frame_rate_divisor_counter = 0;
 		maybe_clear_encoder_core_video_mix(encoder);
 
@@ -751,7 +819,7 @@ void obs_encoder_stop(obs_encoder_t *encoder, encoded_callback_t new_packet, voi
 
 	pthread_mutex_unlock(&encoder->callbacks_mutex);
 
-	encoder->encoder_packet_times.num = 0;
+	packet_time_index_clear(&encoder->encoder_packet_times);
 
 	if (last) {
 		remove_connection(encoder, true);
@@ -806,6 +874,32 @@ uint32_t obs_encoder_get_encoded_frames(const obs_encoder_t *encoder)
 	return obs_encoder_valid(encoder, "obs_output_get_encoded_frames") ? encoder->encoded_frames : 0;
 }
 
+uint64_t obs_encoder_get_packet_bytes_copied(const obs_encoder_t *encoder)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_packet_bytes_copied"))
+		return 0;
+
+	return (uint64_t)os_atomic_load_long_long(&encoder->packet_bytes_copied);
+}
+
+uint64_t obs_encoder_get_packet_bytes_shared(const obs_encoder_t *encoder)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_packet_bytes_shared"))
+		return 0;
+
+	return (uint64_t)os_atomic_load_long_long(&encoder->packet_bytes_shared);
+}
+
+bool obs_encoder_get_video_input_stats(const obs_encoder_t *encoder, struct video_input_stats *stats)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_video_input_stats") || !stats)
+		return false;
+	if (encoder->info.type != OBS_ENCODER_VIDEO)
+		return false;
+
+	return video_output_get_input_stats(encoder->media, receive_video, (void *)encoder, stats);
+}
+
 void obs_encoder_set_scaled_size(obs_encoder_t *encoder, uint32_t width, uint32_t height)
 {
 	if (!obs_encoder_valid(encoder, "obs_encoder_set_scaled_size"))
@@ -1001,6 +1095,31 @@ enum obs_scale_type obs_encoder_get_scale_type(obs_encoder_t *encoder)
 	return encoder->gpu_scale_type;
 }
 
+bool obs_encoder_set_skip_late_frames(obs_encoder_t *encoder, bool skip)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_set_skip_late_frames"))
+		return false;
+
+	if (encoder->info.type != OBS_ENCODER_VIDEO) {
+		blog(LOG_WARNING,
+		     "obs_encoder_set_skip_late_frames: "
+		     "encoder '%s' is not a video encoder",
+		     obs_encoder_get_name(encoder));
+		return false;
+	}
+
+	if (encoder_active(encoder)) {
+		blog(LOG_WARNING,
+		     "encoder '%s': Cannot change skipping late frames "
+		     "while the encoder is active",
+		     obs_encoder_get_name(encoder));
+		return false;
+	}
+
+	encoder->skip_late_frames = skip;
+	return true;
+}
+
 uint32_t obs_encoder_get_frame_rate_divisor(const obs_encoder_t *encoder)
 {
 	if (!obs_encoder_valid(encoder, "obs_encoder_set_frame_rate_divisor"))
@@ -1304,18 +1423,9 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success, bool received
 		 * the entry from the array to ensure it doesn't continuously fill.
 		 */
 		struct encoder_packet_time ept_local;
-		struct encoder_packet_time *ept = NULL;
 		bool found_ept = false;
 		if (pkt->type == OBS_ENCODER_VIDEO) {
-			for (size_t i = encoder->encoder_packet_times.num; i > 0; i--) {
-				ept = &encoder->encoder_packet_times.array[i - 1];
-				if (ept->pts == pkt->pts) {
-					ept_local = *ept;
-					da_erase(encoder->encoder_packet_times, i - 1);
-					found_ept = true;
-					break;
-				}
-			}
+			found_ept = packet_time_index_take(&encoder->encoder_packet_times, pkt->pts, &ept_local);
 			if (!found_ept)
 				blog(LOG_DEBUG, "%s: Encoder packet timing for PTS %" PRId64 " not found", __FUNCTION__,
 				     pkt->pts);
@@ -1323,12 +1433,17 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success, bool received
 
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
+		encoder->fanout_src = pkt->data;
+
 		for (size_t i = encoder->callbacks.num; i > 0; i--) {
 			struct encoder_callback *cb;
 			cb = encoder->callbacks.array + (i - 1);
 			send_packet(encoder, cb, pkt, found_ept ? &ept_local : NULL);
 		}
 
+		encoder->fanout_src = NULL;
+		obs_encoder_packet_release(&encoder->fanout_packet);
+
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
 
 		// Count number of video frames successfully encoded
@@ -1373,17 +1488,18 @@ bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame, const u
 	 * (frame encode request complete) and current PTS. PTS is used to
 	 * associate the frame timing data with the encode packet. */
 	if (frame_cts) {
-		struct encoder_packet_time *ept = da_push_back_new(encoder->encoder_packet_times);
+		struct encoder_packet_time ept = {0};
 		// Get the frame encode request complete timestamp
 		if (success) {
-			ept->ferc = os_gettime_ns();
+			ept.ferc = os_gettime_ns();
 		} else {
 			// Encode had error, set ferc to 0
-			ept->ferc = 0;
+			ept.ferc = 0;
 		}
-		ept->pts = frame->pts;
-		ept->cts = *frame_cts;
-		ept->fer = fer_ts;
+		ept.pts = frame->pts;
+		ept.cts = *frame_cts;
+		ept.fer = fer_ts;
+		packet_time_index_push(&encoder->encoder_packet_times, &ept);
 	}
 	send_off_encoder_packet(encoder, success, received, &pkt);
 
@@ -1399,7 +1515,8 @@ static inline bool video_pause_check_internal(struct pause_data *pause, uint64_t
 		return false;
 	}
 
-	if (ts == pause->ts_end) {
+	/* a suspended encoder may not see the frame at ts_end itself */
+	if (pause->ts_end && ts >= pause->ts_end) {
 		pause->ts_start = 0;
 		pause->ts_end = 0;
 
@@ -1422,6 +1539,54 @@ bool video_pause_check(struct pause_data *pause, uint64_t timestamp)
 }
 
 static const char *receive_video_name = "receive_video";
+/* number of frames video-io skipped for this encoder since the last one it
+ * received (see VIDEO_INPUT_DROP_SKIP) */
+static inline uint64_t skipped_raw_video_frames(struct obs_encoder *encoder, uint64_t timestamp)
+{
+	uint64_t last_ts = encoder->last_raw_video_ts;
+	encoder->last_raw_video_ts = timestamp;
+
+	if (!last_ts || timestamp <= last_ts)
+		return 0;
+
+	uint64_t interval = video_output_get_frame_time(encoder->media) * encoder->frame_rate_divisor;
+	uint64_t frames = (timestamp - last_ts + interval / 2) / interval;
+	return frames > 1 ? frames - 1 : 0;
+}
+
+/* Replaces the damage regions of interest with the rects that changed in
+ * this frame, grown to the smallest block the encoders handle */
+static void update_damage_roi(struct obs_encoder *encoder, const struct video_damage *damage)
+{
+	const uint32_t width = obs_encoder_get_width(encoder);
+	const uint32_t height = obs_encoder_get_height(encoder);
+	struct obs_encoder_roi rois[MAX_VIDEO_DAMAGE_RECTS];
+	size_t num = 0;
+
+	for (uint32_t i = 0; damage && i < damage->num && width >= 16 && height >= 16; i++) {
+		const struct video_damage_rect *rect = &damage->rects[i];
+		struct obs_encoder_roi *roi = &rois[num++];
+		uint32_t cx = rect->cx > 16 ? (rect->cx < width ? rect->cx : width) : 16;
+		uint32_t cy = rect->cy > 16 ? (rect->cy < height ? rect->cy : height) : 16;
+
+		roi->left = rect->x + cx <= width ? rect->x : width - cx;
+		roi->top = rect->y + cy <= height ? rect->y : height - cy;
+		roi->right = roi->left + cx;
+		roi->bottom = roi->top + cy;
+		roi->priority = encoder->damage_roi_priority;
+	}
+
+	if (num == encoder->damage_roi.num && memcmp(rois, encoder->damage_roi.array, num * sizeof(*rois)) == 0)
+		return;
+
+	pthread_mutex_lock(&encoder->roi_mutex);
+	da_resize(encoder->damage_roi, num);
+	if (num)
+		memcpy(encoder->damage_roi.array, rois, num * sizeof(*rois));
+	encoder->roi_increment++;
+	pthread_mutex_unlock(&encoder->roi_mutex);
+}
+
 static void receive_video(void *param, struct video_data *frame)
 {
 	profile_start(receive_video_name);
@@ -1454,8 +1619,12 @@ static void receive_video(void *param, struct video_data *frame)
 		}
 	}
 
-	if (video_pause_check(&encoder->pause, frame->timestamp))
+	uint64_t skipped = skipped_raw_video_frames(encoder, frame->timestamp);
+
+	if (video_pause_check(&encoder->pause, frame->timestamp)) {
+		encoder->last_raw_video_encoded = false;
 		goto wait_for_audio;
+	}
 
 	memset(&enc_frame, 0, sizeof(struct encoder_frame));
 
@@ -1466,11 +1635,20 @@ static void receive_video(void *param, struct video_data *frame)
 
 	if (!encoder->start_ts)
 		encoder->start_ts = frame->timestamp;
+	else
+		encoder->cur_pts += (int64_t)skipped * encoder->timebase_num * encoder->frame_rate_divisor;
 
 	enc_frame.frames = 1;
 	enc_frame.pts = encoder->cur_pts;
+	enc_frame.repeat = frame->repeat && !skipped && encoder->last_raw_video_encoded;
+	if (!enc_frame.repeat && !skipped && encoder->last_raw_video_encoded && frame->damage.num)
+		enc_frame.damage = &frame->damage;
+
+	if (encoder->damage_roi_priority != 0.0f)
+		update_damage_roi(encoder, enc_frame.damage);
 
-	if (do_encode(encoder, &enc_frame, &frame->timestamp))
+	encoder->last_raw_video_encoded = do_encode(encoder, &enc_frame, &frame->timestamp);
+	if (encoder->last_raw_video_encoded)
 		encoder->cur_pts += encoder->timebase_num * encoder->frame_rate_divisor;
 
 wait_for_audio:
@@ -1652,6 +1830,13 @@ static inline bool audio_pause_check_internal(struct pause_data *pause, struct a
 			return !data->frames;
 		}
 
+		/* suspended encoders reconnect after ts_end has passed */
+		if (pause->ts_end && pause->ts_end < data->timestamp) {
+			pause->ts_start = 0;
+			pause->ts_end = 0;
+			return false;
+		}
+
 		return true;
 	}
 
@@ -1722,17 +1907,43 @@ void obs_encoder_remove_output(struct obs_encoder *encoder, struct obs_output *o
 	pthread_mutex_unlock(&encoder->outputs_mutex);
 }
 
-void obs_encoder_packet_create_instance(struct encoder_packet *dst, const struct encoder_packet *src)
+static inline void copy_packet_data(struct encoder_packet *dst, const struct encoder_packet *src)
 {
-	long *p_refs;
-
-	*dst = *src;
-	p_refs = bmalloc(src->size + sizeof(long));
+	long *p_refs = bmalloc(src->size + sizeof(long));
 	dst->data = (void *)(p_refs + 1);
 	*p_refs = 1;
 	memcpy(dst->data, src->data, src->size);
 }
 
+void obs_encoder_packet_create_instance(struct encoder_packet *dst, const struct encoder_packet *src)
+{
+	struct obs_encoder *encoder = src->encoder;
+
+	*dst = *src;
+
+	/* called from the encoder's own callbacks while it sends the packet
+	 * off, so only the first output that keeps the packet copies it */
+	if (encoder && encoder->fanout_src && encoder->fanout_src == src->data) {
+		struct encoder_packet *shared = &encoder->fanout_packet;
+
+		if (!shared->data) {
+			copy_packet_data(shared, src);
+			shared->size = src->size;
+			os_atomic_add_long_long(&encoder->packet_bytes_copied, src->size);
+		} else {
+			os_atomic_add_long_long(&encoder->packet_bytes_shared, src->size);
+		}
+
+		os_atomic_inc_long(((long *)shared->data) - 1);
+		dst->data = shared->data;
+		return;
+	}
+
+	copy_packet_data(dst, src);
+	if (encoder)
+		os_atomic_add_long_long(&encoder->packet_bytes_copied, src->size);
+}
+
 void obs_encoder_packet_ref(struct encoder_packet *dst, struct encoder_packet *src)
 {
 	if (!src)
@@ -1760,6 +1971,177 @@ void obs_encoder_packet_release(struct encoder_packet *pkt)
 	memset(pkt, 0, sizeof(struct encoder_packet));
 }
 
+/* ------------------------------------------------------------------------- */
+/* Packet timing index */
+
+static inline size_t packet_time_hash(int64_t pts, size_t capacity)
+{
+	return (size_t)(((uint64_t)pts * 0x9E3779B97F4A7C15ULL) >> 32) & (capacity - 1);
+}
+
+static struct packet_time_slot *packet_time_find(struct packet_time_index *index, int64_t pts)
+{
+	if (!index->capacity)
+		return NULL;
+
+	size_t i = packet_time_hash(pts, index->capacity);
+	while (index->slots[i].used) {
+		if (index->slots[i].ept.pts == pts)
+			return &index->slots[i];
+		i = (i + 1) & (index->capacity - 1);
+	}
+
+	return NULL;
+}
+
+static void packet_time_insert_slot(struct packet_time_index *index, const struct encoder_packet_time *ept,
+				    uint64_t seq)
+{
+	size_t i = packet_time_hash(ept->pts, index->capacity);
+	while (index->slots[i].used)
+		i = (i + 1) & (index->capacity - 1);
+
+	index->slots[i].ept = *ept;
+	index->slots[i].seq = seq;
+	index->slots[i].used = true;
+	index->count++;
+}
+
+/* linear probing removal: shift later entries of the same probe chain back
+ * into the hole so lookups never need tombstones */
+static void packet_time_remove_slot(struct packet_time_index *index, struct packet_time_slot *slot)
+{
+	const size_t mask = index->capacity - 1;
+	size_t hole = (size_t)(slot - index->slots);
+	size_t i = hole;
+
+	for (;;) {
+		i = (i + 1) & mask;
+		if (!index->slots[i].used)
+			break;
+
+		size_t home = packet_time_hash(index->slots[i].ept.pts, index->capacity);
+		bool movable = hole <= i ? (home <= hole || home > i) : (home <= hole && home > i);
+		if (movable) {
+			index->slots[hole] = index->slots[i];
+			hole = i;
+		}
+	}
+
+	index->slots[hole].used = false;
+	index->count--;
+}
+
+static void packet_time_resize(struct packet_time_index *index, size_t capacity)
+{
+	struct packet_time_slot *old_slots = index->slots;
+	size_t old_capacity = index->capacity;
+
+	index->slots = bzalloc(capacity * sizeof(*index->slots));
+	index->capacity = capacity;
+	index->count = 0;
+
+	for (size_t i = 0; i < old_capacity; i++) {
+		if (old_slots[i].used)
+			packet_time_insert_slot(index, &old_slots[i].ept, old_slots[i].seq);
+	}
+
+	bfree(old_slots);
+}
+
+/* drops order entries whose timing was already taken */
+static void packet_time_trim_order(struct packet_time_index *index)
+{
+	while (index->order.size) {
+		struct packet_time_order *oldest = deque_data(&index->order, 0);
+		struct packet_time_slot *slot = packet_time_find(index, oldest->pts);
+
+		if (slot && slot->seq == oldest->seq)
+			break;
+		deque_pop_front(&index->order, NULL, sizeof(*oldest));
+	}
+}
+
+void packet_time_index_push(struct packet_time_index *index, const struct encoder_packet_time *ept)
+{
+	struct packet_time_slot *existing = packet_time_find(index, ept->pts);
+	struct packet_time_order order = {ept->pts, index->next_seq++};
+
+	if (existing) {
+		existing->ept = *ept;
+		existing->seq = order.seq;
+	} else {
+		if ((index->count + 1) * 2 > index->capacity)
+			packet_time_resize(index, index->capacity ? index->capacity * 2 : 16);
+
+		packet_time_insert_slot(index, ept, order.seq);
+	}
+
+	deque_push_back(&index->order, &order, sizeof(order));
+	packet_time_trim_order(index);
+
+	while (index->order.size > PACKET_TIME_INDEX_MAX * sizeof(order))
+		packet_time_index_pop_front(index);
+}
+
+bool packet_time_index_take(struct packet_time_index *index, int64_t pts, struct encoder_packet_time *ept)
+{
+	struct packet_time_slot *slot = packet_time_find(index, pts);
+	if (!slot)
+		return false;
+
+	*ept = slot->ept;
+	packet_time_remove_slot(index, slot);
+	packet_time_trim_order(index);
+	return true;
+}
+
+void packet_time_index_pop_front(struct packet_time_index *index)
+{
+	packet_time_trim_order(index);
+	if (!index->order.size)
+		return;
+
+	struct packet_time_order oldest;
+	deque_pop_front(&index->order, &oldest, sizeof(oldest));
+	packet_time_remove_slot(index, packet_time_find(index, oldest.pts));
+	packet_time_trim_order(index);
+}
+
+void packet_time_index_offset(struct packet_time_index *index, int64_t offset)
+{
+	struct packet_time_index shifted = {0};
+
+	while (index->order.size) {
+		struct packet_time_order oldest;
+		struct encoder_packet_time ept;
+
+		deque_pop_front(&index->order, &oldest, sizeof(oldest));
+		if (packet_time_index_take(index, oldest.pts, &ept)) {
+			ept.pts -= offset;
+			packet_time_index_push(&shifted, &ept);
+		}
+	}
+
+	packet_time_index_free(index);
+	*index = shifted;
+}
+
+void packet_time_index_clear(struct packet_time_index *index)
+{
+	if (index->capacity)
+		memset(index->slots, 0, index->capacity * sizeof(*index->slots));
+	index->count = 0;
+	deque_free(&index->order);
+}
+
+void packet_time_index_free(struct packet_time_index *index)
+{
+	bfree(index->slots);
+	deque_free(&index->order);
+	memset(index, 0, sizeof(*index));
+}
+
 void obs_encoder_set_preferred_video_format(obs_encoder_t *encoder, enum video_format format)
 {
 	if (!encoder || encoder->info.type != OBS_ENCODER_VIDEO)
@@ -1897,7 +2279,7 @@ uint64_t obs_encoder_get_pause_offset(const obs_encoder_t *encoder)
 
 bool obs_encoder_has_roi(const obs_encoder_t *encoder)
 {
-	return encoder->roi.num > 0;
+	return encoder->roi.num > 0 || encoder->damage_roi.num > 0;
 }
 
 bool obs_encoder_add_roi(obs_encoder_t *encoder, const struct obs_encoder_roi *roi)
@@ -1950,6 +2332,11 @@ void obs_encoder_enum_roi(obs_encoder_t *encoder, void (*enum_proc)(void *, stru
 
 	pthread_mutex_lock(&encoder->roi_mutex);
 
+	/* already in output pixels, and enumerated first so the regions
+	 * added by the user override them */
+	for (size_t i = 0; i < encoder->damage_roi.num; i++)
+		enum_proc(param, &encoder->damage_roi.array[i]);
+
 	size_t idx = encoder->roi.num;
 	while (idx) {
 		struct obs_encoder_roi *roi = &encoder->roi.array[--idx];
@@ -1977,6 +2364,26 @@ uint32_t obs_encoder_get_roi_increment(const obs_encoder_t *encoder)
 	return encoder->roi_increment;
 }
 
+bool obs_encoder_set_damage_roi(obs_encoder_t *encoder, float priority)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_set_damage_roi"))
+		return false;
+	if (!(encoder->info.caps & OBS_ENCODER_CAP_ROI))
+		return false;
+	if (priority < -1.0f || priority > 1.0f)
+		return false;
+
+	encoder->damage_roi_priority = priority;
+	if (priority == 0.0f && encoder->damage_roi.num) {
+		pthread_mutex_lock(&encoder->roi_mutex);
+		da_resize(encoder->damage_roi, 0);
+		encoder->roi_increment++;
+		pthread_mutex_unlock(&encoder->roi_mutex);
+	}
+
+	return true;
+}
+
 bool obs_encoder_set_group(obs_encoder_t *encoder, obs_encoder_group_t *group)
 {
 	if (!obs_encoder_valid(encoder, "obs_encoder_set_group"))
@@ -155,6 +155,19 @@ struct encoder_frame {
 
 	/** Presentation timestamp */
 	int64_t pts;
+
+	/**
+	 * Video only: same picture as the previous frame sent to the encoder,
+	 * which it may encode as skipped blocks or a duplicate frame
+	 */
+	bool repeat;
+
+	/**
+	 * Video only: the parts of the picture that changed since the
+	 * previous frame sent to the encoder, the blocks outside of them can
+	 * be encoded as skipped.  NULL if all of it may have changed.
+	 */
+	const struct video_damage *damage;
 };
 
 /** Encoder region of interest */
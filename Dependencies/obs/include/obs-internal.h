@@ -108,6 +108,11 @@ struct obs_module {
 	void *module;
 	bool loaded;
 
+	/* opened from the module manifest: the binary is loaded the first time
+	 * one of type_ids is looked up */
+	bool deferred;
+	DARRAY(char *) type_ids;
+
 	bool (*load)(void);
 	void (*unload)(void);
 	void (*post_load)(void);
@@ -124,6 +129,9 @@ struct obs_module {
 };
 
 extern void free_module(struct obs_module *mod);
+extern bool load_deferred_module_for_type(const char *id);
+extern void save_module_manifest(void);
+extern void free_module_manifest(void);
 
 struct obs_module_path {
 	char *bin;
@@ -217,6 +225,71 @@ struct obs_view {
 
 extern bool obs_view_init(struct obs_view *view);
 extern void obs_view_free(struct obs_view *view);
+extern bool obs_view_add_content_hash(struct obs_view *view, uint64_t *hash);
+
+/* ------------------------------------------------------------------------- */
+/* content hashes
+ *
+ * FNV-1a over everything rendering a canvas depends on (item transforms,
+ * source pointers and the serials sources bump when their output changes),
+ * so that the graphics thread can tell that a canvas would render exactly
+ * as it did last frame.  The *_add_content_hash functions return false for
+ * content that cannot be tracked, such as filters or synchronous sources
+ * without OBS_SOURCE_CONTENT_TRACKED. */
+
+#define CONTENT_HASH_INIT 0xcbf29ce484222325ULL
+
+static inline void content_hash_add(uint64_t *hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+	uint64_t h = *hash;
+
+	for (size_t i = 0; i < size; i++) {
+		h ^= bytes[i];
+		h *= 0x100000001b3ULL;
+	}
+
+	*hash = h;
+}
+
+/* ------------------------------------------------------------------------- */
+/* canvas damage
+ *
+ * What changed on a canvas since the last frame, found by walking the same
+ * tree as the content hash: a source whose content hash differs from the one
+ * it had on the last frame adds the rects that changed (from its async frames
+ * or obs_source_add_damage), or all of its area if that is not known, and
+ * scenes add where moved or changed items were and are now.  Graphics thread
+ * only. */
+
+/* where a source is drawn on the canvas */
+struct damage_space {
+	/* source pixels to canvas pixels */
+	struct matrix4 transform;
+
+	/* source pixels around a changed one that scaling blends it into */
+	float margin;
+
+	/* canvas pixels the source can draw to */
+	float clip_left;
+	float clip_top;
+	float clip_right;
+	float clip_bottom;
+};
+
+struct canvas_damage {
+	struct video_damage region;
+	bool full;
+};
+
+extern void canvas_damage_add_rect(struct canvas_damage *damage, const struct damage_space *space, float left,
+				   float top, float right, float bottom);
+extern void damage_space_clip(struct damage_space *space, float left, float top, float right, float bottom);
+extern void obs_source_add_canvas_damage(obs_source_t *source, const struct damage_space *space,
+					 struct canvas_damage *damage);
+extern uint64_t obs_view_get_channels_hash(struct obs_view *view);
+extern void obs_view_add_canvas_damage(struct obs_view *view, const struct damage_space *space,
+				       struct canvas_damage *damage);
 
 /* ------------------------------------------------------------------------- */
 /* displays */
@@ -278,6 +351,26 @@ struct obs_core_video_mix {
 	enum gs_color_space render_space;
 	bool texture_rendered;
 	bool textures_copied[NUM_TEXTURES];
+
+	/* the canvas is not rendered again while its content hash stays the
+	 * same; raw outputs then repeat the previous frame instead of staging
+	 * the texture */
+	uint64_t content_hash;
+	bool content_hash_valid;
+	bool canvas_unchanged;
+	bool textures_repeat[NUM_TEXTURES];
+
+	/* what changed since the last render, if the mix was also rendered
+	 * on the last frame: the canvas and the scaled output texture are
+	 * then only updated there (damage_partial), and raw outputs get the
+	 * damage of each staged frame in output pixels */
+	uint64_t damage_frame;
+	uint64_t damage_canvas_state;
+	struct video_damage damage;
+	bool damage_partial;
+	bool output_texture_current;
+	struct video_damage textures_damage[NUM_TEXTURES];
+	bool raw_frame_lost;
 	bool texture_converted;
 	bool using_nv12_tex;
 	bool using_p010_tex;
@@ -287,6 +380,8 @@ struct obs_core_video_mix {
 	int cur_texture;
 	volatile long raw_active;
 	volatile long gpu_encoder_active;
+	/* raw encoders connected to this mix but paused, see suspend_raw_video */
+	volatile long suspended_encoders;
 	bool gpu_was_active;
 	bool raw_was_active;
 	bool was_active;
@@ -343,6 +438,10 @@ struct obs_core_video {
 	uint32_t lagged_frames;
 	bool thread_initialized;
 
+	/* graphics loop iterations, the frames canvas damage is tracked
+	 * between */
+	uint64_t damage_frame;
+
 	gs_texture_t *transparent_texture;
 
 	gs_effect_t *deinterlace_discard_effect;
@@ -366,6 +465,12 @@ struct obs_core_video {
 	pthread_mutex_t mixes_mutex;
 	DARRAY(struct obs_core_video_mix *) mixes;
 	struct obs_core_video_mix *main_mix;
+
+	/* row-band workers for outputs without GPU conversion, created the
+	 * first time such an output needs a YUV frame */
+	os_task_pool_t *convert_pool;
+	os_sem_t *convert_done;
+	bool convert_pool_initialized;
 };
 
 extern void add_ready_encoder_group(obs_encoder_t *encoder);
@@ -467,11 +572,31 @@ struct obs_core_hotkeys {
 
 typedef DARRAY(struct obs_source_info) obs_source_info_array_t;
 
+/* signals that fire often enough to be worth interning once in obs_init
+ * instead of hashing their names every time they are emitted */
+struct obs_core_signal_ids {
+	signal_id_t source_activate, activate;
+	signal_id_t source_deactivate, deactivate;
+	signal_id_t source_show, show;
+	signal_id_t source_hide, hide;
+	signal_id_t source_audio_activate, audio_activate;
+	signal_id_t source_audio_deactivate, audio_deactivate;
+	signal_id_t media_play, media_pause, media_restart, media_stopped;
+	signal_id_t media_next, media_previous, media_started, media_ended;
+	signal_id_t item_transform;
+};
+
 struct obs_core {
 	struct obs_module *first_module;
 	DARRAY(struct obs_module_path) module_paths;
 	DARRAY(char *) safe_modules;
 
+	/* recursive; serializes type registration and deferred module loads */
+	pthread_mutex_t module_mutex;
+	char *module_manifest_path;
+	obs_data_t *module_manifest;
+	bool module_manifest_dirty;
+
 	obs_source_info_array_t source_types;
 	obs_source_info_array_t input_types;
 	obs_source_info_array_t filter_types;
@@ -482,6 +607,7 @@ struct obs_core {
 
 	signal_handler_t *signals;
 	proc_handler_t *procs;
+	struct obs_core_signal_ids signal_ids;
 
 	char *locale;
 	char *module_config_path;
@@ -528,6 +654,7 @@ extern struct obs_core_video_mix *get_mix_for_video(video_t *video);
 extern void start_raw_video(video_t *video, const struct video_scale_info *conversion, uint32_t frame_rate_divisor,
 			    void (*callback)(void *param, struct video_data *frame), void *param);
 extern void stop_raw_video(video_t *video, void (*callback)(void *param, struct video_data *frame), void *param);
+extern void suspend_raw_video(video_t *video, bool suspend);
 
 /* ------------------------------------------------------------------------- */
 /* obs shared context data */
@@ -641,6 +768,27 @@ struct async_frame {
 	bool used;
 };
 
+/* the frames libobs allocates for async sources, what libobs keeps about a
+ * frame besides struct obs_source_frame lives here so that the public struct
+ * keeps its layout */
+struct async_source_frame {
+	struct obs_source_frame frame;
+
+	/* external frames: the planes stay the caller's until release */
+	obs_source_frame_release_t release;
+	void *release_param;
+
+	/* what changed since the source's previous frame (all of it when
+	 * there are no rects), and the number the frame was queued as */
+	struct video_damage damage;
+	uint64_t damage_seq;
+};
+
+static inline struct async_source_frame *get_async_source_frame(struct obs_source_frame *frame)
+{
+	return (struct async_source_frame *)frame;
+}
+
 enum audio_action_type {
 	AUDIO_ACTION_VOL,
 	AUDIO_ACTION_MUTE,
@@ -731,6 +879,30 @@ struct obs_source {
 	/* hint to allow sources to render more quickly */
 	bool texcoords_centered;
 
+	/* bumped whenever what the source renders may have changed: a new
+	 * async frame, a settings update or obs_source_content_changed */
+	volatile long content_serial;
+
+	/* the rects that changed with content_serial; each tick takes them
+	 * for the frame along with the serial, so both match what is
+	 * rendered */
+	pthread_mutex_t damage_mutex;
+	struct video_damage pending_damage;
+	bool pending_damage_all;
+	struct video_damage tick_damage;
+	bool tick_damage_all;
+	long tick_content_serial;
+
+	/* canvas damage, graphics thread only: the content hash and the
+	 * source's own state (size, filters, and for transitions the child
+	 * and matrix) on the last frame the source was drawn on and on the
+	 * one before */
+	uint64_t damage_frame;
+	uint64_t damage_hash[2];
+	bool damage_tracked[2];
+	bool damage_continuous;
+	uint64_t damage_state[2];
+
 	/* timing (if video is present, is based upon video) */
 	volatile bool timing_set;
 	volatile uint64_t timing_adjust;
@@ -791,6 +963,7 @@ struct obs_source {
 	bool async_active;
 	bool async_update_texture;
 	bool async_unbuffered;
+	bool async_drop_oldest;
 	bool async_decoupled;
 	struct obs_source_frame *async_preload_frame;
 	DARRAY(struct async_frame) async_cache;
@@ -804,6 +977,11 @@ struct obs_source {
 	uint32_t async_convert_height[MAX_AV_PLANES];
 	uint64_t async_last_rendered_ts;
 
+	/* frames are numbered as they are queued, a gap to the last one
+	 * shown means a frame with damage was dropped */
+	uint64_t async_frame_seq;
+	uint64_t async_shown_seq;
+
 	pthread_mutex_t caption_cb_mutex;
 	DARRAY(struct caption_cb_info) caption_cb_list;
 
@@ -895,6 +1073,10 @@ extern void obs_transition_tick(obs_source_t *transition, float t);
 extern void obs_transition_enum_sources(obs_source_t *transition, obs_source_enum_proc_t enum_callback, void *param);
 extern void obs_transition_save(obs_source_t *source, obs_data_t *data);
 extern void obs_transition_load(obs_source_t *source, obs_data_t *data);
+extern bool obs_transition_add_content_hash(obs_source_t *transition, uint64_t *hash);
+extern uint64_t obs_transition_get_damage_state(obs_source_t *transition);
+extern void obs_transition_add_canvas_damage(obs_source_t *transition, const struct damage_space *space,
+					     bool continuous, struct canvas_damage *damage);
 
 struct audio_monitor *audio_monitor_create(obs_source_t *source);
 void audio_monitor_reset(struct audio_monitor *monitor);
@@ -916,14 +1098,40 @@ static inline void obs_source_dosignal(struct obs_source *source, const char *si
 	struct calldata data;
 	uint8_t stack[128];
 
+	bool to_obs = signal_obs && !source->context.private && signal_handler_has_callbacks(obs->signals, signal_obs);
+	bool to_source = signal_source && signal_handler_has_callbacks(source->context.signals, signal_source);
+	if (!to_obs && !to_source)
+		return;
+
 	calldata_init_fixed(&data, stack, sizeof(stack));
 	calldata_set_ptr(&data, "source", source);
-	if (signal_obs && !source->context.private)
+	if (to_obs)
 		signal_handler_signal(obs->signals, signal_obs, &data);
-	if (signal_source)
+	if (to_source)
 		signal_handler_signal(source->context.signals, signal_source, &data);
 }
 
+static inline void obs_source_dosignal_id(struct obs_source *source, signal_id_t signal_obs, signal_id_t signal_source)
+{
+	struct calldata data;
+	uint8_t stack[128];
+
+	/* media and show/hide signals fire constantly, mostly with nobody
+	 * listening */
+	bool to_obs = signal_obs && !source->context.private &&
+		      signal_handler_has_callbacks_id(obs->signals, signal_obs);
+	bool to_source = signal_source && signal_handler_has_callbacks_id(source->context.signals, signal_source);
+	if (!to_obs && !to_source)
+		return;
+
+	calldata_init_fixed(&data, stack, sizeof(stack));
+	calldata_set_ptr(&data, "source", source);
+	if (to_obs)
+		signal_handler_signal_id(obs->signals, signal_obs, &data);
+	if (to_source)
+		signal_handler_signal_id(source->context.signals, signal_source, &data);
+}
+
 /* maximum timestamp variance in nanoseconds */
 #define MAX_TS_VAR 2000000000ULL
 
@@ -991,6 +1199,11 @@ extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
 extern void obs_source_video_tick(obs_source_t *source, float seconds);
 extern float obs_source_get_target_volume(obs_source_t *source, obs_source_t *target);
 extern uint64_t obs_source_get_last_async_ts(const obs_source_t *source);
+extern bool obs_source_opaque(obs_source_t *source);
+extern bool obs_source_add_content_hash(obs_source_t *source, uint64_t *hash);
+extern bool obs_scene_add_content_hash(obs_scene_t *scene, uint64_t *hash);
+extern void obs_scene_add_canvas_damage(obs_scene_t *scene, const struct damage_space *space, bool continuous,
+					struct canvas_damage *damage);
 
 extern void obs_source_audio_render(obs_source_t *source, uint32_t mixers, size_t channels, size_t sample_rate,
 				    size_t size);
@@ -1029,6 +1242,39 @@ struct delay_data {
 
 typedef void (*encoded_callback_t)(void *data, struct encoder_packet *packet, struct encoder_packet_time *frame_time);
 
+/* Timing entries of frames still inside an encoder or output, looked up by
+ * pts in O(1).  Entries sit in an open addressing table; the order they were
+ * added in is kept alongside so the oldest can be dropped.  An entry is
+ * dropped once PACKET_TIME_INDEX_MAX newer ones were added, so frames an
+ * encoder never returns do not grow the index forever. */
+#define PACKET_TIME_INDEX_MAX 1024
+
+struct packet_time_slot {
+	struct encoder_packet_time ept;
+	uint64_t seq;
+	bool used;
+};
+
+struct packet_time_order {
+	int64_t pts;
+	uint64_t seq;
+};
+
+struct packet_time_index {
+	struct packet_time_slot *slots;
+	size_t capacity;
+	size_t count;
+	uint64_t next_seq;
+	struct deque order;
+};
+
+extern void packet_time_index_push(struct packet_time_index *index, const struct encoder_packet_time *ept);
+extern bool packet_time_index_take(struct packet_time_index *index, int64_t pts, struct encoder_packet_time *ept);
+extern void packet_time_index_pop_front(struct packet_time_index *index);
+extern void packet_time_index_offset(struct packet_time_index *index, int64_t offset);
+extern void packet_time_index_clear(struct packet_time_index *index);
+extern void packet_time_index_free(struct packet_time_index *index);
+
 struct obs_weak_output {
 	struct obs_weak_ref ref;
 	struct obs_output *output;
@@ -1076,6 +1322,8 @@ struct keyframe_group_data {
 	enum keyframe_group_track_status seen_on_track[MAX_OUTPUT_VIDEO_ENCODERS];
 };
 
+#define INTERLEAVED_TRACKS (MAX_OUTPUT_VIDEO_ENCODERS + MAX_OUTPUT_AUDIO_ENCODERS)
+
 struct obs_output {
 	struct obs_context_data context;
 	struct obs_output_info info;
@@ -1095,7 +1343,9 @@ struct obs_output {
 	pthread_t end_data_capture_thread;
 	os_event_t *stopping_event;
 	pthread_mutex_t interleaved_mutex;
-	DARRAY(struct encoder_packet) interleaved_packets;
+	/* one dts-ordered queue per video track followed by one per audio
+	 * track; the interleaved order is the merge of the queue heads */
+	struct deque interleaved_packets[INTERLEAVED_TRACKS];
 	int stop_code;
 
 	int reconnect_retry_sec;
@@ -1143,8 +1393,8 @@ struct obs_output {
 	// captions are output per track
 	struct caption_track_data *caption_tracks[MAX_OUTPUT_VIDEO_ENCODERS];
 
-	DARRAY(struct encoder_packet_time)
-	encoder_packet_times[MAX_OUTPUT_VIDEO_ENCODERS];
+	struct packet_time_index encoder_packet_times[MAX_OUTPUT_VIDEO_ENCODERS];
+	struct obs_output_latency_stats latency_stats[MAX_OUTPUT_VIDEO_ENCODERS];
 
 	/* Packet callbacks */
 	pthread_mutex_t pkt_callbacks_mutex;
@@ -1244,6 +1494,10 @@ struct obs_encoder {
 	volatile bool paused;
 	bool initialized;
 
+	/* paused and no longer counted as a consumer of raw video/audio, see
+	 * obs_encoder_set_suspended (protected by init_mutex) */
+	bool suspended;
+
 	/* indicates ownership of the info.id buffer */
 	bool owns_info_id;
 
@@ -1261,15 +1515,34 @@ struct obs_encoder {
 	uint32_t frame_rate_divisor_counter; // only used for GPU encoders
 	video_t *fps_override;
 
+	/* raw video frames this encoder falls behind on are skipped instead of
+	 * repeated, see obs_encoder_set_skip_late_frames */
+	bool skip_late_frames;
+
 	// Number of frames successfully encoded
 	uint32_t encoded_frames;
 
+	/* packet currently being handed to the callbacks: the first callback
+	 * that keeps it copies it into fanout_packet, the rest take a reference
+	 * to that copy */
+	const uint8_t *fanout_src;
+	struct encoder_packet fanout_packet;
+	volatile long long packet_bytes_copied;
+	volatile long long packet_bytes_shared;
+
 	/* Regions of interest to prioritize during encoding */
 	pthread_mutex_t roi_mutex;
 	DARRAY(struct obs_encoder_roi) roi;
 	uint32_t roi_increment;
 
+	/* the damage of the last raw frame, as regions of interest under
+	 * the ones above (obs_encoder_set_damage_roi) */
+	DARRAY(struct obs_encoder_roi) damage_roi;
+	float damage_roi_priority;
+
 	int64_t cur_pts;
+	uint64_t last_raw_video_ts;
+	bool last_raw_video_encoded;
 
 	struct deque audio_input_buffer[MAX_AV_PLANES];
 	uint8_t *audio_output_buffer[MAX_AV_PLANES];
@@ -1295,7 +1568,7 @@ struct obs_encoder {
 	pthread_mutex_t callbacks_mutex;
 	DARRAY(struct encoder_callback) callbacks;
 
-	DARRAY(struct encoder_packet_time) encoder_packet_times;
+	struct packet_time_index encoder_packet_times;
 
 	struct pause_data pause;
 
@@ -1317,6 +1590,8 @@ extern void obs_encoder_stop(obs_encoder_t *encoder, encoded_callback_t new_pack
 extern void obs_encoder_add_output(struct obs_encoder *encoder, struct obs_output *output);
 extern void obs_encoder_remove_output(struct obs_encoder *encoder, struct obs_output *output);
 
+extern void obs_encoder_set_suspended(obs_encoder_t *encoder, bool suspend);
+
 extern bool start_gpu_encode(obs_encoder_t *encoder);
 extern void stop_gpu_encode(obs_encoder_t *encoder);
 
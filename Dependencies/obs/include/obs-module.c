@@ -15,6 +15,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <sys/stat.h>
+
 #include "util/platform.h"
 #include "util/dstr.h"
 
@@ -90,6 +92,339 @@ static inline char *get_module_name(const char *file)
 	return name.array;
 }
 
+/* ------------------------------------------------------------------------- */
+/* module manifest */
+
+/* module whose obs_module_load is running on this thread */
+static THREAD_LOCAL struct obs_module *loading_module = NULL;
+
+/* set while obs_register_* checks for duplicate ids, which must not pull in
+ * deferred modules */
+static THREAD_LOCAL bool registering_type = false;
+
+static void record_type_id(const char *id)
+{
+	struct obs_module *mod = loading_module;
+	char *copy;
+
+	if (!mod || !id)
+		return;
+
+	for (size_t i = 0; i < mod->type_ids.num; i++) {
+		if (strcmp(mod->type_ids.array[i], id) == 0)
+			return;
+	}
+
+	copy = bstrdup(id);
+	da_push_back(mod->type_ids, &copy);
+}
+
+static void clear_type_ids(struct obs_module *mod)
+{
+	for (size_t i = 0; i < mod->type_ids.num; i++)
+		bfree(mod->type_ids.array[i]);
+	da_free(mod->type_ids);
+}
+
+static bool get_module_file_info(const char *path, long long *size, long long *mtime)
+{
+	struct stat st;
+
+	if (os_stat(path, &st) != 0)
+		return false;
+
+	*size = (long long)st.st_size;
+	*mtime = (long long)st.st_mtime;
+	return true;
+}
+
+static obs_data_t *get_manifest_modules(void)
+{
+	obs_data_t *modules = obs_data_get_obj(obs->module_manifest, "modules");
+	if (!modules) {
+		modules = obs_data_create();
+		obs_data_set_obj(obs->module_manifest, "modules", modules);
+	}
+	return modules;
+}
+
+/* Entries are only used while the binary has the size and modification
+ * time it had when its types were recorded */
+static obs_data_array_t *get_manifest_types(const char *path)
+{
+	obs_data_t *modules;
+	obs_data_t *entry;
+	obs_data_array_t *types = NULL;
+	long long size, mtime;
+
+	if (!obs->module_manifest || !get_module_file_info(path, &size, &mtime))
+		return NULL;
+
+	modules = get_manifest_modules();
+	entry = obs_data_get_obj(modules, path);
+
+	if (entry && obs_data_get_int(entry, "size") == size && obs_data_get_int(entry, "mtime") == mtime &&
+	    !obs_data_get_bool(entry, "post_load"))
+		types = obs_data_get_array(entry, "types");
+
+	obs_data_release(entry);
+	obs_data_release(modules);
+	return types;
+}
+
+static bool manifest_entry_matches(obs_data_t *entry, const struct obs_module *mod, long long size, long long mtime)
+{
+	obs_data_array_t *types;
+	bool match;
+
+	if (!entry || obs_data_get_int(entry, "size") != size || obs_data_get_int(entry, "mtime") != mtime ||
+	    obs_data_get_bool(entry, "post_load") != !!mod->post_load)
+		return false;
+
+	types = obs_data_get_array(entry, "types");
+	match = obs_data_array_count(types) == mod->type_ids.num;
+
+	for (size_t i = 0; match && i < mod->type_ids.num; i++) {
+		obs_data_t *type = obs_data_array_item(types, i);
+		match = strcmp(obs_data_get_string(type, "id"), mod->type_ids.array[i]) == 0;
+		obs_data_release(type);
+	}
+
+	obs_data_array_release(types);
+	return match;
+}
+
+/* Records the types of a module that just loaded, or drops its entry if it
+ * failed */
+static void update_manifest(const struct obs_module *mod)
+{
+	obs_data_t *modules;
+	obs_data_t *entry;
+	long long size, mtime;
+	bool have_info;
+
+	if (!obs->module_manifest)
+		return;
+
+	pthread_mutex_lock(&obs->module_mutex);
+
+	modules = get_manifest_modules();
+	entry = obs_data_get_obj(modules, mod->bin_path);
+	have_info = get_module_file_info(mod->bin_path, &size, &mtime);
+
+	if (mod->loaded && have_info) {
+		if (!manifest_entry_matches(entry, mod, size, mtime)) {
+			obs_data_array_t *types = obs_data_array_create();
+
+			for (size_t i = 0; i < mod->type_ids.num; i++) {
+				obs_data_t *type = obs_data_create();
+				obs_data_set_string(type, "id", mod->type_ids.array[i]);
+				obs_data_array_push_back(types, type);
+				obs_data_release(type);
+			}
+
+			obs_data_t *new_entry = obs_data_create();
+			obs_data_set_int(new_entry, "size", size);
+			obs_data_set_int(new_entry, "mtime", mtime);
+			obs_data_set_bool(new_entry, "post_load", !!mod->post_load);
+			obs_data_set_array(new_entry, "types", types);
+			obs_data_set_obj(modules, mod->bin_path, new_entry);
+			obs_data_release(new_entry);
+			obs_data_array_release(types);
+			obs->module_manifest_dirty = true;
+		}
+	} else if (entry) {
+		obs_data_erase(modules, mod->bin_path);
+		obs->module_manifest_dirty = true;
+	}
+
+	obs_data_release(entry);
+	obs_data_release(modules);
+	pthread_mutex_unlock(&obs->module_mutex);
+}
+
+void obs_set_module_manifest_path(const char *path)
+{
+	obs_data_t *manifest = NULL;
+
+	if (!obs)
+		return;
+
+	if (path && *path) {
+		manifest = obs_data_create_from_json_file_safe(path, "bak");
+		if (!manifest || obs_data_get_int(manifest, "version") != LIBOBS_API_VER) {
+			obs_data_release(manifest);
+			manifest = obs_data_create();
+			obs_data_set_int(manifest, "version", LIBOBS_API_VER);
+		}
+	}
+
+	pthread_mutex_lock(&obs->module_mutex);
+	free_module_manifest();
+	obs->module_manifest = manifest;
+	obs->module_manifest_path = manifest ? bstrdup(path) : NULL;
+	pthread_mutex_unlock(&obs->module_mutex);
+}
+
+void save_module_manifest(void)
+{
+	pthread_mutex_lock(&obs->module_mutex);
+
+	if (obs->module_manifest && obs->module_manifest_dirty) {
+		if (obs_data_save_json_safe(obs->module_manifest, obs->module_manifest_path, "tmp", "bak"))
+			obs->module_manifest_dirty = false;
+		else
+			blog(LOG_WARNING, "Failed to save module manifest '%s'", obs->module_manifest_path);
+	}
+
+	pthread_mutex_unlock(&obs->module_mutex);
+}
+
+void free_module_manifest(void)
+{
+	obs_data_release(obs->module_manifest);
+	bfree(obs->module_manifest_path);
+	obs->module_manifest = NULL;
+	obs->module_manifest_path = NULL;
+	obs->module_manifest_dirty = false;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void set_module_paths(struct obs_module *mod, const char *path, const char *data_path)
+{
+	mod->bin_path = bstrdup(path);
+	mod->file = strrchr(mod->bin_path, '/');
+	mod->file = (!mod->file) ? mod->bin_path : (mod->file + 1);
+	mod->mod_name = get_module_name(mod->file);
+	mod->data_path = bstrdup(data_path);
+}
+
+/* Adds the module without loading its binary if the manifest knows its
+ * types */
+static bool open_deferred_module(obs_module_t **module, const char *path, const char *data_path)
+{
+	struct obs_module mod = {0};
+	obs_data_array_t *types;
+	size_t count;
+
+	pthread_mutex_lock(&obs->module_mutex);
+	types = get_manifest_types(path);
+	pthread_mutex_unlock(&obs->module_mutex);
+
+	count = obs_data_array_count(types);
+	if (!count) {
+		obs_data_array_release(types);
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *type = obs_data_array_item(types, i);
+		char *id = bstrdup(obs_data_get_string(type, "id"));
+		da_push_back(mod.type_ids, &id);
+		obs_data_release(type);
+	}
+	obs_data_array_release(types);
+
+	set_module_paths(&mod, path, data_path);
+	mod.deferred = true;
+	mod.next = obs->first_module;
+
+	blog(LOG_DEBUG, "---------------------------------");
+	blog(LOG_DEBUG, "Deferring module: %s", mod.file);
+
+	*module = bmemdup(&mod, sizeof(mod));
+	obs->first_module = (*module);
+	return true;
+}
+
+static bool load_deferred_module(struct obs_module *mod)
+{
+	const char *profile_name =
+		profile_store_name(obs_get_profiler_name_store(), "load_deferred_module(%s)", mod->file);
+	bool success = false;
+
+	mod->deferred = false;
+	profile_start(profile_name);
+
+	mod->module = os_dlopen(mod->bin_path);
+	if (!mod->module) {
+		blog(LOG_WARNING, "Deferred module '%s' not loaded", mod->bin_path);
+		goto exit;
+	}
+
+	if (load_module_exports(mod, mod->bin_path) != MODULE_SUCCESS)
+		goto exit;
+
+	blog(LOG_INFO, "Loading deferred module: %s", mod->file);
+
+	mod->set_pointer(mod);
+	if (mod->set_locale)
+		mod->set_locale(obs->locale);
+
+	success = obs_init_module(mod);
+
+exit:
+	/* a module that fails is opened normally next time */
+	if (!mod->loaded)
+		update_manifest(mod);
+
+	profile_end(profile_name);
+	return success;
+}
+
+bool load_deferred_module_for_type(const char *id)
+{
+	struct obs_module *provider = NULL;
+	bool loaded = false;
+
+	if (!obs || !id || registering_type)
+		return false;
+
+	pthread_mutex_lock(&obs->module_mutex);
+
+	for (struct obs_module *mod = obs->first_module; !!mod && !provider; mod = mod->next) {
+		for (size_t i = 0; i < mod->type_ids.num; i++) {
+			if (strcmp(mod->type_ids.array[i], id) == 0) {
+				provider = mod;
+				break;
+			}
+		}
+	}
+
+	if (provider) {
+		/* another thread may have loaded it in the meantime */
+		loaded = provider->deferred ? load_deferred_module(provider) : provider->loaded;
+	} else {
+		/* modules can register types they did not when the manifest
+		 * was written, e.g. encoders for hardware added since */
+		for (struct obs_module *mod = obs->first_module; !!mod; mod = mod->next) {
+			if (mod->deferred)
+				loaded |= load_deferred_module(mod);
+		}
+	}
+
+	pthread_mutex_unlock(&obs->module_mutex);
+	return loaded;
+}
+
+void obs_load_deferred_modules(void)
+{
+	if (!obs)
+		return;
+
+	pthread_mutex_lock(&obs->module_mutex);
+
+	for (struct obs_module *mod = obs->first_module; !!mod; mod = mod->next) {
+		if (mod->deferred)
+			load_deferred_module(mod);
+	}
+
+	pthread_mutex_unlock(&obs->module_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+
 #ifdef _WIN32
 extern void reset_win32_symbol_paths(void);
 #endif
@@ -112,6 +447,9 @@ int obs_open_module(obs_module_t **module, const char *path, const char *data_pa
 	}
 #endif
 
+	if (open_deferred_module(module, path, data_path))
+		return MODULE_SUCCESS;
+
 	blog(LOG_DEBUG, "---------------------------------");
 
 	mod.module = os_dlopen(path);
@@ -124,11 +462,7 @@ int obs_open_module(obs_module_t **module, const char *path, const char *data_pa
 	if (errorcode != MODULE_SUCCESS)
 		return errorcode;
 
-	mod.bin_path = bstrdup(path);
-	mod.file = strrchr(mod.bin_path, '/');
-	mod.file = (!mod.file) ? mod.bin_path : (mod.file + 1);
-	mod.mod_name = get_module_name(mod.file);
-	mod.data_path = bstrdup(data_path);
+	set_module_paths(&mod, path, data_path);
 	mod.next = obs->first_module;
 
 	if (mod.file) {
@@ -149,27 +483,94 @@ bool obs_init_module(obs_module_t *module)
 {
 	if (!module || !obs)
 		return false;
-	if (module->loaded)
+	if (module->loaded || module->deferred)
 		return true;
 
 	const char *profile_name =
 		profile_store_name(obs_get_profiler_name_store(), "obs_init_module(%s)", module->file);
 	profile_start(profile_name);
 
+	/* record the types it registers for the manifest */
+	struct obs_module *prev_loading = loading_module;
+	clear_type_ids(module);
+	loading_module = module;
+
 	module->loaded = module->load();
+	loading_module = prev_loading;
+
 	if (!module->loaded)
 		blog(LOG_WARNING, "Failed to initialize module '%s'", module->file);
 
+	update_manifest(module);
+
 	profile_end(profile_name);
 	return module->loaded;
 }
 
+struct init_modules_data {
+	obs_module_t *const *modules;
+	bool *success;
+	size_t count;
+	volatile long next;
+};
+
+static void *init_modules_thread(void *param)
+{
+	struct init_modules_data *data = param;
+	long idx;
+
+	while ((idx = os_atomic_inc_long(&data->next) - 1) < (long)data->count)
+		data->success[idx] = obs_init_module(data->modules[idx]);
+
+	return NULL;
+}
+
+static const char *obs_init_modules_name = "obs_init_modules";
+
+void obs_init_modules(obs_module_t *const *modules, size_t count, bool *success)
+{
+	struct init_modules_data data = {0};
+	size_t num_threads = count;
+	pthread_t *threads;
+	size_t started = 0;
+
+	if (!obs || !modules || !count)
+		return;
+
+	data.modules = modules;
+	data.count = count;
+	data.success = success ? success : bzalloc(count * sizeof(bool));
+
+	if ((size_t)os_get_logical_cores() < num_threads)
+		num_threads = (size_t)os_get_logical_cores();
+
+	profile_start(obs_init_modules_name);
+
+	/* the calling thread is one of the workers */
+	threads = bzalloc(sizeof(pthread_t) * num_threads);
+	for (size_t i = 1; i < num_threads; i++) {
+		if (pthread_create(&threads[started], NULL, init_modules_thread, &data) == 0)
+			started++;
+	}
+
+	init_modules_thread(&data);
+
+	for (size_t i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	profile_end(obs_init_modules_name);
+
+	bfree(threads);
+	if (!success)
+		bfree(data.success);
+}
+
 void obs_log_loaded_modules(void)
 {
 	blog(LOG_INFO, "  Loaded Modules:");
 
 	for (obs_module_t *mod = obs->first_module; !!mod; mod = mod->next)
-		blog(LOG_INFO, "    %s", mod->file);
+		blog(LOG_INFO, "    %s%s", mod->file, mod->deferred ? " (deferred)" : "");
 }
 
 const char *obs_get_module_file_name(obs_module_t *module)
@@ -407,6 +808,8 @@ void obs_post_load_modules(void)
 	for (obs_module_t *mod = obs->first_module; !!mod; mod = mod->next)
 		if (mod->post_load)
 			mod->post_load();
+
+	save_module_manifest();
 }
 
 static inline void make_data_dir(struct dstr *parsed_data_dir, const char *data_dir, const char *name)
@@ -604,6 +1007,7 @@ void free_module(struct obs_module *mod)
 	if (obs->first_module == mod)
 		obs->first_module = mod->next;
 
+	clear_type_ids(mod);
 	bfree(mod->mod_name);
 	bfree(mod->bin_path);
 	bfree(mod->data_path);
@@ -715,7 +1119,7 @@ cleanup:
 #define encoder_warn(format, ...) blog(LOG_WARNING, "obs_register_encoder: " format, ##__VA_ARGS__)
 #define service_warn(format, ...) blog(LOG_WARNING, "obs_register_service: " format, ##__VA_ARGS__)
 
-void obs_register_source_s(const struct obs_source_info *info, size_t size)
+static void register_source(const struct obs_source_info *info, size_t size)
 {
 	struct obs_source_info data = {0};
 	obs_source_info_array_t *array = NULL;
@@ -808,13 +1212,16 @@ void obs_register_source_s(const struct obs_source_info *info, size_t size)
 	if (array)
 		da_push_back(*array, &data);
 	da_push_back(obs->source_types, &data);
+
+	record_type_id(data.id);
+	record_type_id(data.unversioned_id);
 	return;
 
 error:
 	HANDLE_ERROR(size, obs_source_info, info);
 }
 
-void obs_register_output_s(const struct obs_output_info *info, size_t size)
+static void register_output(const struct obs_output_info *info, size_t size)
 {
 	if (find_output(info->id)) {
 		output_warn("Output id '%s' already exists!  "
@@ -867,13 +1274,15 @@ void obs_register_output_s(const struct obs_output_info *info, size_t size)
 		}
 		strlist_free(protocols);
 	}
+
+	record_type_id(info->id);
 	return;
 
 error:
 	HANDLE_ERROR(size, obs_output_info, info);
 }
 
-void obs_register_encoder_s(const struct obs_encoder_info *info, size_t size)
+static void register_encoder(const struct obs_encoder_info *info, size_t size)
 {
 	if (find_encoder(info->id)) {
 		encoder_warn("Encoder id '%s' already exists!  "
@@ -903,13 +1312,14 @@ void obs_register_encoder_s(const struct obs_encoder_info *info, size_t size)
 #undef CHECK_REQUIRED_VAL_
 
 	REGISTER_OBS_DEF(size, obs_encoder_info, obs->encoder_types, info);
+	record_type_id(info->id);
 	return;
 
 error:
 	HANDLE_ERROR(size, obs_encoder_info, info);
 }
 
-void obs_register_service_s(const struct obs_service_info *info, size_t size)
+static void register_service(const struct obs_service_info *info, size_t size)
 {
 	if (find_service(info->id)) {
 		service_warn("Service id '%s' already exists!  "
@@ -926,8 +1336,47 @@ void obs_register_service_s(const struct obs_service_info *info, size_t size)
 #undef CHECK_REQUIRED_VAL_
 
 	REGISTER_OBS_DEF(size, obs_service_info, obs->service_types, info);
+	record_type_id(info->id);
 	return;
 
 error:
 	HANDLE_ERROR(size, obs_service_info, info);
 }
+
+/* modules initialized by obs_init_modules register from several threads */
+
+void obs_register_source_s(const struct obs_source_info *info, size_t size)
+{
+	pthread_mutex_lock(&obs->module_mutex);
+	registering_type = true;
+	register_source(info, size);
+	registering_type = false;
+	pthread_mutex_unlock(&obs->module_mutex);
+}
+
+void obs_register_output_s(const struct obs_output_info *info, size_t size)
+{
+	pthread_mutex_lock(&obs->module_mutex);
+	registering_type = true;
+	register_output(info, size);
+	registering_type = false;
+	pthread_mutex_unlock(&obs->module_mutex);
+}
+
+void obs_register_encoder_s(const struct obs_encoder_info *info, size_t size)
+{
+	pthread_mutex_lock(&obs->module_mutex);
+	registering_type = true;
+	register_encoder(info, size);
+	registering_type = false;
+	pthread_mutex_unlock(&obs->module_mutex);
+}
+
+void obs_register_service_s(const struct obs_service_info *info, size_t size)
+{
+	pthread_mutex_lock(&obs->module_mutex);
+	registering_type = true;
+	register_service(info, size);
+	registering_type = false;
+	pthread_mutex_unlock(&obs->module_mutex);
+}
@@ -119,14 +119,30 @@ static inline bool log_flag_service(const struct obs_output *output, const char
 	return ret;
 }
 
-const struct obs_output_info *find_output(const char *id)
+/* module_mutex: obs_init_modules registers types from several threads */
+static const struct obs_output_info *find_output_info(const char *id)
 {
+	const struct obs_output_info *found = NULL;
 	size_t i;
-	for (i = 0; i < obs->output_types.num; i++)
-		if (strcmp(obs->output_types.array[i].id, id) == 0)
-			return obs->output_types.array + i;
 
-	return NULL;
+	pthread_mutex_lock(&obs->module_mutex);
+	for (i = 0; i < obs->output_types.num; i++) {
+		if (strcmp(obs->output_types.array[i].id, id) == 0) {
+			found = obs->output_types.array + i;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&obs->module_mutex);
+
+	return found;
+}
+
+const struct obs_output_info *find_output(const char *id)
+{
+	const struct obs_output_info *info = find_output_info(id);
+	if (!info && load_deferred_module_for_type(id))
+		info = find_output_info(id);
+	return info;
 }
 
 const char *obs_output_get_display_name(const char *id)
@@ -226,11 +242,90 @@ fail:
 	return NULL;
 }
 
+/* ------------------------------------------------------------------------- */
+/* Interleave buffer
+ *
+ * Encoders emit packets in dts order, so every track gets its own queue and
+ * the interleaved order is a merge of the queue heads.  Queuing and sending a
+ * packet cost O(tracks) no matter how many packets are buffered. */
+
+struct interleave_cursor {
+	size_t pos[INTERLEAVED_TRACKS];
+};
+
+static inline struct deque *interleaved_queue(struct obs_output *output, enum obs_encoder_type type, size_t track_idx)
+{
+	size_t idx = type == OBS_ENCODER_VIDEO ? track_idx : MAX_OUTPUT_VIDEO_ENCODERS + track_idx;
+	return &output->interleaved_packets[idx];
+}
+
+static inline size_t interleaved_queue_size(const struct deque *queue)
+{
+	return queue->size / sizeof(struct encoder_packet);
+}
+
+static inline struct encoder_packet *interleaved_packet_at(struct deque *queue, size_t idx)
+{
+	return deque_data(queue, idx * sizeof(struct encoder_packet));
+}
+
+/* dts first, then video before audio and lower tracks before higher ones,
+ * so that pruning never drops the extra video tracks of an encoder group */
+static inline bool interleaved_packet_before(const struct encoder_packet *a, const struct encoder_packet *b)
+{
+	if (a->dts_usec != b->dts_usec)
+		return a->dts_usec < b->dts_usec;
+	if (a->type != b->type)
+		return a->type == OBS_ENCODER_VIDEO;
+	return a->track_idx < b->track_idx;
+}
+
+static struct encoder_packet *interleave_cursor_peek(struct obs_output *output,
+						     const struct interleave_cursor *cursor, size_t *track)
+{
+	struct encoder_packet *first = NULL;
+
+	for (size_t i = 0; i < INTERLEAVED_TRACKS; i++) {
+		struct encoder_packet *packet = interleaved_packet_at(&output->interleaved_packets[i], cursor->pos[i]);
+
+		if (packet && (!first || interleaved_packet_before(packet, first))) {
+			first = packet;
+			*track = i;
+		}
+	}
+
+	return first;
+}
+
+static inline struct encoder_packet *interleave_cursor_next(struct obs_output *output,
+							    struct interleave_cursor *cursor)
+{
+	size_t track;
+	struct encoder_packet *packet = interleave_cursor_peek(output, cursor, &track);
+	if (packet)
+		cursor->pos[track]++;
+	return packet;
+}
+
+static inline struct encoder_packet *first_interleaved_packet(struct obs_output *output, size_t *track)
+{
+	struct interleave_cursor cursor = {0};
+	return interleave_cursor_peek(output, &cursor, track);
+}
+
 static inline void free_packets(struct obs_output *output)
 {
-	for (size_t i = 0; i < output->interleaved_packets.num; i++)
-		obs_encoder_packet_release(output->interleaved_packets.array + i);
-	da_free(output->interleaved_packets);
+	for (size_t i = 0; i < INTERLEAVED_TRACKS; i++) {
+		struct deque *queue = &output->interleaved_packets[i];
+
+		while (queue->size) {
+			struct encoder_packet packet;
+			deque_pop_front(queue, &packet, sizeof(packet));
+			obs_encoder_packet_release(&packet);
+		}
+
+		deque_free(queue);
+	}
 }
 
 static inline void clear_raw_audio_buffers(obs_output_t *output)
@@ -295,7 +390,7 @@ void obs_output_destroy(obs_output_t *output)
 		da_free(output->keyframe_group_tracking);
 
 		for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++)
-			da_free(output->encoder_packet_times[i]);
+			packet_time_index_free(&output->encoder_packet_times[i]);
 
 		da_free(output->pkt_callbacks);
 
@@ -434,6 +529,7 @@ static void log_frame_info(struct obs_output *output)
 }
 
 static inline void signal_stop(struct obs_output *output);
+static bool output_pause(obs_output_t *output, bool pause);
 
 void obs_output_actual_stop(obs_output_t *output, bool force, uint64_t ts)
 {
@@ -443,7 +539,8 @@ void obs_output_actual_stop(obs_output_t *output, bool force, uint64_t ts)
 	if (stopping(output) && !force)
 		return;
 
-	obs_output_pause(output, false);
+	/* also undoes obs_output_pause_encoding on outputs that can't pause */
+	output_pause(output, false);
 
 	os_event_reset(output->stopping_event);
 
@@ -765,6 +862,19 @@ fail:
 		}
 	}
 
+	/* outside of the pause mutexes, the audio thread takes those while
+	 * holding the connection locks */
+	if (success) {
+		for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+			if (venc[i])
+				obs_encoder_set_suspended(venc[i], pause);
+		}
+		for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+			if (aenc[i])
+				obs_encoder_set_suspended(aenc[i], pause);
+		}
+	}
+
 	return success;
 }
 
@@ -789,14 +899,10 @@ static bool obs_raw_output_pause(obs_output_t *output, bool pause)
 	return success;
 }
 
-bool obs_output_pause(obs_output_t *output, bool pause)
+static bool output_pause(obs_output_t *output, bool pause)
 {
 	bool success;
 
-	if (!obs_output_valid(output, "obs_output_pause"))
-		return false;
-	if ((output->info.flags & OBS_OUTPUT_CAN_PAUSE) == 0)
-		return false;
 	if (!os_atomic_load_bool(&output->active))
 		return false;
 	if (os_atomic_load_bool(&output->paused) == pause)
@@ -812,6 +918,26 @@ bool obs_output_pause(obs_output_t *output, bool pause)
 	return success;
 }
 
+bool obs_output_pause(obs_output_t *output, bool pause)
+{
+	if (!obs_output_valid(output, "obs_output_pause"))
+		return false;
+	if ((output->info.flags & OBS_OUTPUT_CAN_PAUSE) == 0)
+		return false;
+
+	return output_pause(output, pause);
+}
+
+bool obs_output_pause_encoding(obs_output_t *output, bool pause)
+{
+	if (!obs_output_valid(output, "obs_output_pause_encoding"))
+		return false;
+	if (!flag_encoded(output))
+		return false;
+
+	return output_pause(output, pause);
+}
+
 bool obs_output_paused(const obs_output_t *output)
 {
 	return obs_output_valid(output, "obs_output_paused") ? os_atomic_load_bool(&output->paused) : false;
@@ -1162,6 +1288,21 @@ int obs_output_get_frames_dropped(const obs_output_t *output)
 	return output->info.get_dropped_frames(output->context.data);
 }
 
+bool obs_output_get_latency_stats(obs_output_t *output, size_t track, struct obs_output_latency_stats *stats)
+{
+	if (!obs_output_valid(output, "obs_output_get_latency_stats"))
+		return false;
+	if (!obs_ptr_valid(stats, "obs_output_get_latency_stats"))
+		return false;
+	if (!flag_encoded(output) || track >= MAX_OUTPUT_VIDEO_ENCODERS)
+		return false;
+
+	pthread_mutex_lock(&output->interleaved_mutex);
+	*stats = output->latency_stats[track];
+	pthread_mutex_unlock(&output->interleaved_mutex);
+	return true;
+}
+
 int obs_output_get_total_frames(const obs_output_t *output)
 {
 	return obs_output_valid(output, "obs_output_get_total_frames") ? output->total_frames : 0;
@@ -1644,11 +1785,34 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 	return avc || hevc || av1;
 }
 
+static void add_packet_latency(struct obs_output_latency_stats *stats, uint64_t latency_ns)
+{
+	uint64_t latency_ms = latency_ns / 1000000;
+	size_t bucket = 0;
+
+	while (latency_ms && bucket < OBS_OUTPUT_LATENCY_BUCKETS - 1) {
+		latency_ms >>= 1;
+		bucket++;
+	}
+
+	stats->count++;
+	stats->total_ns += latency_ns;
+	if (latency_ns > stats->max_ns)
+		stats->max_ns = latency_ns;
+	stats->buckets[bucket]++;
+}
+
 static inline void send_interleaved(struct obs_output *output)
 {
-	struct encoder_packet out = output->interleaved_packets.array[0];
 	struct encoder_packet_time ept_local = {0};
 	bool found_ept = false;
+	size_t track;
+
+	struct encoder_packet *first = first_interleaved_packet(output, &track);
+	if (!first)
+		return;
+
+	struct encoder_packet out = *first;
 
 	/* do not send an interleaved packet if there's no packet of the
 	 * opposing type of a higher timestamp in the interleave buffer.
@@ -1656,7 +1820,7 @@ static inline void send_interleaved(struct obs_output *output)
 	if (!has_higher_opposing_ts(output, &out))
 		return;
 
-	da_erase(output->interleaved_packets, 0);
+	deque_pop_front(&output->interleaved_packets[track], NULL, sizeof(out));
 
 	if (out.type == OBS_ENCODER_VIDEO) {
 		output->total_frames++;
@@ -1685,22 +1849,12 @@ static inline void send_interleaved(struct obs_output *output)
 		}
 		pthread_mutex_unlock(&ctrack->caption_mutex);
 
-		/* Iterate the array of encoder packet times to
-		 * find a matching PTS entry, and drain the array.
-		 * Packet timing currently applies to video only.
+		/* Look up and remove the encoder packet timing entry for
+		 * this PTS. Packet timing currently applies to video only.
 		 */
-		struct encoder_packet_time *ept = NULL;
-		size_t num_ept = output->encoder_packet_times[out.track_idx].num;
-		if (num_ept) {
-			for (size_t i = 0; i < num_ept; i++) {
-				ept = &output->encoder_packet_times[out.track_idx].array[i];
-				if (ept->pts == out.pts) {
-					ept_local = *ept;
-					da_erase(output->encoder_packet_times[out.track_idx], i);
-					found_ept = true;
-					break;
-				}
-			}
+		struct packet_time_index *times = &output->encoder_packet_times[out.track_idx];
+		if (times->count) {
+			found_ept = packet_time_index_take(times, out.pts, &ept_local);
 			if (found_ept == false) {
 				blog(LOG_DEBUG, "%s: Track %lu encoder packet timing for PTS%" PRId64 " not found.",
 				     __FUNCTION__, out.track_idx, out.pts);
@@ -1710,6 +1864,9 @@ static inline void send_interleaved(struct obs_output *output)
 			blog(LOG_DEBUG, "%s: Track %lu encoder packet timing array empty.", __FUNCTION__,
 			     out.track_idx);
 		}
+
+		if (found_ept)
+			add_packet_latency(&output->latency_stats[out.track_idx], os_gettime_ns() - ept_local.cts);
 	}
 
 	/* Iterate the registered packet callback(s) and invoke
@@ -1749,11 +1906,12 @@ static size_t get_interleaved_start_idx(struct obs_output *output)
 {
 	int64_t closest_diff = 0x7FFFFFFFFFFFFFFFLL;
 	struct encoder_packet *first_video = find_first_packet_type(output, OBS_ENCODER_VIDEO, 0);
+	struct interleave_cursor cursor = {0};
+	struct encoder_packet *packet;
 	size_t video_idx = DARRAY_INVALID;
 	size_t idx = 0;
 
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i];
+	for (size_t i = 0; (packet = interleave_cursor_next(output, &cursor)) != NULL; i++) {
 		int64_t diff;
 
 		if (packet->type != OBS_ENCODER_AUDIO) {
@@ -1792,7 +1950,7 @@ static int prune_premature_packets(struct obs_output *output)
 		return -1;
 
 	max_idx = video_idx;
-	video = &output->interleaved_packets.array[video_idx];
+	video = find_first_packet_type(output, OBS_ENCODER_VIDEO, 0);
 	duration_usec = video->timebase_num * 1000000LL / video->timebase_den;
 
 	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
@@ -1810,7 +1968,7 @@ static int prune_premature_packets(struct obs_output *output)
 			return -1;
 		}
 
-		audio = &output->interleaved_packets.array[audio_idx];
+		audio = find_first_packet_type(output, OBS_ENCODER_AUDIO, i);
 		if (audio_idx > max_idx)
 			max_idx = audio_idx;
 
@@ -1836,17 +1994,22 @@ static int prune_premature_packets(struct obs_output *output)
 	return diff > duration_usec ? max_idx + 1 : 0;
 }
 
+/* discards the first idx packets in interleaved order */
 static void discard_to_idx(struct obs_output *output, size_t idx)
 {
 	for (size_t i = 0; i < idx; i++) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i];
-		if (packet->type == OBS_ENCODER_VIDEO) {
-			da_pop_front(output->encoder_packet_times[packet->track_idx]);
+		struct encoder_packet packet;
+		size_t track;
+
+		if (!first_interleaved_packet(output, &track))
+			break;
+
+		deque_pop_front(&output->interleaved_packets[track], &packet, sizeof(packet));
+		if (packet.type == OBS_ENCODER_VIDEO) {
+			packet_time_index_pop_front(&output->encoder_packet_times[packet.track_idx]);
 		}
-		obs_encoder_packet_release(packet);
+		obs_encoder_packet_release(&packet);
 	}
-
-	da_erase_range(output->interleaved_packets, 0, idx);
 }
 
 #define DEBUG_STARTING_PACKETS 0
@@ -1858,8 +2021,9 @@ static bool prune_interleaved_packets(struct obs_output *output)
 
 #if DEBUG_STARTING_PACKETS == 1
 	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune_start);
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i];
+	struct interleave_cursor cursor = {0};
+	struct encoder_packet *packet;
+	for (size_t i = 0; (packet = interleave_cursor_next(output, &cursor)) != NULL; i++) {
 		blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
 		     packet->type == OBS_ENCODER_AUDIO ? "audio" : "video", (int)packet->track_idx, packet->dts_usec,
 		     (int)i < prune_start ? "true" : "false");
@@ -1880,25 +2044,20 @@ static bool prune_interleaved_packets(struct obs_output *output)
 	return true;
 }
 
+/* position of the first packet of a track in interleaved order; only used
+ * while starting, when the buffer is walked anyway */
 static int find_first_packet_type_idx(struct obs_output *output, enum obs_encoder_type type, size_t idx)
 {
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i];
-
-		if (packet->type == type && packet->track_idx == idx)
-			return (int)i;
-	}
-
-	return -1;
-}
+	struct encoder_packet *first = find_first_packet_type(output, type, idx);
+	struct interleave_cursor cursor = {0};
+	struct encoder_packet *packet;
 
-static int find_last_packet_type_idx(struct obs_output *output, enum obs_encoder_type type, size_t idx)
-{
-	for (size_t i = output->interleaved_packets.num; i > 0; i--) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i - 1];
+	if (!first)
+		return -1;
 
-		if (packet->type == type && packet->track_idx == idx)
-			return (int)(i - 1);
+	for (int i = 0; (packet = interleave_cursor_next(output, &cursor)) != NULL; i++) {
+		if (packet == first)
+			return i;
 	}
 
 	return -1;
@@ -1907,15 +2066,15 @@ static int find_last_packet_type_idx(struct obs_output *output, enum obs_encoder
 static inline struct encoder_packet *find_first_packet_type(struct obs_output *output, enum obs_encoder_type type,
 							    size_t audio_idx)
 {
-	int idx = find_first_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
+	return interleaved_packet_at(interleaved_queue(output, type, audio_idx), 0);
 }
 
 static inline struct encoder_packet *find_last_packet_type(struct obs_output *output, enum obs_encoder_type type,
 							   size_t audio_idx)
 {
-	int idx = find_last_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
+	struct deque *queue = interleaved_queue(output, type, audio_idx);
+	size_t size = interleaved_queue_size(queue);
+	return size ? interleaved_packet_at(queue, size - 1) : NULL;
 }
 
 static bool get_audio_and_video_packets(struct obs_output *output, struct encoder_packet **video,
@@ -2014,9 +2173,11 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	output->highest_audio_ts -= audio[first_audio_idx]->dts_usec;
 
 	/* apply new offsets to all existing packet DTS/PTS values */
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i];
-		apply_interleaved_packet_offset(output, packet, NULL);
+	for (size_t i = 0; i < INTERLEAVED_TRACKS; i++) {
+		struct deque *queue = &output->interleaved_packets[i];
+
+		for (size_t j = 0; j < interleaved_queue_size(queue); j++)
+			apply_interleaved_packet_offset(output, interleaved_packet_at(queue, j), NULL);
 	}
 
 	return true;
@@ -2024,54 +2185,48 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 
 static inline void insert_interleaved_packet(struct obs_output *output, struct encoder_packet *out)
 {
-	size_t idx;
-	for (idx = 0; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *cur_packet;
-		cur_packet = output->interleaved_packets.array + idx;
+	struct deque *queue = interleaved_queue(output, out->type, out->track_idx);
+	size_t idx = interleaved_queue_size(queue);
 
-		// sort video packets with same DTS by track index,
-		// to prevent the pruning logic from removing additional
-		// video tracks
-		if (out->dts_usec == cur_packet->dts_usec && out->type == OBS_ENCODER_VIDEO &&
-		    cur_packet->type == OBS_ENCODER_VIDEO && out->track_idx > cur_packet->track_idx)
-			continue;
+	deque_push_back(queue, out, sizeof(*out));
 
-		if (out->dts_usec == cur_packet->dts_usec && out->type == OBS_ENCODER_VIDEO) {
-			break;
-		} else if (out->dts_usec < cur_packet->dts_usec) {
+	/* a track's dts only goes backwards if its encoder misbehaves, in
+	 * which case the packet is moved back to keep the queue sorted */
+	while (idx > 0) {
+		struct encoder_packet *prev = interleaved_packet_at(queue, idx - 1);
+		struct encoder_packet *cur = interleaved_packet_at(queue, idx);
+		struct encoder_packet tmp;
+
+		if (!interleaved_packet_before(cur, prev))
 			break;
-		}
-	}
 
-	da_insert(output->interleaved_packets, idx, out);
+		tmp = *prev;
+		*prev = *cur;
+		*cur = tmp;
+		idx--;
+	}
 }
 
+/* every track is shifted by a single offset when starting, so the queues stay
+ * sorted and only the highest timestamps need to be updated */
 static void resort_interleaved_packets(struct obs_output *output)
 {
-	DARRAY(struct encoder_packet) old_array;
+	for (size_t i = 0; i < INTERLEAVED_TRACKS; i++) {
+		struct deque *queue = &output->interleaved_packets[i];
 
-	old_array.da = output->interleaved_packets.da;
-	memset(&output->interleaved_packets, 0, sizeof(output->interleaved_packets));
-
-	for (size_t i = 0; i < old_array.num; i++) {
-		set_higher_ts(output, &old_array.array[i]);
-
-		insert_interleaved_packet(output, &old_array.array[i]);
+		for (size_t j = 0; j < interleaved_queue_size(queue); j++)
+			set_higher_ts(output, interleaved_packet_at(queue, j));
 	}
-
-	da_free(old_array);
 }
 
 static void discard_unused_audio_packets(struct obs_output *output, int64_t dts_usec)
 {
+	struct interleave_cursor cursor = {0};
+	struct encoder_packet *p;
 	size_t idx = 0;
 
-	for (; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *p = &output->interleaved_packets.array[idx];
-
-		if (p->dts_usec >= dts_usec)
-			break;
-	}
+	while ((p = interleave_cursor_next(output, &cursor)) != NULL && p->dts_usec < dts_usec)
+		idx++;
 
 	if (idx)
 		discard_to_idx(output, idx);
@@ -2147,9 +2302,7 @@ static void check_encoder_group_keyframe_alignment(obs_output_t *output, struct
 static void apply_ept_offsets(struct obs_output *output)
 {
 	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
-		for (size_t j = 0; j < output->encoder_packet_times[i].num; j++) {
-			output->encoder_packet_times[i].array[j].pts -= output->video_offsets[i];
-		}
+		packet_time_index_offset(&output->encoder_packet_times[i], output->video_offsets[i]);
 	}
 }
 
@@ -2159,7 +2312,7 @@ static void interleave_packets(void *data, struct encoder_packet *packet, struct
 	struct encoder_packet out;
 	bool was_started;
 	bool received_video;
-	struct encoder_packet_time *output_packet_time = NULL;
+	struct encoder_packet_time output_packet_time;
 
 	if (!active(output))
 		return;
@@ -2193,16 +2346,17 @@ static void interleave_packets(void *data, struct encoder_packet *packet, struct
 	else
 		obs_encoder_packet_create_instance(&out, packet);
 
-	if (packet_time) {
-		output_packet_time = da_push_back_new(output->encoder_packet_times[packet->track_idx]);
-		*output_packet_time = *packet_time;
-	}
+	if (packet_time)
+		output_packet_time = *packet_time;
 
 	if (was_started)
-		apply_interleaved_packet_offset(output, &out, output_packet_time);
+		apply_interleaved_packet_offset(output, &out, packet_time ? &output_packet_time : NULL);
 	else
 		check_received(output, packet);
 
+	if (packet_time)
+		packet_time_index_push(&output->encoder_packet_times[packet->track_idx], &output_packet_time);
+
 	insert_interleaved_packet(output, &out);
 
 	received_video = true;
@@ -2392,8 +2546,9 @@ static void reset_packet_data(obs_output_t *output)
 	output->highest_audio_ts = 0;
 
 	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
-		output->encoder_packet_times[i].num = 0;
+		packet_time_index_clear(&output->encoder_packet_times[i]);
 	}
+	memset(output->latency_stats, 0, sizeof(output->latency_stats));
 
 	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
 		output->received_video[i] = false;
@@ -27,6 +27,7 @@ const struct obs_source_info group_info;
 static void resize_group(obs_sceneitem_t *group, bool scene_resize);
 static void resize_scene(obs_scene_t *scene);
 static void signal_parent(obs_scene_t *parent, const char *name, calldata_t *params);
+static void signal_parent_id(obs_scene_t *parent, signal_id_t id, calldata_t *params);
 static void get_ungrouped_transform(obs_sceneitem_t *group, obs_sceneitem_t *item, struct vec2 *pos, struct vec2 *scale,
 				    float *rot);
 static inline bool crop_enabled(const struct obs_sceneitem_crop *crop);
@@ -691,9 +692,11 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 
 	/* ----------------------- */
 
-	calldata_init_fixed(&params, stack, sizeof(stack));
-	calldata_set_ptr(&params, "item", item);
-	signal_parent(item->parent, "item_transform", &params);
+	if (signal_handler_has_callbacks_id(item->parent->source->context.signals, obs->signal_ids.item_transform)) {
+		calldata_init_fixed(&params, stack, sizeof(stack));
+		calldata_set_ptr(&params, "item", item);
+		signal_parent_id(item->parent, obs->signal_ids.item_transform, &params);
+	}
 
 	if (!update_tex)
 		return;
@@ -1052,6 +1055,101 @@ static inline bool scene_size_changed(obs_scene_t *scene)
 	return true;
 }
 
+/* ------------------------------------------------------------------------- */
+/* occlusion culling */
+
+/* opaque items above an item that are checked for covering it */
+#define MAX_OCCLUDERS 8
+
+static inline bool item_rendered(const struct obs_scene_item *item)
+{
+	return item->user_visible || transition_active(item->hide_transition);
+}
+
+/* bounding box of the item's quad in scene coordinates */
+static bool get_item_rect(const struct obs_scene_item *item, struct item_rect *rect)
+{
+	float cx = (float)calc_cx(item, item->last_width);
+	float cy = (float)calc_cy(item, item->last_height);
+
+	if (cx <= 0.0f || cy <= 0.0f)
+		return false;
+
+	rect->left = rect->top = INFINITY;
+	rect->right = rect->bottom = -INFINITY;
+
+	for (int i = 0; i < 4; i++) {
+		struct vec3 v;
+		vec3_set(&v, (i & 1) ? cx : 0.0f, (i & 2) ? cy : 0.0f, 0.0f);
+		vec3_transform(&v, &v, &item->draw_transform);
+
+		rect->left = fminf(rect->left, v.x);
+		rect->top = fminf(rect->top, v.y);
+		rect->right = fmaxf(rect->right, v.x);
+		rect->bottom = fmaxf(rect->bottom, v.y);
+	}
+
+	return true;
+}
+
+/* an item whose every pixel in its (axis aligned) rect replaces what is
+ * below it */
+static bool item_opaque(const struct obs_scene_item *item)
+{
+	if (!item->user_visible || transition_active(item->show_transition) ||
+	    transition_active(item->hide_transition))
+		return false;
+	if (!default_blending_enabled(item) || item->is_group || item_is_scene(item))
+		return false;
+	if (fmodf(item->rot, 90.0f) != 0.0f)
+		return false;
+
+	return obs_source_opaque(item->source);
+}
+
+static inline bool rect_contains(const struct item_rect *outer, const struct item_rect *inner)
+{
+	return outer->left <= inner->left && outer->top <= inner->top && outer->right >= inner->right &&
+	       outer->bottom >= inner->bottom;
+}
+
+/* Marks the items that opaque items above them cover completely.  Assumes
+ * video lock and up to date transforms. */
+static void update_occluded_items(obs_scene_t *scene)
+{
+	struct item_rect occluders[MAX_OCCLUDERS];
+	size_t num_occluders = 0;
+	struct obs_scene_item *item = scene->first_item;
+
+	while (item && item->next)
+		item = item->next;
+
+	for (; item; item = item->prev) {
+		struct item_rect rect;
+
+		item->occluded = false;
+
+		if (!item_rendered(item) || !get_item_rect(item, &rect))
+			continue;
+
+		/* edge pixels of the occluded item may only be partially
+		 * covered by the occluder, so compare whole pixels */
+		struct item_rect outer = {floorf(rect.left), floorf(rect.top), ceilf(rect.right), ceilf(rect.bottom)};
+
+		for (size_t i = 0; i < num_occluders && !item->occluded; i++)
+			item->occluded = rect_contains(&occluders[i], &outer);
+
+		if (item->occluded || num_occluders == MAX_OCCLUDERS || !item_opaque(item))
+			continue;
+
+		struct item_rect inner = {ceilf(rect.left), ceilf(rect.top), floorf(rect.right), floorf(rect.bottom)};
+		if (inner.left < inner.right && inner.top < inner.bottom)
+			occluders[num_occluders++] = inner;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
 static void scene_video_render(void *data, gs_effect_t *effect)
 {
 	obs_scene_item_ptr_array_t remove_items;
@@ -1067,12 +1165,14 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 		update_transforms_and_prune_sources(scene, &remove_items, NULL, size_changed);
 	}
 
+	update_occluded_items(scene);
+
 	gs_blend_state_push();
 	gs_reset_blend_state();
 
 	item = scene->first_item;
 	while (item) {
-		if (item->user_visible || transition_active(item->hide_transition))
+		if (item_rendered(item) && !item->occluded)
 			render_item(item);
 
 		item = item->next;
@@ -1089,6 +1189,177 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 	UNUSED_PARAMETER(effect);
 }
 
+/* Adds what rendering the scene depends on to the hash, false if that
+ * cannot be told without rendering it */
+bool obs_scene_add_content_hash(obs_scene_t *scene, uint64_t *hash)
+{
+	struct obs_scene_item *item;
+	bool tracked = true;
+
+	video_lock(scene);
+
+	/* anything that makes the next render update transforms first */
+	if (!scene->is_group && (scene_getwidth(scene) != scene->last_width || scene_getheight(scene) != scene->last_height))
+		tracked = false;
+
+	for (item = scene->first_item; tracked && item; item = item->next) {
+		if (obs_source_removed(item->source) || os_atomic_load_bool(&item->update_transform) ||
+		    os_atomic_load_bool(&item->update_group_resize) || source_size_changed(item) ||
+		    transition_active(item->show_transition) || transition_active(item->hide_transition))
+			tracked = false;
+	}
+
+	if (tracked)
+		update_occluded_items(scene);
+
+	for (item = scene->first_item; tracked && item; item = item->next) {
+		bool rendered = item_rendered(item) && !item->occluded;
+
+		content_hash_add(hash, &item, sizeof(item));
+		content_hash_add(hash, &rendered, sizeof(rendered));
+		if (!rendered)
+			continue;
+
+		content_hash_add(hash, &item->draw_transform, sizeof(item->draw_transform));
+		content_hash_add(hash, &item->crop, sizeof(item->crop));
+		content_hash_add(hash, &item->bounds_crop, sizeof(item->bounds_crop));
+		content_hash_add(hash, &item->scale_filter, sizeof(item->scale_filter));
+		content_hash_add(hash, &item->blend_method, sizeof(item->blend_method));
+		content_hash_add(hash, &item->blend_type, sizeof(item->blend_type));
+
+		tracked = obs_source_add_content_hash(item->source, hash);
+	}
+
+	video_unlock(scene);
+	return tracked;
+}
+
+/* where and how the item draws its source, a change damages the rects it
+ * was and is drawn at */
+static void update_item_damage_state(struct obs_scene_item *item, uint64_t frame)
+{
+	struct item_damage_state *state = &item->damage[0];
+
+	if (item->damage_frame == frame)
+		return;
+
+	item->damage[1] = item->damage[0];
+	item->damage_frame = frame;
+
+	state->rendered = item_rendered(item) && !item->occluded;
+	state->has_rect = get_item_rect(item, &state->rect);
+	state->hash = CONTENT_HASH_INIT;
+
+	content_hash_add(&state->hash, &item->source, sizeof(item->source));
+	content_hash_add(&state->hash, &state->rendered, sizeof(state->rendered));
+	content_hash_add(&state->hash, &item->draw_transform, sizeof(item->draw_transform));
+	content_hash_add(&state->hash, &item->crop, sizeof(item->crop));
+	content_hash_add(&state->hash, &item->bounds_crop, sizeof(item->bounds_crop));
+	content_hash_add(&state->hash, &item->scale_filter, sizeof(item->scale_filter));
+	content_hash_add(&state->hash, &item->blend_method, sizeof(item->blend_method));
+	content_hash_add(&state->hash, &item->blend_type, sizeof(item->blend_type));
+	content_hash_add(&state->hash, &item->last_width, sizeof(item->last_width));
+	content_hash_add(&state->hash, &item->last_height, sizeof(item->last_height));
+}
+
+static inline void add_item_rect_damage(struct canvas_damage *damage, const struct damage_space *space,
+					const struct item_damage_state *state)
+{
+	if (state->rendered && state->has_rect)
+		canvas_damage_add_rect(damage, space, state->rect.left, state->rect.top, state->rect.right,
+				       state->rect.bottom);
+}
+
+/* the item's source pixels to the scene's space; items drawn through a
+ * texture are cropped to their rect */
+static void get_item_damage_space(const struct obs_scene_item *item, const struct damage_space *scene_space,
+				  struct damage_space *space)
+{
+	struct matrix4 local;
+
+	*space = *scene_space;
+
+	if (item_texture_enabled(item)) {
+		matrix4_identity(&local);
+		matrix4_translate3f(&local, &local, -(float)(item->crop.left + item->bounds_crop.left),
+				    -(float)(item->crop.top + item->bounds_crop.top), 0.0f);
+		matrix4_mul(&local, &local, &item->draw_transform);
+
+		if (item->damage[0].has_rect)
+			damage_space_clip(space, item->damage[0].rect.left, item->damage[0].rect.top,
+					  item->damage[0].rect.right, item->damage[0].rect.bottom);
+	} else {
+		local = item->draw_transform;
+	}
+
+	matrix4_mul(&space->transform, &local, &scene_space->transform);
+
+	/* bilinear sampling blends a pixel into its neighbours when scaled,
+	 * the scale filters reach further */
+	space->margin = scale_filter_enabled(item) && item->scale_filter != OBS_SCALE_POINT ? 3.0f : 1.0f;
+}
+
+/* Adds the items that moved or changed and what changed in the sources of
+ * the others.  Without the state of the last frame (continuous), or with
+ * items added, removed or about to be moved, the whole scene is damaged. */
+void obs_scene_add_canvas_damage(obs_scene_t *scene, const struct damage_space *space, bool continuous,
+				 struct canvas_damage *damage)
+{
+	uint64_t frame = obs->video.damage_frame;
+	struct obs_scene_item *item;
+	bool whole = !continuous;
+
+	video_lock(scene);
+
+	if (!scene->is_group && (scene_getwidth(scene) != scene->last_width || scene_getheight(scene) != scene->last_height))
+		whole = true;
+
+	for (item = scene->first_item; item; item = item->next) {
+		if (obs_source_removed(item->source) || os_atomic_load_bool(&item->update_transform) ||
+		    os_atomic_load_bool(&item->update_group_resize) || source_size_changed(item) ||
+		    transition_active(item->show_transition) || transition_active(item->hide_transition))
+			whole = true;
+	}
+
+	if (scene->damage_frame != frame) {
+		uint64_t items = CONTENT_HASH_INIT;
+
+		for (item = scene->first_item; item; item = item->next)
+			content_hash_add(&items, &item, sizeof(item));
+
+		scene->damage_items[1] = scene->damage_items[0];
+		scene->damage_items[0] = items;
+		scene->damage_frame = frame;
+		update_occluded_items(scene);
+	}
+
+	if (scene->damage_items[0] != scene->damage_items[1])
+		whole = true;
+
+	if (whole)
+		canvas_damage_add_rect(damage, space, 0.0f, 0.0f, (float)scene_getwidth(scene),
+				       (float)scene_getheight(scene));
+
+	for (item = scene->first_item; item; item = item->next) {
+		update_item_damage_state(item, frame);
+
+		/* items can be drawn outside of the scene */
+		if (whole || item->damage[0].hash != item->damage[1].hash) {
+			add_item_rect_damage(damage, space, &item->damage[1]);
+			add_item_rect_damage(damage, space, &item->damage[0]);
+		}
+
+		if (item->damage[0].rendered) {
+			struct damage_space item_space;
+
+			get_item_damage_space(item, space, &item_space);
+			obs_source_add_canvas_damage(item->source, &item_space, damage);
+		}
+	}
+
+	video_unlock(scene);
+}
+
 static void set_visibility(struct obs_scene_item *item, bool vis)
 {
 	pthread_mutex_lock(&item->actions_mutex);
@@ -2544,6 +2815,12 @@ static void signal_parent(obs_scene_t *parent, const char *command, calldata_t *
 	signal_handler_signal(parent->source->context.signals, command, params);
 }
 
+static void signal_parent_id(obs_scene_t *parent, signal_id_t id, calldata_t *params)
+{
+	calldata_set_ptr(params, "scene", parent);
+	signal_handler_signal_id(parent->source->context.signals, id, params);
+}
+
 struct passthrough {
 	obs_data_array_t *ids;
 	obs_data_array_t *scenes_and_groups;
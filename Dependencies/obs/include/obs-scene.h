@@ -27,6 +27,21 @@ struct item_action {
 	uint64_t timestamp;
 };
 
+struct item_rect {
+	float left;
+	float top;
+	float right;
+	float bottom;
+};
+
+/* what an item was drawn with on one frame, for canvas damage */
+struct item_damage_state {
+	uint64_t hash;
+	struct item_rect rect;
+	bool has_rect;
+	bool rendered;
+};
+
 struct obs_scene_item {
 	volatile long ref;
 	volatile bool removed;
@@ -48,6 +63,14 @@ struct obs_scene_item {
 	bool selected;
 	bool locked;
 
+	/* covered by opaque items above it, not rendered this frame */
+	bool occluded;
+
+	/* the last frame the item's canvas damage was checked on, and its
+	 * state then and on the frame before */
+	uint64_t damage_frame;
+	struct item_damage_state damage[2];
+
 	gs_texrender_t *item_render;
 	struct obs_sceneitem_crop crop;
 
@@ -123,5 +146,10 @@ struct obs_scene {
 	pthread_mutex_t audio_mutex;
 	struct obs_scene_item *first_item;
 
+	/* the items in order on the last two frames checked for canvas
+	 * damage */
+	uint64_t damage_frame;
+	uint64_t damage_items[2];
+
 	DARRAY(struct scene_source_mix) mix_sources;
 };
@@ -19,14 +19,30 @@
 
 #define get_weak(service) ((obs_weak_service_t *)service->context.control)
 
-const struct obs_service_info *find_service(const char *id)
+/* module_mutex: obs_init_modules registers types from several threads */
+static const struct obs_service_info *find_service_info(const char *id)
 {
+	const struct obs_service_info *found = NULL;
 	size_t i;
-	for (i = 0; i < obs->service_types.num; i++)
-		if (strcmp(obs->service_types.array[i].id, id) == 0)
-			return obs->service_types.array + i;
 
-	return NULL;
+	pthread_mutex_lock(&obs->module_mutex);
+	for (i = 0; i < obs->service_types.num; i++) {
+		if (strcmp(obs->service_types.array[i].id, id) == 0) {
+			found = obs->service_types.array + i;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&obs->module_mutex);
+
+	return found;
+}
+
+const struct obs_service_info *find_service(const char *id)
+{
+	const struct obs_service_info *info = find_service_info(id);
+	if (!info && load_deferred_module_for_type(id))
+		info = find_service_info(id);
+	return info;
 }
 
 const char *obs_service_get_display_name(const char *id)
@@ -742,6 +742,79 @@ void obs_transition_video_render2(obs_source_t *transition, obs_transition_video
 		handle_stop(transition);
 }
 
+/* outside of a transition only source A is rendered, through
+ * obs_transition_video_render */
+bool obs_transition_add_content_hash(obs_source_t *transition, uint64_t *hash)
+{
+	obs_source_t *child = NULL;
+	struct matrix4 matrix;
+	bool tracked;
+
+	lock_transition(transition);
+	tracked = !transition->transitioning_video && !transition->transitioning_audio;
+	if (tracked)
+		child = obs_source_get_ref(transition->transition_sources[0]);
+	matrix = transition->transition_matrices[0];
+	unlock_transition(transition);
+
+	if (!tracked)
+		return false;
+
+	content_hash_add(hash, &matrix, sizeof(matrix));
+	content_hash_add(hash, &child, sizeof(child));
+
+	if (child) {
+		tracked = obs_source_add_content_hash(child, hash);
+		obs_source_release(child);
+	}
+
+	return tracked;
+}
+
+/* what decides where the child is drawn, a change damages the whole
+ * transition */
+uint64_t obs_transition_get_damage_state(obs_source_t *transition)
+{
+	uint64_t state = CONTENT_HASH_INIT;
+	obs_source_t *child;
+	bool transitioning;
+	struct matrix4 matrix;
+
+	lock_transition(transition);
+	transitioning = transition->transitioning_video || transition->transitioning_audio;
+	child = transition->transition_sources[0];
+	matrix = transition->transition_matrices[0];
+	unlock_transition(transition);
+
+	content_hash_add(&state, &transitioning, sizeof(transitioning));
+	content_hash_add(&state, &child, sizeof(child));
+	content_hash_add(&state, &matrix, sizeof(matrix));
+	return state;
+}
+
+void obs_transition_add_canvas_damage(obs_source_t *transition, const struct damage_space *space, bool continuous,
+				      struct canvas_damage *damage)
+{
+	obs_source_t *child = NULL;
+	struct damage_space child_space = *space;
+	bool transitioning;
+
+	lock_transition(transition);
+	transitioning = transition->transitioning_video || transition->transitioning_audio;
+	if (!transitioning)
+		child = obs_source_get_ref(transition->transition_sources[0]);
+	matrix4_mul(&child_space.transform, &transition->transition_matrices[0], &space->transform);
+	unlock_transition(transition);
+
+	if (!continuous || transitioning)
+		canvas_damage_add_rect(damage, space, 0.0f, 0.0f, (float)get_cx(transition), (float)get_cy(transition));
+
+	if (child) {
+		obs_source_add_canvas_damage(child, &child_space, damage);
+		obs_source_release(child);
+	}
+}
+
 static enum gs_color_space mix_spaces(enum gs_color_space a, enum gs_color_space b)
 {
 	if ((a == GS_CS_709_EXTENDED) || (a == GS_CS_709_SCRGB) || (b == GS_CS_709_EXTENDED) || (b == GS_CS_709_SCRGB))
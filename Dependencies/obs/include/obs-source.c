@@ -50,26 +50,47 @@ static inline bool destroying(const struct obs_source *source)
 	return os_atomic_load_long(&source->destroying);
 }
 
-struct obs_source_info *get_source_info(const char *id)
+/* module_mutex: obs_init_modules registers types from several threads */
+static struct obs_source_info *find_source_info(const char *id)
 {
+	struct obs_source_info *found = NULL;
+
+	pthread_mutex_lock(&obs->module_mutex);
 	for (size_t i = 0; i < obs->source_types.num; i++) {
 		struct obs_source_info *info = &obs->source_types.array[i];
-		if (strcmp(info->id, id) == 0)
-			return info;
+		if (strcmp(info->id, id) == 0) {
+			found = info;
+			break;
+		}
 	}
+	pthread_mutex_unlock(&obs->module_mutex);
 
-	return NULL;
+	return found;
+}
+
+struct obs_source_info *get_source_info(const char *id)
+{
+	struct obs_source_info *info = find_source_info(id);
+	if (!info && load_deferred_module_for_type(id))
+		info = find_source_info(id);
+	return info;
 }
 
 struct obs_source_info *get_source_info2(const char *unversioned_id, uint32_t ver)
 {
+	struct obs_source_info *found = NULL;
+
+	pthread_mutex_lock(&obs->module_mutex);
 	for (size_t i = 0; i < obs->source_types.num; i++) {
 		struct obs_source_info *info = &obs->source_types.array[i];
-		if (strcmp(info->unversioned_id, unversioned_id) == 0 && info->version == ver)
-			return info;
+		if (strcmp(info->unversioned_id, unversioned_id) == 0 && info->version == ver) {
+			found = info;
+			break;
+		}
 	}
+	pthread_mutex_unlock(&obs->module_mutex);
 
-	return NULL;
+	return found;
 }
 
 static const char *source_signals[] = {
@@ -181,6 +202,7 @@ static bool obs_source_init(struct obs_source *source)
 	pthread_mutex_init_value(&source->audio_cb_mutex);
 	pthread_mutex_init_value(&source->caption_cb_mutex);
 	pthread_mutex_init_value(&source->media_actions_mutex);
+	pthread_mutex_init_value(&source->damage_mutex);
 
 	if (pthread_mutex_init_recursive(&source->filter_mutex) != 0)
 		return false;
@@ -198,6 +220,8 @@ static bool obs_source_init(struct obs_source *source)
 		return false;
 	if (pthread_mutex_init(&source->media_actions_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&source->damage_mutex, NULL) != 0)
+		return false;
 
 	if (is_audio_source(source) || is_composite_source(source))
 		allocate_audio_output_buffer(source);
@@ -563,14 +587,39 @@ void obs_source_frame_init(struct obs_source_frame *frame, enum video_format for
 	}
 }
 
+static struct obs_source_frame *async_frame_create(enum video_format format, uint32_t width, uint32_t height)
+{
+	struct async_source_frame *async_frame = bzalloc(sizeof(*async_frame));
+
+	obs_source_frame_init(&async_frame->frame, format, width, height);
+	return &async_frame->frame;
+}
+
+/* frees a frame from async_frame_create or create_external_frame, unlike
+ * obs_source_frame_destroy this hands external planes back to their owner */
+static void async_frame_destroy(struct obs_source_frame *frame)
+{
+	struct async_source_frame *async_frame = get_async_source_frame(frame);
+
+	if (!frame)
+		return;
+
+	if (async_frame->release)
+		async_frame->release(async_frame->release_param);
+	else
+		bfree(frame->data[0]);
+	bfree(async_frame);
+}
+
 static inline void obs_source_frame_decref(struct obs_source_frame *frame)
 {
 	if (os_atomic_dec_long(&frame->refs) == 0)
-		obs_source_frame_destroy(frame);
+		async_frame_destroy(frame);
 }
 
 static bool obs_source_filter_remove_refless(obs_source_t *source, obs_source_t *filter);
 static void obs_source_destroy_defer(struct obs_source *source);
+static inline void free_async_cache(struct obs_source *source);
 
 void obs_source_destroy(struct obs_source *source)
 {
@@ -632,6 +681,12 @@ static void obs_source_destroy_defer(struct obs_source *source)
 
 	obs_source_dosignal(source, "source_destroy", "destroy");
 
+	/* frames from obs_source_output_video_external can point into memory
+	 * the source frees on destroy, so hand them back first */
+	pthread_mutex_lock(&source->async_mutex);
+	free_async_cache(source);
+	pthread_mutex_unlock(&source->async_mutex);
+
 	if (source->context.data) {
 		source->info.destroy(source->context.data);
 		source->context.data = NULL;
@@ -691,6 +746,7 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	pthread_mutex_destroy(&source->caption_cb_mutex);
 	pthread_mutex_destroy(&source->async_mutex);
 	pthread_mutex_destroy(&source->media_actions_mutex);
+	pthread_mutex_destroy(&source->damage_mutex);
 	obs_data_release(source->private_settings);
 	obs_context_data_free(&source->context);
 
@@ -909,12 +965,42 @@ uint32_t obs_get_source_output_flags(const char *id)
 	return info ? info->output_flags : 0;
 }
 
+/* records a content change, of the given rects or of everything when there
+ * are none, for the next tick to take */
+static void add_pending_damage(obs_source_t *source, const struct video_damage *damage)
+{
+	pthread_mutex_lock(&source->damage_mutex);
+
+	if (damage && damage->num)
+		video_damage_merge(&source->pending_damage, damage);
+	else
+		source->pending_damage_all = true;
+
+	os_atomic_inc_long(&source->content_serial);
+	pthread_mutex_unlock(&source->damage_mutex);
+}
+
+/* the content serial and its damage as of this tick */
+static void take_pending_damage(obs_source_t *source)
+{
+	pthread_mutex_lock(&source->damage_mutex);
+
+	source->tick_damage = source->pending_damage;
+	source->tick_damage_all = source->pending_damage_all;
+	source->tick_content_serial = os_atomic_load_long(&source->content_serial);
+	source->pending_damage.num = 0;
+	source->pending_damage_all = false;
+
+	pthread_mutex_unlock(&source->damage_mutex);
+}
+
 static void obs_source_deferred_update(obs_source_t *source)
 {
 	if (source->context.data && source->info.update) {
 		long count = os_atomic_load_long(&source->defer_update_count);
 		source->info.update(source->context.data, source->context.settings);
 		os_atomic_compare_swap_long(&source->defer_update_count, count, 0);
+		add_pending_damage(source, NULL);
 		obs_source_dosignal(source, "source_update", "update");
 	}
 }
@@ -1028,28 +1114,28 @@ static void activate_source(obs_source_t *source)
 {
 	if (source->context.data && source->info.activate)
 		source->info.activate(source->context.data);
-	obs_source_dosignal(source, "source_activate", "activate");
+	obs_source_dosignal_id(source, obs->signal_ids.source_activate, obs->signal_ids.activate);
 }
 
 static void deactivate_source(obs_source_t *source)
 {
 	if (source->context.data && source->info.deactivate)
 		source->info.deactivate(source->context.data);
-	obs_source_dosignal(source, "source_deactivate", "deactivate");
+	obs_source_dosignal_id(source, obs->signal_ids.source_deactivate, obs->signal_ids.deactivate);
 }
 
 static void show_source(obs_source_t *source)
 {
 	if (source->context.data && source->info.show)
 		source->info.show(source->context.data);
-	obs_source_dosignal(source, "source_show", "show");
+	obs_source_dosignal_id(source, obs->signal_ids.source_show, obs->signal_ids.show);
 }
 
 static void hide_source(obs_source_t *source)
 {
 	if (source->context.data && source->info.hide)
 		source->info.hide(source->context.data);
-	obs_source_dosignal(source, "source_hide", "hide");
+	obs_source_dosignal_id(source, obs->signal_ids.source_hide, obs->signal_ids.hide);
 }
 
 static void activate_tree(obs_source_t *parent, obs_source_t *child, void *param)
@@ -1152,27 +1238,27 @@ void process_media_actions(obs_source_t *source)
 			source->info.media_play_pause(source->context.data, action.pause);
 
 			if (action.pause)
-				obs_source_dosignal(source, NULL, "media_pause");
+				obs_source_dosignal_id(source, NULL, obs->signal_ids.media_pause);
 			else
-				obs_source_dosignal(source, NULL, "media_play");
+				obs_source_dosignal_id(source, NULL, obs->signal_ids.media_play);
 			break;
 
 		case MEDIA_ACTION_RESTART:
 			source->info.media_restart(source->context.data);
-			obs_source_dosignal(source, NULL, "media_restart");
+			obs_source_dosignal_id(source, NULL, obs->signal_ids.media_restart);
 			break;
 
 		case MEDIA_ACTION_STOP:
 			source->info.media_stop(source->context.data);
-			obs_source_dosignal(source, NULL, "media_stopped");
+			obs_source_dosignal_id(source, NULL, obs->signal_ids.media_stopped);
 			break;
 		case MEDIA_ACTION_NEXT:
 			source->info.media_next(source->context.data);
-			obs_source_dosignal(source, NULL, "media_next");
+			obs_source_dosignal_id(source, NULL, obs->signal_ids.media_next);
 			break;
 		case MEDIA_ACTION_PREVIOUS:
 			source->info.media_previous(source->context.data);
-			obs_source_dosignal(source, NULL, "media_previous");
+			obs_source_dosignal_id(source, NULL, obs->signal_ids.media_previous);
 			break;
 		case MEDIA_ACTION_SET_TIME:
 			source->info.media_set_time(source->context.data, action.ms);
@@ -1204,8 +1290,19 @@ static void async_tick(obs_source_t *source)
 		filter_frame(source, &source->prev_async_frame);
 	filter_frame(source, &source->cur_async_frame);
 
-	if (source->cur_async_frame)
-		source->async_update_texture = set_async_texture_size(source, source->cur_async_frame);
+	if (source->cur_async_frame) {
+		struct obs_source_frame *frame = source->cur_async_frame;
+		struct async_source_frame *async_frame = get_async_source_frame(frame);
+
+		/* the frame's damage is relative to the frame before it, only
+		 * of use if that one was shown */
+		bool consecutive = async_frame->damage_seq && async_frame->damage_seq == source->async_shown_seq + 1 &&
+				   !deinterlacing_enabled(source);
+
+		source->async_update_texture = set_async_texture_size(source, frame);
+		source->async_shown_seq = async_frame->damage_seq;
+		add_pending_damage(source, consecutive ? &async_frame->damage : NULL);
+	}
 
 	pthread_mutex_unlock(&source->async_mutex);
 }
@@ -1282,6 +1379,8 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 	if (source->context.data && source->info.video_tick)
 		source->info.video_tick(source->context.data, seconds);
 
+	take_pending_damage(source);
+
 	source->async_rendered = false;
 	source->deinterlace_rendered = false;
 }
@@ -2813,6 +2912,251 @@ void obs_source_video_render(obs_source_t *source)
 	}
 }
 
+void obs_source_content_changed(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_content_changed"))
+		return;
+
+	add_pending_damage(source, NULL);
+}
+
+void obs_source_add_damage(obs_source_t *source, uint32_t x, uint32_t y, uint32_t cx, uint32_t cy)
+{
+	struct video_damage damage = {0};
+
+	if (!obs_source_valid(source, "obs_source_add_damage"))
+		return;
+
+	video_damage_add(&damage, x, y, cx, cy);
+	if (damage.num)
+		add_pending_damage(source, &damage);
+}
+
+static inline bool async_format_opaque(enum video_format format)
+{
+	switch (format) {
+	case VIDEO_FORMAT_NONE:
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_I40A:
+	case VIDEO_FORMAT_I42A:
+	case VIDEO_FORMAT_YUVA:
+	case VIDEO_FORMAT_AYUV:
+	case VIDEO_FORMAT_YA2L:
+		return false;
+	default:
+		return true;
+	}
+}
+
+static inline bool async_video_input(const obs_source_t *source)
+{
+	return source->info.type == OBS_SOURCE_TYPE_INPUT &&
+	       (source->info.output_flags & OBS_SOURCE_ASYNC_VIDEO) == OBS_SOURCE_ASYNC_VIDEO;
+}
+
+/* whether the source covers all of its width and height with opaque pixels
+ * when rendered, filters could change that */
+bool obs_source_opaque(obs_source_t *source)
+{
+	if (!source->context.data || !source->enabled || source->filters.num)
+		return false;
+	if (!obs_source_get_width(source) || !obs_source_get_height(source))
+		return false;
+
+	if ((source->info.output_flags & OBS_SOURCE_OPAQUE) != 0)
+		return true;
+
+	return async_video_input(source) && source->async_active && source->async_textures[0] &&
+	       !deinterlacing_enabled(source) && async_format_opaque(source->async_format);
+}
+
+bool obs_source_add_content_hash(obs_source_t *source, uint64_t *hash)
+{
+	uint32_t flags = source->info.output_flags;
+
+	content_hash_add(hash, &source, sizeof(source));
+	content_hash_add(hash, &source->enabled, sizeof(source->enabled));
+
+	if ((flags & OBS_SOURCE_VIDEO) == 0 || !source->context.data || !source->enabled)
+		return true;
+	if (source->filters.num)
+		return false;
+
+	if (source->info.type == OBS_SOURCE_TYPE_SCENE)
+		return obs_scene_add_content_hash(source->context.data, hash);
+	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
+		return obs_transition_add_content_hash(source, hash);
+
+	long serial = source->tick_content_serial;
+
+	if (async_video_input(source)) {
+		if (deinterlacing_enabled(source))
+			return false;
+
+		content_hash_add(hash, &serial, sizeof(serial));
+		content_hash_add(hash, &source->async_active, sizeof(source->async_active));
+		content_hash_add(hash, &source->async_width, sizeof(source->async_width));
+		content_hash_add(hash, &source->async_height, sizeof(source->async_height));
+		content_hash_add(hash, &source->async_rotation, sizeof(source->async_rotation));
+		content_hash_add(hash, &source->async_flip, sizeof(source->async_flip));
+		return true;
+	}
+
+	if ((flags & OBS_SOURCE_CONTENT_TRACKED) != 0) {
+		uint32_t size[2] = {obs_source_get_width(source), obs_source_get_height(source)};
+
+		content_hash_add(hash, &serial, sizeof(serial));
+		content_hash_add(hash, size, sizeof(size));
+		return true;
+	}
+
+	return false;
+}
+
+static inline void transform_rect(const struct matrix4 *transform, float *left, float *top, float *right,
+				  float *bottom)
+{
+	struct vec3 corners[4];
+	float min_x = INFINITY, min_y = INFINITY;
+	float max_x = -INFINITY, max_y = -INFINITY;
+
+	vec3_set(&corners[0], *left, *top, 0.0f);
+	vec3_set(&corners[1], *right, *top, 0.0f);
+	vec3_set(&corners[2], *left, *bottom, 0.0f);
+	vec3_set(&corners[3], *right, *bottom, 0.0f);
+
+	for (size_t i = 0; i < 4; i++) {
+		vec3_transform(&corners[i], &corners[i], transform);
+		min_x = fminf(min_x, corners[i].x);
+		min_y = fminf(min_y, corners[i].y);
+		max_x = fmaxf(max_x, corners[i].x);
+		max_y = fmaxf(max_y, corners[i].y);
+	}
+
+	*left = min_x;
+	*top = min_y;
+	*right = max_x;
+	*bottom = max_y;
+}
+
+void canvas_damage_add_rect(struct canvas_damage *damage, const struct damage_space *space, float left, float top,
+			    float right, float bottom)
+{
+	if (damage->full || left >= right || top >= bottom)
+		return;
+
+	left -= space->margin;
+	top -= space->margin;
+	right += space->margin;
+	bottom += space->margin;
+	transform_rect(&space->transform, &left, &top, &right, &bottom);
+
+	/* a pixel the rect only partly covers is still sampled */
+	left = floorf(fmaxf(left - 1.0f, space->clip_left));
+	top = floorf(fmaxf(top - 1.0f, space->clip_top));
+	right = ceilf(fminf(right + 1.0f, space->clip_right));
+	bottom = ceilf(fminf(bottom + 1.0f, space->clip_bottom));
+
+	if (left >= right || top >= bottom)
+		return;
+
+	video_damage_add(&damage->region, (uint32_t)left, (uint32_t)top, (uint32_t)(right - left),
+			 (uint32_t)(bottom - top));
+}
+
+void damage_space_clip(struct damage_space *space, float left, float top, float right, float bottom)
+{
+	transform_rect(&space->transform, &left, &top, &right, &bottom);
+
+	space->clip_left = fmaxf(space->clip_left, floorf(left));
+	space->clip_top = fmaxf(space->clip_top, floorf(top));
+	space->clip_right = fminf(space->clip_right, ceilf(right));
+	space->clip_bottom = fminf(space->clip_bottom, ceilf(bottom));
+}
+
+/* async frames and obs_source_add_damage only know which rects changed on
+ * the source as it is, not rotated or flipped */
+static inline bool tick_damage_usable(const obs_source_t *source)
+{
+	if (source->tick_damage_all || !source->tick_damage.num)
+		return false;
+	if (async_video_input(source))
+		return !source->async_rotation && !source->async_flip;
+	return (source->info.output_flags & OBS_SOURCE_CONTENT_TRACKED) != 0;
+}
+
+void obs_source_add_canvas_damage(obs_source_t *source, const struct damage_space *space,
+				  struct canvas_damage *damage)
+{
+	uint64_t frame = obs->video.damage_frame;
+	uint32_t flags = source->info.output_flags;
+	uint32_t cx = obs_source_get_width(source);
+	uint32_t cy = obs_source_get_height(source);
+	bool drawn = (flags & OBS_SOURCE_VIDEO) != 0 && source->context.data && source->enabled;
+	bool composite = drawn && !source->filters.num &&
+			 (source->info.type == OBS_SOURCE_TYPE_SCENE ||
+			  source->info.type == OBS_SOURCE_TYPE_TRANSITION);
+
+	/* scenes and transitions keep their own per frame state and are
+	 * walked every frame, other sources compare content hashes */
+	if (source->damage_frame != frame) {
+		uint64_t state = CONTENT_HASH_INIT;
+		bool filtered = source->filters.num > 0;
+
+		content_hash_add(&state, &drawn, sizeof(drawn));
+		content_hash_add(&state, &filtered, sizeof(filtered));
+		content_hash_add(&state, &cx, sizeof(cx));
+		content_hash_add(&state, &cy, sizeof(cy));
+		if (composite && source->info.type == OBS_SOURCE_TYPE_TRANSITION) {
+			uint64_t transition_state = obs_transition_get_damage_state(source);
+			content_hash_add(&state, &transition_state, sizeof(transition_state));
+		}
+
+		source->damage_continuous = source->damage_frame + 1 == frame;
+		source->damage_frame = frame;
+		source->damage_state[1] = source->damage_state[0];
+		source->damage_state[0] = state;
+
+		if (!composite) {
+			uint64_t hash = CONTENT_HASH_INIT;
+			bool tracked = obs_source_add_content_hash(source, &hash);
+
+			source->damage_hash[1] = source->damage_hash[0];
+			source->damage_tracked[1] = source->damage_tracked[0];
+			source->damage_hash[0] = hash;
+			source->damage_tracked[0] = tracked;
+		}
+	}
+
+	bool whole = !source->damage_continuous || source->damage_state[0] != source->damage_state[1];
+
+	if (composite) {
+		if (source->info.type == OBS_SOURCE_TYPE_SCENE)
+			obs_scene_add_canvas_damage(source->context.data, space, !whole, damage);
+		else
+			obs_transition_add_canvas_damage(source, space, !whole, damage);
+		return;
+	}
+
+	if (!whole && source->damage_tracked[0] && source->damage_tracked[1] &&
+	    source->damage_hash[0] == source->damage_hash[1])
+		return;
+
+	if (!whole && drawn && !source->filters.num && tick_damage_usable(source)) {
+		for (uint32_t i = 0; i < source->tick_damage.num; i++) {
+			const struct video_damage_rect *rect = &source->tick_damage.rects[i];
+			float right = fminf((float)(rect->x + rect->cx), (float)cx);
+			float bottom = fminf((float)(rect->y + rect->cy), (float)cy);
+
+			canvas_damage_add_rect(damage, space, (float)rect->x, (float)rect->y, right, bottom);
+		}
+		return;
+	}
+
+	canvas_damage_add_rect(damage, space, 0.0f, 0.0f, (float)cx, (float)cy);
+}
+
 static uint32_t get_recurse_width(obs_source_t *source)
 {
 	uint32_t width;
@@ -3349,26 +3693,58 @@ static void clean_cache(obs_source_t *source)
 		struct async_frame *af = &source->async_cache.array[i - 1];
 		if (!af->used) {
 			if (++af->unused_count == MAX_UNUSED_FRAME_DURATION) {
-				obs_source_frame_destroy(af->frame);
+				async_frame_destroy(af->frame);
 				da_erase(source->async_cache, i - 1);
 			}
 		}
 	}
 }
 
+static struct obs_source_frame *create_external_frame(const struct obs_source_frame *frame,
+						      obs_source_frame_release_t release, void *param)
+{
+	struct async_source_frame *async_frame = bzalloc(sizeof(*async_frame));
+	struct obs_source_frame *new_frame = &async_frame->frame;
+
+	*new_frame = *frame;
+	new_frame->refs = 0;
+	new_frame->prev_frame = false;
+	async_frame->release = release;
+	async_frame->release_param = param;
+	return new_frame;
+}
+
+static void set_async_frame_damage(struct obs_source_frame *frame, const struct video_damage *damage)
+{
+	struct async_source_frame *async_frame = get_async_source_frame(frame);
+
+	/* no rects (all of it) for damage that does not fit */
+	async_frame->damage.num = 0;
+	if (damage && damage->num <= MAX_VIDEO_DAMAGE_RECTS)
+		video_damage_merge(&async_frame->damage, damage);
+}
+
 #define MAX_ASYNC_FRAMES 30
-//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
-static inline struct obs_source_frame *cache_video(struct obs_source *source, const struct obs_source_frame *frame)
+//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && async_frame_destroy(output)
+static inline struct obs_source_frame *cache_video(struct obs_source *source, const struct obs_source_frame *frame,
+						   const struct video_damage *damage,
+						   obs_source_frame_release_t release, void *param)
 {
 	struct obs_source_frame *new_frame = NULL;
 
 	pthread_mutex_lock(&source->async_mutex);
 
 	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
-		free_async_cache(source);
-		source->last_frame_ts = 0;
-		pthread_mutex_unlock(&source->async_mutex);
-		return NULL;
+		if (!source->async_drop_oldest) {
+			free_async_cache(source);
+			source->last_frame_ts = 0;
+			pthread_mutex_unlock(&source->async_mutex);
+			return NULL;
+		}
+
+		struct obs_source_frame *oldest = source->async_frames.array[0];
+		da_erase(source->async_frames, 0);
+		remove_async_frame(source, oldest);
 	}
 
 	if (async_texture_changed(source, frame)) {
@@ -3382,6 +3758,20 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source, co
 	source->async_cache_full_range = frame->full_range;
 	source->async_cache_trc = frame->trc;
 
+	if (release) {
+		struct async_frame new_af = {0};
+
+		new_frame = create_external_frame(frame, release, param);
+		set_async_frame_damage(new_frame, damage);
+		new_frame->refs = 2;
+		new_af.frame = new_frame;
+		new_af.used = true;
+		da_push_back(source->async_cache, &new_af);
+
+		pthread_mutex_unlock(&source->async_mutex);
+		return new_frame;
+	}
+
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *af = &source->async_cache.array[i];
 		if (!af->used) {
@@ -3398,7 +3788,7 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source, co
 	if (!new_frame) {
 		struct async_frame new_af;
 
-		new_frame = obs_source_frame_create(format, frame->width, frame->height);
+		new_frame = async_frame_create(format, frame->width, frame->height);
 		new_af.frame = new_frame;
 		new_af.used = true;
 		new_af.unused_count = 0;
@@ -3412,14 +3802,20 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source, co
 	pthread_mutex_unlock(&source->async_mutex);
 
 	copy_frame_data(new_frame, frame);
+	set_async_frame_damage(new_frame, damage);
 
 	return new_frame;
 }
 
-static void obs_source_output_video_internal(obs_source_t *source, const struct obs_source_frame *frame)
+static void obs_source_output_video_internal(obs_source_t *source, const struct obs_source_frame *frame,
+					     const struct video_damage *damage, obs_source_frame_release_t release,
+					     void *param)
 {
-	if (!obs_source_valid(source, "obs_source_output_video"))
+	if (!obs_source_valid(source, "obs_source_output_video")) {
+		if (release)
+			release(param);
 		return;
+	}
 
 	if (!frame) {
 		pthread_mutex_lock(&source->async_mutex);
@@ -3432,15 +3828,18 @@ static void obs_source_output_video_internal(obs_source_t *source, const struct
 
 	source_profiler_async_frame_received(source);
 
-	struct obs_source_frame *output = cache_video(source, frame);
+	struct obs_source_frame *output = cache_video(source, frame, damage, release, param);
+	if (!output && release)
+		release(param);
 
 	/* ------------------------------------------- */
 	pthread_mutex_lock(&source->async_mutex);
 	if (output) {
 		if (os_atomic_dec_long(&output->refs) == 0) {
-			obs_source_frame_destroy(output);
+			async_frame_destroy(output);
 			output = NULL;
 		} else {
+			get_async_source_frame(output)->damage_seq = ++source->async_frame_seq;
 			da_push_back(source->async_frames, &output);
 			source->async_active = true;
 		}
@@ -3449,18 +3848,49 @@ static void obs_source_output_video_internal(obs_source_t *source, const struct
 }
 
 void obs_source_output_video(obs_source_t *source, const struct obs_source_frame *frame)
+{
+	obs_source_output_video_damaged(source, frame, NULL);
+}
+
+void obs_source_output_video_damaged(obs_source_t *source, const struct obs_source_frame *frame,
+				     const struct video_damage *damage)
 {
 	if (destroying(source))
 		return;
 	if (!frame) {
-		obs_source_output_video_internal(source, NULL);
+		obs_source_output_video_internal(source, NULL, NULL, NULL, NULL);
 		return;
 	}
 
 	struct obs_source_frame new_frame = *frame;
 	new_frame.full_range = format_is_yuv(frame->format) ? new_frame.full_range : true;
 
-	obs_source_output_video_internal(source, &new_frame);
+	obs_source_output_video_internal(source, &new_frame, damage, NULL, NULL);
+}
+
+void obs_source_output_video_external(obs_source_t *source, const struct obs_source_frame *frame,
+				      obs_source_frame_release_t release, void *param)
+{
+	obs_source_output_video_external_damaged(source, frame, NULL, release, param);
+}
+
+void obs_source_output_video_external_damaged(obs_source_t *source, const struct obs_source_frame *frame,
+					      const struct video_damage *damage, obs_source_frame_release_t release,
+					      void *param)
+{
+	if (!release) {
+		obs_source_output_video_damaged(source, frame, damage);
+		return;
+	}
+	if (!frame || destroying(source)) {
+		release(param);
+		return;
+	}
+
+	struct obs_source_frame new_frame = *frame;
+	new_frame.full_range = format_is_yuv(frame->format) ? new_frame.full_range : true;
+
+	obs_source_output_video_internal(source, &new_frame, damage, release, param);
 }
 
 void obs_source_output_video2(obs_source_t *source, const struct obs_source_frame2 *frame)
@@ -3468,7 +3898,7 @@ void obs_source_output_video2(obs_source_t *source, const struct obs_source_fram
 	if (destroying(source))
 		return;
 	if (!frame) {
-		obs_source_output_video_internal(source, NULL);
+		obs_source_output_video_internal(source, NULL, NULL, NULL, NULL);
 		return;
 	}
 
@@ -3494,7 +3924,7 @@ void obs_source_output_video2(obs_source_t *source, const struct obs_source_fram
 	memcpy(&new_frame.color_range_min, &frame->color_range_min, sizeof(frame->color_range_min));
 	memcpy(&new_frame.color_range_max, &frame->color_range_max, sizeof(frame->color_range_max));
 
-	obs_source_output_video_internal(source, &new_frame);
+	obs_source_output_video_internal(source, &new_frame, NULL, NULL, NULL);
 }
 
 void obs_source_set_async_rotation(obs_source_t *source, long rotation)
@@ -3638,6 +4068,7 @@ void obs_source_show_preloaded_video(obs_source_t *source)
 	set_async_texture_size(source, source->async_preload_frame);
 	update_async_textures(source, source->async_preload_frame, source->async_textures, source->async_texrender);
 	source->async_active = true;
+	add_pending_damage(source, NULL);
 
 	obs_leave_graphics();
 
@@ -3665,6 +4096,7 @@ static void obs_source_set_video_frame_internal(obs_source_t *source, const stru
 	copy_frame_data(source->async_preload_frame, frame);
 	set_async_texture_size(source, source->async_preload_frame);
 	update_async_textures(source, source->async_preload_frame, source->async_textures, source->async_texrender);
+	add_pending_damage(source, NULL);
 
 	source->last_frame_ts = frame->timestamp;
 
@@ -3932,7 +4364,14 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 		struct async_frame *f = &source->async_cache.array[i];
 
 		if (f->frame == frame) {
-			f->used = false;
+			/* external frames cannot be reused, hand the
+			 * buffer back to its owner right away */
+			if (get_async_source_frame(frame)->release) {
+				da_erase(source->async_cache, i);
+				obs_source_frame_decref(frame);
+			} else {
+				f->used = false;
+			}
 			break;
 		}
 	}
@@ -4079,12 +4518,12 @@ void obs_source_release_frame(obs_source_t *source, struct obs_source_frame *fra
 		return;
 
 	if (!source) {
-		obs_source_frame_destroy(frame);
+		async_frame_destroy(frame);
 	} else {
 		pthread_mutex_lock(&source->async_mutex);
 
 		if (os_atomic_dec_long(&frame->refs) == 0)
-			obs_source_frame_destroy(frame);
+			async_frame_destroy(frame);
 		else
 			remove_async_frame(source, frame);
 
@@ -5457,6 +5896,21 @@ bool obs_source_async_unbuffered(const obs_source_t *source)
 	return obs_source_valid(source, "obs_source_async_unbuffered") ? source->async_unbuffered : false;
 }
 
+void obs_source_set_async_drop_oldest(obs_source_t *source, bool drop_oldest)
+{
+	if (!obs_source_valid(source, "obs_source_set_async_drop_oldest"))
+		return;
+
+	pthread_mutex_lock(&source->async_mutex);
+	source->async_drop_oldest = drop_oldest;
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
+bool obs_source_async_drop_oldest(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_async_drop_oldest") ? source->async_drop_oldest : false;
+}
+
 obs_data_t *obs_source_get_private_settings(obs_source_t *source)
 {
 	if (!obs_ptr_valid(source, "obs_source_get_private_settings"))
@@ -5536,9 +5990,9 @@ void obs_source_set_audio_active(obs_source_t *source, bool active)
 		return;
 
 	if (active)
-		obs_source_dosignal(source, "source_audio_activate", "audio_activate");
+		obs_source_dosignal_id(source, obs->signal_ids.source_audio_activate, obs->signal_ids.audio_activate);
 	else
-		obs_source_dosignal(source, "source_audio_deactivate", "audio_deactivate");
+		obs_source_dosignal_id(source, obs->signal_ids.source_audio_deactivate, obs->signal_ids.audio_deactivate);
 }
 
 bool obs_source_audio_active(const obs_source_t *source)
@@ -5718,7 +6172,7 @@ void obs_source_media_started(obs_source_t *source)
 	if ((source->info.output_flags & OBS_SOURCE_CONTROLLABLE_MEDIA) == 0)
 		return;
 
-	obs_source_dosignal(source, NULL, "media_started");
+	obs_source_dosignal_id(source, NULL, obs->signal_ids.media_started);
 }
 
 void obs_source_media_ended(obs_source_t *source)
@@ -5728,7 +6182,7 @@ void obs_source_media_ended(obs_source_t *source)
 	if ((source->info.output_flags & OBS_SOURCE_CONTROLLABLE_MEDIA) == 0)
 		return;
 
-	obs_source_dosignal(source, NULL, "media_ended");
+	obs_source_dosignal_id(source, NULL, obs->signal_ids.media_ended);
 }
 
 obs_data_array_t *obs_source_backup_filters(obs_source_t *source)
@@ -203,6 +203,26 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_CAP_DONT_SHOW_PROPERTIES (1 << 16)
 
+/**
+ * Source always fills its whole width and height with fully opaque pixels
+ *
+ * Scene items this source covers completely are not rendered.  Async video
+ * sources do not need to set this, libobs knows which frame formats have
+ * alpha.
+ */
+#define OBS_SOURCE_OPAQUE (1 << 17)
+
+/**
+ * Source reports when its video changes
+ *
+ * The source calls obs_source_content_changed() whenever what it renders
+ * changes, or obs_source_add_damage() for the part that changed, so that
+ * libobs can reuse the last rendered canvas while it stays the same and
+ * only update what changed.  Without this flag, synchronous video sources
+ * are assumed to change every frame.
+ */
+#define OBS_SOURCE_CONTENT_TRACKED (1 << 18)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent, obs_source_t *child, void *param);
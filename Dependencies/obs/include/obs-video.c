@@ -42,6 +42,10 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	delta_time = cur_time - last_time;
 	seconds = (float)((double)delta_time / 1000000000.0);
 
+	/* canvas damage compares what is rendered now with what was
+	 * rendered on the frame before */
+	obs->video.damage_frame++;
+
 	/* ------------------------------------- */
 	/* call tick callbacks                   */
 
@@ -121,6 +125,37 @@ static inline void set_render_size(uint32_t width, uint32_t height)
 	gs_set_viewport(0, 0, width, height);
 }
 
+/* renders to a part of the target only, in the target's coordinates */
+static inline void set_render_rect(const struct video_damage_rect *rect)
+{
+	gs_ortho((float)rect->x, (float)(rect->x + rect->cx), (float)rect->y, (float)(rect->y + rect->cy), -100.0f,
+		 100.0f);
+	gs_set_viewport((int)rect->x, (int)rect->y, (int)rect->cx, (int)rect->cy);
+}
+
+/* gs_clear ignores the viewport, so the part of the canvas that is rendered
+ * again is cleared by drawing over it */
+static void clear_render_rect(const struct video_damage_rect *rect)
+{
+	gs_effect_t *effect = obs->video.solid_effect;
+	gs_eparam_t *color = gs_effect_get_param_by_name(effect, "color");
+	struct vec4 clear_color;
+
+	vec4_zero(&clear_color);
+	gs_effect_set_vec4(color, &clear_color);
+
+	gs_blend_state_push();
+	gs_enable_blending(false);
+	gs_matrix_push();
+	gs_matrix_translate3f((float)rect->x, (float)rect->y, 0.0f);
+
+	while (gs_effect_loop(effect, "Solid"))
+		gs_draw_sprite(NULL, 0, rect->cx, rect->cy);
+
+	gs_matrix_pop();
+	gs_blend_state_pop();
+}
+
 static inline void unmap_last_surface(struct obs_core_video_mix *video)
 {
 	for (int c = 0; c < NUM_CHANNELS; ++c) {
@@ -166,22 +201,116 @@ static inline void draw_mix_texture(const size_t mix_idx)
 	gs_enable_framebuffer_srgb(false);
 }
 
+static inline bool draw_callbacks_exist(void)
+{
+	bool exist;
+
+	pthread_mutex_lock(&obs->data.draw_callbacks_mutex);
+	exist = obs->data.draw_callbacks.num > 0;
+	pthread_mutex_unlock(&obs->data.draw_callbacks_mutex);
+
+	return exist;
+}
+
+static inline void add_canvas_settings_hash(struct obs_core_video_mix *video, uint64_t *hash)
+{
+	content_hash_add(hash, &video->render_space, sizeof(video->render_space));
+	content_hash_add(hash, &obs->video.sdr_white_level, sizeof(obs->video.sdr_white_level));
+	content_hash_add(hash, &obs->video.hdr_nominal_peak_level, sizeof(obs->video.hdr_nominal_peak_level));
+}
+
+/* what the canvas would be rendered from, false if that cannot be told
+ * without rendering it */
+static bool get_canvas_content_hash(struct obs_core_video_mix *video, uint64_t *hash)
+{
+	*hash = CONTENT_HASH_INIT;
+	add_canvas_settings_hash(video, hash);
+
+	/* draw callbacks can draw anything */
+	return !draw_callbacks_exist() && obs_view_add_content_hash(video->view, hash);
+}
+
+/* What changed on the canvas since the last frame, false if all of it has to
+ * be rendered again: the mix was not rendered on the last frame, or what
+ * the whole canvas depends on changed. */
+static bool get_canvas_damage(struct obs_core_video_mix *video, struct video_damage *damage)
+{
+	uint64_t frame = obs->video.damage_frame;
+	uint64_t state = CONTENT_HASH_INIT;
+	uint64_t channels = obs_view_get_channels_hash(video->view);
+	struct canvas_damage canvas_damage = {0};
+	struct damage_space space;
+
+	add_canvas_settings_hash(video, &state);
+	content_hash_add(&state, &channels, sizeof(channels));
+
+	canvas_damage.full = !video->texture_rendered || video->damage_frame + 1 != frame ||
+			     video->damage_canvas_state != state || draw_callbacks_exist();
+	video->damage_frame = frame;
+	video->damage_canvas_state = state;
+
+	matrix4_identity(&space.transform);
+	space.margin = 0.0f;
+	space.clip_left = 0.0f;
+	space.clip_top = 0.0f;
+	space.clip_right = (float)video->ovi.base_width;
+	space.clip_bottom = (float)video->ovi.base_height;
+
+	/* the sources keep the state they compare with the next frame, so
+	 * they are walked even when the canvas is rendered whole */
+	obs_view_add_canvas_damage(video->view, &space, &canvas_damage);
+
+	*damage = canvas_damage.region;
+	return !canvas_damage.full;
+}
+
 static const char *render_main_texture_name = "render_main_texture";
 static inline void render_main_texture(struct obs_core_video_mix *video)
 {
 	uint32_t base_width = video->ovi.base_width;
 	uint32_t base_height = video->ovi.base_height;
+	uint64_t content_hash;
 
 	profile_start(render_main_texture_name);
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_MAIN_TEXTURE, render_main_texture_name);
 
-	struct vec4 clear_color;
-	vec4_set(&clear_color, 0.0f, 0.0f, 0.0f, 0.0f);
+	/* the texture still holds the last frame if nothing it was rendered
+	 * from has changed since */
+	bool tracked = get_canvas_content_hash(video, &content_hash);
+	video->canvas_unchanged = tracked && video->content_hash_valid && video->texture_rendered &&
+				  content_hash == video->content_hash;
+	video->content_hash = content_hash;
+	video->content_hash_valid = tracked;
+
+	/* or if what changed is not on the canvas */
+	bool damage_known = get_canvas_damage(video, &video->damage);
+	if (damage_known && !video->damage.num)
+		video->canvas_unchanged = true;
+
+	video->damage_partial = false;
+	if (video->canvas_unchanged)
+		goto rendered;
+
+	/* otherwise only the part that changed is rendered again, unless
+	 * that is most of it */
+	struct video_damage_rect bounds = {0, 0, base_width, base_height};
+	if (damage_known) {
+		video_damage_get_bounds(&video->damage, &bounds);
+		video->damage_partial = (uint64_t)bounds.cx * bounds.cy * 4 < (uint64_t)base_width * base_height * 3;
+	}
 
 	gs_set_render_target_with_color_space(video->render_texture, NULL, video->render_space);
-	gs_clear(GS_CLEAR_COLOR, &clear_color, 1.0f, 0);
 
-	set_render_size(base_width, base_height);
+	if (video->damage_partial) {
+		set_render_rect(&bounds);
+		clear_render_rect(&bounds);
+	} else {
+		struct vec4 clear_color;
+		vec4_set(&clear_color, 0.0f, 0.0f, 0.0f, 0.0f);
+
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 1.0f, 0);
+		set_render_size(base_width, base_height);
+	}
 
 	pthread_mutex_lock(&obs->data.draw_callbacks_mutex);
 
@@ -199,8 +328,12 @@ static inline void render_main_texture(struct obs_core_video_mix *video)
 	else
 		obs_view_render(video->view);
 
+	if (video->damage_partial)
+		set_render_size(base_width, base_height);
+
 	video->texture_rendered = true;
 
+rendered:
 	pthread_mutex_lock(&obs->data.draw_callbacks_mutex);
 
 	for (size_t i = 0; i < obs->data.rendered_callbacks.num; ++i) {
@@ -264,19 +397,52 @@ static inline gs_effect_t *get_scale_effect(struct obs_core_video_mix *mix, uint
 	}
 }
 
+/* canvas pixels a scale effect samples around the one it outputs, and the
+ * output pixels that makes around a changed canvas pixel */
+#define SCALE_EFFECT_RADIUS 3.0f
+
+static inline uint32_t get_scaled_damage_margin(struct obs_core_video_mix *mix, uint32_t width, uint32_t height)
+{
+	float scale = fmaxf((float)width / (float)mix->ovi.base_width, (float)height / (float)mix->ovi.base_height);
+	return (uint32_t)ceilf(SCALE_EFFECT_RADIUS * fmaxf(scale, 1.0f)) + 1;
+}
+
+/* Scales the canvas to the output size.  The damage is set to what changed
+ * in the output texture since the last frame, no rects if all of it may
+ * have. */
 static const char *render_output_texture_name = "render_output_texture";
-static inline gs_texture_t *render_output_texture(struct obs_core_video_mix *mix)
+static inline gs_texture_t *render_output_texture(struct obs_core_video_mix *mix, struct video_damage *damage)
 {
 	struct obs_video_info *const ovi = &mix->ovi;
 	gs_texture_t *texture = mix->render_texture;
 	gs_texture_t *target = mix->output_texture;
 	const uint32_t width = gs_texture_get_width(target);
 	const uint32_t height = gs_texture_get_height(target);
+
+	damage->num = 0;
+	if (mix->damage_partial)
+		*damage = mix->damage;
+
 	if ((width == ovi->base_width) && (height == ovi->base_height))
 		return texture;
+	if (mix->canvas_unchanged && mix->output_texture_current)
+		return target;
 
 	profile_start(render_output_texture_name);
 
+	/* the output texture only has to be scaled again where the canvas
+	 * changed, if it holds the last frame */
+	struct video_damage_rect bounds = {0, 0, width, height};
+	bool partial = damage->num && mix->output_texture_current;
+
+	if (partial) {
+		video_damage_scale(damage, ovi->base_width, ovi->base_height, width, height,
+				   get_scaled_damage_margin(mix, width, height));
+		video_damage_get_bounds(damage, &bounds);
+	} else {
+		damage->num = 0;
+	}
+
 	gs_effect_t *effect = get_scale_effect(mix, width, height);
 	gs_technique_t *tech = gs_effect_get_technique(effect, "Draw");
 
@@ -286,7 +452,10 @@ static inline gs_texture_t *render_output_texture(struct obs_core_video_mix *mix
 	size_t passes, i;
 
 	gs_set_render_target(target, NULL);
-	set_render_size(width, height);
+	if (partial)
+		set_render_rect(&bounds);
+	else
+		set_render_size(width, height);
 
 	if (bres) {
 		struct vec2 base;
@@ -314,6 +483,11 @@ static inline gs_texture_t *render_output_texture(struct obs_core_video_mix *mix
 	gs_enable_blending(true);
 	gs_enable_framebuffer_srgb(false);
 
+	if (partial)
+		set_render_size(width, height);
+
+	mix->output_texture_current = true;
+
 	profile_end(render_output_texture_name);
 
 	return target;
@@ -545,10 +719,19 @@ static inline void render_video(struct obs_core_video_mix *video, bool raw_activ
 	render_main_texture(video);
 
 	if (raw_active || gpu_active) {
+		int prev_texture = cur_texture == 0 ? NUM_TEXTURES - 1 : cur_texture - 1;
 		gs_texture_t *const *convert_textures = video->convert_textures;
 		gs_stagesurf_t *const *copy_surfaces = video->copy_surfaces[cur_texture];
 		size_t channel_count = NUM_CHANNELS;
-		gs_texture_t *output_texture = render_output_texture(video);
+		gs_texture_t *output_texture = NULL;
+		struct video_damage damage = {0};
+
+		/* an unchanged canvas is not scaled, converted and staged
+		 * again for raw outputs, they repeat the previous frame */
+		const bool raw_repeat = raw_active && video->canvas_unchanged && video->textures_copied[prev_texture];
+
+		if (!raw_repeat || gpu_active)
+			output_texture = render_output_texture(video, &damage);
 
 		if (gpu_active) {
 			convert_textures = video->convert_textures_encode;
@@ -559,7 +742,7 @@ static inline void render_video(struct obs_core_video_mix *video, bool raw_activ
 			gs_flush();
 		}
 
-		if (video->gpu_conversion) {
+		if (video->gpu_conversion && output_texture) {
 			render_convert_texture(video, convert_textures, output_texture);
 		}
 
@@ -568,10 +751,18 @@ static inline void render_video(struct obs_core_video_mix *video, bool raw_activ
 			output_gpu_encoders(video, raw_active);
 		}
 
-		if (raw_active) {
+		if (raw_repeat) {
+			unmap_last_surface(video);
+			video->textures_copied[cur_texture] = true;
+			video->textures_repeat[cur_texture] = true;
+		} else if (raw_active) {
 			stage_output_texture(video, cur_texture, convert_textures, output_texture, copy_surfaces,
 					     channel_count);
+			video->textures_repeat[cur_texture] = false;
+			video->textures_damage[cur_texture] = damage;
 		}
+	} else if (!video->canvas_unchanged) {
+		video->output_texture_current = false;
 	}
 
 	gs_set_render_target(NULL, NULL);
@@ -774,24 +965,220 @@ static inline void copy_rgbx_frame(struct video_frame *output, const struct vide
 	}
 }
 
-static inline void output_video_data(struct obs_core_video_mix *video, struct video_data *input_frame, int count)
+/* ------------------------------------------------------------------------- */
+/* CPU conversion of the staged BGRA output into YUV, split into row bands that
+ * run on the conversion pool while the graphics thread does the first one */
+
+#define MAX_CONVERT_BANDS 32
+
+/* damaged rects are split into bands of at least this many rows */
+#define MIN_DAMAGE_BAND_HEIGHT 16
+
+struct convert_band {
+	const struct video_data *input;
+	const struct video_frame *output;
+	const struct video_output_info *info;
+	const float *color_matrix;
+	uint32_t x;
+	uint32_t width;
+	uint32_t start_y;
+	uint32_t end_y;
+};
+
+static inline bool cpu_conversion_supported(enum video_format format)
+{
+	switch (format) {
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_I444:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void convert_rgbx_band(const struct convert_band *band)
+{
+	const struct video_data *input = band->input;
+	const uint8_t *in = input->data[0] + (size_t)band->x * 4;
+	uint8_t *const *data = band->output->data;
+	const uint32_t *out_linesize = band->output->linesize;
+	const uint32_t x = band->x;
+	const uint32_t width = band->width;
+
+	switch (band->info->format) {
+	case VIDEO_FORMAT_I420: {
+		uint8_t *output[3] = {data[0] + x, data[1] + x / 2, data[2] + x / 2};
+		compress_bgrx_to_i420(in, input->linesize[0], width, band->start_y, band->end_y, output, out_linesize,
+				      band->color_matrix);
+		break;
+	}
+	case VIDEO_FORMAT_NV12: {
+		uint8_t *output[2] = {data[0] + x, data[1] + x};
+		compress_bgrx_to_nv12(in, input->linesize[0], width, band->start_y, band->end_y, output, out_linesize,
+				      band->color_matrix);
+		break;
+	}
+	case VIDEO_FORMAT_I444: {
+		uint8_t *output[3] = {data[0] + x, data[1] + x, data[2] + x};
+		convert_bgrx_to_i444(in, input->linesize[0], width, band->start_y, band->end_y, output, out_linesize,
+				     band->color_matrix);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+static void convert_band_task(void *param)
+{
+	convert_rgbx_band(param);
+	os_sem_post(obs->video.convert_done);
+}
+
+static os_task_pool_t *get_convert_pool(void)
+{
+	struct obs_core_video *video = &obs->video;
+
+	if (!video->convert_pool_initialized) {
+		int cores = os_get_logical_cores();
+		size_t threads = cores > 1 ? (size_t)cores - 1 : 0;
+		if (threads > MAX_CONVERT_BANDS - 1)
+			threads = MAX_CONVERT_BANDS - 1;
+
+		if (threads && os_sem_init(&video->convert_done, 0) == 0) {
+			video->convert_pool = os_task_pool_create(threads, "libobs: cpu conversion");
+			if (!video->convert_pool) {
+				os_sem_destroy(video->convert_done);
+				video->convert_done = NULL;
+			}
+		}
+
+		blog(LOG_INFO, "CPU video conversion using %zu worker thread(s)",
+		     video->convert_pool ? os_task_pool_thread_count(video->convert_pool) : 0);
+		video->convert_pool_initialized = true;
+	}
+
+	return video->convert_pool;
+}
+
+/* Splits a rect of the frame into up to max_bands bands, which start on even
+ * rows so 4:2:0 chroma rows are never split */
+static size_t add_convert_bands(struct convert_band *bands, const struct convert_band *rect, size_t max_bands,
+				uint32_t min_height)
+{
+	uint32_t rows = rect->end_y - rect->start_y;
+	uint32_t band_height = (uint32_t)((rows + max_bands - 1) / max_bands);
+	size_t count = 0;
+
+	if (band_height < min_height)
+		band_height = min_height;
+	band_height = (band_height + 1) & ~1U;
+
+	for (uint32_t y = rect->start_y; y < rect->end_y; y += band_height) {
+		struct convert_band *band = &bands[count++];
+
+		*band = *rect;
+		band->start_y = y;
+		band->end_y = y + band_height < rect->end_y ? y + band_height : rect->end_y;
+	}
+
+	return count;
+}
+
+/* Converts the damaged rects of the staged frame, or all of it without
+ * damage, into the output frame */
+static const char *convert_rgbx_frame_name = "convert_rgbx_frame";
+static void convert_rgbx_frame(struct obs_core_video_mix *video, struct video_frame *output,
+			       const struct video_data *input, const struct video_output_info *info,
+			       const struct video_damage *damage)
+{
+	profile_start(convert_rgbx_frame_name);
+
+	os_task_pool_t *pool = get_convert_pool();
+	struct convert_band bands[MAX_CONVERT_BANDS + MAX_VIDEO_DAMAGE_RECTS];
+	size_t threads = pool ? os_task_pool_thread_count(pool) + 1 : 1;
+	size_t band_count = 0;
+	size_t queued = 0;
+
+	struct convert_band frame = {
+		.input = input,
+		.output = output,
+		.info = info,
+		.color_matrix = video->color_matrix,
+		.width = info->width,
+		.end_y = info->height,
+	};
+
+	if (!damage->num) {
+		band_count = add_convert_bands(bands, &frame, threads, 1);
+	} else {
+		uint64_t area = video_damage_get_area(damage);
+
+		for (uint32_t i = 0; i < damage->num; i++) {
+			const struct video_damage_rect *rect = &damage->rects[i];
+			struct convert_band band = frame;
+
+			/* even rects, chroma pixels cover 2x2 luma pixels */
+			uint32_t right = (rect->x + rect->cx + 1) & ~1U;
+			uint32_t bottom = (rect->y + rect->cy + 1) & ~1U;
+
+			band.x = rect->x & ~1U;
+			band.start_y = rect->y & ~1U;
+			band.width = (right < info->width ? right : info->width) - band.x;
+			band.end_y = bottom < info->height ? bottom : info->height;
+
+			/* the threads are shared out by area */
+			size_t max_bands = (size_t)((uint64_t)threads * rect->cx * rect->cy / area);
+			band_count += add_convert_bands(bands + band_count, &band, max_bands ? max_bands : 1,
+							MIN_DAMAGE_BAND_HEIGHT);
+		}
+	}
+
+	for (size_t i = 1; i < band_count; i++) {
+		if (os_task_pool_queue_task(pool, convert_band_task, &bands[i]))
+			queued++;
+		else
+			convert_rgbx_band(&bands[i]);
+	}
+
+	convert_rgbx_band(&bands[0]);
+
+	while (queued--)
+		os_sem_wait(obs->video.convert_done);
+
+	profile_end(convert_rgbx_frame_name);
+}
+
+/* Outputs the staged frame with what changed since the last one; CPU
+ * conversion only converts that part of it.  Returns false if the frame
+ * was dropped. */
+static inline bool output_video_data(struct obs_core_video_mix *video, struct video_data *input_frame, int count,
+				     struct video_damage *damage)
 {
 	const struct video_output_info *info;
 	struct video_frame output_frame;
+	bool cpu_conversion;
 	bool locked;
 
 	info = video_output_get_info(video->video);
+	cpu_conversion = !video->gpu_conversion && cpu_conversion_supported(info->format);
 
-	locked = video_output_lock_frame(video->video, &output_frame, count, input_frame->timestamp);
+	locked = video_output_lock_frame_damaged(video->video, &output_frame, count, input_frame->timestamp, damage,
+						 cpu_conversion);
 	if (locked) {
 		if (video->gpu_conversion) {
 			set_gpu_converted_data(&output_frame, input_frame, info);
+		} else if (cpu_conversion) {
+			convert_rgbx_frame(video, &output_frame, input_frame, info, damage);
 		} else {
 			copy_rgbx_frame(&output_frame, input_frame, info);
 		}
 
 		video_output_unlock_frame(video->video);
 	}
+
+	return locked;
 }
 
 void add_ready_encoder_group(obs_encoder_t *encoder)
@@ -874,6 +1261,7 @@ static inline void output_frame(struct obs_core_video_mix *video)
 	int prev_texture = cur_texture == 0 ? NUM_TEXTURES - 1 : cur_texture - 1;
 	struct video_data frame;
 	bool frame_ready = 0;
+	bool frame_repeat = false;
 
 	memset(&frame, 0, sizeof(struct video_data));
 
@@ -886,12 +1274,19 @@ static inline void output_frame(struct obs_core_video_mix *video)
 	GS_DEBUG_MARKER_END();
 	profile_end(output_frame_render_video_name);
 
-	if (raw_active) {
+	if (raw_active && video->textures_repeat[prev_texture]) {
+		frame_ready = video->textures_copied[prev_texture];
+		frame_repeat = true;
+	} else if (raw_active) {
 		profile_start(output_frame_download_frame_name);
 		frame_ready = download_frame(video, prev_texture, &frame);
 		profile_end(output_frame_download_frame_name);
 	}
 
+	/* the damage of a frame is relative to the one staged before it */
+	if (raw_active && !frame_ready)
+		video->raw_frame_lost = true;
+
 	profile_start(output_frame_gs_flush_name);
 	gs_flush();
 	profile_end(output_frame_gs_flush_name);
@@ -905,7 +1300,17 @@ static inline void output_frame(struct obs_core_video_mix *video)
 
 		frame.timestamp = vframe_info.timestamp;
 		profile_start(output_frame_output_video_data_name);
-		output_video_data(video, &frame, vframe_info.count);
+		/* with no frame to repeat, the next one is staged again */
+		if (frame_repeat && !video_output_repeat_frame(video->video, vframe_info.count, frame.timestamp)) {
+			video->content_hash_valid = false;
+			video->raw_frame_lost = true;
+		} else if (!frame_repeat) {
+			frame.damage = video->textures_damage[prev_texture];
+			if (video->raw_frame_lost)
+				frame.damage.num = 0;
+
+			video->raw_frame_lost = !output_video_data(video, &frame, vframe_info.count, &frame.damage);
+		}
 		profile_end(output_frame_output_video_data_name);
 	}
 
@@ -913,13 +1318,44 @@ static inline void output_frame(struct obs_core_video_mix *video)
 		video->cur_texture = 0;
 }
 
+static inline bool main_texture_used(void)
+{
+	bool used;
+
+	pthread_mutex_lock(&obs->data.displays_mutex);
+	used = obs->data.first_display != NULL;
+	pthread_mutex_unlock(&obs->data.displays_mutex);
+
+	if (!used) {
+		pthread_mutex_lock(&obs->data.draw_callbacks_mutex);
+		used = obs->data.rendered_callbacks.num != 0;
+		pthread_mutex_unlock(&obs->data.draw_callbacks_mutex);
+	}
+
+	return used;
+}
+
+/* a mix whose only encoders are paused ones (see obs_encoder_set_suspended)
+ * has nobody to render for while paused, unless the main texture is still
+ * being previewed or read back */
+static inline bool mix_paused(struct obs_core_video_mix *mix, bool main_used)
+{
+	if (mix->was_active || !os_atomic_load_long(&mix->suspended_encoders))
+		return false;
+
+	return mix != obs->video.main_mix || !main_used;
+}
+
 static inline void output_frames(void)
 {
+	const bool main_used = main_texture_used();
+
 	pthread_mutex_lock(&obs->video.mixes_mutex);
 	for (size_t i = 0, num = obs->video.mixes.num; i < num; i++) {
 		struct obs_core_video_mix *mix = obs->video.mixes.array[i];
 		if (mix->view) {
-			output_frame(mix);
+			if (!mix_paused(mix, main_used))
+				output_frame(mix);
 		} else {
 			obs->video.mixes.array[i] = NULL;
 			obs_free_video_mix(mix);
@@ -937,6 +1373,8 @@ static void clear_base_frame_data(struct obs_core_video_mix *video)
 {
 	video->texture_rendered = false;
 	video->texture_converted = false;
+	video->content_hash_valid = false;
+	video->output_texture_current = false;
 	deque_free(&video->vframe_info_buffer);
 	video->cur_texture = 0;
 }
@@ -944,6 +1382,8 @@ static void clear_base_frame_data(struct obs_core_video_mix *video)
 static void clear_raw_frame_data(struct obs_core_video_mix *video)
 {
 	memset(video->textures_copied, 0, sizeof(video->textures_copied));
+	memset(video->textures_repeat, 0, sizeof(video->textures_repeat));
+	video->raw_frame_lost = true;
 	deque_free(&video->vframe_info_buffer);
 }
 
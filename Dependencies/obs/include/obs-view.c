@@ -139,6 +139,63 @@ void obs_view_render(obs_view_t *view)
 	pthread_mutex_unlock(&view->channels_mutex);
 }
 
+bool obs_view_add_content_hash(obs_view_t *view, uint64_t *hash)
+{
+	bool tracked = true;
+
+	pthread_mutex_lock(&view->channels_mutex);
+
+	for (size_t i = 0; tracked && i < MAX_CHANNELS; i++) {
+		struct obs_source *source = view->channels[i];
+
+		content_hash_add(hash, &source, sizeof(source));
+		if (source)
+			tracked = !source->removed && obs_source_add_content_hash(source, hash);
+	}
+
+	pthread_mutex_unlock(&view->channels_mutex);
+	return tracked;
+}
+
+/* which sources the channels hold and their sizes; a change makes the whole
+ * canvas damaged */
+uint64_t obs_view_get_channels_hash(obs_view_t *view)
+{
+	uint64_t hash = CONTENT_HASH_INIT;
+
+	pthread_mutex_lock(&view->channels_mutex);
+
+	for (size_t i = 0; i < MAX_CHANNELS; i++) {
+		struct obs_source *source = view->channels[i];
+		uint32_t size[2] = {0, 0};
+
+		if (source && !source->removed) {
+			size[0] = obs_source_get_width(source);
+			size[1] = obs_source_get_height(source);
+		}
+
+		content_hash_add(&hash, &source, sizeof(source));
+		content_hash_add(&hash, size, sizeof(size));
+	}
+
+	pthread_mutex_unlock(&view->channels_mutex);
+	return hash;
+}
+
+void obs_view_add_canvas_damage(obs_view_t *view, const struct damage_space *space, struct canvas_damage *damage)
+{
+	pthread_mutex_lock(&view->channels_mutex);
+
+	for (size_t i = 0; i < MAX_CHANNELS; i++) {
+		struct obs_source *source = view->channels[i];
+
+		if (source && !source->removed)
+			obs_source_add_canvas_damage(source, space, damage);
+	}
+
+	pthread_mutex_unlock(&view->channels_mutex);
+}
+
 static inline size_t find_mix_for_view(obs_view_t *view)
 {
 	for (size_t i = 0, num = obs->video.mixes.num; i < num; i++) {
@@ -820,6 +820,12 @@ static void obs_free_video(void)
 	pthread_mutex_destroy(&obs->video.task_mutex);
 	pthread_mutex_init_value(&obs->video.task_mutex);
 	deque_free(&obs->video.tasks);
+
+	os_task_pool_destroy(obs->video.convert_pool);
+	os_sem_destroy(obs->video.convert_done);
+	obs->video.convert_pool = NULL;
+	obs->video.convert_done = NULL;
+	obs->video.convert_pool_initialized = false;
 }
 
 static void obs_free_graphics(void)
@@ -1056,6 +1062,33 @@ static const char *obs_signals[] = {
 	NULL,
 };
 
+static void obs_init_signal_ids(struct obs_core_signal_ids *ids)
+{
+#define INTERN(name) ids->name = signal_id_intern(#name)
+	INTERN(source_activate);
+	INTERN(activate);
+	INTERN(source_deactivate);
+	INTERN(deactivate);
+	INTERN(source_show);
+	INTERN(show);
+	INTERN(source_hide);
+	INTERN(hide);
+	INTERN(source_audio_activate);
+	INTERN(audio_activate);
+	INTERN(source_audio_deactivate);
+	INTERN(audio_deactivate);
+	INTERN(media_play);
+	INTERN(media_pause);
+	INTERN(media_restart);
+	INTERN(media_stopped);
+	INTERN(media_next);
+	INTERN(media_previous);
+	INTERN(media_started);
+	INTERN(media_ended);
+	INTERN(item_transform);
+#undef INTERN
+}
+
 static inline bool obs_init_handlers(void)
 {
 	obs->signals = signal_handler_create();
@@ -1066,6 +1099,8 @@ static inline bool obs_init_handlers(void)
 	if (!obs->procs)
 		return false;
 
+	obs_init_signal_ids(&obs->signal_ids);
+
 	return signal_handler_add_array(obs->signals, obs_signals);
 }
 
@@ -1167,6 +1202,10 @@ static bool obs_init(const char *locale, const char *module_config_path, profile
 	pthread_mutex_init_value(&obs->video.task_mutex);
 	pthread_mutex_init_value(&obs->video.encoder_group_mutex);
 	pthread_mutex_init_value(&obs->video.mixes_mutex);
+	pthread_mutex_init_value(&obs->module_mutex);
+
+	if (pthread_mutex_init_recursive(&obs->module_mutex) != 0)
+		return false;
 
 	obs->name_store_owned = !store;
 	obs->name_store = store ? store : profiler_name_store_create();
@@ -1348,6 +1387,10 @@ void obs_shutdown(void)
 	stop_audio();
 	stop_hotkeys();
 
+	/* keep the types of modules loaded on demand for the next start */
+	save_module_manifest();
+	free_module_manifest();
+
 	module = obs->first_module;
 	while (module) {
 		struct obs_module *next = module->next;
@@ -1375,6 +1418,8 @@ void obs_shutdown(void)
 		bfree(obs->safe_modules.array[i]);
 	da_free(obs->safe_modules);
 
+	pthread_mutex_destroy(&obs->module_mutex);
+
 	if (obs->name_store_owned)
 		profiler_name_store_free(obs->name_store);
 
@@ -1611,6 +1656,8 @@ bool obs_get_audio_info(struct obs_audio_info *oai)
 
 bool obs_enum_source_types(size_t idx, const char **id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->source_types.num)
 		return false;
 	*id = obs->source_types.array[idx].id;
@@ -1619,6 +1666,8 @@ bool obs_enum_source_types(size_t idx, const char **id)
 
 bool obs_enum_input_types(size_t idx, const char **id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->input_types.num)
 		return false;
 	*id = obs->input_types.array[idx].id;
@@ -1627,6 +1676,8 @@ bool obs_enum_input_types(size_t idx, const char **id)
 
 bool obs_enum_input_types2(size_t idx, const char **id, const char **unversioned_id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->input_types.num)
 		return false;
 	if (id)
@@ -1644,6 +1695,8 @@ const char *obs_get_latest_input_type_id(const char *unversioned_id)
 	if (!unversioned_id)
 		return NULL;
 
+	load_deferred_module_for_type(unversioned_id);
+
 	for (size_t i = 0; i < obs->source_types.num; i++) {
 		struct obs_source_info *info = &obs->source_types.array[i];
 		if (strcmp(info->unversioned_id, unversioned_id) == 0 && (int)info->version > version) {
@@ -1661,6 +1714,8 @@ const char *obs_get_latest_input_type_id(const char *unversioned_id)
 
 bool obs_enum_filter_types(size_t idx, const char **id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->filter_types.num)
 		return false;
 	*id = obs->filter_types.array[idx].id;
@@ -1669,6 +1724,8 @@ bool obs_enum_filter_types(size_t idx, const char **id)
 
 bool obs_enum_transition_types(size_t idx, const char **id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->transition_types.num)
 		return false;
 	*id = obs->transition_types.array[idx].id;
@@ -1677,6 +1734,8 @@ bool obs_enum_transition_types(size_t idx, const char **id)
 
 bool obs_enum_output_types(size_t idx, const char **id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->output_types.num)
 		return false;
 	*id = obs->output_types.array[idx].id;
@@ -1685,6 +1744,8 @@ bool obs_enum_output_types(size_t idx, const char **id)
 
 bool obs_enum_encoder_types(size_t idx, const char **id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->encoder_types.num)
 		return false;
 	*id = obs->encoder_types.array[idx].id;
@@ -1693,6 +1754,8 @@ bool obs_enum_encoder_types(size_t idx, const char **id)
 
 bool obs_enum_service_types(size_t idx, const char **id)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->service_types.num)
 		return false;
 	*id = obs->service_types.array[idx].id;
@@ -2907,6 +2970,15 @@ uint32_t obs_get_lagged_frames(void)
 	return obs->video.lagged_frames;
 }
 
+uint32_t obs_get_audio_buffering_ms(void)
+{
+	if (!obs || !obs->audio.audio)
+		return 0;
+
+	uint64_t frames = (uint64_t)obs->audio.total_buffering_ticks * AUDIO_OUTPUT_FRAMES;
+	return (uint32_t)(frames * 1000 / audio_output_get_sample_rate(obs->audio.audio));
+}
+
 struct obs_core_video_mix *get_mix_for_video(video_t *v)
 {
 	struct obs_core_video_mix *result = NULL;
@@ -2942,6 +3014,23 @@ void stop_raw_video(video_t *v, void (*callback)(void *param, struct video_data
 	video_output_disconnect(v, callback, param);
 }
 
+/* keeps the connection, but stops counting it as a reason for the mix to
+ * render, convert and download output frames */
+void suspend_raw_video(video_t *v, bool suspend)
+{
+	struct obs_core_video_mix *video = get_mix_for_video(v);
+	if (!video)
+		return;
+
+	if (suspend) {
+		os_atomic_inc_long(&video->suspended_encoders);
+		os_atomic_dec_long(&video->raw_active);
+	} else {
+		os_atomic_inc_long(&video->raw_active);
+		os_atomic_dec_long(&video->suspended_encoders);
+	}
+}
+
 void obs_add_raw_video_callback(const struct video_scale_info *conversion,
 				void (*callback)(void *param, struct video_data *frame), void *param)
 {
@@ -3279,6 +3368,9 @@ bool obs_weak_object_references_object(obs_weak_object_t *weak, obs_object_t *ob
 
 bool obs_is_output_protocol_registered(const char *protocol)
 {
+	/* protocols are only known once their outputs are registered */
+	obs_load_deferred_modules();
+
 	for (size_t i = 0; i < obs->data.protocols.num; i++) {
 		if (strcmp(protocol, obs->data.protocols.array[i]) == 0)
 			return true;
@@ -3289,6 +3381,8 @@ bool obs_is_output_protocol_registered(const char *protocol)
 
 bool obs_enum_output_protocols(size_t idx, char **protocol)
 {
+	if (idx == 0)
+		obs_load_deferred_modules();
 	if (idx >= obs->data.protocols.num)
 		return false;
 
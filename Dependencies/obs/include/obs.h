@@ -470,6 +470,16 @@ EXPORT int obs_open_module(obs_module_t **module, const char *path, const char *
  */
 EXPORT bool obs_init_module(obs_module_t *module);
 
+/**
+ * Initializes several modules at once, running their obs_module_load exports
+ * in parallel on worker threads.  Only use it for modules that do not depend
+ * on each other while loading, and that only register types there: lookups
+ * are locked against the registrations, but the type tables they point into
+ * can move until every module is initialized.  If success is not NULL, it
+ * receives the result of obs_init_module for each module.
+ */
+EXPORT void obs_init_modules(obs_module_t *const *modules, size_t count, bool *success);
+
 /** Returns a module based upon its name, or NULL if not found */
 EXPORT obs_module_t *obs_get_module(const char *name);
 
@@ -537,6 +547,22 @@ EXPORT void obs_load_all_modules2(struct obs_module_failure_info *mfi);
  * be called after all modules have been loaded. */
 EXPORT void obs_post_load_modules(void);
 
+/**
+ * Sets the file of the module manifest, which records the source, output,
+ * encoder and service types each module registers.  Modules found in the
+ * manifest and unchanged since are not loaded by obs_open_module and
+ * obs_init_module; each is loaded the first time one of its types is looked
+ * up instead.  Modules exporting obs_module_post_load are always loaded.
+ *
+ * Call after obs_startup and before opening modules.  NULL (the default)
+ * disables the manifest.
+ */
+EXPORT void obs_set_module_manifest_path(const char *path);
+
+/** Loads the modules deferred by the module manifest now, e.g. before
+ * listing every available type. */
+EXPORT void obs_load_deferred_modules(void);
+
 struct obs_module_info {
 	const char *bin_path;
 	const char *data_path;
@@ -831,6 +857,9 @@ EXPORT uint64_t obs_get_frame_interval_ns(void);
 EXPORT uint32_t obs_get_total_frames(void);
 EXPORT uint32_t obs_get_lagged_frames(void);
 
+/** Audio buffering libobs currently adds to wait for late audio sources */
+EXPORT uint32_t obs_get_audio_buffering_ms(void);
+
 EXPORT bool obs_nv12_tex_active(void);
 EXPORT bool obs_p010_tex_active(void);
 
@@ -1030,6 +1059,19 @@ EXPORT void obs_source_reset_settings(obs_source_t *source, obs_data_t *settings
 /** Renders a video source. */
 EXPORT void obs_source_video_render(obs_source_t *source);
 
+/**
+ * Tells libobs that what a source with OBS_SOURCE_CONTENT_TRACKED renders
+ * has changed, so the canvas showing it is rendered again
+ */
+EXPORT void obs_source_content_changed(obs_source_t *source);
+
+/**
+ * Like obs_source_content_changed, for a change that only covers a rect of
+ * the source, so that only that part of the canvas is rendered and
+ * converted again
+ */
+EXPORT void obs_source_add_damage(obs_source_t *source, uint32_t x, uint32_t y, uint32_t cx, uint32_t cy);
+
 /** Gets the width of a source (if it has video) */
 EXPORT uint32_t obs_source_get_width(obs_source_t *source);
 
@@ -1324,6 +1366,29 @@ EXPORT void obs_source_draw(gs_texture_t *image, int x, int y, uint32_t cx, uint
 EXPORT void obs_source_output_video(obs_source_t *source, const struct obs_source_frame *frame);
 EXPORT void obs_source_output_video2(obs_source_t *source, const struct obs_source_frame2 *frame);
 
+/**
+ * Like obs_source_output_video, with what changed since the frame the source
+ * output before it, so that only that part of the canvas is rendered and
+ * converted again.  A NULL damage or one without rects means all of it.
+ */
+EXPORT void obs_source_output_video_damaged(obs_source_t *source, const struct obs_source_frame *frame,
+					    const struct video_damage *damage);
+
+typedef void (*obs_source_frame_release_t)(void *param);
+
+/**
+ * Outputs asynchronous video data without copying it.  The planes stay owned
+ * by the caller and are read in place until libobs calls release(param),
+ * which happens exactly once per call (also when the frame is dropped) and
+ * may happen on any thread with source locks held: do not reuse the buffer
+ * before then, and do not call back into the source from release.
+ */
+EXPORT void obs_source_output_video_external(obs_source_t *source, const struct obs_source_frame *frame,
+					     obs_source_frame_release_t release, void *param);
+EXPORT void obs_source_output_video_external_damaged(obs_source_t *source, const struct obs_source_frame *frame,
+						     const struct video_damage *damage,
+						     obs_source_frame_release_t release, void *param);
+
 EXPORT void obs_source_set_async_rotation(obs_source_t *source, long rotation);
 
 EXPORT void obs_source_output_cea708(obs_source_t *source, const struct obs_source_cea_708 *captions);
@@ -1452,6 +1517,11 @@ EXPORT void obs_source_get_audio_mix(const obs_source_t *source, struct obs_sour
 EXPORT void obs_source_set_async_unbuffered(obs_source_t *source, bool unbuffered);
 EXPORT bool obs_source_async_unbuffered(const obs_source_t *source);
 
+/** When more async frames are queued than the source can buffer, drop the
+ * oldest queued frame instead of flushing the whole queue */
+EXPORT void obs_source_set_async_drop_oldest(obs_source_t *source, bool drop_oldest);
+EXPORT bool obs_source_async_drop_oldest(const obs_source_t *source);
+
 /** Used to decouple audio from video so that audio doesn't attempt to sync up
  * with video.  I.E. Audio acts independently.  Only works when in unbuffered
  * mode. */
@@ -1874,6 +1944,15 @@ EXPORT bool obs_output_can_pause(const obs_output_t *output);
 /** Pauses the output (if the functionality is allowed by the output */
 EXPORT bool obs_output_pause(obs_output_t *output, bool pause);
 
+/**
+ * Pauses the encoders of an encoded output, also for outputs that do not
+ * support pausing themselves (e.g. streaming).  The output stays connected but
+ * gets no packets until unpaused, and timestamps continue where they stopped.
+ * Encoders with nothing else to feed stop costing render and mixing time.
+ * Shared encoders pause for all of their outputs.
+ */
+EXPORT bool obs_output_pause_encoding(obs_output_t *output, bool pause);
+
 /** Returns whether output is paused */
 EXPORT bool obs_output_paused(const obs_output_t *output);
 
@@ -1972,6 +2051,22 @@ EXPORT uint64_t obs_output_get_total_bytes(const obs_output_t *output);
 EXPORT int obs_output_get_frames_dropped(const obs_output_t *output);
 EXPORT int obs_output_get_total_frames(const obs_output_t *output);
 
+#define OBS_OUTPUT_LATENCY_BUCKETS 16
+
+/** Latency from render (cts) to interleaving (pir) of a video track's packets */
+struct obs_output_latency_stats {
+	uint64_t count;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	/** buckets[0] counts latencies under 1 ms, buckets[i] those from
+	 * 2^(i-1) to 2^i ms; the last bucket also takes everything longer */
+	uint64_t buckets[OBS_OUTPUT_LATENCY_BUCKETS];
+};
+
+/** Copies the latency histogram of a video track, false if the output
+ * is not encoded or the track index is out of range */
+EXPORT bool obs_output_get_latency_stats(obs_output_t *output, size_t track, struct obs_output_latency_stats *stats);
+
 /**
  * Sets the preferred scaled resolution for this output.  Set width and height
  * to 0 to disable scaling.
@@ -2191,6 +2286,15 @@ EXPORT void obs_encoder_set_gpu_scale_type(obs_encoder_t *encoder, enum obs_scal
  */
 EXPORT bool obs_encoder_set_frame_rate_divisor(obs_encoder_t *encoder, uint32_t divisor);
 
+/**
+ * For raw video encoders, skips the frames the encoder falls behind on
+ * instead of having it encode repeats of them to catch up (the default).
+ * Skipped frames still count as skipped due to encoding lag.
+ *
+ * Can only be called on stopped encoders
+ */
+EXPORT bool obs_encoder_set_skip_late_frames(obs_encoder_t *encoder, bool skip);
+
 /**
  * Adds region of interest (ROI) for an encoder. This allows prioritizing
  * quality of regions of the frame.
@@ -2209,6 +2313,15 @@ EXPORT void obs_encoder_enum_roi(obs_encoder_t *encoder, void (*enum_proc)(void
 /** Get ROI increment, encoders must rebuild their ROI map if it has changed */
 EXPORT uint32_t obs_encoder_get_roi_increment(const obs_encoder_t *encoder);
 
+/**
+ * Passes the parts of each raw frame that changed since the last one to the
+ * encoder as regions of interest with the given priority, below the regions
+ * added with obs_encoder_add_roi.  A priority of 0 stops it.
+ *
+ * Returns false if the encoder does not support ROI.
+ */
+EXPORT bool obs_encoder_set_damage_roi(obs_encoder_t *encoder, float priority);
+
 /** For video encoders, returns true if pre-encode scaling is enabled */
 EXPORT bool obs_encoder_scaling_enabled(const obs_encoder_t *encoder);
 
@@ -2230,6 +2343,23 @@ EXPORT uint32_t obs_encoder_get_frame_rate_divisor(const obs_encoder_t *encoder)
 /** For video encoders, returns the number of frames encoded */
 EXPORT uint32_t obs_encoder_get_encoded_frames(const obs_encoder_t *encoder);
 
+/**
+ * Returns the number of packet bytes copied out of the encoder for outputs.
+ * An output that keeps a packet takes a reference to a copy another output
+ * already made; those bytes count towards obs_encoder_get_packet_bytes_shared
+ * instead.
+ */
+EXPORT uint64_t obs_encoder_get_packet_bytes_copied(const obs_encoder_t *encoder);
+EXPORT uint64_t obs_encoder_get_packet_bytes_shared(const obs_encoder_t *encoder);
+
+/**
+ * For video encoders reading raw frames, gets the frames video-io passed to
+ * the encoder, the ticks it fell behind on and the time spent scaling and in
+ * the encoder's callback.  Returns false for texture encoders or while the
+ * encoder is not active.
+ */
+EXPORT bool obs_encoder_get_video_input_stats(const obs_encoder_t *encoder, struct video_input_stats *stats);
+
 /** For audio encoders, returns the sample rate of the audio */
 EXPORT uint32_t obs_encoder_get_sample_rate(const obs_encoder_t *encoder);
 
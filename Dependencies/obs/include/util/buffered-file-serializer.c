@@ -14,10 +14,26 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "buffered-file-serializer.h"
 
 #include <inttypes.h>
 
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#endif
+
 #include "platform.h"
 #include "threading.h"
 #include "deque.h"
@@ -37,6 +53,7 @@ struct io_header {
 struct io_buffer {
 	bool active;
 	bool shutdown_requested;
+	bool flush_requested;
 	bool output_error;
 	os_event_t *buffer_space_available_event;
 	os_event_t *new_data_available_event;
@@ -48,6 +65,15 @@ struct io_buffer {
 
 	size_t buffer_size;
 	size_t chunk_size;
+	size_t max_buffered;
+	bool preallocated;
+
+#if defined(__linux__)
+	struct io_ring *ring;
+#endif
+
+	pthread_mutex_t stats_mutex;
+	struct buffered_file_serializer_stats stats;
 };
 
 struct file_output_data {
@@ -55,16 +81,430 @@ struct file_output_data {
 	struct io_buffer io;
 };
 
+#ifndef _WIN32
+static inline size_t max(size_t a, size_t b)
+{
+	return a > b ? a : b;
+}
+
+static inline size_t min(size_t a, size_t b)
+{
+	return a < b ? a : b;
+}
+#endif
+
+static void record_write(struct io_buffer *io, size_t bytes, uint64_t time_ns)
+{
+	pthread_mutex_lock(&io->stats_mutex);
+	io->stats.bytes_written += bytes;
+	io->stats.writes++;
+	io->stats.write_time_ns += time_ns;
+	if (time_ns > io->stats.max_write_time_ns)
+		io->stats.max_write_time_ns = time_ns;
+	pthread_mutex_unlock(&io->stats_mutex);
+}
+
+static void record_queue_depth(struct io_buffer *io, unsigned int depth)
+{
+	pthread_mutex_lock(&io->stats_mutex);
+	io->stats.queue_depth = depth;
+	if (depth > io->stats.max_queue_depth)
+		io->stats.max_queue_depth = depth;
+	pthread_mutex_unlock(&io->stats_mutex);
+}
+
+/* ========================================================================== */
+/* io_uring backend (Linux)                                                   */
+
+#if defined(__linux__)
+#define RING_DEFAULT_QUEUE_DEPTH 4
+#define RING_ALIGNMENT 4096
+
+/* Chunks are written straight from these buffers, so each one stays owned by
+ * the kernel until its completion has been reaped. */
+struct ring_chunk {
+	unsigned char *data;
+	struct iovec iov;
+	uint64_t offset;
+	size_t size;
+	uint64_t submit_time;
+	bool in_flight;
+};
+
+struct io_ring {
+	int ring_fd;
+	int fd;          /* written through the ring, O_DIRECT if direct */
+	int buffered_fd; /* unaligned pieces if direct, otherwise fd */
+	bool direct;
+
+	void *sq_ptr;
+	size_t sq_size;
+	void *cq_ptr;
+	size_t cq_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	struct ring_chunk *chunks;
+	unsigned num_chunks;
+	unsigned cur;
+	unsigned in_flight;
+
+	/* End of the last write, a write starting anywhere else may overlap
+	 * one that is still in flight */
+	uint64_t last_end;
+};
+
+static inline int sys_io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static inline int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static void ring_destroy(struct io_ring *ring)
+{
+	if (!ring)
+		return;
+
+	if (ring->chunks) {
+		for (unsigned i = 0; i < ring->num_chunks; i++)
+			free(ring->chunks[i].data);
+		bfree(ring->chunks);
+	}
+
+	if (ring->sqes)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ptr && ring->cq_ptr != ring->sq_ptr)
+		munmap(ring->cq_ptr, ring->cq_size);
+	if (ring->sq_ptr)
+		munmap(ring->sq_ptr, ring->sq_size);
+
+	if (ring->ring_fd >= 0)
+		close(ring->ring_fd);
+	if (ring->buffered_fd >= 0 && ring->buffered_fd != ring->fd)
+		close(ring->buffered_fd);
+	if (ring->fd >= 0)
+		close(ring->fd);
+
+	bfree(ring);
+}
+
+static void *ring_map(int fd, size_t size, off_t offset)
+{
+	void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+	return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+/* Returns NULL if the file cannot be opened or io_uring is not available
+ * (old kernel, blocked by seccomp), the caller then uses stdio instead. */
+static struct io_ring *ring_create(const char *path, const struct buffered_file_serializer_options *options,
+				   size_t chunk_size)
+{
+	struct io_ring *ring = bzalloc(sizeof(*ring));
+	ring->ring_fd = ring->fd = ring->buffered_fd = -1;
+
+	unsigned depth = options->queue_depth ? options->queue_depth : RING_DEFAULT_QUEUE_DEPTH;
+	struct io_uring_params params = {0};
+
+	ring->ring_fd = sys_io_uring_setup(depth, &params);
+	if (ring->ring_fd < 0) {
+		blog(LOG_WARNING, "io_uring is not available (%s), using buffered stdio writes", strerror(errno));
+		goto fail;
+	}
+
+	ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		ring->sq_size = ring->cq_size = max(ring->sq_size, ring->cq_size);
+
+	ring->sq_ptr = ring_map(ring->ring_fd, ring->sq_size, IORING_OFF_SQ_RING);
+	if (!ring->sq_ptr)
+		goto fail;
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		ring->cq_ptr = ring->sq_ptr;
+	else if (!(ring->cq_ptr = ring_map(ring->ring_fd, ring->cq_size, IORING_OFF_CQ_RING)))
+		goto fail;
+
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = ring_map(ring->ring_fd, ring->sqes_size, IORING_OFF_SQES);
+	if (!ring->sqes)
+		goto fail;
+
+	uint8_t *sq = ring->sq_ptr;
+	uint8_t *cq = ring->cq_ptr;
+	ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+	ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+	ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+	ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+	ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+	// One chunk per write in flight plus the one being filled, with room
+	// for the partial block carried over between chunks with O_DIRECT
+	ring->num_chunks = depth + 1;
+	ring->chunks = bzalloc(ring->num_chunks * sizeof(struct ring_chunk));
+	for (unsigned i = 0; i < ring->num_chunks; i++) {
+		if (posix_memalign((void **)&ring->chunks[i].data, RING_ALIGNMENT, chunk_size + RING_ALIGNMENT) != 0) {
+			ring->chunks[i].data = NULL;
+			goto fail;
+		}
+	}
+
+	int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+	if (options->direct_io) {
+		ring->fd = open(path, flags | O_DIRECT, 0644);
+		if (ring->fd >= 0)
+			ring->direct = true;
+		else
+			blog(LOG_WARNING, "O_DIRECT is not supported for '%s' (%s), writing through the page cache",
+			     path, strerror(errno));
+	}
+	if (ring->fd < 0)
+		ring->fd = open(path, flags, 0644);
+	if (ring->fd < 0)
+		goto fail;
+
+	ring->buffered_fd = ring->direct ? open(path, O_WRONLY | O_CLOEXEC) : ring->fd;
+	if (ring->buffered_fd < 0)
+		goto fail;
+
+	return ring;
+
+fail:
+	ring_destroy(ring);
+	return NULL;
+}
+
+static bool ring_submit(struct file_output_data *out, unsigned idx)
+{
+	struct io_ring *ring = out->io.ring;
+	struct ring_chunk *chunk = &ring->chunks[idx];
+	unsigned tail = *ring->sq_tail;
+	unsigned index = tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_WRITEV;
+	sqe->fd = ring->fd;
+	sqe->addr = (uint64_t)(uintptr_t)&chunk->iov;
+	sqe->len = 1;
+	sqe->off = chunk->offset;
+	sqe->user_data = idx;
+
+	ring->sq_array[index] = index;
+	__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	int ret;
+	do {
+		ret = sys_io_uring_enter(ring->ring_fd, 1, 0, 0);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret < 0) {
+		blog(LOG_ERROR, "Error submitting write to '%s': %s", out->filename.array, strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+/* Processes finished writes, waiting for at least one if wait is set */
+static bool ring_reap(struct file_output_data *out, bool wait)
+{
+	struct io_ring *ring = out->io.ring;
+	bool success = true;
+
+	if (wait) {
+		int ret = sys_io_uring_enter(ring->ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+		if (ret < 0 && errno != EINTR) {
+			blog(LOG_ERROR, "Error waiting for writes to '%s': %s", out->filename.array, strerror(errno));
+			return false;
+		}
+	}
+
+	unsigned head = *ring->cq_head;
+	unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+	for (; head != tail; head++) {
+		struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+		unsigned idx = (unsigned)cqe->user_data;
+		struct ring_chunk *chunk = &ring->chunks[idx];
+
+		if (cqe->res < 0) {
+			blog(LOG_ERROR, "Error writing to '%s': %s", out->filename.array, strerror(-cqe->res));
+			success = false;
+		} else if ((size_t)cqe->res < chunk->iov.iov_len) {
+			// Short write, queue the rest
+			chunk->iov.iov_base = (unsigned char *)chunk->iov.iov_base + cqe->res;
+			chunk->iov.iov_len -= cqe->res;
+			chunk->offset += cqe->res;
+			if (ring_submit(out, idx))
+				continue;
+			success = false;
+		} else {
+			record_write(&out->io, chunk->size, os_gettime_ns() - chunk->submit_time);
+		}
+
+		chunk->in_flight = false;
+		ring->in_flight--;
+	}
+
+	__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+	record_queue_depth(&out->io, ring->in_flight);
+	return success;
+}
+
+static bool ring_drain(struct file_output_data *out)
+{
+	while (out->io.ring->in_flight) {
+		if (!ring_reap(out, true))
+			return false;
+	}
+	return true;
+}
+
+/* Synchronous write through the page cache, for the parts of a chunk that
+ * O_DIRECT cannot take */
+static bool ring_pwrite(struct file_output_data *out, const unsigned char *data, size_t size, uint64_t offset)
+{
+	uint64_t start = os_gettime_ns();
+	size_t done = 0;
+
+	while (done < size) {
+		ssize_t ret = pwrite(out->io.ring->buffered_fd, data + done, size - done, (off_t)(offset + done));
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			blog(LOG_ERROR, "Error writing to '%s': %s", out->filename.array, strerror(errno));
+			return false;
+		}
+		done += (size_t)ret;
+	}
+
+	record_write(&out->io, size, os_gettime_ns() - start);
+	return true;
+}
+
+/* Submits the current chunk and returns the buffer to fill next, or NULL on
+ * error.  With O_DIRECT only whole blocks go through the ring: the part up to
+ * the first block boundary is written synchronously, and the partial block at
+ * the end is carried over to the next chunk (so that it gets rewritten as a
+ * whole block once it fills up), or written synchronously if final is set
+ * because a flush, seek or shutdown needs it on disk now. */
+static unsigned char *ring_write_chunk(struct file_output_data *out, size_t *chunk_used, uint64_t *chunk_offset,
+				       bool final)
+{
+	struct io_ring *ring = out->io.ring;
+	struct ring_chunk *chunk = &ring->chunks[ring->cur];
+	size_t used = *chunk_used;
+	uint64_t offset = *chunk_offset;
+	size_t tail = 0;
+
+	if (!used)
+		return chunk->data;
+
+	if (offset != ring->last_end && !ring_drain(out))
+		return NULL;
+
+	if (ring->direct) {
+		size_t head = min((RING_ALIGNMENT - offset % RING_ALIGNMENT) % RING_ALIGNMENT, used);
+		if (head) {
+			if (!ring_pwrite(out, chunk->data, head, offset))
+				return NULL;
+
+			// O_DIRECT also needs the memory aligned
+			memmove(chunk->data, chunk->data + head, used - head);
+			used -= head;
+			offset += head;
+		}
+		tail = used % RING_ALIGNMENT;
+	}
+
+	size_t body = used - tail;
+	if (tail && final && !ring_pwrite(out, chunk->data + body, tail, offset + body))
+		return NULL;
+
+	ring->last_end = final ? offset + used : offset + body;
+	*chunk_offset = offset + body;
+	*chunk_used = final ? 0 : tail;
+
+	if (!body)
+		return chunk->data;
+
+	chunk->iov.iov_base = chunk->data;
+	chunk->iov.iov_len = body;
+	chunk->offset = offset;
+	chunk->size = body;
+	chunk->submit_time = os_gettime_ns();
+	if (!ring_submit(out, ring->cur))
+		return NULL;
+
+	chunk->in_flight = true;
+	ring->in_flight++;
+	record_queue_depth(&out->io, ring->in_flight);
+
+	// Pick up finished writes, waiting only if the queue is full
+	if (!ring_reap(out, false))
+		return NULL;
+	while (ring->in_flight >= ring->num_chunks - 1) {
+		if (!ring_reap(out, true))
+			return NULL;
+	}
+
+	for (unsigned i = 0; i < ring->num_chunks; i++) {
+		if (ring->chunks[i].in_flight)
+			continue;
+
+		if (*chunk_used)
+			memcpy(ring->chunks[i].data, chunk->data + body, *chunk_used);
+		ring->cur = i;
+		break;
+	}
+	return ring->chunks[ring->cur].data;
+}
+
+/* Gives back the preallocated space past the end of the file */
+static void release_preallocation(int fd)
+{
+	struct stat st;
+	if (fstat(fd, &st) == 0 && ftruncate(fd, st.st_size) != 0)
+		blog(LOG_DEBUG, "Failed to release preallocated space: %s", strerror(errno));
+}
+#endif
+
 static void *io_thread(void *opaque)
 {
 	struct file_output_data *out = opaque;
 	os_set_thread_name("buffered writer i/o thread");
 
-	// Chunk collects the writes into a larger batch
+	// Chunk collects the writes into a larger batch, starting at file
+	// offset chunk_offset
 	size_t chunk_used = 0;
 	size_t chunk_size = out->io.chunk_size;
+	size_t chunk_capacity = chunk_size;
+	uint64_t chunk_offset = 0;
+	unsigned char *chunk;
+
+#if defined(__linux__)
+	if (out->io.ring) {
+		chunk = out->io.ring->chunks[out->io.ring->cur].data;
+		if (out->io.ring->direct)
+			chunk_capacity += RING_ALIGNMENT;
+	} else
+#endif
+		chunk = bmalloc(chunk_size);
 
-	unsigned char *chunk = bmalloc(chunk_size);
 	if (!chunk) {
 		os_atomic_set_bool(&out->io.output_error, true);
 		fprintf(stderr, "Error allocating memory for output\n");
@@ -72,6 +512,8 @@ static void *io_thread(void *opaque)
 	}
 
 	bool shutting_down;
+	bool flushing;
+	bool seek_pending = false;
 	bool want_seek = false;
 	bool force_flush_chunk = false;
 
@@ -91,6 +533,7 @@ static void *io_thread(void *opaque)
 			pthread_mutex_lock(&out->io.data_mutex);
 
 			shutting_down = os_atomic_load_bool(&out->io.shutdown_requested);
+			flushing = out->io.flush_requested;
 
 			// Fetch as many writes as possible from the deque
 			// and fill up our local chunk. This may involve
@@ -115,6 +558,7 @@ static void *io_thread(void *opaque)
 					// if we already plan to seek, then seek.
 					if (chunk_used || want_seek) {
 						force_flush_chunk = true;
+						seek_pending = true;
 						break;
 					}
 
@@ -128,7 +572,7 @@ static void *io_thread(void *opaque)
 
 				// Make sure there's enough room for the data, if
 				// not then force a flush
-				if (header.data_length + chunk_used > chunk_size) {
+				if (header.data_length + chunk_used > chunk_capacity) {
 					force_flush_chunk = true;
 					break;
 				}
@@ -136,6 +580,9 @@ static void *io_thread(void *opaque)
 				// Remove header that we already read
 				deque_pop_front(&out->io.data, NULL, sizeof(header));
 
+				if (!chunk_used)
+					chunk_offset = current_seek_position;
+
 				// Copy from the buffer to our local chunk
 				deque_pop_front(&out->io.data, chunk + chunk_used, header.data_length);
 
@@ -150,14 +597,51 @@ static void *io_thread(void *opaque)
 			// Try to avoid lots of small writes unless this was the final
 			// data left in the buffer. The buffer might be entirely empty
 			// if we were woken up to exit.
-			if (!force_flush_chunk && (!chunk_used || (chunk_used < 65536 && !shutting_down))) {
+			if (!force_flush_chunk && (!chunk_used || (chunk_used < 65536 && !shutting_down && !flushing))) {
 				os_event_reset(out->io.new_data_available_event);
+
+				// Everything requested is written once nothing is
+				// left pending here
+				bool flush_file = flushing && !chunk_used;
+				if (flush_file)
+					out->io.flush_requested = false;
+
 				pthread_mutex_unlock(&out->io.data_mutex);
+
+				if (flush_file) {
+#if defined(__linux__)
+					if (out->io.ring) {
+						if (!ring_drain(out)) {
+							os_atomic_set_bool(&out->io.output_error, true);
+							goto error;
+						}
+					} else
+#endif
+						fflush(out->io.output_file);
+				}
 				break;
 			}
 
 			pthread_mutex_unlock(&out->io.data_mutex);
 
+#if defined(__linux__)
+			// The ring writes at chunk_offset, seeks are only bookkeeping
+			if (out->io.ring) {
+				bool final = shutting_down || flushing || seek_pending;
+
+				chunk = ring_write_chunk(out, &chunk_used, &chunk_offset, final);
+				if (!chunk) {
+					os_atomic_set_bool(&out->io.output_error, true);
+					goto error;
+				}
+
+				want_seek = false;
+				seek_pending = false;
+				force_flush_chunk = false;
+				continue;
+			}
+#endif
+
 			// Seek if we need to
 			if (want_seek) {
 				os_fseeki64(out->io.output_file, next_seek_position, SEEK_SET);
@@ -177,6 +661,7 @@ static void *io_thread(void *opaque)
 			}
 
 			// Write the current chunk to the output file
+			uint64_t write_start = os_gettime_ns();
 			size_t bytes_written = fwrite(chunk, 1, chunk_used, out->io.output_file);
 			if (bytes_written != chunk_used) {
 				blog(LOG_ERROR, "Error writing to '%s': %s (%zu != %zu)\n", out->filename.array,
@@ -185,8 +670,10 @@ static void *io_thread(void *opaque)
 
 				goto error;
 			}
+			record_write(&out->io, bytes_written, os_gettime_ns() - write_start);
 
 			chunk_used = 0;
+			seek_pending = false;
 			force_flush_chunk = false;
 		}
 
@@ -196,6 +683,22 @@ static void *io_thread(void *opaque)
 	}
 
 error:
+#if defined(__linux__)
+	if (out->io.ring) {
+		ring_drain(out);
+		if (out->io.preallocated)
+			release_preallocation(out->io.ring->fd);
+		ring_destroy(out->io.ring);
+		out->io.ring = NULL;
+		return NULL;
+	}
+
+	if (out->io.preallocated) {
+		fflush(out->io.output_file);
+		release_preallocation(fileno(out->io.output_file));
+	}
+#endif
+
 	if (chunk)
 		bfree(chunk);
 
@@ -234,18 +737,6 @@ static int64_t file_output_seek(void *opaque, int64_t offset, enum serialize_see
 	return (int64_t)out->io.next_pos;
 }
 
-#ifndef _WIN32
-static inline size_t max(size_t a, size_t b)
-{
-	return a > b ? a : b;
-}
-
-static inline size_t min(size_t a, size_t b)
-{
-	return a < b ? a : b;
-}
-#endif
-
 static size_t file_output_write(void *opaque, const void *buf, size_t buf_size)
 {
 	struct file_output_data *out = opaque;
@@ -300,6 +791,9 @@ static size_t file_output_write(void *opaque, const void *buf, size_t buf_size)
 			next_chunk_size = min(remaining, out->io.chunk_size);
 		}
 
+		if (out->io.data.size > out->io.max_buffered)
+			out->io.max_buffered = out->io.data.size;
+
 		// Tell the I/O thread that there's new data to be written
 		os_event_signal(out->io.new_data_available_event);
 
@@ -319,12 +813,36 @@ static int64_t file_output_get_pos(void *opaque)
 	return (int64_t)out->io.next_pos;
 }
 
+void buffered_file_serializer_flush(struct serializer *s)
+{
+	struct file_output_data *out = s->data;
+
+	if (!out)
+		return;
+
+	pthread_mutex_lock(&out->io.data_mutex);
+	out->io.flush_requested = true;
+	os_event_signal(out->io.new_data_available_event);
+	pthread_mutex_unlock(&out->io.data_mutex);
+}
+
 bool buffered_file_serializer_init_defaults(struct serializer *s, const char *path)
 {
 	return buffered_file_serializer_init(s, path, 0, 0);
 }
 
 bool buffered_file_serializer_init(struct serializer *s, const char *path, size_t max_bufsize, size_t chunk_size)
+{
+	struct buffered_file_serializer_options options = {
+		.max_bufsize = max_bufsize,
+		.chunk_size = chunk_size,
+	};
+
+	return buffered_file_serializer_init_ex(s, path, &options);
+}
+
+bool buffered_file_serializer_init_ex(struct serializer *s, const char *path,
+				      const struct buffered_file_serializer_options *options)
 {
 	struct file_output_data *out;
 
@@ -332,18 +850,45 @@ bool buffered_file_serializer_init(struct serializer *s, const char *path, size_
 
 	dstr_init_copy(&out->filename, path);
 
-	out->io.output_file = os_fopen(path, "wb");
+	out->io.buffer_size = options->max_bufsize ? options->max_bufsize : DEFAULT_BUF_SIZE;
+	out->io.chunk_size = options->chunk_size ? options->chunk_size : DEFAULT_CHUNK_SIZE;
+
+#if defined(__linux__)
+	if (options->io_uring)
+		out->io.ring = ring_create(path, options, out->io.chunk_size);
+
+	if (!out->io.ring)
+#endif
+		out->io.output_file = os_fopen(path, "wb");
+
+#if defined(__linux__)
+	if (!out->io.ring && !out->io.output_file)
+#else
 	if (!out->io.output_file)
+#endif
 		return false;
 
-	out->io.buffer_size = max_bufsize ? max_bufsize : DEFAULT_BUF_SIZE;
-	out->io.chunk_size = chunk_size ? chunk_size : DEFAULT_CHUNK_SIZE;
+#if defined(__linux__)
+	if (options->preallocate) {
+		// Reserves the blocks without changing the file size, so the
+		// file stays readable while it is written
+		int fd = out->io.ring ? out->io.ring->fd : fileno(out->io.output_file);
+		if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)options->preallocate) == 0)
+			out->io.preallocated = true;
+		else
+			blog(LOG_DEBUG, "Failed to preallocate '%s': %s", path, strerror(errno));
+	}
+
+	out->io.stats.io_uring = out->io.ring != NULL;
+	out->io.stats.direct_io = out->io.ring && out->io.ring->direct;
+#endif
 
 	// Start at 1MB, this can grow up to max_bufsize depending
 	// on how fast data is going in and out.
 	deque_reserve(&out->io.data, 1048576);
 
 	pthread_mutex_init(&out->io.data_mutex, NULL);
+	pthread_mutex_init(&out->io.stats_mutex, NULL);
 
 	os_event_init(&out->io.buffer_space_available_event, OS_EVENT_TYPE_AUTO);
 	os_event_init(&out->io.new_data_available_event, OS_EVENT_TYPE_AUTO);
@@ -360,6 +905,25 @@ bool buffered_file_serializer_init(struct serializer *s, const char *path, size_
 	return true;
 }
 
+void buffered_file_serializer_get_stats(struct serializer *s, struct buffered_file_serializer_stats *stats)
+{
+	struct file_output_data *out = s->data;
+
+	if (!out) {
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	pthread_mutex_lock(&out->io.stats_mutex);
+	*stats = out->io.stats;
+	pthread_mutex_unlock(&out->io.stats_mutex);
+
+	pthread_mutex_lock(&out->io.data_mutex);
+	stats->buffered = out->io.data.size;
+	stats->max_buffered = out->io.max_buffered;
+	pthread_mutex_unlock(&out->io.data_mutex);
+}
+
 void buffered_file_serializer_free(struct serializer *s)
 {
 	struct file_output_data *out = s->data;
@@ -376,10 +940,21 @@ void buffered_file_serializer_free(struct serializer *s)
 		pthread_mutex_unlock(&out->io.data_mutex);
 		pthread_join(out->io.io_thread, NULL);
 
+		struct buffered_file_serializer_stats *stats = &out->io.stats;
+		blog(LOG_INFO,
+		     "Wrote '%s' (%s%s): %" PRIu64 " KiB in %" PRIu64 " writes, %.2f ms average / %.2f ms max "
+		     "per write, up to %u in flight, up to %zu KiB buffered",
+		     out->filename.array, stats->io_uring ? "io_uring" : "stdio", stats->direct_io ? ", O_DIRECT" : "",
+		     stats->bytes_written / 1024, stats->writes,
+		     stats->writes ? (double)stats->write_time_ns / stats->writes / 1000000.0 : 0.0,
+		     (double)stats->max_write_time_ns / 1000000.0, stats->max_queue_depth,
+		     out->io.max_buffered / 1024);
+
 		os_event_destroy(out->io.new_data_available_event);
 		os_event_destroy(out->io.buffer_space_available_event);
 
 		pthread_mutex_destroy(&out->io.data_mutex);
+		pthread_mutex_destroy(&out->io.stats_mutex);
 
 		blog(LOG_DEBUG, "Final buffer capacity: %zu KiB", out->io.data.capacity / 1024);
 
@@ -22,11 +22,56 @@
 extern "C" {
 #endif
 
+struct buffered_file_serializer_options {
+	size_t max_bufsize; /* 0: 256 MiB */
+	size_t chunk_size;  /* 0: 1 MiB */
+
+	/* Linux only, ignored elsewhere.  With io_uring the I/O thread
+	 * submits chunks asynchronously and keeps up to queue_depth (0: 4)
+	 * writes in flight instead of blocking on each one.  direct_io opens
+	 * the file with O_DIRECT so recordings do not fill the page cache;
+	 * only block-aligned parts are written that way, the rest (after a
+	 * seek or flush) goes through a regular descriptor.  Falls back to
+	 * the stdio writer if io_uring or O_DIRECT is unavailable. */
+	bool io_uring;
+	bool direct_io;
+	unsigned int queue_depth;
+
+	/* Reserves this many bytes of disk up front (fallocate), limiting
+	 * fragmentation when several files grow at once.  Unused space is
+	 * released when the file is closed. */
+	uint64_t preallocate;
+};
+
+struct buffered_file_serializer_stats {
+	uint64_t bytes_written;
+	uint64_t writes;
+	uint64_t write_time_ns; /* summed time from submission to completion */
+	uint64_t max_write_time_ns;
+
+	unsigned int queue_depth; /* writes in flight */
+	unsigned int max_queue_depth;
+	size_t buffered;          /* bytes waiting for the I/O thread */
+	size_t max_buffered;
+
+	bool io_uring;
+	bool direct_io;
+};
+
 EXPORT bool buffered_file_serializer_init_defaults(struct serializer *s, const char *path);
 EXPORT bool buffered_file_serializer_init(struct serializer *s, const char *path, size_t max_bufsize,
 					  size_t chunk_size);
+EXPORT bool buffered_file_serializer_init_ex(struct serializer *s, const char *path,
+					     const struct buffered_file_serializer_options *options);
 EXPORT void buffered_file_serializer_free(struct serializer *s);
 
+EXPORT void buffered_file_serializer_get_stats(struct serializer *s, struct buffered_file_serializer_stats *stats);
+
+/* Has the I/O thread write out everything serialized so far and flush the
+ * file, without waiting for it.  For formats that are meant to be readable up
+ * to the last complete unit (e.g. fragmented MP4) if the process dies. */
+EXPORT void buffered_file_serializer_flush(struct serializer *s);
+
 #ifdef __cplusplus
 }
 #endif
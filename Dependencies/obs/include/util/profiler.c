@@ -230,7 +230,9 @@ static void merge_call(profile_entry *entry, profile_call *call, profile_call *p
 		merge_call(get_child(entry, child->name), child, NULL);
 	}
 
-	if (entry->expected_time_between_calls != 0 && prev_call) {
+	/* calls of the same root from different threads can be drained out
+	 * of order */
+	if (entry->expected_time_between_calls != 0 && prev_call && prev_call->start_time <= call->start_time) {
 		migrate_old_entries(&entry->times_between_calls, true);
 		uint64_t usec = diff_ns_to_usec(prev_call->start_time, call->start_time);
 		add_hashmap_entry(&entry->times_between_calls, usec, 1);
@@ -248,12 +250,61 @@ static void merge_call(profile_entry *entry, profile_call *call, profile_call *p
 #endif
 }
 
+/* Finished root calls are queued per thread without locking and merged into
+ * root_entries lazily, when a snapshot or trace is taken or when the queue of
+ * a thread runs full, so profile_end never waits for other threads.
+ *
+ * Since threads write to their queue without holding root_mutex, queues are
+ * never freed (not even by profiler_free), only reused once their thread has
+ * exited.  They are allocated outside of bmem so that they are not reported
+ * as leaks. */
+#define PROFILE_THREAD_QUEUE_SIZE 256
+
+typedef struct profile_thread profile_thread;
+struct profile_thread {
+	profile_call *queue[PROFILE_THREAD_QUEUE_SIZE];
+	volatile long head; /* written by the owning thread only */
+	volatile long tail; /* written with root_mutex held only */
+	volatile bool exited;
+	long trace_tid;
+	bool trace_named;
+	profile_thread *next;
+};
+
+typedef struct profile_trace_event profile_trace_event;
+struct profile_trace_event {
+	const char *name;
+	uint64_t start_time;
+	uint64_t end_time;
+	long tid;
+};
+
+typedef struct profile_trace_thread profile_trace_thread;
+struct profile_trace_thread {
+	long tid;
+	const char *name;
+};
+
 static bool enabled = false;
 static pthread_mutex_t root_mutex = PTHREAD_MUTEX_INITIALIZER;
 static DARRAY(profile_root_entry) root_entries;
+static profile_thread *threads = NULL;
+static long next_trace_tid = 1;
+
+/* most recent calls for profiler_trace_dump_json, a ring buffer */
+static profile_trace_event *trace_events;
+static size_t trace_capacity;
+static size_t trace_count;
+static size_t trace_next;
+static DARRAY(profile_trace_thread) trace_threads;
+
+/* only used to notice when threads exit so their queues can be reused */
+static pthread_key_t thread_key;
+static bool thread_key_created = false;
 
 static THREAD_LOCAL profile_call *thread_context = NULL;
 static THREAD_LOCAL bool thread_enabled = true;
+static THREAD_LOCAL profile_thread *thread_queue = NULL;
 
 void profiler_start(void)
 {
@@ -326,33 +377,144 @@ void profile_register_root(const char *name, uint64_t expected_time_between_call
 
 static void free_call_context(profile_call *context);
 
-static void merge_context(profile_call *context)
+static void trace_call(profile_call *call, long tid)
 {
-	pthread_mutex_t *mutex = NULL;
-	profile_entry *entry = NULL;
-	profile_call *prev_call = NULL;
+	profile_trace_event *event = &trace_events[trace_next];
+	event->name = call->name;
+	event->start_time = call->start_time;
+	event->end_time = call->end_time;
+	event->tid = tid;
+
+	trace_next = (trace_next + 1) % trace_capacity;
+	if (trace_count < trace_capacity)
+		trace_count++;
+
+	for (size_t i = 0; i < call->children.num; i++)
+		trace_call(&call->children.array[i], tid);
+}
 
-	if (!lock_root()) {
+/* root_mutex must be held */
+static void merge_context_locked(profile_thread *thread, profile_call *context)
+{
+	if (!enabled) {
 		free_call_context(context);
 		return;
 	}
 
-	profile_root_entry *r_entry = get_root_entry(context->name);
+	if (trace_capacity) {
+		if (!thread->trace_named) {
+			profile_trace_thread trace_thread = {thread->trace_tid, context->name};
+			da_push_back(trace_threads, &trace_thread);
+			thread->trace_named = true;
+		}
+
+		trace_call(context, thread->trace_tid);
+	}
 
-	mutex = r_entry->mutex;
-	entry = r_entry->entry;
-	prev_call = r_entry->prev_call;
+	profile_root_entry *r_entry = get_root_entry(context->name);
+	profile_call *prev_call = r_entry->prev_call;
 
 	r_entry->prev_call = context;
 
-	pthread_mutex_lock(mutex);
+	pthread_mutex_lock(r_entry->mutex);
+	merge_call(r_entry->entry, context, prev_call);
+	pthread_mutex_unlock(r_entry->mutex);
+
+	free_call_context(prev_call);
+}
+
+/* root_mutex must be held */
+static void drain_thread(profile_thread *thread)
+{
+	unsigned long head = (unsigned long)os_atomic_load_long(&thread->head);
+	unsigned long tail = (unsigned long)thread->tail;
+
+	while (tail != head) {
+		profile_call *context = thread->queue[tail % PROFILE_THREAD_QUEUE_SIZE];
+		merge_context_locked(thread, context);
+		os_atomic_set_long(&thread->tail, (long)++tail);
+	}
+}
+
+/* root_mutex must be held */
+static void drain_threads(void)
+{
+	for (profile_thread *thread = threads; thread; thread = thread->next)
+		drain_thread(thread);
+}
+
+static void thread_exited(void *data)
+{
+	profile_thread *thread = data;
+
+	pthread_mutex_lock(&root_mutex);
+	os_atomic_set_bool(&thread->exited, true);
 	pthread_mutex_unlock(&root_mutex);
+}
 
-	merge_call(entry, context, prev_call);
+/* reuses the queue of a thread that exited, or adds a new one */
+static profile_thread *register_thread(void)
+{
+	profile_thread *thread = NULL;
 
-	pthread_mutex_unlock(mutex);
+	pthread_mutex_lock(&root_mutex);
+	if (!thread_key_created)
+		thread_key_created = pthread_key_create(&thread_key, thread_exited) == 0;
 
-	free_call_context(prev_call);
+	for (profile_thread *t = threads; t; t = t->next) {
+		if (os_atomic_load_bool(&t->exited)) {
+			thread = t;
+			drain_thread(thread);
+			break;
+		}
+	}
+
+	if (!thread) {
+		thread = calloc(1, sizeof(profile_thread));
+		if (!thread) {
+			pthread_mutex_unlock(&root_mutex);
+			return NULL;
+		}
+
+		thread->next = threads;
+		threads = thread;
+	}
+
+	thread->exited = false;
+	thread->trace_tid = next_trace_tid++;
+	thread->trace_named = false;
+	if (thread_key_created)
+		pthread_setspecific(thread_key, thread);
+	pthread_mutex_unlock(&root_mutex);
+
+	return thread;
+}
+
+static void queue_context(profile_call *context)
+{
+	profile_thread *thread = thread_queue;
+	if (!thread)
+		thread = thread_queue = register_thread();
+	if (!thread) {
+		free_call_context(context);
+		return;
+	}
+
+	unsigned long head = (unsigned long)thread->head;
+	unsigned long tail = (unsigned long)os_atomic_load_long(&thread->tail);
+
+	if (head - tail == PROFILE_THREAD_QUEUE_SIZE) {
+		if (!lock_root()) {
+			free_call_context(context);
+			return;
+		}
+
+		drain_thread(thread);
+		pthread_mutex_unlock(&root_mutex);
+	}
+
+	thread->queue[head % PROFILE_THREAD_QUEUE_SIZE] = context;
+	os_atomic_set_long(&thread->head, (long)(head + 1));
 }
 
 void profile_start(const char *name)
@@ -426,7 +588,7 @@ void profile_end(const char *name)
 	if (call->parent)
 		return;
 
-	merge_context(call);
+	queue_context(call);
 }
 
 static int profiler_time_entry_compare(const void *first, const void *second)
@@ -770,7 +932,13 @@ void profiler_free(void)
 
 	pthread_mutex_lock(&root_mutex);
 	enabled = false;
+	drain_threads();
 	da_move(old_root_entries, root_entries);
+
+	bfree(trace_events);
+	trace_events = NULL;
+	trace_capacity = trace_count = trace_next = 0;
+	da_free(trace_threads);
 	pthread_mutex_unlock(&root_mutex);
 
 	for (size_t i = 0; i < old_root_entries.num; i++) {
@@ -888,6 +1056,7 @@ profiler_snapshot_t *profile_snapshot_create(void)
 	profiler_snapshot_t *snap = bzalloc(sizeof(profiler_snapshot_t));
 
 	pthread_mutex_lock(&root_mutex);
+	drain_threads();
 	da_reserve(snap->roots, root_entries.num);
 	for (size_t i = 0; i < root_entries.num; i++) {
 		pthread_mutex_lock(root_entries.array[i].mutex);
@@ -1016,6 +1185,82 @@ bool profiler_snapshot_dump_csv_gz(const profiler_snapshot_t *snap, const char *
 	return true;
 }
 
+/* ------------------------------------------------------------------------- */
+/* Chrome trace event format export */
+
+void profiler_trace_start(size_t max_events)
+{
+	pthread_mutex_lock(&root_mutex);
+	drain_threads();
+
+	bfree(trace_events);
+	trace_events = max_events ? bmalloc(max_events * sizeof(profile_trace_event)) : NULL;
+	trace_capacity = max_events;
+	trace_count = trace_next = 0;
+
+	da_free(trace_threads);
+	for (profile_thread *thread = threads; thread; thread = thread->next)
+		thread->trace_named = false;
+	pthread_mutex_unlock(&root_mutex);
+}
+
+void profiler_trace_stop(void)
+{
+	profiler_trace_start(0);
+}
+
+static void dstr_cat_json_string(struct dstr *str, const char *value)
+{
+	dstr_cat_ch(str, '"');
+	for (const char *c = value; *c; c++) {
+		if (*c == '"' || *c == '\\')
+			dstr_catf(str, "\\%c", *c);
+		else if ((unsigned char)*c < 0x20)
+			dstr_catf(str, "\\u%04x", (unsigned char)*c);
+		else
+			dstr_cat_ch(str, *c);
+	}
+	dstr_cat_ch(str, '"');
+}
+
+bool profiler_trace_dump_json(const char *filename)
+{
+	struct dstr buffer = {0};
+
+	FILE *f = os_fopen(filename, "wb");
+	if (!f)
+		return false;
+
+	pthread_mutex_lock(&root_mutex);
+	drain_threads();
+
+	dstr_copy(&buffer, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for (size_t i = 0; i < trace_threads.num; i++) {
+		dstr_catf(&buffer, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%ld,\"args\":{\"name\":",
+			  i ? ",\n" : "", trace_threads.array[i].tid);
+		dstr_cat_json_string(&buffer, trace_threads.array[i].name);
+		dstr_cat(&buffer, "}}");
+	}
+	fwrite(buffer.array, 1, buffer.len, f);
+
+	size_t first = (trace_next + trace_capacity - trace_count) % (trace_capacity ? trace_capacity : 1);
+	for (size_t i = 0; i < trace_count; i++) {
+		profile_trace_event *event = &trace_events[(first + i) % trace_capacity];
+
+		dstr_printf(&buffer, "%s{\"name\":", (i || trace_threads.num) ? ",\n" : "");
+		dstr_cat_json_string(&buffer, event->name);
+		dstr_catf(&buffer, ",\"ph\":\"X\",\"pid\":1,\"tid\":%ld,\"ts\":%.3f,\"dur\":%.3f}", event->tid,
+			  event->start_time / 1000.0, (event->end_time - event->start_time) / 1000.0);
+		fwrite(buffer.array, 1, buffer.len, f);
+	}
+	pthread_mutex_unlock(&root_mutex);
+
+	fputs("\n]}\n", f);
+	fclose(f);
+	dstr_free(&buffer);
+	return true;
+}
+
 size_t profiler_snapshot_num_roots(profiler_snapshot_t *snap)
 {
 	return snap ? snap->roots.num : 0;
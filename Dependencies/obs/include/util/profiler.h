@@ -69,6 +69,12 @@ EXPORT void profile_snapshot_free(profiler_snapshot_t *snap);
 EXPORT bool profiler_snapshot_dump_csv(const profiler_snapshot_t *snap, const char *filename);
 EXPORT bool profiler_snapshot_dump_csv_gz(const profiler_snapshot_t *snap, const char *filename);
 
+/* Keeps the last max_events calls (0 to stop) for export as a Chrome trace /
+ * Perfetto JSON file, one track per profiled thread */
+EXPORT void profiler_trace_start(size_t max_events);
+EXPORT void profiler_trace_stop(void);
+EXPORT bool profiler_trace_dump_json(const char *filename);
+
 EXPORT size_t profiler_snapshot_num_roots(profiler_snapshot_t *snap);
 EXPORT void profiler_snapshot_enumerate_roots(profiler_snapshot_t *snap, profiler_entry_enum_func func, void *context);
 
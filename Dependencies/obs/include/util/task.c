@@ -2,6 +2,8 @@
 #include "bmem.h"
 #include "threading.h"
 #include "deque.h"
+#include "darray.h"
+#include "platform.h"
 
 struct os_task_queue {
 	pthread_t thread;
@@ -162,3 +164,122 @@ static void *tiny_tubular_task_thread(void *param)
 
 	return NULL;
 }
+
+/* ------------------------------------------------------------------------- */
+
+struct os_task_pool {
+	DARRAY(pthread_t) threads;
+	char *name;
+	os_sem_t *sem;
+	volatile bool stop;
+
+	pthread_mutex_t mutex;
+	struct deque tasks;
+};
+
+static void *task_pool_thread(void *param)
+{
+	struct os_task_pool *tp = param;
+
+	os_set_thread_name(tp->name);
+
+	while (os_sem_wait(tp->sem) == 0) {
+		struct os_task_info ti;
+		bool have_task = false;
+
+		pthread_mutex_lock(&tp->mutex);
+		if (tp->tasks.size) {
+			deque_pop_front(&tp->tasks, &ti, sizeof(ti));
+			have_task = true;
+		}
+		pthread_mutex_unlock(&tp->mutex);
+
+		if (have_task)
+			ti.task(ti.param);
+		else if (os_atomic_load_bool(&tp->stop))
+			break;
+	}
+
+	return NULL;
+}
+
+os_task_pool_t *os_task_pool_create(size_t threads, const char *name)
+{
+	struct os_task_pool *tp;
+
+	if (!threads)
+		threads = (size_t)os_get_logical_cores();
+	if (!threads)
+		threads = 1;
+
+	tp = bzalloc(sizeof(*tp));
+	tp->name = bstrdup(name ? name : "os_task_pool");
+
+	if (pthread_mutex_init(&tp->mutex, NULL) != 0)
+		goto fail1;
+	if (os_sem_init(&tp->sem, 0) != 0)
+		goto fail2;
+
+	for (size_t i = 0; i < threads; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, task_pool_thread, tp) != 0)
+			break;
+		da_push_back(tp->threads, &thread);
+	}
+
+	if (!tp->threads.num) {
+		os_sem_destroy(tp->sem);
+		goto fail2;
+	}
+
+	return tp;
+
+fail2:
+	pthread_mutex_destroy(&tp->mutex);
+fail1:
+	bfree(tp->name);
+	bfree(tp);
+	return NULL;
+}
+
+bool os_task_pool_queue_task(os_task_pool_t *tp, os_task_t task, void *param)
+{
+	struct os_task_info ti = {
+		task,
+		param,
+	};
+
+	if (!tp)
+		return false;
+
+	pthread_mutex_lock(&tp->mutex);
+	deque_push_back(&tp->tasks, &ti, sizeof(ti));
+	pthread_mutex_unlock(&tp->mutex);
+	os_sem_post(tp->sem);
+	return true;
+}
+
+size_t os_task_pool_thread_count(const os_task_pool_t *tp)
+{
+	return tp ? tp->threads.num : 0;
+}
+
+/* tasks still queued are run before the threads exit */
+void os_task_pool_destroy(os_task_pool_t *tp)
+{
+	if (!tp)
+		return;
+
+	os_atomic_set_bool(&tp->stop, true);
+	for (size_t i = 0; i < tp->threads.num; i++)
+		os_sem_post(tp->sem);
+	for (size_t i = 0; i < tp->threads.num; i++)
+		pthread_join(tp->threads.array[i], NULL);
+
+	da_free(tp->threads);
+	os_sem_destroy(tp->sem);
+	pthread_mutex_destroy(&tp->mutex);
+	deque_free(&tp->tasks);
+	bfree(tp->name);
+	bfree(tp);
+}
@@ -17,6 +17,17 @@ EXPORT void os_task_queue_destroy(os_task_queue_t *tt);
 EXPORT bool os_task_queue_wait(os_task_queue_t *tt);
 EXPORT bool os_task_queue_inside(os_task_queue_t *tt);
 
+/* Pool of worker threads sharing one queue.  Tasks run in parallel in no
+ * particular order; callers that need ordering must not queue a task again
+ * before the previous one has finished. */
+struct os_task_pool;
+typedef struct os_task_pool os_task_pool_t;
+
+EXPORT os_task_pool_t *os_task_pool_create(size_t threads, const char *name);
+EXPORT bool os_task_pool_queue_task(os_task_pool_t *tp, os_task_t task, void *param);
+EXPORT size_t os_task_pool_thread_count(const os_task_pool_t *tp);
+EXPORT void os_task_pool_destroy(os_task_pool_t *tp);
+
 #ifdef __cplusplus
 }
 #endif
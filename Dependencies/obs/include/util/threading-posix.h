@@ -56,6 +56,16 @@ static inline bool os_atomic_compare_exchange_long(volatile long *val, long *old
 	return __atomic_compare_exchange_n(val, old_val, new_val, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
 }
 
+static inline long long os_atomic_add_long_long(volatile long long *val, long long diff)
+{
+	return __atomic_add_fetch(val, diff, __ATOMIC_SEQ_CST);
+}
+
+static inline long long os_atomic_load_long_long(const volatile long long *ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
 static inline void os_atomic_store_bool(volatile bool *ptr, bool val)
 {
 	__atomic_store_n(ptr, val, __ATOMIC_SEQ_CST);
@@ -88,6 +88,17 @@ static inline bool os_atomic_compare_exchange_long(volatile long *val, long *old
 	return previous == old_val;
 }
 
+static inline long long os_atomic_add_long_long(volatile long long *val, long long diff)
+{
+	return _InterlockedExchangeAdd64(val, diff) + diff;
+}
+
+static inline long long os_atomic_load_long_long(const volatile long long *ptr)
+{
+	/* also atomic on 32-bit targets, unlike a plain 64-bit load */
+	return _InterlockedCompareExchange64((volatile long long *)ptr, 0, 0);
+}
+
 static inline void os_atomic_store_bool(volatile bool *ptr, bool val)
 {
 #if defined(_M_ARM64)
@@ -0,0 +1,203 @@
+// audio_mix_bench.cpp - Cost of one libobs audio tick: mixing sources into the mixes and clamping
+//
+// Mirrors what obs-audio.c mix_audio() and audio-io.c clamp_audio_output()
+// do every AUDIO_OUTPUT_FRAMES: each source's per-mix output is added into
+// every mix, then each mix is copied to its unclamped buffer and clamped.
+// The scalar loops libobs used before are timed next to the SIMD kernels
+// from media-io/audio-math.h, with all mixes active and with only some of
+// them active (inactive mixes are skipped), and the results are compared.
+//
+//     ./audio_mix_bench               # 32 sources, 6 mixes, 8 channels; 6, 2 and 1 active
+//     ./audio_mix_bench 64 2          # 64 sources, 6 and 2 active mixes
+#include <media-io/audio-io.h>
+#include <media-io/audio-math.h>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static constexpr size_t channels = 8;
+static constexpr size_t sample_rate = 48000;
+
+struct Buffers {
+    size_t sources;
+    // [source][mix][channel][frame], like obs_source::audio_output_buf
+    std::vector<float> source_data;
+    // [mix][channel][frame], like audio_mix::buffer / buffer_unclamped
+    std::vector<float> mix;
+    std::vector<float> unclamped;
+
+    explicit Buffers(size_t source_count)
+        : sources(source_count),
+          source_data(source_count * MAX_AUDIO_MIXES * channels * AUDIO_OUTPUT_FRAMES),
+          mix(MAX_AUDIO_MIXES * channels * AUDIO_OUTPUT_FRAMES),
+          unclamped(MAX_AUDIO_MIXES * channels * AUDIO_OUTPUT_FRAMES) {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> dist(-0.2f, 0.2f);
+        for (float& sample : source_data) {
+            sample = dist(rng);
+        }
+        // a stray NaN so the NaN handling is part of the comparison
+        source_data[12345 % source_data.size()] = NAN;
+    }
+
+    float* source_buf(size_t source, size_t mix_idx, size_t ch) {
+        return &source_data[((source * MAX_AUDIO_MIXES + mix_idx) * channels + ch) * AUDIO_OUTPUT_FRAMES];
+    }
+
+    float* mix_buf(size_t mix_idx, size_t ch) {
+        return &mix[(mix_idx * channels + ch) * AUDIO_OUTPUT_FRAMES];
+    }
+
+    float* unclamped_buf(size_t mix_idx, size_t ch) {
+        return &unclamped[(mix_idx * channels + ch) * AUDIO_OUTPUT_FRAMES];
+    }
+};
+
+// The loops obs-audio.c / audio-io.c used before the SIMD kernels
+static void tick_scalar(Buffers& b, uint32_t active_mixes) {
+    std::fill(b.mix.begin(), b.mix.end(), 0.0f);
+
+    for (size_t source = 0; source < b.sources; source++) {
+        for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+            for (size_t ch = 0; ch < channels; ch++) {
+                float* mix = b.mix_buf(mix_idx, ch);
+                float* aud = b.source_buf(source, mix_idx, ch);
+                float* end = aud + AUDIO_OUTPUT_FRAMES;
+                while (aud < end) {
+                    *(mix++) += *(aud++);
+                }
+            }
+        }
+    }
+
+    for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+        if ((active_mixes & (1 << mix_idx)) == 0) {
+            continue;
+        }
+        for (size_t ch = 0; ch < channels; ch++) {
+            float* mix_data = b.mix_buf(mix_idx, ch);
+            float* mix_end = mix_data + AUDIO_OUTPUT_FRAMES;
+            memcpy(b.unclamped_buf(mix_idx, ch), mix_data, AUDIO_OUTPUT_FRAMES * sizeof(float));
+            while (mix_data < mix_end) {
+                float val = *mix_data;
+                val = (val == val) ? val : 0.0f;
+                val = (val > 1.0f) ? 1.0f : val;
+                val = (val < -1.0f) ? -1.0f : val;
+                *(mix_data++) = val;
+            }
+        }
+    }
+}
+
+static void tick_simd(Buffers& b, uint32_t active_mixes) {
+    std::fill(b.mix.begin(), b.mix.end(), 0.0f);
+
+    for (size_t source = 0; source < b.sources; source++) {
+        for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+            if ((active_mixes & (1 << mix_idx)) == 0) {
+                continue;
+            }
+            for (size_t ch = 0; ch < channels; ch++) {
+                mix_float_samples(b.mix_buf(mix_idx, ch), b.source_buf(source, mix_idx, ch), AUDIO_OUTPUT_FRAMES);
+            }
+        }
+    }
+
+    for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+        if ((active_mixes & (1 << mix_idx)) == 0) {
+            continue;
+        }
+        for (size_t ch = 0; ch < channels; ch++) {
+            copy_clamp_float_samples(b.mix_buf(mix_idx, ch), b.unclamped_buf(mix_idx, ch), AUDIO_OUTPUT_FRAMES);
+        }
+    }
+}
+
+static double time_tick(const std::function<void()>& tick, double min_seconds) {
+    using clock = std::chrono::steady_clock;
+
+    tick(); // warm up caches
+
+    int iterations = 0;
+    auto start = clock::now();
+    double elapsed = 0.0;
+    do {
+        tick();
+        iterations++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < min_seconds);
+
+    return elapsed / iterations;
+}
+
+static bool same_active_mixes(Buffers& a, Buffers& b, uint32_t active_mixes) {
+    for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+        if ((active_mixes & (1 << mix_idx)) == 0) {
+            continue;
+        }
+        for (size_t ch = 0; ch < channels; ch++) {
+            const size_t bytes = AUDIO_OUTPUT_FRAMES * sizeof(float);
+            if (memcmp(a.mix_buf(mix_idx, ch), b.mix_buf(mix_idx, ch), bytes) != 0 ||
+                memcmp(a.unclamped_buf(mix_idx, ch), b.unclamped_buf(mix_idx, ch), bytes) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    size_t sources = argc > 1 ? strtoul(argv[1], nullptr, 10) : 32;
+    size_t active = argc > 2 ? strtoul(argv[2], nullptr, 10) : 0;
+
+    if (sources == 0 || (argc > 2 && (active == 0 || active > MAX_AUDIO_MIXES))) {
+        std::cerr << "Usage: audio_mix_bench [sources] [active mixes, 1-" << MAX_AUDIO_MIXES << "]" << std::endl;
+        return 1;
+    }
+
+    const double tick_us = 1e6 * AUDIO_OUTPUT_FRAMES / sample_rate;
+    std::cout << sources << " sources, " << MAX_AUDIO_MIXES << " mixes, " << channels << " channels, "
+              << AUDIO_OUTPUT_FRAMES << " frames per tick (" << tick_us << " us of audio)" << std::endl
+              << std::endl;
+
+    // a typical session only has outputs on one or two of the mixes, which
+    // is where skipping the inactive ones matters
+    std::vector<size_t> active_counts = { MAX_AUDIO_MIXES, 2, 1 };
+    if (active) {
+        active_counts = { MAX_AUDIO_MIXES };
+        if (active != MAX_AUDIO_MIXES) {
+            active_counts.push_back(active);
+        }
+    }
+
+    Buffers scalar(sources), simd(sources);
+    bool all_match = true;
+
+    printf("  %-14s%14s%14s%10s%12s\n", "active mixes", "scalar", "simd", "speedup", "tick load");
+    for (size_t count : active_counts) {
+        const uint32_t mask = (1u << count) - 1;
+
+        double scalar_time = time_tick([&] { tick_scalar(scalar, mask); }, 0.5);
+        double simd_time = time_tick([&] { tick_simd(simd, mask); }, 0.5);
+
+        if (!same_active_mixes(scalar, simd, mask)) {
+            all_match = false;
+        }
+
+        printf("  %-14zu%11.1f us%11.1f us%9.2fx%11.2f%%\n", count, scalar_time * 1e6, simd_time * 1e6,
+               scalar_time / simd_time, 100.0 * simd_time * 1e6 / tick_us);
+    }
+
+    if (!all_match) {
+        std::cerr << std::endl << "SIMD mix produced different output than the scalar loops" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,283 @@
+// effect_cache_bench.cpp - Startup cost of loading the libobs effects, parsed vs from the effect cache
+//
+// obs_reset_video loads every .effect file under libobs' data directory
+// through gs_effect_create.  This times that work for all effects in a
+// directory: lexing, preprocessing and parsing them with the effect parser
+// (a cold start), against rebuilding them from graphics/effect-cache.c
+// entries written by the first run (a warm start).  Both paths then check
+// that they produced the same parameters, techniques and shader code.
+//
+// There is no graphics device here: shaders are created by stubs that only
+// keep their code, so the times leave out the backend compiling it, which
+// both paths pay the same.
+//
+//     ./effect_cache_bench                      # the vendored libobs data/*.effect
+//     ./effect_cache_bench /usr/share/obs/libobs
+#include <graphics/effect-cache.h>
+#include <util/platform.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// ---------------------------------------------------------------------------
+// Graphics stubs for the symbols the effect parser and cache use
+
+struct gs_shader {
+    std::string code;
+};
+
+struct gs_shader_param;
+
+extern "C" {
+
+gs_shader_t* gs_vertexshader_create(const char* shader, const char*, char**) {
+    return new gs_shader{ shader };
+}
+
+gs_shader_t* gs_pixelshader_create(const char* shader, const char*, char**) {
+    return new gs_shader{ shader };
+}
+
+void gs_shader_destroy(gs_shader_t* shader) {
+    delete shader;
+}
+
+// Any parameter named in the code exists; only its address is compared
+gs_sparam_t* gs_shader_get_param_by_name(gs_shader_t* shader, const char* name) {
+    size_t pos = shader->code.find(name);
+    return pos == std::string::npos ? nullptr : (gs_sparam_t*)(shader->code.data() + pos);
+}
+
+gs_eparam_t* gs_effect_get_param_by_name(const gs_effect_t* effect, const char* name) {
+    for (size_t i = 0; i < effect->params.num; i++) {
+        if (strcmp(effect->params.array[i].name, name) == 0) {
+            return effect->params.array + i;
+        }
+    }
+    return nullptr;
+}
+
+const char* gs_preprocessor_name(void) {
+    return "_OPENGL";
+}
+
+int gs_get_device_type(void) {
+    return GS_DEVICE_OPENGL;
+}
+
+// Referenced by util/platform.c and util/platform-nix.c, never called here
+struct obs_video_info;
+bool obs_get_video_info(struct obs_video_info*) {
+    return false;
+}
+
+void uuid_generate(unsigned char out[16]) {
+    memset(out, 0, 16);
+}
+
+void uuid_unparse_lower(const unsigned char[16], char* out) {
+    strcpy(out, "00000000-0000-0000-0000-000000000000");
+}
+}
+
+// ---------------------------------------------------------------------------
+
+struct EffectFile {
+    std::string path;
+    std::string text;
+};
+
+struct EffectDeleter {
+    void operator()(gs_effect_t* effect) const {
+        effect_free(effect);
+        delete effect;
+    }
+};
+
+using Effect = std::unique_ptr<gs_effect_t, EffectDeleter>;
+
+static Effect new_effect(const EffectFile& file) {
+    Effect effect(new gs_effect_t);
+    effect_init(effect.get());
+    effect->effect_path = bstrdup(file.path.c_str());
+    return effect;
+}
+
+// What gs_effect_create does without a cache entry; writes one when store is set
+static Effect parse_effect(const EffectFile& file, bool store) {
+    Effect effect = new_effect(file);
+    struct effect_parser parser;
+
+    ep_init(&parser);
+    parser.keep_shader_strings = store;
+
+    bool success = ep_parse(&parser, effect.get(), file.text.c_str(), file.path.c_str());
+    if (success && store) {
+        effect_cache_store(effect.get(), &parser, file.text.c_str(), file.path.c_str());
+    }
+
+    ep_free(&parser);
+    return success ? std::move(effect) : nullptr;
+}
+
+static Effect load_effect(const EffectFile& file) {
+    Effect effect = new_effect(file);
+    return effect_cache_load(effect.get(), file.text.c_str(), file.path.c_str()) ? std::move(effect) : nullptr;
+}
+
+static bool same_params(const gs_effect_param_array_t& a, const gs_effect_param_array_t& b) {
+    if (a.num != b.num) {
+        return false;
+    }
+    for (size_t i = 0; i < a.num; i++) {
+        const gs_effect_param& pa = a.array[i];
+        const gs_effect_param& pb = b.array[i];
+        if (strcmp(pa.name, pb.name) != 0 || pa.type != pb.type || pa.section != pb.section ||
+            pa.default_val.num != pb.default_val.num ||
+            memcmp(pa.default_val.array, pb.default_val.array, pa.default_val.num) != 0 ||
+            !same_params(pa.annotations, pb.annotations)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool same_shader(gs_shader_t* a, gs_shader_t* b, const pass_shaderparam_array_t& pa,
+                        const pass_shaderparam_array_t& pb) {
+    if (!a || !b || a->code != b->code || pa.num != pb.num) {
+        return false;
+    }
+    for (size_t i = 0; i < pa.num; i++) {
+        if (strcmp(pa.array[i].eparam->name, pb.array[i].eparam->name) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool same_effect(const gs_effect_t* a, const gs_effect_t* b) {
+    if (!same_params(a->params, b->params) || a->techniques.num != b->techniques.num ||
+        (a->view_proj == nullptr) != (b->view_proj == nullptr) || (a->world == nullptr) != (b->world == nullptr)) {
+        return false;
+    }
+    for (size_t i = 0; i < a->techniques.num; i++) {
+        const gs_effect_technique& ta = a->techniques.array[i];
+        const gs_effect_technique& tb = b->techniques.array[i];
+        if (strcmp(ta.name, tb.name) != 0 || ta.passes.num != tb.passes.num) {
+            return false;
+        }
+        for (size_t j = 0; j < ta.passes.num; j++) {
+            const gs_effect_pass& pa = ta.passes.array[j];
+            const gs_effect_pass& pb = tb.passes.array[j];
+            if (!same_shader(pa.vertshader, pb.vertshader, pa.vertshader_params, pb.vertshader_params) ||
+                !same_shader(pa.pixelshader, pb.pixelshader, pa.pixelshader_params, pb.pixelshader_params)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Best of several rounds of loading every effect, in seconds
+static double time_startup(const std::function<void()>& load_all) {
+    double best = 1e9;
+    for (int round = 0; round < 20; round++) {
+        auto start = std::chrono::steady_clock::now();
+        load_all();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = (std::min)(best, elapsed.count());
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    fs::path dir = argc > 1 ? argv[1] : BENCH_OBS_DATA_DIR;
+
+    std::vector<EffectFile> files;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        if (entry.path().extension() != ".effect") {
+            continue;
+        }
+        char* text = os_quick_read_utf8_file(entry.path().string().c_str());
+        if (text) {
+            files.push_back({ entry.path().string(), text });
+            bfree(text);
+        }
+    }
+    std::sort(files.begin(), files.end(), [](const EffectFile& a, const EffectFile& b) { return a.path < b.path; });
+
+    if (files.empty()) {
+        std::cerr << "Usage: effect_cache_bench [directory with .effect files]" << std::endl;
+        return 1;
+    }
+
+    std::string cache_dir = (fs::temp_directory_path() / "effect_cache_bench_XXXXXX").string();
+    if (!mkdtemp(cache_dir.data())) {
+        std::cerr << "Could not create a cache directory" << std::endl;
+        return 1;
+    }
+    gs_effect_set_cache_path(cache_dir.c_str());
+
+    // first start: parse everything and fill the cache
+    std::vector<Effect> parsed;
+    size_t parse_failed = 0;
+    for (const EffectFile& file : files) {
+        parsed.push_back(parse_effect(file, true));
+        parse_failed += !parsed.back();
+    }
+
+    bool all_match = true;
+    size_t cached = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        Effect loaded = load_effect(files[i]);
+        if (!parsed[i] || !loaded) {
+            continue;
+        }
+        cached++;
+        if (!same_effect(parsed[i].get(), loaded.get())) {
+            std::cerr << "Cached effect differs from parsed: " << files[i].path << std::endl;
+            all_match = false;
+        }
+    }
+
+    double parse_time = time_startup([&] {
+        for (const EffectFile& file : files) {
+            parse_effect(file, false);
+        }
+    });
+    double cache_time = time_startup([&] {
+        for (const EffectFile& file : files) {
+            if (!load_effect(file)) {
+                parse_effect(file, false);
+            }
+        }
+    });
+
+    gs_effect_set_cache_path(nullptr);
+    fs::remove_all(cache_dir, ec);
+
+    std::cout << files.size() << " effects in " << dir.string() << " (" << cached << " cached, " << parse_failed
+              << " failed to parse)" << std::endl
+              << std::endl;
+    printf("  %-22s%12s%12s\n", "", "total", "per effect");
+    printf("  %-22s%9.2f ms%9.1f us\n", "parse (cold start)", parse_time * 1e3, parse_time * 1e6 / files.size());
+    printf("  %-22s%9.2f ms%9.1f us\n", "effect cache (warm)", cache_time * 1e3, cache_time * 1e6 / files.size());
+    printf("  %-22s%11.1fx\n", "speedup", parse_time / cache_time);
+
+    if (!all_match) {
+        std::cerr << std::endl << "Effects loaded from the cache differ from the parsed ones" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,245 @@
+// format_conversion_bench.cpp - Throughput of the libobs CPU format conversions per SIMD level
+//
+// Builds the vendored media-io/format-conversion.c directly, so it runs without
+// an OBS install.  Every kernel is timed at every SIMD level the CPU supports
+// and its output is compared against the SSE2 result.
+//
+//     ./format_conversion_bench            # 1080p, 4K and multi-monitor canvases
+//     ./format_conversion_bench 2560x1440  # custom canvas sizes
+#include <media-io/format-conversion.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Canvas {
+    std::string name;
+    uint32_t width;
+    uint32_t height;
+};
+
+// 64-byte aligned plane, the alignment libobs frames get
+class Plane {
+public:
+    explicit Plane(size_t size) : storage(size + 64) {
+        uintptr_t addr = reinterpret_cast<uintptr_t>(storage.data());
+        offset = (64 - (addr & 63)) & 63;
+    }
+
+    uint8_t* data() { return storage.data() + offset; }
+    size_t size() const { return storage.size() - 64; }
+
+private:
+    std::vector<uint8_t> storage;
+    size_t offset = 0;
+};
+
+struct Frame {
+    std::vector<Plane> planes;
+    uint32_t linesize[4] = {};
+
+    uint8_t* ptrs[4] = {};
+
+    void add_plane(uint32_t ls, uint32_t rows) {
+        linesize[planes.size()] = ls;
+        planes.emplace_back((size_t)ls * rows);
+        for (size_t i = 0; i < planes.size(); i++) {
+            ptrs[i] = planes[i].data();
+        }
+    }
+
+    bool equals(Frame& other) {
+        for (size_t i = 0; i < planes.size(); i++) {
+            if (memcmp(planes[i].data(), other.planes[i].data(), planes[i].size()) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+struct Kernel {
+    const char* name;
+    // highest level with a kernel of its own; above it the same code runs
+    format_conversion_simd widest;
+    std::function<void(Frame& out)> setup_output;
+    std::function<void(Frame& out)> run;
+};
+
+static const char* simd_name(format_conversion_simd simd) {
+    switch (simd) {
+    case FORMAT_CONVERSION_SIMD_SSE2: return "sse2";
+    case FORMAT_CONVERSION_SIMD_AVX2: return "avx2";
+    case FORMAT_CONVERSION_SIMD_AVX512: return "avx512";
+    default: return "auto";
+    }
+}
+
+static void fill_random(Frame& frame, uint32_t seed) {
+    std::mt19937 rng(seed);
+    for (auto& plane : frame.planes) {
+        uint8_t* p = plane.data();
+        for (size_t i = 0; i < plane.size(); i++) {
+            p[i] = (uint8_t)rng();
+        }
+    }
+}
+
+static std::vector<Kernel> make_kernels(const Canvas& c, Frame& packed444, Frame& i420, Frame& nv12, Frame& packed422) {
+    const uint32_t w = c.width, h = c.height;
+    std::vector<Kernel> kernels;
+
+    kernels.push_back({ "uyvx->i420", FORMAT_CONVERSION_SIMD_AVX512,
+        [=](Frame& out) { out.add_plane(w, h); out.add_plane(w / 2, h / 2); out.add_plane(w / 2, h / 2); },
+        [&, h](Frame& out) { compress_uyvx_to_i420(packed444.ptrs[0], packed444.linesize[0], 0, h, out.ptrs, out.linesize); } });
+
+    kernels.push_back({ "uyvx->nv12", FORMAT_CONVERSION_SIMD_AVX512,
+        [=](Frame& out) { out.add_plane(w, h); out.add_plane(w, h / 2); },
+        [&, h](Frame& out) { compress_uyvx_to_nv12(packed444.ptrs[0], packed444.linesize[0], 0, h, out.ptrs, out.linesize); } });
+
+    kernels.push_back({ "uyvx->i444", FORMAT_CONVERSION_SIMD_AVX512,
+        [=](Frame& out) { out.add_plane(w, h); out.add_plane(w, h); out.add_plane(w, h); },
+        [&, h](Frame& out) { convert_uyvx_to_i444(packed444.ptrs[0], packed444.linesize[0], 0, h, out.ptrs, out.linesize); } });
+
+    kernels.push_back({ "i420->packed", FORMAT_CONVERSION_SIMD_AVX2,
+        [=](Frame& out) { out.add_plane(w * 4, h); },
+        [&, h](Frame& out) { decompress_420(i420.ptrs, i420.linesize, 0, h, out.ptrs[0], out.linesize[0]); } });
+
+    kernels.push_back({ "nv12->packed", FORMAT_CONVERSION_SIMD_AVX2,
+        [=](Frame& out) { out.add_plane(w * 4, h); },
+        [&, h](Frame& out) { decompress_nv12(nv12.ptrs, nv12.linesize, 0, h, out.ptrs[0], out.linesize[0]); } });
+
+    kernels.push_back({ "yuy2->packed", FORMAT_CONVERSION_SIMD_SSE2,
+        [=](Frame& out) { out.add_plane(w * 4, h); },
+        [&, w, h](Frame& out) {
+            // decompress_422 takes its row width from min(in, out) / 2 in
+            // macropixels rather than from the strides, so go row by row
+            for (uint32_t y = 0; y < h; y++) {
+                decompress_422(packed422.ptrs[0] + (size_t)y * packed422.linesize[0], w, 0, 1,
+                    out.ptrs[0] + (size_t)y * out.linesize[0], w, true);
+            }
+        } });
+
+    return kernels;
+}
+
+static double time_kernel(Kernel& kernel, Frame& out, double min_seconds) {
+    using clock = std::chrono::steady_clock;
+
+    kernel.run(out); // warm up caches and page in the output
+
+    int iterations = 0;
+    auto start = clock::now();
+    double elapsed = 0.0;
+    do {
+        kernel.run(out);
+        iterations++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < min_seconds);
+
+    return elapsed / iterations;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<Canvas> canvases;
+
+    for (int i = 1; i < argc; i++) {
+        uint32_t w = 0, h = 0;
+        if (sscanf(argv[i], "%ux%u", &w, &h) != 2 || w == 0 || h == 0 || (w % 4) || (h % 2)) {
+            std::cerr << "Invalid canvas size (needs WxH, width a multiple of 4, even height): " << argv[i] << std::endl;
+            return 1;
+        }
+        canvases.push_back({ argv[i], w, h });
+    }
+
+    if (canvases.empty()) {
+        canvases = {
+            { "1080p", 1920, 1080 },
+            { "4K", 3840, 2160 },
+            { "3x1080p monitors", 5760, 1080 },
+            { "3x1440p monitors", 7680, 1440 },
+        };
+    }
+
+    const format_conversion_simd best = format_conversion_get_simd();
+    std::vector<format_conversion_simd> levels;
+    for (int level = FORMAT_CONVERSION_SIMD_SSE2; level <= best; level++) {
+        levels.push_back((format_conversion_simd)level);
+    }
+
+    std::cout << "Best supported SIMD level: " << simd_name(best) << std::endl;
+
+    bool all_match = true;
+
+    for (const Canvas& c : canvases) {
+        Frame packed444, i420, nv12, packed422;
+        packed444.add_plane(c.width * 4, c.height);
+        i420.add_plane(c.width, c.height);
+        i420.add_plane(c.width / 2, c.height / 2);
+        i420.add_plane(c.width / 2, c.height / 2);
+        nv12.add_plane(c.width, c.height);
+        nv12.add_plane(c.width, c.height / 2);
+        packed422.add_plane(c.width * 2, c.height);
+        fill_random(packed444, 1);
+        fill_random(i420, 2);
+        fill_random(nv12, 3);
+        fill_random(packed422, 4);
+
+        const double mpix = (double)c.width * c.height / 1e6;
+        std::cout << std::endl << c.name << " (" << c.width << "x" << c.height << ")" << std::endl;
+        printf("  %-14s", "kernel");
+        for (auto level : levels) {
+            printf("%14s", simd_name(level));
+        }
+        printf("%10s\n", "speedup");
+
+        for (Kernel& kernel : make_kernels(c, packed444, i420, nv12, packed422)) {
+            Frame reference;
+            kernel.setup_output(reference);
+
+            printf("  %-14s", kernel.name);
+
+            double sse2_time = 0.0, last_time = 0.0;
+            for (auto level : levels) {
+                if (level > kernel.widest) {
+                    printf("%14s", "-");
+                    continue;
+                }
+
+                Frame out;
+                kernel.setup_output(out);
+
+                format_conversion_set_simd(level);
+                double seconds = time_kernel(kernel, out, 0.25);
+
+                if (level == FORMAT_CONVERSION_SIMD_SSE2) {
+                    kernel.run(reference);
+                    sse2_time = seconds;
+                } else if (!out.equals(reference)) {
+                    all_match = false;
+                    printf("%9s  ", "MISMATCH");
+                    continue;
+                }
+
+                last_time = seconds;
+                printf("%8.2f Gp/s", mpix / seconds / 1000.0);
+            }
+
+            printf("%9.2fx\n", sse2_time / last_time);
+        }
+    }
+
+    format_conversion_set_simd(FORMAT_CONVERSION_SIMD_AUTO);
+
+    if (!all_match) {
+        std::cerr << std::endl << "Wide kernels produced different output than SSE2" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,225 @@
+// adaptive_bitrate.h - Closed-loop video bitrate control for a running stream
+//
+// Once a second the controller looks at the output's congestion (the fill
+// level of the RTMP send buffer), the frames it dropped and how many bytes it
+// actually got out compared to what the encoder is producing.  A backed-up
+// link cuts the video bitrate multiplicatively; a link that stayed clean for a
+// while gets it raised again in small steps, never outside [floor, ceiling]:
+//
+//   congestion >= high, new drops, or  -> bitrate *= decrease_factor (or down
+//   a backlog building up while less      to what the link carried if that is
+//   than throughput_low gets through      lower), then hold for hold_samples
+//   congestion <= low                  -> after stable_samples such samples,
+//                                         bitrate += increase_step
+//
+// Changes go to the encoder with obs_encoder_update(), which the x264/NVENC/
+// AMF encoders apply to the running stream without a restart.  Configured with
+// OBS_ABR (0 disables), OBS_ABR_MIN_KBPS and OBS_ABR_MAX_KBPS.
+#pragma once
+
+#include <obs.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+struct AdaptiveBitrateConfig {
+    bool enabled = true;
+    int floor_kbps = 0;
+    int ceiling_kbps = 0;
+    int interval_ms = 1000;
+
+    float congestion_high = 0.30f;
+    float congestion_low = 0.05f;
+    double throughput_low = 0.80;
+    double decrease_factor = 0.75;
+    int increase_step_kbps = 0; // 0: 5% of the ceiling
+    int hold_samples = 3;
+    int stable_samples = 10;
+
+    // Floor and ceiling default to a quarter of and exactly the bitrate the
+    // stream starts with
+    static AdaptiveBitrateConfig from_env(int start_kbps) {
+        AdaptiveBitrateConfig config;
+        const char* enabled = getenv("OBS_ABR");
+        const char* floor = getenv("OBS_ABR_MIN_KBPS");
+        const char* ceiling = getenv("OBS_ABR_MAX_KBPS");
+
+        config.enabled = !(enabled && strcmp(enabled, "0") == 0);
+        config.floor_kbps = (floor && *floor) ? atoi(floor) : start_kbps / 4;
+        config.ceiling_kbps = (ceiling && *ceiling) ? atoi(ceiling) : start_kbps;
+        config.floor_kbps = (std::max)(config.floor_kbps, 100);
+        config.ceiling_kbps = (std::max)(config.ceiling_kbps, config.floor_kbps);
+        return config;
+    }
+};
+
+class AdaptiveBitrate {
+public:
+    ~AdaptiveBitrate() {
+        stop();
+    }
+
+    void start(obs_output_t* output, obs_encoder_t* encoder, int start_kbps, const AdaptiveBitrateConfig& config) {
+        stop();
+        if (!config.enabled) {
+            return;
+        }
+
+        this->output = output;
+        this->encoder = encoder;
+        this->config = config;
+        if (this->config.increase_step_kbps <= 0) {
+            this->config.increase_step_kbps = (std::max)(config.ceiling_kbps / 20, 50);
+        }
+
+        // also undoes whatever a previous session left the encoder at
+        bitrate = (std::min)((std::max)(start_kbps, config.floor_kbps), config.ceiling_kbps);
+        apply(bitrate);
+
+        std::cout << "Adaptive bitrate: " << config.floor_kbps << "-" << config.ceiling_kbps
+            << " kbps, starting at " << bitrate << " kbps" << std::endl;
+
+        running = true;
+        worker = std::thread(&AdaptiveBitrate::loop, this);
+    }
+
+    // Must be called before the output or encoder is released
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            running = false;
+        }
+        wake.notify_all();
+
+        if (worker.joinable()) {
+            worker.join();
+        }
+        output = nullptr;
+        encoder = nullptr;
+    }
+
+    int current_kbps() const {
+        return bitrate;
+    }
+
+private:
+    obs_output_t* output = nullptr;
+    obs_encoder_t* encoder = nullptr;
+    AdaptiveBitrateConfig config;
+
+    std::atomic<int> bitrate{ 0 };
+    std::atomic<bool> running{ false };
+    std::thread worker;
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+
+    uint64_t last_bytes = 0;
+    int last_dropped = 0;
+    std::chrono::steady_clock::time_point last_time;
+    int hold = 0;
+    int stable = 0;
+
+    void apply(int kbps) {
+        obs_data_t* settings = obs_data_create();
+        obs_data_set_int(settings, "bitrate", kbps);
+        obs_data_set_int(settings, "buffer_size", kbps);
+        obs_encoder_update(encoder, settings);
+        obs_data_release(settings);
+    }
+
+    void reset_baseline() {
+        last_bytes = obs_output_get_total_bytes(output);
+        last_dropped = obs_output_get_frames_dropped(output);
+        last_time = std::chrono::steady_clock::now();
+        stable = 0;
+    }
+
+    void sample() {
+        // a reconnect resets the connection and its counters, and a paused
+        // output sends nothing; start over once it is back
+        if (obs_output_reconnecting(output) || obs_output_paused(output)) {
+            hold = config.hold_samples;
+            reset_baseline();
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - last_time).count();
+        uint64_t bytes = obs_output_get_total_bytes(output);
+        int dropped = obs_output_get_frames_dropped(output);
+        float congestion = obs_output_get_congestion(output);
+
+        // bytes the link moved against what the encoder was asked to produce;
+        // audio and container overhead push this slightly above 1 on a clean link
+        double sent_kbps = 0.0;
+        if (bytes >= last_bytes && seconds > 0.0) {
+            sent_kbps = (bytes - last_bytes) * 8.0 / 1000.0 / seconds;
+        }
+        double throughput = sent_kbps / bitrate;
+        int new_drops = dropped - last_dropped;
+
+        last_bytes = bytes;
+        last_dropped = dropped;
+        last_time = now;
+
+        if (hold > 0) {
+            hold--;
+            return;
+        }
+
+        // an encoder undershooting on a static scene also sends less than the
+        // bitrate, so the throughput only counts once data is queueing up
+        bool backlog = congestion > config.congestion_low && throughput < config.throughput_low;
+
+        int current = bitrate;
+        if (congestion >= config.congestion_high || new_drops > 0 || backlog) {
+            stable = 0;
+            int target = (int)(current * config.decrease_factor);
+            if (backlog) {
+                target = (std::min)(target, (int)(sent_kbps * 0.9));
+            }
+            target = (std::max)(target, config.floor_kbps);
+            if (target < current) {
+                set_bitrate(target, congestion, new_drops, sent_kbps);
+            }
+            hold = config.hold_samples;
+        } else if (congestion <= config.congestion_low) {
+            if (++stable >= config.stable_samples && current < config.ceiling_kbps) {
+                stable = 0;
+                set_bitrate((std::min)(current + config.increase_step_kbps, config.ceiling_kbps), congestion,
+                    new_drops, sent_kbps);
+            }
+        } else {
+            stable = 0;
+        }
+    }
+
+    void set_bitrate(int kbps, float congestion, int new_drops, double sent_kbps) {
+        std::cout << "[abr] " << bitrate << " -> " << kbps << " kbps (congestion "
+            << (int)(congestion * 100.0f) << "%, " << new_drops << " dropped, "
+            << (int)sent_kbps << " kbps sent)" << std::endl;
+
+        bitrate = kbps;
+        apply(kbps);
+    }
+
+    void loop() {
+        auto interval = std::chrono::milliseconds(config.interval_ms);
+        hold = config.hold_samples;
+        reset_baseline();
+
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        while (!wake.wait_for(lock, interval, [this] { return !running; })) {
+            lock.unlock();
+            sample();
+            lock.lock();
+        }
+    }
+};
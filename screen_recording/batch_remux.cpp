@@ -0,0 +1,73 @@
+// batch_remux.cpp - Remux a batch of recordings into another container in parallel
+//
+// Usage: obs_batch_remux [-j jobs] <extension> <file>...
+//
+// Every input is remuxed next to itself with the new extension
+// (e.g. "mkv" turns shift/cam1.flv into shift/cam1.mkv), stream copying the
+// packets.  Up to <jobs> files (default: one per logical core) are remuxed
+// at once by libobs' media_remux_batch, which prints the combined progress and
+// throughput while it runs.  Exits non-zero if any file failed.
+#include <obs.h>
+#include <media-io/media-remux.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+static bool print_progress(void*, const struct media_remux_batch_progress* progress) {
+    std::cout << "\r" << progress->jobs_done << "/" << progress->jobs << " files"
+        << " (" << progress->jobs_active << " running, " << progress->jobs_failed << " failed), "
+        << std::fixed << std::setprecision(1) << progress->percent << "%, "
+        << progress->bytes_per_sec / (1024.0 * 1024.0) << " MiB/s   " << std::flush;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    size_t jobs = 0;
+    int arg = 1;
+
+    if (arg + 1 < argc && strcmp(argv[arg], "-j") == 0) {
+        jobs = (size_t)(std::max)(std::atoi(argv[arg + 1]), 1);
+        arg += 2;
+    }
+
+    if (argc - arg < 2) {
+        std::cerr << "Usage: " << argv[0] << " [-j jobs] <extension> <file>..." << std::endl;
+        return 1;
+    }
+
+    std::string extension = argv[arg++];
+    if (extension[0] != '.') {
+        extension = "." + extension;
+    }
+
+    std::vector<std::string> inputs;
+    media_remux_batch_t batch = media_remux_batch_create(jobs);
+    for (; arg < argc; arg++) {
+        fs::path output = fs::path(argv[arg]).replace_extension(extension);
+        if (output == fs::path(argv[arg])) {
+            std::cerr << "Skipping " << argv[arg] << ": already " << extension << std::endl;
+            continue;
+        }
+        media_remux_batch_add(batch, argv[arg], output.string().c_str());
+        inputs.push_back(argv[arg]);
+    }
+
+    bool success = !inputs.empty() && media_remux_batch_process(batch, print_progress, nullptr);
+    std::cout << std::endl;
+
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (!media_remux_batch_succeeded(batch, i)) {
+            std::cerr << "Failed: " << inputs[i] << std::endl;
+        }
+    }
+
+    media_remux_batch_destroy(batch);
+    return success ? 0 : 1;
+}
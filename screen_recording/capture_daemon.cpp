@@ -0,0 +1,885 @@
+// obs_capture_daemon.cpp - Long-running OBS RTMP daemon hosting many streaming sessions in one libobs process
+//
+// obs_startup, module loading and obs_reset_video happen once when the
+// daemon starts.  After that every session only creates what is specific to
+// it: an obs_view canvas with its own scene at the session resolution, an
+// encoder, a service and an RTMP output.  Starting a session therefore costs
+// milliseconds instead of a full libobs bring-up.
+//
+// Sessions that capture the same content at the same size share the canvas,
+// and sessions that additionally use the same encoder settings share the
+// video encoder (e.g. one encode pushed to several RTMP ingest points).
+// Audio is mixed globally by libobs, so all sessions share the audio sources
+// and a single audio encoder.
+//
+// Commands are read line by line from stdin (works with a pipe or FIFO):
+//   start <name> <rtmp_server> <stream_key> [WIDTHxHEIGHT] [bitrate] [capture]
+//   stop <name>
+//   save <name>
+//   list
+//   quit
+//
+// With OBS_REPLAY_RING_MB set (Linux), every session also keeps its last
+// OBS_REPLAY_SEC seconds (default 300) in a ring file of that size under
+// OBS_REPLAY_DIR (default /var/tmp), and "save" writes them out as an MP4
+// next to it.
+#include <obs.h>
+#include <obs-module.h>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <filesystem>
+#include <algorithm>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#define MODULE_EXTENSION ".dll"
+#elif __linux__
+#include "linux_platform.h"
+#include "synthetic_sources.h"
+#include "replay_ring_output.h"
+#define MODULE_EXTENSION ".so"
+#endif
+
+namespace fs = std::filesystem;
+
+struct SessionConfig {
+    std::string name;
+    std::string rtmp_server;
+    std::string stream_key;
+    int width = 1920;
+    int height = 1080;
+    int video_bitrate = 5000;
+    // Monitor index on Windows, free-form id for the synthetic source on
+    // headless Linux.  Sessions with the same capture and size share a canvas.
+    std::string capture = "0";
+};
+
+// One scene rendered into its own obs_view canvas
+struct Canvas {
+    std::string key;
+    obs_view_t* view = nullptr;
+    obs_scene_t* scene = nullptr;
+    obs_source_t* capture = nullptr;
+    video_t* video = nullptr;
+    int refs = 0;
+};
+
+struct SharedEncoder {
+    std::string key;
+    obs_encoder_t* encoder = nullptr;
+    int refs = 0;
+};
+
+struct Session {
+    SessionConfig config;
+    Canvas* canvas = nullptr;
+    SharedEncoder* video_encoder = nullptr;
+    obs_service_t* service = nullptr;
+    obs_output_t* output = nullptr;
+    obs_output_t* replay = nullptr;
+    std::string replay_ring;
+    double startup_ms = 0.0;
+};
+
+class OBSCaptureDaemon {
+private:
+    std::map<std::string, std::unique_ptr<Canvas>> canvases;
+    std::map<std::string, std::unique_ptr<SharedEncoder>> encoders;
+    std::map<std::string, std::unique_ptr<Session>> sessions;
+
+    obs_source_t* mic_capture = nullptr;
+    obs_source_t* desktop_audio = nullptr;
+    obs_encoder_t* audio_encoder = nullptr;
+
+    std::string obs_path;
+    int fps = 30;
+    int audio_bitrate = 128;
+    bool initialized = false;
+
+    int replay_ring_mb = 0;
+    int replay_sec = 300;
+    std::string replay_dir = "/var/tmp";
+
+#ifdef __linux__
+    Display* display = nullptr;
+#endif
+
+    // Opens a plugin without running its obs_module_load yet
+    obs_module_t* open_module(const std::string& bin_path, const std::string& data_path,
+        const std::string& module_name) {
+        obs_module_t* module = nullptr;
+
+        std::string module_path = bin_path + "/" + module_name + MODULE_EXTENSION;
+
+        if (!fs::exists(module_path)) {
+            std::cerr << "Module not found: " << module_path << std::endl;
+            return nullptr;
+        }
+
+        int code = obs_open_module(&module, module_path.c_str(), data_path.c_str());
+        if (code != MODULE_SUCCESS) {
+            std::cerr << "Failed to open module '" << module_name << "': error " << code << std::endl;
+            return nullptr;
+        }
+
+        return module;
+    }
+
+    bool load_required_modules() {
+#ifdef _WIN32
+        std::string bin_path = obs_path + "/obs-plugins/64bit";
+        std::string data_path = obs_path + "/data/obs-plugins";
+
+        std::vector<std::string> modules = {
+            "win-capture",
+            "win-wasapi",
+            "obs-outputs",
+            "obs-ffmpeg",
+            "obs-x264",
+            "rtmp-services"
+        };
+#else
+        std::string bin_path = linux_plugin_directory();
+        std::string data_path = obs_path + "/obs-plugins";
+
+        std::vector<std::string> modules = {
+            "obs-outputs",
+            "obs-ffmpeg",
+            "obs-x264",
+            "rtmp-services"
+        };
+#endif
+
+        std::vector<obs_module_t*> opened;
+        std::vector<std::string> opened_names;
+        for (const auto& module : modules) {
+            std::string module_data = data_path + "/" + module;
+            obs_module_t* opened_module = open_module(bin_path, module_data, module);
+            if (opened_module) {
+                opened.push_back(opened_module);
+                opened_names.push_back(module);
+            } else {
+                std::cerr << "Warning: Failed to load module: " << module << std::endl;
+            }
+        }
+
+        std::unique_ptr<bool[]> loaded(new bool[opened.size()]());
+#ifdef HAVE_VENDORED_LIBOBS
+        // The plugins do not depend on each other, so their obs_module_load
+        // calls run in parallel
+        obs_init_modules(opened.data(), opened.size(), loaded.get());
+#else
+        for (size_t i = 0; i < opened.size(); i++) {
+            loaded[i] = obs_init_module(opened[i]);
+        }
+#endif
+
+        for (size_t i = 0; i < opened.size(); i++) {
+            if (loaded[i]) {
+                std::cout << "Successfully loaded module: " << opened_names[i] << std::endl;
+            } else {
+                std::cerr << "Warning: Failed to load module: " << opened_names[i] << std::endl;
+            }
+        }
+
+        return true;
+    }
+
+    bool setup_audio() {
+        obs_data_t* desktop_settings = obs_data_create();
+        obs_data_t* mic_settings = obs_data_create();
+
+#ifdef _WIN32
+        desktop_audio = obs_source_create("wasapi_output_capture",
+            "Desktop Audio", desktop_settings, nullptr);
+
+        obs_data_set_string(mic_settings, "device_id", "default");
+        mic_capture = obs_source_create("wasapi_input_capture",
+            "Microphone", mic_settings, nullptr);
+#else
+        obs_data_set_double(desktop_settings, "frequency", 440.0);
+        desktop_audio = obs_source_create("synthetic_audio",
+            "Desktop Audio", desktop_settings, nullptr);
+
+        obs_data_set_double(mic_settings, "frequency", 660.0);
+        mic_capture = obs_source_create("synthetic_audio",
+            "Microphone", mic_settings, nullptr);
+#endif
+
+        obs_data_release(desktop_settings);
+        obs_data_release(mic_settings);
+
+        if (mic_capture) {
+            obs_set_output_source(1, mic_capture);
+        }
+
+        if (desktop_audio) {
+            obs_set_output_source(2, desktop_audio);
+        }
+
+        obs_data_t* audio_settings = obs_data_create();
+        obs_data_set_int(audio_settings, "bitrate", audio_bitrate);
+
+        const char* audio_encoders[] = {
+            "ffmpeg_aac",
+            "mf_aac",
+            "CoreAudio_AAC"
+        };
+
+        for (const auto& encoder_id : audio_encoders) {
+            audio_encoder = obs_audio_encoder_create(encoder_id, "Shared Audio Encoder",
+                audio_settings, 0, nullptr);
+            if (audio_encoder) {
+                std::cout << "Audio encoder: " << encoder_id << std::endl;
+                break;
+            }
+        }
+
+        obs_data_release(audio_settings);
+
+        if (!audio_encoder) {
+            std::cerr << "Failed to create audio encoder" << std::endl;
+            return false;
+        }
+
+        obs_encoder_set_audio(audio_encoder, obs_get_audio());
+        return true;
+    }
+
+    Canvas* acquire_canvas(const SessionConfig& config, bool& shared) {
+        std::string key = config.capture + "@" + std::to_string(config.width) +
+            "x" + std::to_string(config.height);
+
+        auto it = canvases.find(key);
+        if (it != canvases.end()) {
+            it->second->refs++;
+            shared = true;
+            return it->second.get();
+        }
+
+        shared = false;
+        std::unique_ptr<Canvas> canvas = std::make_unique<Canvas>();
+        canvas->key = key;
+
+        std::string scene_name = "Scene " + key;
+        canvas->scene = obs_scene_create_private(scene_name.c_str());
+        if (!canvas->scene) {
+            std::cerr << "Failed to create scene for canvas " << key << std::endl;
+            return nullptr;
+        }
+
+        obs_data_t* capture_settings = obs_data_create();
+#ifdef _WIN32
+        const char* capture_id = "monitor_capture";
+        obs_data_set_bool(capture_settings, "capture_cursor", true);
+        obs_data_set_int(capture_settings, "monitor", std::atoi(config.capture.c_str()));
+#else
+        const char* capture_id = "synthetic_video";
+        obs_data_set_int(capture_settings, "width", config.width);
+        obs_data_set_int(capture_settings, "height", config.height);
+        obs_data_set_int(capture_settings, "fps", fps);
+#endif
+
+        std::string capture_name = "Capture " + key;
+        canvas->capture = obs_source_create_private(capture_id, capture_name.c_str(), capture_settings);
+        obs_data_release(capture_settings);
+
+        if (!canvas->capture) {
+            std::cerr << "Failed to create capture source for canvas " << key << std::endl;
+            release_canvas_resources(canvas.get());
+            return nullptr;
+        }
+
+        obs_sceneitem_t* item = obs_scene_add(canvas->scene, canvas->capture);
+        if (item) {
+            // Fit whatever the capture delivers into the session canvas
+            vec2 bounds;
+            bounds.x = (float)config.width;
+            bounds.y = (float)config.height;
+            obs_sceneitem_set_bounds_type(item, OBS_BOUNDS_SCALE_INNER);
+            obs_sceneitem_set_bounds(item, &bounds);
+        }
+
+        struct obs_video_info ovi;
+        obs_get_video_info(&ovi);
+        ovi.base_width = config.width;
+        ovi.base_height = config.height;
+        ovi.output_width = config.width;
+        ovi.output_height = config.height;
+
+        canvas->view = obs_view_create();
+        obs_view_set_source(canvas->view, 0, obs_scene_get_source(canvas->scene));
+        canvas->video = obs_view_add2(canvas->view, &ovi);
+
+        if (!canvas->video) {
+            std::cerr << "Failed to create video mix for canvas " << key << std::endl;
+            release_canvas_resources(canvas.get());
+            return nullptr;
+        }
+
+        canvas->refs = 1;
+        Canvas* result = canvas.get();
+        canvases[key] = std::move(canvas);
+        return result;
+    }
+
+    void release_canvas_resources(Canvas* canvas) {
+        if (canvas->view) {
+            obs_view_set_source(canvas->view, 0, nullptr);
+            obs_view_remove(canvas->view);
+            obs_view_destroy(canvas->view);
+            canvas->view = nullptr;
+        }
+
+        if (canvas->capture) {
+            obs_source_release(canvas->capture);
+            canvas->capture = nullptr;
+        }
+
+        if (canvas->scene) {
+            obs_scene_release(canvas->scene);
+            canvas->scene = nullptr;
+        }
+    }
+
+    void release_canvas(Canvas* canvas) {
+        if (--canvas->refs > 0) {
+            return;
+        }
+
+        std::string key = canvas->key;
+        release_canvas_resources(canvas);
+        canvases.erase(key);
+        std::cout << "Canvas " << key << " released" << std::endl;
+    }
+
+    SharedEncoder* acquire_video_encoder(const SessionConfig& config, Canvas* canvas, bool& shared) {
+        std::string key = canvas->key + "/" + std::to_string(config.video_bitrate);
+
+        auto it = encoders.find(key);
+        if (it != encoders.end()) {
+            it->second->refs++;
+            shared = true;
+            return it->second.get();
+        }
+
+        shared = false;
+
+        obs_data_t* video_settings = obs_data_create();
+        obs_data_set_int(video_settings, "bitrate", config.video_bitrate);
+        obs_data_set_int(video_settings, "keyint_sec", 2);
+        obs_data_set_string(video_settings, "preset", "veryfast");
+        obs_data_set_string(video_settings, "profile", "main");
+        obs_data_set_string(video_settings, "tune", "zerolatency");
+        obs_data_set_int(video_settings, "buffer_size", config.video_bitrate);
+
+        const char* video_encoders[] = {
+            "obs_x264",
+            "ffmpeg_nvenc",
+            "jim_nvenc",
+            "amd_amf_h264"
+        };
+
+        std::string encoder_name = "Video Encoder " + key;
+        obs_encoder_t* encoder = nullptr;
+        for (const auto& encoder_id : video_encoders) {
+            encoder = obs_video_encoder_create(encoder_id, encoder_name.c_str(),
+                video_settings, nullptr);
+            if (encoder) {
+                break;
+            }
+        }
+
+        obs_data_release(video_settings);
+
+        if (!encoder) {
+            std::cerr << "Failed to create video encoder " << key << std::endl;
+            return nullptr;
+        }
+
+        obs_encoder_set_video(encoder, canvas->video);
+
+        std::unique_ptr<SharedEncoder> shared_encoder = std::make_unique<SharedEncoder>();
+        shared_encoder->key = key;
+        shared_encoder->encoder = encoder;
+        shared_encoder->refs = 1;
+
+        SharedEncoder* result = shared_encoder.get();
+        encoders[key] = std::move(shared_encoder);
+        return result;
+    }
+
+    void release_video_encoder(SharedEncoder* shared_encoder) {
+        if (--shared_encoder->refs > 0) {
+            return;
+        }
+
+        std::string key = shared_encoder->key;
+        obs_encoder_release(shared_encoder->encoder);
+        encoders.erase(key);
+    }
+
+    // The replay ring shares the session's encoders; a session whose replay
+    // fails to start still streams
+    void start_replay(Session* session) {
+        session->replay_ring = replay_dir + "/" + session->config.name + ".ring";
+
+        obs_data_t* replay_settings = obs_data_create();
+        obs_data_set_string(replay_settings, "path", session->replay_ring.c_str());
+        obs_data_set_int(replay_settings, "max_size_mb", replay_ring_mb);
+        obs_data_set_int(replay_settings, "max_time_sec", replay_sec);
+        obs_data_set_string(replay_settings, "directory", replay_dir.c_str());
+        std::string format = "Replay " + session->config.name + " %CCYY-%MM-%DD %hh-%mm-%ss";
+        obs_data_set_string(replay_settings, "format", format.c_str());
+
+        std::string replay_name = "Replay " + session->config.name;
+        session->replay = obs_output_create("replay_ring_output", replay_name.c_str(), replay_settings, nullptr);
+        obs_data_release(replay_settings);
+
+        if (!session->replay) {
+            std::cerr << "Failed to create replay output for " << session->config.name << std::endl;
+            return;
+        }
+
+        obs_output_set_video_encoder(session->replay, session->video_encoder->encoder);
+        obs_output_set_audio_encoder(session->replay, audio_encoder, 0);
+
+        if (!obs_output_start(session->replay)) {
+            std::cerr << "Failed to start replay for " << session->config.name << std::endl;
+            obs_output_release(session->replay);
+            session->replay = nullptr;
+        }
+    }
+
+    void release_session_resources(Session* session) {
+        if (session->replay) {
+            obs_output_release(session->replay);
+            session->replay = nullptr;
+            std::error_code ec;
+            fs::remove(session->replay_ring, ec);
+        }
+
+        if (session->output) {
+            obs_output_release(session->output);
+            session->output = nullptr;
+        }
+
+        if (session->service) {
+            obs_service_release(session->service);
+            session->service = nullptr;
+        }
+
+        if (session->video_encoder) {
+            release_video_encoder(session->video_encoder);
+            session->video_encoder = nullptr;
+        }
+
+        if (session->canvas) {
+            release_canvas(session->canvas);
+            session->canvas = nullptr;
+        }
+    }
+
+public:
+    explicit OBSCaptureDaemon(int fps_rate = 30) : fps(fps_rate) {
+#ifdef _WIN32
+        obs_path = "C:/Program Files/obs-studio";
+#else
+        obs_path = linux_data_directory();
+#endif
+    }
+
+    ~OBSCaptureDaemon() {
+        shutdown();
+    }
+
+    bool initialize() {
+        auto begin = std::chrono::steady_clock::now();
+
+#ifdef _WIN32
+        std::string plugin_bin_path = obs_path + "/obs-plugins/64bit";
+        std::string data_path = obs_path + "/data/obs-plugins/%module%";
+        obs_add_module_path(plugin_bin_path.c_str(), data_path.c_str());
+#else
+        std::string plugin_bin_path = linux_plugin_directory();
+        std::string data_path = obs_path + "/obs-plugins/%module%";
+
+        obs_add_data_path((obs_path + "/libobs/").c_str());
+        obs_add_module_path(plugin_bin_path.c_str(), data_path.c_str());
+
+        linux_profiler_start();
+        linux_effect_cache_start();
+        display = linux_open_display();
+        if (!display) {
+            return false;
+        }
+#endif
+
+        if (!obs_startup("en-US", nullptr, nullptr)) {
+            std::cerr << "Failed to initialize OBS core" << std::endl;
+            return false;
+        }
+        initialized = true;
+
+#ifdef __linux__
+        linux_module_manifest_start();
+#endif
+        load_required_modules();
+        obs_post_load_modules();
+#ifdef __linux__
+        register_synthetic_sources();
+        register_replay_ring_output();
+
+        const char* ring_mb = getenv("OBS_REPLAY_RING_MB");
+        const char* seconds = getenv("OBS_REPLAY_SEC");
+        const char* directory = getenv("OBS_REPLAY_DIR");
+        replay_ring_mb = (ring_mb && *ring_mb) ? std::atoi(ring_mb) : 0;
+        if (seconds && *seconds) {
+            replay_sec = std::atoi(seconds);
+        }
+        if (directory && *directory) {
+            replay_dir = directory;
+        }
+#endif
+
+        // The main canvas is never rendered into an output; sessions get
+        // their own obs_view canvases, so keep it as small as possible
+        struct obs_video_info ovi = {};
+        ovi.fps_num = fps;
+        ovi.fps_den = 1;
+        ovi.base_width = 64;
+        ovi.base_height = 64;
+        ovi.output_width = 64;
+        ovi.output_height = 64;
+        ovi.output_format = VIDEO_FORMAT_NV12;
+        ovi.colorspace = VIDEO_CS_709;
+        ovi.range = VIDEO_RANGE_PARTIAL;
+        ovi.adapter = 0;
+        ovi.gpu_conversion = true;
+        ovi.scale_type = OBS_SCALE_BICUBIC;
+#ifdef _WIN32
+        ovi.graphics_module = "libobs-d3d11";
+#else
+        ovi.graphics_module = "libobs-opengl";
+        ovi.gpu_conversion = linux_gpu_conversion();
+#endif
+
+        int result = obs_reset_video(&ovi);
+        if (result != OBS_VIDEO_SUCCESS) {
+            std::cerr << "Failed to initialize video. Error code: " << result << std::endl;
+            return false;
+        }
+
+#ifdef __linux__
+        linux_video_workers_start();
+#endif
+
+        struct obs_audio_info oai = {};
+        oai.samples_per_sec = 48000;
+        oai.speakers = SPEAKERS_STEREO;
+
+        if (!obs_reset_audio(&oai)) {
+            std::cerr << "Failed to initialize audio" << std::endl;
+            return false;
+        }
+
+        if (!setup_audio()) {
+            return false;
+        }
+
+        double elapsed = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - begin).count();
+        std::cout << "Daemon initialized in " << elapsed << " ms" << std::endl;
+        return true;
+    }
+
+    bool start_session(const SessionConfig& config) {
+        if (sessions.count(config.name)) {
+            std::cerr << "Session already exists: " << config.name << std::endl;
+            return false;
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        std::unique_ptr<Session> session = std::make_unique<Session>();
+        session->config = config;
+
+        bool canvas_shared = false;
+        session->canvas = acquire_canvas(config, canvas_shared);
+        if (!session->canvas) {
+            return false;
+        }
+
+        bool encoder_shared = false;
+        session->video_encoder = acquire_video_encoder(config, session->canvas, encoder_shared);
+        if (!session->video_encoder) {
+            release_session_resources(session.get());
+            return false;
+        }
+
+        obs_data_t* service_settings = obs_data_create();
+        obs_data_set_string(service_settings, "service", "Custom");
+        obs_data_set_string(service_settings, "server", config.rtmp_server.c_str());
+        obs_data_set_string(service_settings, "key", config.stream_key.c_str());
+
+        std::string service_name = "RTMP Service " + config.name;
+        session->service = obs_service_create_private("rtmp_custom", service_name.c_str(), service_settings);
+        obs_data_release(service_settings);
+
+        if (!session->service) {
+            std::cerr << "Failed to create RTMP service for " << config.name << std::endl;
+            release_session_resources(session.get());
+            return false;
+        }
+
+        obs_data_t* output_settings = obs_data_create();
+        obs_data_set_string(output_settings, "bind_ip", "default");
+        obs_data_set_bool(output_settings, "new_socket_loop_enabled", false);
+        obs_data_set_bool(output_settings, "low_latency_mode_enabled", true);
+        obs_data_set_int(output_settings, "retry_delay", 2);
+        obs_data_set_int(output_settings, "max_retries", 5);
+
+        std::string output_name = "RTMP Output " + config.name;
+        session->output = obs_output_create("rtmp_output", output_name.c_str(), output_settings, nullptr);
+        obs_data_release(output_settings);
+
+        if (!session->output) {
+            std::cerr << "Failed to create RTMP output for " << config.name << std::endl;
+            release_session_resources(session.get());
+            return false;
+        }
+
+        obs_output_set_service(session->output, session->service);
+        obs_output_set_video_encoder(session->output, session->video_encoder->encoder);
+        obs_output_set_audio_encoder(session->output, audio_encoder, 0);
+
+        if (!obs_output_start(session->output)) {
+            const char* error = obs_output_get_last_error(session->output);
+            std::cerr << "Failed to start session " << config.name << ": "
+                << (error ? error : "unknown") << std::endl;
+            release_session_resources(session.get());
+            return false;
+        }
+
+        if (replay_ring_mb > 0) {
+            start_replay(session.get());
+        }
+
+        session->startup_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - begin).count();
+
+        std::cout << "Session " << config.name << " started in " << session->startup_ms << " ms"
+            << " (canvas " << (canvas_shared ? "shared" : "new")
+            << ", encoder " << (encoder_shared ? "shared" : "new") << ")" << std::endl;
+
+        sessions[config.name] = std::move(session);
+        return true;
+    }
+
+    bool stop_session(const std::string& name) {
+        auto it = sessions.find(name);
+        if (it == sessions.end()) {
+            std::cerr << "No such session: " << name << std::endl;
+            return false;
+        }
+
+        Session* session = it->second.get();
+        obs_output_stop(session->output);
+        if (session->replay) {
+            obs_output_stop(session->replay);
+        }
+
+        int timeout = 50; // 5 seconds timeout
+        while ((obs_output_active(session->output) ||
+            (session->replay && obs_output_active(session->replay))) && timeout > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            timeout--;
+        }
+
+        if (timeout == 0) {
+            std::cerr << "Warning: Timeout while stopping session " << name << std::endl;
+            obs_output_force_stop(session->output);
+            if (session->replay) {
+                obs_output_force_stop(session->replay);
+            }
+        }
+
+        release_session_resources(session);
+        sessions.erase(it);
+
+        std::cout << "Session " << name << " stopped" << std::endl;
+        return true;
+    }
+
+    bool save_replay(const std::string& name) {
+        auto it = sessions.find(name);
+        if (it == sessions.end()) {
+            std::cerr << "No such session: " << name << std::endl;
+            return false;
+        }
+
+        obs_output_t* replay = it->second->replay;
+        if (!replay) {
+            std::cerr << "Session " << name << " has no replay (set OBS_REPLAY_RING_MB)" << std::endl;
+            return false;
+        }
+
+        // the save runs in the background and logs the file it wrote
+        calldata_t params = {};
+        proc_handler_call(obs_output_get_proc_handler(replay), "save", &params);
+        calldata_free(&params);
+        return true;
+    }
+
+    void list_sessions() {
+        std::cout << "\n=== SESSIONS (" << sessions.size() << ", "
+            << canvases.size() << " canvases, "
+            << encoders.size() << " video encoders) ===" << std::endl;
+
+        for (const auto& entry : sessions) {
+            const Session* session = entry.second.get();
+            obs_output_t* output = session->output;
+
+            std::cout << session->config.name << ": "
+                << session->config.width << "x" << session->config.height
+                << " @ " << session->config.video_bitrate << " kbps"
+                << ", canvas " << session->canvas->key
+                << ", frames " << obs_output_get_total_frames(output)
+                << ", dropped " << obs_output_get_frames_dropped(output)
+                << ", startup " << session->startup_ms << " ms" << std::endl;
+        }
+        std::cout << "========================" << std::endl;
+    }
+
+    void run() {
+        std::string line;
+
+        std::cout << "Ready. Commands: start <name> <server> <key> [WxH] [bitrate] [capture] | "
+            << "stop <name> | save <name> | list | quit" << std::endl;
+
+        while (std::getline(std::cin, line)) {
+            std::istringstream args(line);
+            std::string command;
+            args >> command;
+
+            if (command == "start") {
+                SessionConfig config;
+                std::string size;
+                args >> config.name >> config.rtmp_server >> config.stream_key;
+
+                if (config.stream_key.empty()) {
+                    std::cerr << "Usage: start <name> <server> <key> [WxH] [bitrate] [capture]" << std::endl;
+                    continue;
+                }
+
+                if (args >> size) {
+                    if (sscanf(size.c_str(), "%dx%d", &config.width, &config.height) != 2 ||
+                        config.width <= 0 || config.height <= 0) {
+                        std::cerr << "Invalid size: " << size << std::endl;
+                        continue;
+                    }
+                }
+
+                if (args >> config.video_bitrate) {
+                    config.video_bitrate = (std::max)(1000, (std::min)(config.video_bitrate, 50000));
+                }
+
+                args >> config.capture;
+                start_session(config);
+            }
+            else if (command == "stop") {
+                std::string name;
+                args >> name;
+                stop_session(name);
+            }
+            else if (command == "save") {
+                std::string name;
+                args >> name;
+                save_replay(name);
+            }
+            else if (command == "list") {
+                list_sessions();
+            }
+            else if (command == "quit") {
+                break;
+            }
+            else if (!command.empty()) {
+                std::cout << "Unknown command: " << command << std::endl;
+            }
+        }
+    }
+
+    void shutdown() {
+        std::vector<std::string> names;
+        for (const auto& entry : sessions) {
+            names.push_back(entry.first);
+        }
+        for (const auto& name : names) {
+            stop_session(name);
+        }
+
+        if (!initialized) {
+            return;
+        }
+
+        for (int i = 0; i < 6; i++) {
+            obs_set_output_source(i, nullptr);
+        }
+
+        if (audio_encoder) {
+            obs_encoder_release(audio_encoder);
+            audio_encoder = nullptr;
+        }
+
+        if (mic_capture) {
+            obs_source_release(mic_capture);
+            mic_capture = nullptr;
+        }
+
+        if (desktop_audio) {
+            obs_source_release(desktop_audio);
+            desktop_audio = nullptr;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        obs_shutdown();
+        initialized = false;
+
+#ifdef __linux__
+        linux_close_display(display);
+        display = nullptr;
+        linux_profiler_finish();
+#endif
+    }
+};
+
+int main(int argc, char* argv[]) {
+    int fps = 30;
+
+    if (argc > 1) {
+        fps = std::atoi(argv[1]);
+        fps = (std::max)(10, (std::min)(fps, 60)); // Clamp between 10-60
+    }
+
+    std::cout << "OBS Multi-Session Capture Daemon" << std::endl;
+    std::cout << "================================" << std::endl;
+    std::cout << "FPS: " << fps << std::endl;
+
+    OBSCaptureDaemon daemon(fps);
+    if (!daemon.initialize()) {
+        std::cerr << "Initialization failed" << std::endl;
+        return 1;
+    }
+
+    daemon.run();
+
+    std::cout << "\nShutting down..." << std::endl;
+    daemon.shutdown();
+    return 0;
+}
@@ -0,0 +1,800 @@
+// fragmented_mp4_output.h - Fragmented MP4 recording output with constant memory use
+//
+// Registers "fragmented_mp4_output", an encoded A/V output that writes H.264 +
+// AAC as fragmented MP4: an init segment (ftyp + moov with empty sample
+// tables) followed by one moof + mdat pair per fragment.  Packets are only
+// held until the next fragment is cut - on the first video keyframe once
+// fragment_sec (default 2) have been collected - and then handed to the
+// buffered file serializer, whose I/O thread writes them out and flushes the
+// file.  Memory stays at about one fragment no matter how long the recording
+// runs, and a file cut off by a crash or power loss plays up to its last
+// complete fragment, with no moov to rebuild.  Flushing each fragment needs
+// the vendored libobs; with a stock one the serializer writes fragments out
+// a chunk at a time, so the tail of a crashed file can be lost.
+//
+// Settings: "path", "fragment_sec", plus the mp4_output file splitting
+// settings ("max_time_sec", "max_size_mb", "directory", "format",
+// "extension"), which emit "file_changed" with the next file the same way.
+// On Linux "io_uring", "direct_io" and "preallocate_mb" select the
+// serializer's io_uring / O_DIRECT backend and fallocate the file up front
+// (vendored libobs only, ignored with a stock one).
+//
+// Call register_fragmented_mp4_output() once after obs_startup().
+#pragma once
+
+#include <obs.h>
+#include <obs-avc.h>
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/buffered-file-serializer.h>
+#include <util/platform.h>
+#include <util/serializer.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Big-endian box builder; boxes are opened with begin() and their size is
+// patched in by end()
+class Mp4Boxes {
+public:
+    std::vector<uint8_t> data;
+
+    void u8(uint8_t v) {
+        data.push_back(v);
+    }
+
+    void u16(uint16_t v) {
+        u8((uint8_t)(v >> 8));
+        u8((uint8_t)v);
+    }
+
+    void u24(uint32_t v) {
+        u8((uint8_t)(v >> 16));
+        u16((uint16_t)v);
+    }
+
+    void u32(uint32_t v) {
+        u16((uint16_t)(v >> 16));
+        u16((uint16_t)v);
+    }
+
+    void u64(uint64_t v) {
+        u32((uint32_t)(v >> 32));
+        u32((uint32_t)v);
+    }
+
+    void bytes(const void* p, size_t size) {
+        const uint8_t* b = static_cast<const uint8_t*>(p);
+        data.insert(data.end(), b, b + size);
+    }
+
+    void zeros(size_t count) {
+        data.insert(data.end(), count, 0);
+    }
+
+    void fourcc(const char* type) {
+        bytes(type, 4);
+    }
+
+    size_t begin(const char* type) {
+        size_t start = data.size();
+        u32(0);
+        fourcc(type);
+        return start;
+    }
+
+    size_t begin_full(const char* type, uint8_t version, uint32_t flags) {
+        size_t start = begin(type);
+        u8(version);
+        u24(flags);
+        return start;
+    }
+
+    void end(size_t start) {
+        patch32(start, (uint32_t)(data.size() - start));
+    }
+
+    void patch32(size_t pos, uint32_t v) {
+        data[pos] = (uint8_t)(v >> 24);
+        data[pos + 1] = (uint8_t)(v >> 16);
+        data[pos + 2] = (uint8_t)(v >> 8);
+        data[pos + 3] = (uint8_t)v;
+    }
+
+    // unity matrix of mvhd/tkhd
+    void matrix() {
+        const uint32_t m[9] = { 0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000 };
+        for (uint32_t v : m) {
+            u32(v);
+        }
+    }
+
+    // MPEG-4 descriptor header with the length in the fixed 4 byte form
+    void descriptor(uint8_t tag, uint32_t size) {
+        u8(tag);
+        u8(0x80 | ((size >> 21) & 0x7F));
+        u8(0x80 | ((size >> 14) & 0x7F));
+        u8(0x80 | ((size >> 7) & 0x7F));
+        u8(size & 0x7F);
+    }
+};
+
+// Muxes encoder packets into a fragmented MP4 file.  Packet data has to be
+// reference counted like encoder output (obs_encoder_packet_ref()).
+class Fmp4Writer {
+public:
+    int64_t fragment_usec = 2000000;
+    int64_t file_start_usec = -1;
+    uint64_t file_bytes = 0;
+    std::atomic<uint64_t> total_bytes{ 0 };
+
+    ~Fmp4Writer() {
+        close();
+    }
+
+    // Takes the codec parameters for the init segment from initialized
+    // encoders
+    bool configure(obs_encoder_t* video_encoder, obs_encoder_t* audio_encoder) {
+        if (strcmp(obs_encoder_get_codec(video_encoder), "h264") != 0 ||
+            strcmp(obs_encoder_get_codec(audio_encoder), "aac") != 0) {
+            blog(LOG_WARNING, "fmp4: only H.264 video and AAC audio are supported");
+            return false;
+        }
+
+        uint8_t* extra = nullptr;
+        size_t extra_size = 0;
+        uint8_t* avcc = nullptr;
+        if (!obs_encoder_get_extra_data(video_encoder, &extra, &extra_size) || !extra_size) {
+            blog(LOG_WARNING, "fmp4: video encoder has no SPS/PPS");
+            return false;
+        }
+        size_t avcc_size = obs_parse_avc_header(&avcc, extra, extra_size);
+        video.config.assign(avcc, avcc + avcc_size);
+        bfree(avcc);
+
+        extra = nullptr;
+        extra_size = 0;
+        obs_encoder_get_extra_data(audio_encoder, &extra, &extra_size);
+        audio.config.assign(extra, extra + extra_size);
+
+        const struct video_output_info* voi = video_output_get_info(obs_encoder_video(video_encoder));
+        video.id = 1;
+        video.timescale = voi->fps_num;
+        width = obs_encoder_get_width(video_encoder);
+        height = obs_encoder_get_height(video_encoder);
+
+        audio.id = 2;
+        audio.timescale = obs_encoder_get_sample_rate(audio_encoder);
+        channels = (uint32_t)audio_output_get_channels(obs_encoder_audio(audio_encoder));
+        obs_data_t* audio_settings = obs_encoder_get_settings(audio_encoder);
+        audio_bitrate = (uint32_t)obs_data_get_int(audio_settings, "bitrate") * 1000;
+        obs_data_release(audio_settings);
+        return true;
+    }
+
+    bool open(const std::string& path, const struct buffered_file_serializer_options& options) {
+        close();
+#ifdef HAVE_VENDORED_LIBOBS
+        bool opened = buffered_file_serializer_init_ex(&file, path.c_str(), &options);
+#else
+        bool opened = buffered_file_serializer_init(&file, path.c_str(), options.max_bufsize, options.chunk_size);
+#endif
+        if (!opened) {
+            blog(LOG_WARNING, "fmp4: failed to open '%s'", path.c_str());
+            return false;
+        }
+        file_open = true;
+        file_bytes = 0;
+        file_start_usec = -1;
+        sequence = 0;
+        video.started = false;
+        audio.started = false;
+        write_init_segment();
+        return true;
+    }
+
+    // Writes out the samples still pending and closes the file
+    void close() {
+        if (file_open) {
+            write_fragment(nullptr);
+            buffered_file_serializer_free(&file);
+            file_open = false;
+        }
+        clear_pending();
+    }
+
+    bool is_open() const {
+        return file_open;
+    }
+
+    // Fragments are cut on the first video keyframe past fragment_usec
+    bool fragment_due(const struct encoder_packet* packet) const {
+        return packet->type == OBS_ENCODER_VIDEO && packet->keyframe && fragment_start_usec >= 0 &&
+            packet->dts_usec - fragment_start_usec >= fragment_usec;
+    }
+
+    void add_packet(struct encoder_packet* packet) {
+        bool is_video = packet->type == OBS_ENCODER_VIDEO;
+
+        if (file_start_usec < 0) {
+            file_start_usec = packet->dts_usec;
+        }
+        if (fragment_start_usec < 0) {
+            fragment_start_usec = packet->dts_usec;
+        }
+
+        Sample sample = {};
+        if (is_video) {
+            // Annex B start codes -> 4 byte NAL lengths
+            obs_parse_avc_packet(&sample.packet, packet);
+        } else {
+            obs_encoder_packet_ref(&sample.packet, packet);
+        }
+
+        Track& track = is_video ? video : audio;
+        sample.decode_time = track.decode_time(packet, file_start_usec);
+        sample.composition_offset = (int32_t)(Track::ticks(packet, packet->pts - packet->dts) - track.composition_shift);
+
+        if (!track.pending.empty()) {
+            Sample& previous = track.pending.back();
+            previous.duration = (uint32_t)(sample.decode_time - previous.decode_time);
+        }
+        track.pending.push_back(sample);
+    }
+
+    // Writes the pending samples as one moof + mdat.  next_video is the
+    // keyframe starting the following fragment, which gives the last video
+    // sample its duration.
+    void write_fragment(const struct encoder_packet* next_video) {
+        if (video.pending.empty() && audio.pending.empty()) {
+            return;
+        }
+
+        if (!video.pending.empty()) {
+            Sample& last = video.pending.back();
+            if (next_video) {
+                last.duration = (uint32_t)(video.decode_time(next_video, file_start_usec) - last.decode_time);
+            } else {
+                last.duration = video.pending.size() > 1 ? video.pending[video.pending.size() - 2].duration : 1;
+            }
+        }
+        if (!audio.pending.empty()) {
+            audio.pending.back().duration =
+                audio.pending.size() > 1 ? audio.pending[audio.pending.size() - 2].duration : 1024;
+        }
+
+        Mp4Boxes b;
+        size_t moof = b.begin("moof");
+        size_t mfhd = b.begin_full("mfhd", 0, 0);
+        b.u32(++sequence);
+        b.end(mfhd);
+
+        size_t data_offsets[2] = {};
+        int traf_count = 0;
+        for (Track* track : { &video, &audio }) {
+            if (track->pending.empty()) {
+                continue;
+            }
+            bool is_video = track == &video;
+
+            size_t traf = b.begin("traf");
+            size_t tfhd = b.begin_full("tfhd", 0, 0x020000); // default-base-is-moof
+            b.u32(track->id);
+            b.end(tfhd);
+
+            size_t tfdt = b.begin_full("tfdt", 1, 0);
+            b.u64((uint64_t)track->pending.front().decode_time);
+            b.end(tfdt);
+
+            // duration, size (+ flags and signed composition offset for video)
+            size_t trun = b.begin_full("trun", is_video ? 1 : 0, is_video ? 0xF01 : 0x301);
+            b.u32((uint32_t)track->pending.size());
+            data_offsets[traf_count++] = b.data.size();
+            b.u32(0);
+            for (const Sample& sample : track->pending) {
+                b.u32(sample.duration);
+                b.u32((uint32_t)sample.packet.size);
+                if (is_video) {
+                    b.u32(sample.packet.keyframe ? 0x02000000 : 0x01010000);
+                    b.u32((uint32_t)sample.composition_offset);
+                }
+            }
+            b.end(trun);
+            b.end(traf);
+        }
+        b.end(moof);
+
+        // sample data offsets count from the start of the moof
+        size_t offset = b.data.size() + 8;
+        traf_count = 0;
+        for (Track* track : { &video, &audio }) {
+            if (track->pending.empty()) {
+                continue;
+            }
+            b.patch32(data_offsets[traf_count++], (uint32_t)offset);
+            for (const Sample& sample : track->pending) {
+                offset += sample.packet.size;
+            }
+        }
+
+        size_t mdat_size = offset - b.data.size();
+        b.u32((uint32_t)mdat_size);
+        b.fourcc("mdat");
+        write(b);
+
+        for (Track* track : { &video, &audio }) {
+            for (const Sample& sample : track->pending) {
+                write(sample.packet.data, sample.packet.size);
+            }
+        }
+
+        clear_pending();
+#ifdef HAVE_VENDORED_LIBOBS
+        buffered_file_serializer_flush(&file);
+#endif
+    }
+
+private:
+    struct Sample {
+        struct encoder_packet packet;
+        int64_t decode_time; // in track units, relative to the file start
+        uint32_t duration;
+        int32_t composition_offset;
+    };
+
+    struct Track {
+        uint32_t id = 0;
+        uint32_t timescale = 0;
+        std::vector<uint8_t> config; // avcC / AudioSpecificConfig
+        std::vector<Sample> pending;
+
+        // where the current file starts on this track.  The composition
+        // offsets are shifted by the first sample's (the B-frame reorder
+        // delay) so presentation starts with decoding, which saves an edit list
+        bool started = false;
+        int64_t origin_ticks = 0;
+        int64_t origin_offset = 0;
+        int64_t composition_shift = 0;
+
+        // dts * timebase_num: the track timescale is the timebase denominator
+        static int64_t ticks(const struct encoder_packet* packet, int64_t value) {
+            return value * packet->timebase_num;
+        }
+
+        int64_t decode_time(const struct encoder_packet* packet, int64_t file_start_usec) {
+            if (!started) {
+                started = true;
+                origin_ticks = ticks(packet, packet->dts);
+                int64_t offset_usec = packet->dts_usec - file_start_usec;
+                origin_offset = offset_usec > 0 ? offset_usec * timescale / 1000000 : 0;
+                composition_shift = ticks(packet, packet->pts - packet->dts);
+            }
+            return ticks(packet, packet->dts) - origin_ticks + origin_offset;
+        }
+    };
+
+    struct serializer file = {};
+    bool file_open = false;
+    uint32_t sequence = 0;
+
+    Track video;
+    Track audio;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t channels = 2;
+    uint32_t audio_bitrate = 0;
+    int64_t fragment_start_usec = -1;
+
+    void clear_pending() {
+        for (Track* track : { &video, &audio }) {
+            for (Sample& sample : track->pending) {
+                obs_encoder_packet_release(&sample.packet);
+            }
+            track->pending.clear();
+        }
+        fragment_start_usec = -1;
+    }
+
+    void write(const Mp4Boxes& boxes) {
+        write(boxes.data.data(), boxes.data.size());
+    }
+
+    void write(const void* data, size_t size) {
+        s_write(&file, data, size);
+        file_bytes += size;
+        total_bytes += size;
+    }
+
+    void write_init_segment() {
+        Mp4Boxes b;
+
+        size_t ftyp = b.begin("ftyp");
+        b.fourcc("isom");
+        b.u32(0x200);
+        b.fourcc("isom");
+        b.fourcc("iso6");
+        b.fourcc("avc1");
+        b.fourcc("mp41");
+        b.end(ftyp);
+
+        size_t moov = b.begin("moov");
+        size_t mvhd = b.begin_full("mvhd", 0, 0);
+        b.u32(0);           // creation time
+        b.u32(0);           // modification time
+        b.u32(1000);        // timescale
+        b.u32(0);           // duration, unknown up front
+        b.u32(0x00010000);  // rate
+        b.u16(0x0100);      // volume
+        b.zeros(10);
+        b.matrix();
+        b.zeros(24);
+        b.u32(audio.id + 1); // next track id
+        b.end(mvhd);
+
+        write_track(b, video, true);
+        write_track(b, audio, false);
+
+        size_t mvex = b.begin("mvex");
+        for (const Track* track : { &video, &audio }) {
+            size_t trex = b.begin_full("trex", 0, 0);
+            b.u32(track->id);
+            b.u32(1); // sample description index
+            b.u32(0); // default duration
+            b.u32(0); // default size
+            b.u32(0); // default flags
+            b.end(trex);
+        }
+        b.end(mvex);
+        b.end(moov);
+
+        write(b);
+    }
+
+    void write_track(Mp4Boxes& b, const Track& track, bool is_video) {
+        size_t trak = b.begin("trak");
+
+        size_t tkhd = b.begin_full("tkhd", 0, 3); // enabled, in movie
+        b.u32(0);
+        b.u32(0);
+        b.u32(track.id);
+        b.u32(0);
+        b.u32(0); // duration
+        b.zeros(8);
+        b.u16(0); // layer
+        b.u16(0); // alternate group
+        b.u16(is_video ? 0 : 0x0100);
+        b.u16(0);
+        b.matrix();
+        b.u32(is_video ? width << 16 : 0);
+        b.u32(is_video ? height << 16 : 0);
+        b.end(tkhd);
+
+        size_t mdia = b.begin("mdia");
+        size_t mdhd = b.begin_full("mdhd", 0, 0);
+        b.u32(0);
+        b.u32(0);
+        b.u32(track.timescale);
+        b.u32(0);
+        b.u16(0x55C4); // "und"
+        b.u16(0);
+        b.end(mdhd);
+
+        size_t hdlr = b.begin_full("hdlr", 0, 0);
+        b.u32(0);
+        b.fourcc(is_video ? "vide" : "soun");
+        b.zeros(12);
+        const char* name = is_video ? "VideoHandler" : "SoundHandler";
+        b.bytes(name, strlen(name) + 1);
+        b.end(hdlr);
+
+        size_t minf = b.begin("minf");
+        if (is_video) {
+            size_t vmhd = b.begin_full("vmhd", 0, 1);
+            b.zeros(8);
+            b.end(vmhd);
+        } else {
+            size_t smhd = b.begin_full("smhd", 0, 0);
+            b.zeros(4);
+            b.end(smhd);
+        }
+
+        size_t dinf = b.begin("dinf");
+        size_t dref = b.begin_full("dref", 0, 0);
+        b.u32(1);
+        size_t url = b.begin_full("url ", 0, 1); // data is in this file
+        b.end(url);
+        b.end(dref);
+        b.end(dinf);
+
+        size_t stbl = b.begin("stbl");
+        size_t stsd = b.begin_full("stsd", 0, 0);
+        b.u32(1);
+        if (is_video) {
+            write_avc1(b);
+        } else {
+            write_mp4a(b);
+        }
+        b.end(stsd);
+
+        // samples are all in the fragments
+        for (const char* type : { "stts", "stsc", "stco" }) {
+            size_t box = b.begin_full(type, 0, 0);
+            b.u32(0);
+            b.end(box);
+        }
+        size_t stsz = b.begin_full("stsz", 0, 0);
+        b.u32(0);
+        b.u32(0);
+        b.end(stsz);
+
+        b.end(stbl);
+        b.end(minf);
+        b.end(mdia);
+        b.end(trak);
+    }
+
+    void write_avc1(Mp4Boxes& b) {
+        size_t avc1 = b.begin("avc1");
+        b.zeros(6);
+        b.u16(1); // data reference index
+        b.zeros(16);
+        b.u16((uint16_t)width);
+        b.u16((uint16_t)height);
+        b.u32(0x00480000); // 72 dpi
+        b.u32(0x00480000);
+        b.u32(0);
+        b.u16(1); // frame count
+        b.zeros(32);
+        b.u16(0x0018);
+        b.u16(0xFFFF);
+
+        size_t avcc = b.begin("avcC");
+        b.bytes(video.config.data(), video.config.size());
+        b.end(avcc);
+        b.end(avc1);
+    }
+
+    void write_mp4a(Mp4Boxes& b) {
+        size_t mp4a = b.begin("mp4a");
+        b.zeros(6);
+        b.u16(1);
+        b.zeros(8);
+        b.u16((uint16_t)channels);
+        b.u16(16);
+        b.u32(0);
+        b.u32(audio.timescale << 16);
+
+        // descriptor sizes exclude their own 5 byte headers
+        const uint32_t config_size = (uint32_t)audio.config.size();
+        const uint32_t decoder_config_size = 13 + 5 + config_size;
+        const uint32_t sl_config_size = 1;
+
+        size_t esds = b.begin_full("esds", 0, 0);
+        b.descriptor(0x03, 3 + 5 + decoder_config_size + 5 + sl_config_size);
+        b.u16((uint16_t)audio.id);
+        b.u8(0);
+        b.descriptor(0x04, decoder_config_size);
+        b.u8(0x40);       // MPEG-4 audio
+        b.u8(0x15);       // audio stream
+        b.u24(0);         // buffer size
+        b.u32(audio_bitrate);
+        b.u32(audio_bitrate);
+        b.descriptor(0x05, config_size);
+        b.bytes(audio.config.data(), config_size);
+        b.descriptor(0x06, sl_config_size);
+        b.u8(0x02);
+        b.end(esds);
+
+        b.end(mp4a);
+    }
+};
+
+class FragmentedMp4Output {
+public:
+    static const char* get_name(void*) {
+        return "Fragmented MP4 Output";
+    }
+
+    static void* create(obs_data_t* settings, obs_output_t* output) {
+        FragmentedMp4Output* self = new FragmentedMp4Output();
+        self->output = output;
+        signal_handler_add(obs_output_get_signal_handler(output), "void file_changed(string next_file)");
+        update(self, settings);
+        return self;
+    }
+
+    static void destroy(void* data) {
+        delete static_cast<FragmentedMp4Output*>(data);
+    }
+
+    static void get_defaults(obs_data_t* settings) {
+        obs_data_set_default_double(settings, "fragment_sec", 2.0);
+        obs_data_set_default_string(settings, "extension", "mp4");
+    }
+
+    static void update(void* data, obs_data_t* settings) {
+        FragmentedMp4Output* self = static_cast<FragmentedMp4Output*>(data);
+        std::lock_guard<std::mutex> lock(self->mutex);
+        self->writer.fragment_usec = (int64_t)(obs_data_get_double(settings, "fragment_sec") * 1000000.0);
+        if (self->writer.fragment_usec <= 0) {
+            self->writer.fragment_usec = 2000000;
+        }
+    }
+    static bool start(void* data) {
+        FragmentedMp4Output* self = static_cast<FragmentedMp4Output*>(data);
+        return self->start_output();
+    }
+
+    static void stop(void* data, uint64_t ts) {
+        FragmentedMp4Output* self = static_cast<FragmentedMp4Output*>(data);
+        std::unique_lock<std::mutex> lock(self->mutex);
+        if (!self->active) {
+            return;
+        }
+        if (ts != 0) {
+            self->stop_ts = (int64_t)ts / 1000;
+            self->stopping = true;
+            return;
+        }
+        self->finish();
+        lock.unlock();
+        obs_output_end_data_capture(self->output);
+    }
+
+    static void encoded_packet(void* data, struct encoder_packet* packet) {
+        FragmentedMp4Output* self = static_cast<FragmentedMp4Output*>(data);
+        std::unique_lock<std::mutex> lock(self->mutex);
+        if (!self->active) {
+            return;
+        }
+
+        int code = !packet ? OBS_OUTPUT_ENCODE_ERROR : self->add_packet(packet);
+        if (code == OBS_OUTPUT_SUCCESS && self->active) {
+            return;
+        }
+
+        // the output has to be ended without holding the lock, the encoders
+        // are stopped from here
+        if (self->active) {
+            self->finish();
+        }
+        lock.unlock();
+        if (code == OBS_OUTPUT_SUCCESS) {
+            obs_output_end_data_capture(self->output);
+        } else {
+            obs_output_signal_stop(self->output, code);
+        }
+    }
+
+    static uint64_t get_total_bytes(void* data) {
+        return static_cast<FragmentedMp4Output*>(data)->writer.total_bytes;
+    }
+
+private:
+    obs_output_t* output = nullptr;
+    std::mutex mutex;
+    bool active = false;
+    bool stopping = false;
+    int64_t stop_ts = 0;
+
+    std::string path;
+    int64_t max_time_usec = 0;
+    int64_t max_size_bytes = 0;
+    struct buffered_file_serializer_options file_options = {};
+    Fmp4Writer writer;
+
+    bool start_output() {
+        if (!obs_output_can_begin_data_capture(output, 0) || !obs_output_initialize_encoders(output, 0)) {
+            return false;
+        }
+        if (!writer.configure(obs_output_get_video_encoder(output), obs_output_get_audio_encoder(output, 0))) {
+            return false;
+        }
+
+        obs_data_t* settings = obs_output_get_settings(output);
+        path = obs_data_get_string(settings, "path");
+        max_time_usec = obs_data_get_int(settings, "max_time_sec") * 1000000;
+        max_size_bytes = obs_data_get_int(settings, "max_size_mb") * 1024 * 1024;
+        file_options = {};
+        file_options.io_uring = obs_data_get_bool(settings, "io_uring");
+        file_options.direct_io = obs_data_get_bool(settings, "direct_io");
+        file_options.preallocate = (uint64_t)obs_data_get_int(settings, "preallocate_mb") * 1024 * 1024;
+        obs_data_release(settings);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!writer.open(path, file_options)) {
+            return false;
+        }
+
+        stopping = false;
+        writer.total_bytes = 0;
+        active = true;
+        if (!obs_output_begin_data_capture(output, 0)) {
+            active = false;
+            writer.close();
+            return false;
+        }
+
+        std::cout << "Fragmented MP4: " << path << " (" << writer.fragment_usec / 1000 << " ms fragments)" << std::endl;
+        return true;
+    }
+
+    // Writes out what is left and closes the file; the caller ends the
+    // output once the lock is released
+    void finish() {
+        writer.close();
+        active = false;
+    }
+
+    // Returns the code to stop the output with when the packet ends it
+    int add_packet(struct encoder_packet* packet) {
+        if (packet->type == OBS_ENCODER_AUDIO && packet->track_idx != 0) {
+            return OBS_OUTPUT_SUCCESS;
+        }
+
+        if (stopping && packet->sys_dts_usec >= stop_ts) {
+            finish();
+            return OBS_OUTPUT_SUCCESS;
+        }
+
+        if (writer.fragment_due(packet)) {
+            writer.write_fragment(packet);
+
+            // splits only happen where a fragment starts, so every file
+            // begins with a keyframe
+            if ((max_time_usec > 0 && packet->dts_usec - writer.file_start_usec >= max_time_usec) ||
+                (max_size_bytes > 0 && (int64_t)writer.file_bytes >= max_size_bytes)) {
+                if (!split_file()) {
+                    return OBS_OUTPUT_ERROR;
+                }
+            }
+        }
+
+        writer.add_packet(packet);
+        return OBS_OUTPUT_SUCCESS;
+    }
+
+    bool split_file() {
+        obs_data_t* settings = obs_output_get_settings(output);
+        std::string directory = obs_data_get_string(settings, "directory");
+        const char* format = obs_data_get_string(settings, "format");
+        const char* extension = obs_data_get_string(settings, "extension");
+        obs_data_release(settings);
+
+        char* filename = os_generate_formatted_filename(extension, true, format);
+        path = directory + "/" + filename;
+        bfree(filename);
+
+        if (!writer.open(path, file_options)) {
+            return false;
+        }
+
+        calldata_t params = {};
+        calldata_set_string(&params, "next_file", path.c_str());
+        signal_handler_signal(obs_output_get_signal_handler(output), "file_changed", &params);
+        calldata_free(&params);
+        return true;
+    }
+};
+
+inline void register_fragmented_mp4_output() {
+    struct obs_output_info info = {};
+    info.id = "fragmented_mp4_output";
+    info.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED;
+    info.encoded_video_codecs = "h264";
+    info.encoded_audio_codecs = "aac";
+    info.get_name = FragmentedMp4Output::get_name;
+    info.create = FragmentedMp4Output::create;
+    info.destroy = FragmentedMp4Output::destroy;
+    info.start = FragmentedMp4Output::start;
+    info.stop = FragmentedMp4Output::stop;
+    info.encoded_packet = FragmentedMp4Output::encoded_packet;
+    info.update = FragmentedMp4Output::update;
+    info.get_defaults = FragmentedMp4Output::get_defaults;
+    info.get_total_bytes = FragmentedMp4Output::get_total_bytes;
+    obs_register_output(&info);
+}
@@ -0,0 +1,274 @@
+// linux_platform.h - Linux/headless replacements for the Win32 helpers used by the capture apps
+//
+// libobs on Linux goes through the obs-nix platform layer: the OpenGL
+// renderer (libobs-opengl) needs an X11 display handed to it through
+// obs_set_nix_platform_display() before obs_startup().  On render farm / CI
+// boxes without a screen run the apps under a virtual X server, e.g.
+//
+//     xvfb-run -s "-screen 0 1920x1080x24" ./obs_screen_capture 10 out.mp4
+//
+// Screen size and layout are not probed from the display; they come from
+// OBS_HEADLESS_MONITORS ("1920x1080" or "1920x1080,2560x1440", laid out left
+// to right) so that runs are reproducible across hosts.  OBS_CPU_CONVERSION=1
+// moves the output color conversion from the GPU to the CPU,
+// OBS_VIDEO_WORKER_THREADS=<n> feeds the encoders from a pool of n threads,
+// OBS_PROFILER_TRACE=<file.json> records the libobs profiler into a Chrome
+// trace / Perfetto file on shutdown, OBS_EFFECT_CACHE_DIR moves the parsed
+// effect cache and OBS_MODULE_MANIFEST the plugin manifest.
+#pragma once
+
+#include <obs.h>
+#include <obs-nix-platform.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+#include <X11/Xlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Plugin directory of the libobs the apps link, passed in by CMakeLists.txt
+#ifndef LINUX_DEFAULT_PLUGIN_DIR
+#error "LINUX_DEFAULT_PLUGIN_DIR must be defined by the build"
+#endif
+#define LINUX_DEFAULT_DATA_DIR "/usr/share/obs"
+
+struct HeadlessMonitor {
+    int x, y;
+    int width, height;
+};
+
+inline std::string linux_env_or(const char* name, const char* fallback) {
+    const char* value = getenv(name);
+    return (value && *value) ? value : fallback;
+}
+
+// Directory containing the running executable
+inline std::string linux_exe_directory() {
+    char buffer[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", buffer, sizeof(buffer) - 1);
+    if (len <= 0) {
+        return ".";
+    }
+    buffer[len] = '\0';
+    std::string exe_path = buffer;
+    size_t pos = exe_path.find_last_of('/');
+    return exe_path.substr(0, pos);
+}
+
+// Plugin binaries (*.so), overridable with OBS_PLUGIN_DIR
+inline std::string linux_plugin_directory() {
+    return linux_env_or("OBS_PLUGIN_DIR", LINUX_DEFAULT_PLUGIN_DIR);
+}
+
+// Root of libobs/plugin data (contains libobs/ and obs-plugins/), overridable
+// with OBS_DATA_DIR
+inline std::string linux_data_directory() {
+    return linux_env_or("OBS_DATA_DIR", LINUX_DEFAULT_DATA_DIR);
+}
+
+// GPU color conversion unless OBS_CPU_CONVERSION=1.  Software-rendered hosts
+// (llvmpipe under Xvfb) are faster converting the output to NV12 on the CPU,
+// where libobs splits it across all cores.
+inline bool linux_gpu_conversion() {
+    return linux_env_or("OBS_CPU_CONVERSION", "0") == "0";
+}
+
+// Per-user cache directory ($XDG_CACHE_HOME, else ~/.cache), empty if
+// neither is set
+inline std::string linux_cache_directory() {
+    std::string cache_home = linux_env_or("XDG_CACHE_HOME", "");
+    if (cache_home.empty()) {
+        std::string home = linux_env_or("HOME", "");
+        if (!home.empty()) {
+            cache_home = home + "/.cache";
+        }
+    }
+    return cache_home;
+}
+
+// Caches parsed effects on disk so that obs_reset_video in later runs skips
+// lexing and parsing the libobs shaders.  OBS_EFFECT_CACHE_DIR overrides the
+// location ($XDG_CACHE_HOME/obs-effects by default), OBS_EFFECT_CACHE_DIR=0
+// turns it off.  Call before obs_reset_video().  Needs the vendored libobs.
+inline void linux_effect_cache_start() {
+#ifdef HAVE_VENDORED_LIBOBS
+    std::string dir = linux_env_or("OBS_EFFECT_CACHE_DIR", "");
+    if (dir == "0") {
+        return;
+    }
+
+    if (dir.empty()) {
+        std::string cache_home = linux_cache_directory();
+        if (cache_home.empty()) {
+            return;
+        }
+        dir = cache_home + "/obs-effects";
+    }
+
+    gs_effect_set_cache_path(dir.c_str());
+#endif
+}
+
+// Keeps a manifest of the types each plugin registers, so that later runs
+// open plugins without loading them and a plugin's binary is only loaded
+// the first time one of its sources, encoders, outputs or services is used.
+// OBS_MODULE_MANIFEST overrides the file ($XDG_CACHE_HOME/obs-modules.json
+// by default), OBS_MODULE_MANIFEST=0 turns it off.  Call after obs_startup()
+// and before opening the modules.  Needs the vendored libobs.
+inline void linux_module_manifest_start() {
+#ifdef HAVE_VENDORED_LIBOBS
+    std::string path = linux_env_or("OBS_MODULE_MANIFEST", "");
+    if (path == "0") {
+        return;
+    }
+
+    if (path.empty()) {
+        std::string cache_home = linux_cache_directory();
+        if (cache_home.empty()) {
+            return;
+        }
+        os_mkdirs(cache_home.c_str());
+        path = cache_home + "/obs-modules.json";
+    }
+
+    obs_set_module_manifest_path(path.c_str());
+#endif
+}
+
+// Runs video-io's scaling and encoder callbacks on a shared pool of
+// OBS_VIDEO_WORKER_THREADS threads instead of one thread per encoder, which
+// pays off with many encoders in one process (e.g. obs_capture_daemon).  Call
+// after obs_reset_video() and before starting any encoder.  Needs the vendored
+// libobs.
+inline void linux_video_workers_start() {
+#ifdef HAVE_VENDORED_LIBOBS
+    int threads = std::atoi(linux_env_or("OBS_VIDEO_WORKER_THREADS", "0").c_str());
+    if (threads <= 0) {
+        return;
+    }
+
+    if (video_output_set_worker_threads(obs_get_video(), (size_t)threads)) {
+        std::cout << "Video-io using " << threads << " worker thread(s)" << std::endl;
+    } else {
+        std::cerr << "Failed to start " << threads << " video-io worker threads" << std::endl;
+    }
+#endif
+}
+
+// Starts the libobs profiler when OBS_PROFILER_TRACE is set.  Call before
+// obs_startup() so the graphics/video/audio threads are covered from the start.
+// The trace needs the vendored libobs.
+inline void linux_profiler_start() {
+    if (linux_env_or("OBS_PROFILER_TRACE", "").empty()) {
+        return;
+    }
+
+#ifdef HAVE_VENDORED_LIBOBS
+    // the last ~minute of a 60 fps pipeline
+    profiler_start();
+    profiler_trace_start(1000000);
+#else
+    std::cerr << "OBS_PROFILER_TRACE needs the vendored libobs, ignoring it" << std::endl;
+#endif
+}
+
+// Writes the trace and frees the profiler, after obs_shutdown()
+inline void linux_profiler_finish() {
+#ifdef HAVE_VENDORED_LIBOBS
+    std::string path = linux_env_or("OBS_PROFILER_TRACE", "");
+    if (path.empty()) {
+        return;
+    }
+
+    if (profiler_trace_dump_json(path.c_str())) {
+        std::cout << "Profiler trace written to " << path << std::endl;
+    } else {
+        std::cerr << "Failed to write profiler trace " << path << std::endl;
+    }
+    profiler_stop();
+    profiler_free();
+#endif
+}
+
+inline std::vector<HeadlessMonitor> linux_headless_monitors() {
+    std::vector<HeadlessMonitor> monitors;
+    std::stringstream spec(linux_env_or("OBS_HEADLESS_MONITORS", "1920x1080"));
+    std::string entry;
+    int next_x = 0;
+
+    while (std::getline(spec, entry, ',')) {
+        int width = 0, height = 0;
+        if (sscanf(entry.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+            std::cerr << "Ignoring invalid OBS_HEADLESS_MONITORS entry: " << entry << std::endl;
+            continue;
+        }
+
+        monitors.push_back({ next_x, 0, width, height });
+        next_x += width;
+    }
+
+    return monitors;
+}
+
+// Must be called before obs_startup().  Returns the display so the caller
+// can close it after obs_shutdown().
+inline Display* linux_open_display() {
+    Display* display = XOpenDisplay(nullptr);
+    if (!display) {
+        std::cerr << "Unable to open X display (DISPLAY="
+            << linux_env_or("DISPLAY", "") << ")." << std::endl;
+        std::cerr << "On headless hosts run under a virtual server, e.g. xvfb-run." << std::endl;
+        return nullptr;
+    }
+
+    obs_set_nix_platform(OBS_NIX_PLATFORM_X11_EGL);
+    obs_set_nix_platform_display(display);
+    return display;
+}
+
+inline void linux_close_display(Display* display) {
+    if (display) {
+        XCloseDisplay(display);
+    }
+}
+
+// Console helpers standing in for <conio.h> _kbhit()/_getch()
+inline bool linux_kbhit() {
+    struct termios saved, raw;
+    tcgetattr(STDIN_FILENO, &saved);
+    raw = saved;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(STDIN_FILENO, &fds);
+    struct timeval tv = { 0, 0 };
+    int ready = select(STDIN_FILENO + 1, &fds, nullptr, nullptr, &tv);
+
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    return ready > 0;
+}
+
+inline char linux_getch() {
+    struct termios saved, raw;
+    tcgetattr(STDIN_FILENO, &saved);
+    raw = saved;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+
+    char c = 0;
+    if (read(STDIN_FILENO, &c, 1) != 1) {
+        c = 0;
+    }
+
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    return c;
+}
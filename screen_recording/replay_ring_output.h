@@ -0,0 +1,490 @@
+// replay_ring_output.h - Replay buffer kept in a memory-mapped ring file
+//
+// Registers "replay_ring_output", an encoded A/V output that keeps the last
+// stretch of a session ready to be saved, like OBS's replay buffer, but
+// appends the interleaved packets to a fixed-size ring file on local disk
+// instead of holding them in memory.  The file is mmap'd and every packet
+// becomes a record (header + data) written at the head; once the ring is full
+// the oldest records are evicted at the tail.  Only an index of the video
+// keyframes stays in memory, and finished parts of the ring are handed to
+// writeback right away, so a session costs clean page cache the kernel can
+// reclaim rather than heap.
+//
+// "save" remuxes the last max_time_sec, starting at a keyframe, straight from
+// the ring into a fragmented MP4 (Fmp4Writer) on its own thread.  It holds at
+// most one fragment plus a small write buffer, and reads no more than the
+// ring holds.  Recording is never held up by a save: a save that falls a
+// whole ring behind ends its file where the data was overwritten.
+//
+// Settings: "path" (the ring file), "max_size_mb", "max_time_sec" and, for
+// saved files, "directory", "format", "extension".  Procs "void save()" and
+// "void get_last_replay(out string path)" and signal "void saved()" match the
+// replay buffer.  Linux only.
+//
+// Call register_replay_ring_output() once after obs_startup().
+#pragma once
+
+#include "fragmented_mp4_output.h"
+#include <callback/proc.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <deque>
+#include <thread>
+
+class ReplayRingOutput {
+public:
+    static const char* get_name(void*) {
+        return "Replay Ring Output";
+    }
+
+    static void* create(obs_data_t* settings, obs_output_t* output) {
+        ReplayRingOutput* self = new ReplayRingOutput();
+        self->output = output;
+        signal_handler_add(obs_output_get_signal_handler(output), "void saved()");
+        proc_handler_t* procs = obs_output_get_proc_handler(output);
+        proc_handler_add(procs, "void save()", save_proc, self);
+        proc_handler_add(procs, "void get_last_replay(out string path)", get_last_replay_proc, self);
+        update(self, settings);
+        return self;
+    }
+
+    static void destroy(void* data) {
+        ReplayRingOutput* self = static_cast<ReplayRingOutput*>(data);
+        self->join_save();
+        self->unmap();
+        delete self;
+    }
+
+    static void get_defaults(obs_data_t* settings) {
+        obs_data_set_default_int(settings, "max_size_mb", 512);
+        obs_data_set_default_int(settings, "max_time_sec", 300);
+        obs_data_set_default_string(settings, "format", "Replay %CCYY-%MM-%DD %hh-%mm-%ss");
+        obs_data_set_default_string(settings, "extension", "mp4");
+    }
+
+    static void update(void* data, obs_data_t* settings) {
+        ReplayRingOutput* self = static_cast<ReplayRingOutput*>(data);
+        std::lock_guard<std::mutex> lock(self->mutex);
+        self->max_time_usec = obs_data_get_int(settings, "max_time_sec") * 1000000;
+    }
+
+    static bool start(void* data) {
+        ReplayRingOutput* self = static_cast<ReplayRingOutput*>(data);
+        return self->start_output();
+    }
+
+    static void stop(void* data, uint64_t ts) {
+        ReplayRingOutput* self = static_cast<ReplayRingOutput*>(data);
+        std::unique_lock<std::mutex> lock(self->mutex);
+        if (!self->active) {
+            return;
+        }
+        if (ts != 0) {
+            self->stop_ts = (int64_t)ts / 1000;
+            self->stopping = true;
+            return;
+        }
+        self->active = false;
+        lock.unlock();
+        obs_output_end_data_capture(self->output);
+    }
+
+    static void encoded_packet(void* data, struct encoder_packet* packet) {
+        ReplayRingOutput* self = static_cast<ReplayRingOutput*>(data);
+        std::unique_lock<std::mutex> lock(self->mutex);
+        if (!self->active) {
+            return;
+        }
+        if (!packet) {
+            self->active = false;
+            lock.unlock();
+            obs_output_signal_stop(self->output, OBS_OUTPUT_ENCODE_ERROR);
+            return;
+        }
+        if (self->stopping && packet->sys_dts_usec >= self->stop_ts) {
+            self->active = false;
+            lock.unlock();
+            obs_output_end_data_capture(self->output);
+            return;
+        }
+        if (packet->type == OBS_ENCODER_AUDIO && packet->track_idx != 0) {
+            return;
+        }
+        self->append(packet);
+    }
+
+    static uint64_t get_total_bytes(void* data) {
+        return static_cast<ReplayRingOutput*>(data)->total_bytes;
+    }
+
+private:
+    // Records are 8 byte aligned and never wrap around the end of the ring; a
+    // wrap marker fills the rest of the ring instead and the record starts
+    // over at the beginning
+    static const uint32_t RECORD_MAGIC = 0x52525043; // "RRPC"
+    static const uint32_t WRAP_MAGIC = 0x52525057;   // "RRPW"
+    static const uint64_t WRITEBACK_BYTES = 4 * 1024 * 1024;
+
+    struct Record {
+        uint32_t magic;
+        uint32_t size;
+        int64_t dts;
+        int64_t pts;
+        int64_t dts_usec;
+        int32_t timebase_num;
+        int32_t timebase_den;
+        uint8_t type;
+        uint8_t keyframe;
+        uint8_t reserved[6];
+    };
+    static_assert(sizeof(Record) == 48, "ring records must stay 8 byte aligned");
+
+    struct Keyframe {
+        uint64_t pos;
+        int64_t dts_usec;
+    };
+
+    obs_output_t* output = nullptr;
+    std::mutex mutex;
+    bool active = false;
+    bool stopping = false;
+    int64_t stop_ts = 0;
+    int64_t max_time_usec = 0;
+    std::atomic<uint64_t> total_bytes{ 0 };
+
+    // head and tail are logical positions that only grow; the byte at
+    // logical position p lives at ring[p % capacity]
+    int fd = -1;
+    uint8_t* ring = nullptr;
+    uint64_t capacity = 0;
+    uint64_t head = 0;
+    uint64_t tail = 0;
+    uint64_t written_back = 0;
+    int64_t last_dts_usec = 0;
+    std::deque<Keyframe> keyframes;
+
+    std::mutex save_mutex;
+    std::thread save_thread;
+    std::atomic<bool> saving{ false };
+    std::string last_replay;
+
+    static uint64_t record_size(uint32_t size) {
+        return (sizeof(Record) + size + 7) & ~(uint64_t)7;
+    }
+
+    bool start_output() {
+        if (!obs_output_can_begin_data_capture(output, 0) || !obs_output_initialize_encoders(output, 0)) {
+            return false;
+        }
+
+        obs_data_t* settings = obs_output_get_settings(output);
+        std::string path = obs_data_get_string(settings, "path");
+        uint64_t size = (uint64_t)obs_data_get_int(settings, "max_size_mb") * 1024 * 1024;
+        obs_data_release(settings);
+
+        // a save still reading the previous ring has to finish first, and
+        // none may start until the new one is mapped
+        std::lock_guard<std::mutex> save_lock(save_mutex);
+        if (save_thread.joinable()) {
+            save_thread.join();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        unmap();
+        if (!map(path, size)) {
+            return false;
+        }
+
+        head = tail = written_back = 0;
+        last_dts_usec = 0;
+        keyframes.clear();
+        stopping = false;
+        total_bytes = 0;
+        active = true;
+        if (!obs_output_begin_data_capture(output, 0)) {
+            active = false;
+            return false;
+        }
+
+        std::cout << "Replay ring: " << path << " (" << capacity / (1024 * 1024) << " MB, "
+            << max_time_usec / 1000000 << " s saved)" << std::endl;
+        return true;
+    }
+
+    bool map(const std::string& path, uint64_t size) {
+        capacity = size & ~(uint64_t)7;
+        if (capacity < 1024 * 1024) {
+            blog(LOG_WARNING, "replay ring: max_size_mb must be at least 1");
+            return false;
+        }
+
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            blog(LOG_WARNING, "replay ring: failed to open '%s': %s", path.c_str(), strerror(errno));
+            return false;
+        }
+
+        // real blocks up front: a page of a sparse file that cannot be
+        // allocated later would be a SIGBUS in the middle of a session
+        int err = posix_fallocate(fd, 0, (off_t)capacity);
+        if (err != 0) {
+            blog(LOG_WARNING, "replay ring: failed to allocate %llu bytes for '%s': %s",
+                (unsigned long long)capacity, path.c_str(), strerror(err));
+            unmap();
+            return false;
+        }
+
+        void* mapped = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            blog(LOG_WARNING, "replay ring: failed to map '%s': %s", path.c_str(), strerror(errno));
+            unmap();
+            return false;
+        }
+        ring = static_cast<uint8_t*>(mapped);
+        return true;
+    }
+
+    void unmap() {
+        if (ring) {
+            munmap(ring, capacity);
+            ring = nullptr;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    void evict_oldest() {
+        uint64_t phys = tail % capacity;
+        const Record* record = reinterpret_cast<const Record*>(ring + phys);
+        if (record->magic == WRAP_MAGIC) {
+            tail += capacity - phys;
+        } else {
+            tail += record_size(record->size);
+        }
+        while (!keyframes.empty() && keyframes.front().pos < tail) {
+            keyframes.pop_front();
+        }
+    }
+
+    void append(struct encoder_packet* packet) {
+        uint64_t length = record_size((uint32_t)packet->size);
+        if (length > capacity / 2) {
+            blog(LOG_WARNING, "replay ring: dropping a %zu byte packet, the ring is too small", packet->size);
+            return;
+        }
+
+        uint64_t phys = head % capacity;
+        uint64_t skip = phys + length > capacity ? capacity - phys : 0;
+        while (capacity - (head - tail) < skip + length) {
+            evict_oldest();
+        }
+
+        if (skip) {
+            reinterpret_cast<Record*>(ring + phys)->magic = WRAP_MAGIC;
+            head += skip;
+            phys = 0;
+        }
+
+        Record* record = reinterpret_cast<Record*>(ring + phys);
+        record->magic = RECORD_MAGIC;
+        record->size = (uint32_t)packet->size;
+        record->dts = packet->dts;
+        record->pts = packet->pts;
+        record->dts_usec = packet->dts_usec;
+        record->timebase_num = packet->timebase_num;
+        record->timebase_den = packet->timebase_den;
+        record->type = (uint8_t)packet->type;
+        record->keyframe = packet->keyframe ? 1 : 0;
+        memset(record->reserved, 0, sizeof(record->reserved));
+        memcpy(record + 1, packet->data, packet->size);
+
+        if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe) {
+            keyframes.push_back({ head, packet->dts_usec });
+        }
+        head += length;
+        last_dts_usec = packet->dts_usec;
+        total_bytes += packet->size;
+
+        // start writeback of what is complete so those pages are clean
+        // before the ring comes around to them again
+        if (head - written_back >= WRITEBACK_BYTES) {
+            write_back();
+        }
+    }
+
+    void write_back() {
+        while (written_back < head) {
+            uint64_t phys = written_back % capacity;
+            uint64_t length = (std::min)(head - written_back, capacity - phys);
+            sync_file_range(fd, (off64_t)phys, (off64_t)length, SYNC_FILE_RANGE_WRITE);
+            written_back += length;
+        }
+    }
+
+    static void save_proc(void* data, calldata_t* params) {
+        ReplayRingOutput* self = static_cast<ReplayRingOutput*>(data);
+        self->save();
+        UNUSED_PARAMETER(params);
+    }
+
+    static void get_last_replay_proc(void* data, calldata_t* params) {
+        ReplayRingOutput* self = static_cast<ReplayRingOutput*>(data);
+        std::lock_guard<std::mutex> lock(self->mutex);
+        calldata_set_string(params, "path", self->last_replay.c_str());
+    }
+
+    void join_save() {
+        std::lock_guard<std::mutex> lock(save_mutex);
+        if (save_thread.joinable()) {
+            save_thread.join();
+        }
+    }
+
+    void save() {
+        std::lock_guard<std::mutex> save_lock(save_mutex);
+        if (saving.exchange(true)) {
+            blog(LOG_WARNING, "replay ring: a save is already running");
+            return;
+        }
+        if (save_thread.joinable()) {
+            save_thread.join();
+        }
+
+        uint64_t begin = 0;
+        uint64_t end = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ring || keyframes.empty()) {
+                blog(LOG_WARNING, "replay ring: nothing recorded yet");
+                saving = false;
+                return;
+            }
+
+            // the newest keyframe that still gives max_time_usec, or the
+            // oldest one when the ring holds less than that
+            int64_t cutoff = last_dts_usec - max_time_usec;
+            begin = keyframes.front().pos;
+            for (const Keyframe& keyframe : keyframes) {
+                if (max_time_usec <= 0 || keyframe.dts_usec > cutoff) {
+                    break;
+                }
+                begin = keyframe.pos;
+            }
+            end = head;
+        }
+
+        save_thread = std::thread(&ReplayRingOutput::save_range, this, begin, end);
+    }
+
+    // Copies the record at pos out of the ring into a refcounted packet, or
+    // returns false once the recording has overwritten it
+    bool read_record(uint64_t& pos, struct encoder_packet* packet) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (;;) {
+            if (pos < tail) {
+                return false;
+            }
+
+            uint64_t phys = pos % capacity;
+            const Record* record = reinterpret_cast<const Record*>(ring + phys);
+            if (record->magic == WRAP_MAGIC) {
+                pos += capacity - phys;
+                continue;
+            }
+
+            long* refs = static_cast<long*>(bmalloc(sizeof(long) + record->size));
+            *refs = 1;
+            *packet = {};
+            packet->data = reinterpret_cast<uint8_t*>(refs + 1);
+            packet->size = record->size;
+            packet->dts = record->dts;
+            packet->pts = record->pts;
+            packet->dts_usec = record->dts_usec;
+            packet->timebase_num = record->timebase_num;
+            packet->timebase_den = record->timebase_den;
+            packet->type = (enum obs_encoder_type)record->type;
+            packet->keyframe = record->keyframe != 0;
+            memcpy(packet->data, record + 1, record->size);
+
+            pos += record_size(record->size);
+            return true;
+        }
+    }
+
+    void save_range(uint64_t begin, uint64_t end) {
+        obs_data_t* settings = obs_output_get_settings(output);
+        std::string directory = obs_data_get_string(settings, "directory");
+        const char* format = obs_data_get_string(settings, "format");
+        const char* extension = obs_data_get_string(settings, "extension");
+        char* filename = os_generate_formatted_filename(extension, true, format);
+        std::string path = directory + "/" + filename;
+        bfree(filename);
+        obs_data_release(settings);
+
+        // the ring is read far faster than a disk takes it, so keep the
+        // serializer's queue short instead of buffering the whole replay
+        struct buffered_file_serializer_options options = {};
+        options.max_bufsize = 8 * 1024 * 1024;
+
+        uint64_t begin_ns = os_gettime_ns();
+        Fmp4Writer writer;
+        writer.fragment_usec = 2000000;
+        bool ok = writer.configure(obs_output_get_video_encoder(output), obs_output_get_audio_encoder(output, 0)) &&
+            writer.open(path, options);
+
+        uint64_t pos = begin;
+        while (ok && pos < end) {
+            struct encoder_packet packet;
+            if (!read_record(pos, &packet)) {
+                blog(LOG_WARNING, "replay ring: the recording overtook the save, '%s' ends early", path.c_str());
+                break;
+            }
+            if (writer.fragment_due(&packet)) {
+                writer.write_fragment(&packet);
+            }
+            writer.add_packet(&packet);
+            obs_encoder_packet_release(&packet);
+        }
+        writer.close();
+
+        if (!ok) {
+            saving = false;
+            return;
+        }
+
+        blog(LOG_INFO, "replay ring: saved %llu bytes to '%s' in %llu ms", (unsigned long long)writer.total_bytes.load(),
+            path.c_str(), (unsigned long long)((os_gettime_ns() - begin_ns) / 1000000));
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            last_replay = path;
+        }
+        saving = false;
+
+        // empty like the stock replay buffer's, handlers may look up params
+        calldata_t params = {};
+        signal_handler_signal(obs_output_get_signal_handler(output), "saved", &params);
+        calldata_free(&params);
+    }
+};
+
+inline void register_replay_ring_output() {
+    struct obs_output_info info = {};
+    info.id = "replay_ring_output";
+    info.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED;
+    info.encoded_video_codecs = "h264";
+    info.encoded_audio_codecs = "aac";
+    info.get_name = ReplayRingOutput::get_name;
+    info.create = ReplayRingOutput::create;
+    info.destroy = ReplayRingOutput::destroy;
+    info.start = ReplayRingOutput::start;
+    info.stop = ReplayRingOutput::stop;
+    info.encoded_packet = ReplayRingOutput::encoded_packet;
+    info.update = ReplayRingOutput::update;
+    info.get_defaults = ReplayRingOutput::get_defaults;
+    info.get_total_bytes = ReplayRingOutput::get_total_bytes;
+    obs_register_output(&info);
+}
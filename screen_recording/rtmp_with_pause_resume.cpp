@@ -1,4 +1,4 @@
-// obs_rtmp_streaming.cpp - Multi-monitor OBS RTMP streaming with pause functionality for Windows
+// obs_rtmp_streaming.cpp - Multi-monitor OBS RTMP streaming with pause functionality for Windows and headless Linux
 #include <obs.h>
 #include <obs-module.h>
 #include <iostream>
@@ -6,6 +6,7 @@
 #include <chrono>
 #include <string>
 #include <vector>
+#include <memory>
 #include <cstring>
 #include <fstream>
 #include <filesystem>
@@ -13,12 +14,21 @@
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include "adaptive_bitrate.h"
 
 #ifdef _WIN32
 #include <windows.h>
 #include <shlwapi.h>
 #include <conio.h>
 #pragma comment(lib, "shlwapi.lib")
+#define MODULE_EXTENSION ".dll"
+#elif __linux__
+#include "linux_platform.h"
+#include "synthetic_sources.h"
+#include "stream_metrics.h"
+#define _kbhit linux_kbhit
+#define _getch linux_getch
+#define MODULE_EXTENSION ".so"
 #endif
 
 namespace fs = std::filesystem;
@@ -29,14 +39,17 @@ struct MonitorInfo {
     int x, y;
     int width, height;
     bool isPrimary;
+#ifdef _WIN32
     HMONITOR hMonitor;
+#endif
 };
 
 // Pause state enum
 enum class PauseState {
     NONE,
     AUDIO_ONLY,
-    BOTH
+    BOTH,
+    ENCODING    // encoders paused, nothing rendered, mixed or sent
 };
 
 class OBSRTMPStreamer {
@@ -61,6 +74,10 @@ private:
     int fps = 30;
     int video_bitrate = 5000;
     int audio_bitrate = 128;
+    int stream_bitrate = 0;
+
+    // Adjusts the video bitrate to the link while streaming
+    AdaptiveBitrate abr;
 
     // Thread control
     std::atomic<bool> is_streaming{ false };
@@ -80,6 +97,12 @@ private:
     // Stored visibility states for screen captures
     std::vector<bool> screen_capture_visibility;
 
+#ifdef __linux__
+    Display* display = nullptr;
+    StreamMetrics metrics;
+#endif
+
+#ifdef _WIN32
     static BOOL CALLBACK MonitorEnumProc(HMONITOR hMonitor, HDC hdcMonitor,
         LPRECT lprcMonitor, LPARAM dwData) {
         std::vector<MonitorInfo>* monitors = (std::vector<MonitorInfo>*)dwData;
@@ -110,10 +133,32 @@ private:
 
         return TRUE;
     }
+#endif
 
     void detect_monitors() {
         monitors.clear();
+#ifdef _WIN32
         EnumDisplayMonitors(NULL, NULL, MonitorEnumProc, (LPARAM)&monitors);
+#else
+        // Headless: virtual monitors from OBS_HEADLESS_MONITORS
+        for (const auto& headless : linux_headless_monitors()) {
+            MonitorInfo info;
+            info.index = static_cast<int>(monitors.size());
+            info.name = "Virtual-" + std::to_string(info.index);
+            info.x = headless.x;
+            info.y = headless.y;
+            info.width = headless.width;
+            info.height = headless.height;
+            info.isPrimary = info.index == 0;
+
+            monitors.push_back(info);
+
+            std::cout << "Found Monitor " << info.index << ": " << info.name
+                << " (" << info.width << "x" << info.height << ")"
+                << " at position (" << info.x << ", " << info.y << ")"
+                << (info.isPrimary ? " [PRIMARY]" : "") << std::endl;
+        }
+#endif
 
         int min_x = INT_MAX, min_y = INT_MAX;
         int max_x = INT_MIN, max_y = INT_MIN;
@@ -139,15 +184,16 @@ private:
         std::cout << "Number of monitors detected: " << monitors.size() << std::endl;
     }
 
-    bool load_module(const std::string& bin_path, const std::string& data_path,
+    // Opens a plugin without running its obs_module_load yet
+    obs_module_t* open_module(const std::string& bin_path, const std::string& data_path,
         const std::string& module_name) {
         obs_module_t* module = nullptr;
 
-        std::string module_path = bin_path + "/" + module_name + ".dll";
+        std::string module_path = bin_path + "/" + module_name + MODULE_EXTENSION;
 
         if (!fs::exists(module_path)) {
             std::cerr << "Module not found: " << module_path << std::endl;
-            return false;
+            return nullptr;
         }
 
         int code = obs_open_module(&module, module_path.c_str(), data_path.c_str());
@@ -169,19 +215,14 @@ private:
             default:
                 std::cerr << "Unknown error " << code << std::endl;
             }
-            return false;
+            return nullptr;
         }
 
-        if (!obs_init_module(module)) {
-            std::cerr << "Failed to initialize module: " << module_name << std::endl;
-            return false;
-        }
-
-        std::cout << "Successfully loaded module: " << module_name << std::endl;
-        return true;
+        return module;
     }
 
     bool load_required_modules() {
+#ifdef _WIN32
         std::string bin_path = obs_path + "/obs-plugins/64bit";
         std::string data_path = obs_path + "/data/obs-plugins";
 
@@ -193,14 +234,51 @@ private:
             "obs-x264",
             "rtmp-services"
         };
+#else
+        std::string bin_path = linux_plugin_directory();
+        std::string data_path = obs_path + "/obs-plugins";
 
+        // Capture comes from the synthetic sources, so no capture plugins
+        std::vector<std::string> modules = {
+            "obs-outputs",
+            "obs-ffmpeg",
+            "obs-x264",
+            "rtmp-services"
+        };
+#endif
+
+        std::vector<obs_module_t*> opened;
+        std::vector<std::string> opened_names;
         for (const auto& module : modules) {
             std::string module_data = data_path + "/" + module;
-            if (!load_module(bin_path, module_data, module)) {
+            obs_module_t* opened_module = open_module(bin_path, module_data, module);
+            if (opened_module) {
+                opened.push_back(opened_module);
+                opened_names.push_back(module);
+            } else {
                 std::cerr << "Warning: Failed to load module: " << module << std::endl;
             }
         }
 
+        std::unique_ptr<bool[]> loaded(new bool[opened.size()]());
+#ifdef HAVE_VENDORED_LIBOBS
+        // The plugins do not depend on each other, so their obs_module_load
+        // calls run in parallel
+        obs_init_modules(opened.data(), opened.size(), loaded.get());
+#else
+        for (size_t i = 0; i < opened.size(); i++) {
+            loaded[i] = obs_init_module(opened[i]);
+        }
+#endif
+
+        for (size_t i = 0; i < opened.size(); i++) {
+            if (loaded[i]) {
+                std::cout << "Successfully loaded module: " << opened_names[i] << std::endl;
+            } else {
+                std::cerr << "Warning: Failed to load module: " << opened_names[i] << std::endl;
+            }
+        }
+
         return true;
     }
 
@@ -264,12 +342,44 @@ private:
         std::cout << "Screen capture resumed" << std::endl;
     }
 
+    // Unlike pause_audio()/pause_screen() this stops the work instead of
+    // feeding the encoders silence and an empty scene: the encoders drop
+    // everything while paused and libobs stops rendering and mixing for
+    // them.  The stream keeps its connection and continues with the next
+    // timestamp on resume, viewers see the last frame until then.  Needs
+    // the vendored libobs.
+    bool pause_encoding() {
+#ifdef HAVE_VENDORED_LIBOBS
+        std::lock_guard<std::mutex> lock(pause_mutex);
+
+        if (!rtmp_output || !obs_output_pause_encoding(rtmp_output, true)) {
+            std::cerr << "Failed to pause encoding" << std::endl;
+            return false;
+        }
+        return true;
+#else
+        std::cerr << "Pausing the encoders needs the vendored libobs, use 'B' to pause screen and audio instead" << std::endl;
+        return false;
+#endif
+    }
+
+    void resume_encoding() {
+#ifdef HAVE_VENDORED_LIBOBS
+        std::lock_guard<std::mutex> lock(pause_mutex);
+
+        if (rtmp_output) {
+            obs_output_pause_encoding(rtmp_output, false);
+        }
+#endif
+    }
+
     void control_loop() {
         std::cout << "\n=== STREAMING CONTROLS ===" << std::endl;
         std::cout << "Press 'S' to START streaming" << std::endl;
         std::cout << "Press 'T' to STOP streaming" << std::endl;
         std::cout << "Press 'A' to PAUSE/RESUME audio only" << std::endl;
         std::cout << "Press 'B' to PAUSE/RESUME both screen and audio" << std::endl;
+        std::cout << "Press 'P' to PAUSE/RESUME encoding (stream freezes, no CPU used)" << std::endl;
         std::cout << "Press 'R' to RESUME all (if paused)" << std::endl;
         std::cout << "Press 'I' to show stream INFO/stats" << std::endl;
         std::cout << "Press 'Q' to QUIT application" << std::endl;
@@ -314,6 +424,9 @@ private:
                             pause_state = PauseState::NONE;
                             std::cout << "\nAudio resumed." << std::endl;
                         }
+                        else if (current == PauseState::ENCODING) {
+                            std::cout << "\nEncoding is paused. Use 'P' or 'R' to resume." << std::endl;
+                        }
                         else {
                             std::cout << "\nBoth audio and screen are paused. Use 'R' to resume all." << std::endl;
                         }
@@ -338,6 +451,9 @@ private:
                             pause_state = PauseState::NONE;
                             std::cout << "\nBoth audio and screen resumed." << std::endl;
                         }
+                        else if (current == PauseState::ENCODING) {
+                            std::cout << "\nEncoding is paused. Use 'P' or 'R' to resume." << std::endl;
+                        }
                         else {
                             // If only audio is paused, pause screen too
                             pause_screen();
@@ -350,6 +466,29 @@ private:
                     }
                     break;
 
+                case 'P':
+                    if (is_streaming) {
+                        PauseState current = pause_state.load();
+                        if (current == PauseState::NONE) {
+                            if (pause_encoding()) {
+                                pause_state = PauseState::ENCODING;
+                                std::cout << "\nEncoding paused. Press 'P' or 'R' to resume." << std::endl;
+                            }
+                        }
+                        else if (current == PauseState::ENCODING) {
+                            resume_encoding();
+                            pause_state = PauseState::NONE;
+                            std::cout << "\nEncoding resumed." << std::endl;
+                        }
+                        else {
+                            std::cout << "\nAudio/screen are paused. Use 'R' to resume first." << std::endl;
+                        }
+                    }
+                    else {
+                        std::cout << "\nNo stream is running!" << std::endl;
+                    }
+                    break;
+
                 case 'R':
                     if (is_streaming) {
                         PauseState current = pause_state.load();
@@ -364,6 +503,11 @@ private:
                             pause_state = PauseState::NONE;
                             std::cout << "\nBoth audio and screen resumed." << std::endl;
                         }
+                        else if (current == PauseState::ENCODING) {
+                            resume_encoding();
+                            pause_state = PauseState::NONE;
+                            std::cout << "\nEncoding resumed." << std::endl;
+                        }
                         else {
                             std::cout << "\nNothing is paused." << std::endl;
                         }
@@ -390,6 +534,9 @@ private:
                         case PauseState::BOTH:
                             std::cout << "Both audio and screen paused" << std::endl;
                             break;
+                        case PauseState::ENCODING:
+                            std::cout << "Encoding paused" << std::endl;
+                            break;
                         }
                     }
                     else {
@@ -409,6 +556,9 @@ private:
                                 resume_audio();
                                 resume_screen();
                             }
+                            else if (pause_state == PauseState::ENCODING) {
+                                resume_encoding();
+                            }
                             pause_state = PauseState::NONE;
                         }
                         stop_streaming();
@@ -429,7 +579,11 @@ private:
 public:
     OBSRTMPStreamer(const std::string& server, const std::string& key, int fps_rate = 30, int vbitrate = 5000)
         : rtmp_server(server), stream_key(key), fps(fps_rate), video_bitrate(vbitrate) {
+#ifdef _WIN32
         obs_path = "C:/Program Files/obs-studio";
+#else
+        obs_path = linux_data_directory();
+#endif
 
         if (!fs::exists(obs_path)) {
             std::cerr << "Error: OBS Studio not found at: " << obs_path << std::endl;
@@ -454,12 +608,29 @@ public:
             return false;
         }
 
+#ifdef _WIN32
         std::string bin_path = obs_path + "/bin/64bit";
         std::string plugin_bin_path = obs_path + "/obs-plugins/64bit";
         std::string data_path = obs_path + "/data/obs-plugins/%module%";
 
         obs_add_module_path(bin_path.c_str(), data_path.c_str());
         obs_add_module_path(plugin_bin_path.c_str(), data_path.c_str());
+#else
+        std::string plugin_bin_path = linux_plugin_directory();
+        std::string data_path = obs_path + "/obs-plugins/%module%";
+
+        obs_add_data_path((obs_path + "/libobs/").c_str());
+        obs_add_module_path(plugin_bin_path.c_str(), data_path.c_str());
+
+        linux_profiler_start();
+        linux_effect_cache_start();
+
+        // libobs-opengl renders through the X11/EGL platform display
+        display = linux_open_display();
+        if (!display) {
+            return false;
+        }
+#endif
 
         if (!obs_startup("en-US", nullptr, nullptr)) {
             std::cerr << "Failed to initialize OBS core" << std::endl;
@@ -468,8 +639,14 @@ public:
 
         std::cout << "OBS core initialized successfully" << std::endl;
 
+#ifdef __linux__
+        linux_module_manifest_start();
+#endif
         load_required_modules();
         obs_post_load_modules();
+#ifdef __linux__
+        register_synthetic_sources();
+#endif
 
         // Setup video
         struct obs_video_info ovi = {};
@@ -485,7 +662,12 @@ public:
         ovi.adapter = 0;
         ovi.gpu_conversion = true;
         ovi.scale_type = OBS_SCALE_BICUBIC;
+#ifdef _WIN32
         ovi.graphics_module = "libobs-d3d11";
+#else
+        ovi.graphics_module = "libobs-opengl";
+        ovi.gpu_conversion = linux_gpu_conversion();
+#endif
 
         int result = obs_reset_video(&ovi);
         if (result != OBS_VIDEO_SUCCESS) {
@@ -493,6 +675,9 @@ public:
             return false;
         }
 
+#ifdef __linux__
+        linux_video_workers_start();
+#endif
         std::cout << "Video initialized: " << total_width << "x"
             << total_height << " @ " << fps << " FPS" << std::endl;
 
@@ -523,13 +708,21 @@ public:
                 << " (" << monitor.name << ")" << std::endl;
 
             obs_data_t* screen_settings = obs_data_create();
+#ifdef _WIN32
+            const char* capture_id = "monitor_capture";
             obs_data_set_bool(screen_settings, "capture_cursor", true);
             obs_data_set_int(screen_settings, "monitor", monitor.index);
             obs_data_set_bool(screen_settings, "compatibility", false);
             obs_data_set_bool(screen_settings, "force_scaling", false);
+#else
+            const char* capture_id = "synthetic_video";
+            obs_data_set_int(screen_settings, "width", monitor.width);
+            obs_data_set_int(screen_settings, "height", monitor.height);
+            obs_data_set_int(screen_settings, "fps", fps);
+#endif
 
             std::string source_name = "Monitor " + std::to_string(monitor.index) + " - " + monitor.name;
-            obs_source_t* screen_capture = obs_source_create("monitor_capture",
+            obs_source_t* screen_capture = obs_source_create(capture_id,
                 source_name.c_str(),
                 screen_settings,
                 nullptr);
@@ -569,12 +762,22 @@ public:
         obs_data_t* desktop_settings = obs_data_create();
         obs_data_t* mic_settings = obs_data_create();
 
+#ifdef _WIN32
         desktop_audio = obs_source_create("wasapi_output_capture",
             "Desktop Audio", desktop_settings, nullptr);
 
         obs_data_set_string(mic_settings, "device_id", "default");
         mic_capture = obs_source_create("wasapi_input_capture",
             "Microphone", mic_settings, nullptr);
+#else
+        obs_data_set_double(desktop_settings, "frequency", 440.0);
+        desktop_audio = obs_source_create("synthetic_audio",
+            "Desktop Audio", desktop_settings, nullptr);
+
+        obs_data_set_double(mic_settings, "frequency", 660.0);
+        mic_capture = obs_source_create("synthetic_audio",
+            "Microphone", mic_settings, nullptr);
+#endif
 
         obs_data_release(desktop_settings);
         obs_data_release(mic_settings);
@@ -624,6 +827,7 @@ public:
         double base_pixels_per_second = 1920.0 * 1080.0 * 30.0;
         int calculated_bitrate = (int)((pixels_per_second / base_pixels_per_second) * video_bitrate);
         calculated_bitrate = (std::max)(1000, (std::min)(calculated_bitrate, 50000));
+        stream_bitrate = calculated_bitrate;
 
         obs_data_set_int(video_settings, "bitrate", calculated_bitrate);
         obs_data_set_int(video_settings, "keyint_sec", 2);
@@ -729,6 +933,10 @@ public:
             return false;
         }
 
+        abr.start(rtmp_output, video_encoder, stream_bitrate, AdaptiveBitrateConfig::from_env(stream_bitrate));
+#ifdef __linux__
+        metrics.set_output(rtmp_output);
+#endif
         is_streaming = true;
         pause_state = PauseState::NONE;
         std::cout << "Streaming started successfully!" << std::endl;
@@ -753,6 +961,9 @@ public:
                 resume_audio();
                 resume_screen();
             }
+            else if (pause_state == PauseState::ENCODING) {
+                resume_encoding();
+            }
             pause_state = PauseState::NONE;
         }
 
@@ -770,6 +981,10 @@ public:
             obs_output_force_stop(rtmp_output);
         }
 
+        abr.stop();
+#ifdef __linux__
+        metrics.set_output(nullptr);
+#endif
         obs_output_release(rtmp_output);
         rtmp_output = nullptr;
         is_streaming = false;
@@ -807,6 +1022,15 @@ public:
             return;
         }
 
+#ifdef __linux__
+        // Prometheus endpoint for continuous monitoring, see stream_metrics.h
+        std::string metrics_listen = linux_env_or("OBS_METRICS_LISTEN", "");
+        if (!metrics_listen.empty()) {
+            metrics.set_encoders(video_encoder, audio_encoder);
+            metrics.start(metrics_listen, atoi(linux_env_or("OBS_METRICS_INTERVAL_MS", "1000").c_str()));
+        }
+#endif
+
         // Start control thread
         control_thread = std::thread(&OBSRTMPStreamer::control_loop, this);
 
@@ -838,6 +1062,9 @@ public:
         std::cout << "Total frames: " << total_frames << std::endl;
         std::cout << "Dropped frames: " << dropped_frames << std::endl;
         std::cout << "Congestion: " << (congestion * 100.0) << "%" << std::endl;
+        if (abr.current_kbps()) {
+            std::cout << "Video bitrate: " << abr.current_kbps() << " kbps (adaptive)" << std::endl;
+        }
         std::cout << "========================" << std::endl;
     }
 
@@ -847,6 +1074,11 @@ private:
             stop_streaming();
         }
 
+#ifdef __linux__
+        metrics.stop();
+        metrics.set_encoders(nullptr, nullptr);
+#endif
+
         for (int i = 0; i < 6; i++) {
             obs_set_output_source(i, nullptr);
         }
@@ -891,6 +1123,12 @@ private:
 
         std::this_thread::sleep_for(std::chrono::milliseconds(500));
         obs_shutdown();
+
+#ifdef __linux__
+        linux_close_display(display);
+        display = nullptr;
+        linux_profiler_finish();
+#endif
     }
 };
 
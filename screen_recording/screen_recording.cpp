@@ -1,4 +1,4 @@
-// obs_capture_cross_platform.cpp - Cross-platform OBS screen capture for Windows and macOS
+// obs_capture_cross_platform.cpp - Cross-platform OBS screen capture for Windows, macOS and headless Linux
 #include <obs.h>
 #include <obs-module.h>
 #include <iostream>
@@ -6,9 +6,14 @@
 #include <chrono>
 #include <string>
 #include <vector>
+#include <memory>
 #include <cstring>
 #include <fstream>
 #include <filesystem>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include "fragmented_mp4_output.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -18,6 +23,10 @@
 #elif __APPLE__
 #include <CoreGraphics/CoreGraphics.h>
 #define PATH_SEPARATOR "/"
+#elif __linux__
+#include "linux_platform.h"
+#include "synthetic_sources.h"
+#define PATH_SEPARATOR "/"
 #endif
 
 namespace fs = std::filesystem;
@@ -37,23 +46,66 @@ private:
     int capture_duration;
     std::string exe_dir;
 
+    // Segmented recording: mp4_output finalizes the current file and starts
+    // <name>_NNN.mp4 on the first keyframe past either limit (0 = no limit),
+    // keeping only the newest max_segments files when that is set
+    int segment_seconds = 0;
+    int segment_mb = 0;
+    int max_segments = 0;
+    int segment_index = 0;
+    std::mutex segment_mutex;
+    std::deque<std::string> segment_files;
+
+    // OBS_FRAGMENTED_MP4=<seconds>: write fragmented MP4 flushed every few
+    // seconds instead of a regular MP4 finalized at the end
+    double fragment_seconds = 0.0;
+#ifdef __linux__
+    Display* display = nullptr;
+#endif
+
     // Get the directory where the executable is located
     std::string get_exe_directory() {
+#ifdef _WIN32
         char buffer[MAX_PATH];
         GetModuleFileNameA(NULL, buffer, MAX_PATH);
         std::string exe_path = buffer;
         size_t pos = exe_path.find_last_of("\\/");
         return exe_path.substr(0, pos);
+#else
+        return linux_exe_directory();
+#endif
+    }
+
+    // Root directory holding libobs/ and obs-plugins/ data
+    std::string get_data_directory() {
+#ifdef __linux__
+        return linux_data_directory();
+#else
+        return exe_dir + PATH_SEPARATOR "data";
+#endif
     }
 
     bool load_plugins() {
+#ifdef __linux__
+        // Capture comes from the synthetic sources, so no capture plugins
+        std::vector<std::string> plugins = {
+            "obs-ffmpeg", "obs-outputs", "obs-x264", "rtmp-services"
+        };
+        std::string plugin_dir = linux_plugin_directory();
+        std::string plugin_ext = ".so";
+#else
         std::vector<std::string> plugins = {
             "win-capture", "win-wasapi", "obs-ffmpeg",
             "obs-outputs", "obs-x264", "rtmp-services"
         };
+        std::string plugin_dir = exe_dir;
+        std::string plugin_ext = ".dll";
+#endif
 
+        std::vector<obs_module_t*> opened;
+        std::vector<std::string> opened_names;
         for (const auto& plugin : plugins) {
-            std::string plugin_path = exe_dir + "\\" + plugin + ".dll";
+            std::string plugin_path = plugin_dir + PATH_SEPARATOR + plugin + plugin_ext;
 
             if (!fs::exists(plugin_path)) {
                 std::cerr << "Warning: Plugin not found: " << plugin_path << std::endl;
@@ -62,17 +114,50 @@ private:
 
             obs_module_t* module = nullptr;
             if (obs_open_module(&module, plugin_path.c_str(), nullptr) == MODULE_SUCCESS && module) {
-                obs_init_module(module);
-                std::cout << "Successfully loaded plugin: " << plugin << std::endl;
+                opened.push_back(module);
+                opened_names.push_back(plugin);
             }
             else {
                 std::cerr << "Failed to load plugin: " << plugin << " from " << plugin_path << std::endl;
             }
         }
+
+        std::unique_ptr<bool[]> loaded(new bool[opened.size()]());
+#ifdef HAVE_VENDORED_LIBOBS
+        // The plugins do not depend on each other, so their obs_module_load
+        // calls run in parallel
+        obs_init_modules(opened.data(), opened.size(), loaded.get());
+#else
+        for (size_t i = 0; i < opened.size(); i++) {
+            loaded[i] = obs_init_module(opened[i]);
+        }
+#endif
+
+        for (size_t i = 0; i < opened.size(); i++) {
+            if (loaded[i]) {
+                std::cout << "Successfully loaded plugin: " << opened_names[i] << std::endl;
+            }
+            else {
+                std::cerr << "Failed to initialize plugin: " << opened_names[i] << std::endl;
+            }
+        }
         return true;
     }
 
     void get_screen_resolution(int& width, int& height) {
+#ifdef __linux__
+        // Headless: the canvas covers the configured virtual monitors
+        width = 0;
+        height = 0;
+        for (const auto& monitor : linux_headless_monitors()) {
+            width = (std::max)(width, monitor.x + monitor.width);
+            height = (std::max)(height, monitor.y + monitor.height);
+        }
+        if (width == 0 || height == 0) {
+            width = 1920;
+            height = 1080;
+        }
+#else
         HDC hdc = GetDC(NULL);
         width = GetDeviceCaps(hdc, HORZRES);
         height = GetDeviceCaps(hdc, VERTRES);
@@ -84,6 +169,7 @@ private:
             width = mi.rcMonitor.right - mi.rcMonitor.left;
             height = mi.rcMonitor.bottom - mi.rcMonitor.top;
         }
+#endif
 
         std::cout << "Screen resolution: " << width << "x" << height << std::endl;
     }
@@ -95,21 +181,35 @@ public:
         std::cout << "Working directory: " << exe_dir << std::endl;
     }
 
+    void set_segmenting(int seconds, int megabytes, int keep) {
+        segment_seconds = (std::max)(seconds, 0);
+        segment_mb = (std::max)(megabytes, 0);
+        max_segments = (std::max)(keep, 0);
+    }
+
+    bool segmenting() const {
+        return segment_seconds > 0 || segment_mb > 0;
+    }
+
+    void set_fragmented(double seconds) {
+        fragment_seconds = (std::max)(seconds, 0.0);
+    }
+
     bool initialize() {
         // Set up data paths - OBS needs to find its effect files
-        std::string data_path = exe_dir + "\\data";
-        std::string libobs_data = data_path + "\\libobs";
+        std::string data_path = get_data_directory();
+        std::string libobs_data = data_path + PATH_SEPARATOR "libobs";
 
         // Check if data directory exists
         if (!fs::exists(libobs_data)) {
             std::cerr << "ERROR: OBS data directory not found: " << libobs_data << std::endl;
-            std::cerr << "Please ensure the 'data\\libobs' folder with effect files is in:" << std::endl;
-            std::cerr << "  " << exe_dir << std::endl;
+            std::cerr << "Please ensure the 'data" PATH_SEPARATOR "libobs' folder with effect files is in:" << std::endl;
+            std::cerr << "  " << data_path << std::endl;
             return false;
         }
 
         // Verify at least one effect file exists
-        std::string test_effect = libobs_data + "\\default.effect";
+        std::string test_effect = libobs_data + PATH_SEPARATOR "default.effect";
         if (!fs::exists(test_effect)) {
             std::cerr << "ERROR: OBS effect files not found in: " << libobs_data << std::endl;
             std::cerr << "Please copy the libobs/data folder contents there." << std::endl;
@@ -117,11 +217,28 @@ public:
         }
 
         // Add data paths
+#ifdef __linux__
+        // Effect files are looked up directly under the registered path
+        obs_add_data_path((libobs_data + PATH_SEPARATOR).c_str());
+#else
         obs_add_data_path(data_path.c_str());
+#endif
         std::cout << "Added OBS data path: " << data_path << std::endl;
 
         // Also add module data path for plugins
-        obs_add_module_path(exe_dir.c_str(), (data_path + "\\obs-plugins\\%module%").c_str());
+        obs_add_module_path(exe_dir.c_str(),
+            (data_path + PATH_SEPARATOR "obs-plugins" PATH_SEPARATOR "%module%").c_str());
+
+#ifdef __linux__
+        linux_profiler_start();
+        linux_effect_cache_start();
+
+        // libobs-opengl renders through the X11/EGL platform display
+        display = linux_open_display();
+        if (!display) {
+            return false;
+        }
+#endif
 
         // Initialize OBS
         if (!obs_startup("en-US", nullptr, nullptr)) {
@@ -131,8 +248,15 @@ public:
 
         std::cout << "OBS core initialized successfully" << std::endl;
 
+#ifdef __linux__
+        linux_module_manifest_start();
+#endif
         // Load plugins
         load_plugins();
+        register_fragmented_mp4_output();
+#ifdef __linux__
+        register_synthetic_sources();
+#endif
 
         // Get screen resolution
         int screen_width, screen_height;
@@ -165,8 +289,13 @@ public:
         ovi.gpu_conversion = true;
         ovi.scale_type = OBS_SCALE_BICUBIC;
 
+#ifdef __linux__
+        ovi.graphics_module = "libobs-opengl";
+        ovi.gpu_conversion = linux_gpu_conversion();
+#else
         // Let OBS auto-detect the graphics module
         ovi.graphics_module = nullptr;
+#endif
 
         int result = obs_reset_video(&ovi);
         if (result != OBS_VIDEO_SUCCESS) {
@@ -174,6 +303,9 @@ public:
             return false;
         }
 
+#ifdef __linux__
+        linux_video_workers_start();
+#endif
         std::cout << "Video initialized successfully" << std::endl;
 
         // Setup audio
@@ -200,10 +332,20 @@ public:
 
         // Create screen capture
         obs_data_t* screen_settings = obs_data_create();
+#ifdef __linux__
+        struct obs_video_info ovi;
+        obs_get_video_info(&ovi);
+        obs_data_set_int(screen_settings, "width", ovi.base_width);
+        obs_data_set_int(screen_settings, "height", ovi.base_height);
+        obs_data_set_int(screen_settings, "fps", ovi.fps_num / ovi.fps_den);
+
+        screen_capture = obs_source_create("synthetic_video", "Screen", screen_settings, nullptr);
+#else
         obs_data_set_bool(screen_settings, "show_cursor", true);
         obs_data_set_int(screen_settings, "monitor", 0);  // Primary monitor
 
         screen_capture = obs_source_create("monitor_capture", "Screen", screen_settings, nullptr);
+#endif
         obs_data_release(screen_settings);
 
         if (!screen_capture) {
@@ -219,6 +361,16 @@ public:
         obs_data_t* desktop_settings = obs_data_create();
         obs_data_t* mic_settings = obs_data_create();
 
+#ifdef __linux__
+        // Two tones so both mixer inputs are distinguishable in the output
+        obs_data_set_double(desktop_settings, "frequency", 440.0);
+        desktop_audio = obs_source_create("synthetic_audio",
+            "Desktop Audio", desktop_settings, nullptr);
+
+        obs_data_set_double(mic_settings, "frequency", 660.0);
+        mic_capture = obs_source_create("synthetic_audio",
+            "Microphone", mic_settings, nullptr);
+#else
         // Windows WASAPI for desktop audio
         desktop_audio = obs_source_create("wasapi_output_capture",
             "Desktop Audio", desktop_settings, nullptr);
@@ -227,6 +379,7 @@ public:
         obs_data_set_string(mic_settings, "device_id", "default");
         mic_capture = obs_source_create("wasapi_input_capture",
             "Microphone", mic_settings, nullptr);
+#endif
 
         obs_data_release(desktop_settings);
         obs_data_release(mic_settings);
@@ -253,6 +406,13 @@ public:
         obs_data_t* video_settings = obs_data_create();
         obs_data_set_int(video_settings, "bitrate", 5000);
         obs_data_set_string(video_settings, "preset", "veryfast");
+        if (fragment_seconds > 0.0) {
+            // fragments are cut on keyframes
+            obs_data_set_int(video_settings, "keyint_sec", (std::max)((int)fragment_seconds, 1));
+        } else if (segmenting()) {
+            // segments can only start on a keyframe
+            obs_data_set_int(video_settings, "keyint_sec", 2);
+        }
 
         video_encoder = obs_video_encoder_create("obs_x264", "Video Encoder",
             video_settings, nullptr);
@@ -285,15 +445,89 @@ public:
         obs_encoder_set_video(video_encoder, obs_get_video());
         obs_encoder_set_audio(audio_encoder, obs_get_audio());
 
+#ifdef HAVE_VENDORED_LIBOBS
+        // spend the bits where the picture changed
+        const char* damage_roi = getenv("OBS_DAMAGE_ROI");
+        if (damage_roi && !obs_encoder_set_damage_roi(video_encoder, (float)std::atof(damage_roi))) {
+            std::cerr << "Video encoder does not support regions of interest" << std::endl;
+        }
+#endif
+
         std::cout << "Encoders configured successfully" << std::endl;
         return true;
     }
 
+    // recording.mp4 -> recording_001.mp4, recording_002.mp4, ...
+    std::string segment_name(int index) const {
+        char number[16];
+        snprintf(number, sizeof(number), "_%03d", index);
+        return fs::path(output_path).stem().string() + number;
+    }
+
+    std::string segment_path(int index) const {
+        fs::path path = fs::absolute(output_path);
+        return (path.parent_path() / (segment_name(index) + path.extension().string())).string();
+    }
+
+    // "file_changed" from the output thread: the previous segment has been
+    // finalized and next_file is being written
+    static void segment_changed(void* param, calldata_t* data) {
+        OBSScreenCapture* self = static_cast<OBSScreenCapture*>(param);
+        std::lock_guard<std::mutex> lock(self->segment_mutex);
+
+        std::cout << "Segment finished: " << self->segment_files.back() << std::endl;
+        self->segment_files.push_back(calldata_string(data, "next_file"));
+
+        // the output reads the name for the split after this one from its settings
+        obs_data_t* settings = obs_output_get_settings(self->output);
+        obs_data_set_string(settings, "format", self->segment_name(++self->segment_index + 1).c_str());
+        obs_data_release(settings);
+
+        while (self->max_segments > 0 && (int)self->segment_files.size() > self->max_segments) {
+            std::error_code ec;
+            fs::remove(self->segment_files.front(), ec);
+            std::cout << "Removed old segment: " << self->segment_files.front() << std::endl;
+            self->segment_files.pop_front();
+        }
+    }
+
     bool start_recording() {
         obs_data_t* output_settings = obs_data_create();
-        obs_data_set_string(output_settings, "path", output_path.c_str());
 
-        output = obs_output_create("mp4_output", "Recording", output_settings, nullptr);
+        if (segmenting()) {
+            fs::path path = fs::absolute(output_path);
+            std::string extension = path.extension().string();
+
+            segment_index = 1;
+            segment_files = { segment_path(1) };
+
+            obs_data_set_string(output_settings, "path", segment_files.front().c_str());
+            obs_data_set_int(output_settings, "max_time_sec", segment_seconds);
+            obs_data_set_int(output_settings, "max_size_mb", segment_mb);
+            obs_data_set_string(output_settings, "directory", path.parent_path().string().c_str());
+            obs_data_set_string(output_settings, "format", segment_name(2).c_str());
+            obs_data_set_string(output_settings, "extension", extension.empty() ? "mp4" : extension.c_str() + 1);
+            obs_data_set_bool(output_settings, "allow_spaces", true);
+            obs_data_set_bool(output_settings, "allow_overwrite", true);
+        } else {
+            obs_data_set_string(output_settings, "path", output_path.c_str());
+        }
+
+        const char* output_id = "mp4_output";
+        if (fragment_seconds > 0.0) {
+            output_id = "fragmented_mp4_output";
+            obs_data_set_double(output_settings, "fragment_sec", fragment_seconds);
+
+            // OBS_FILE_IO=uring|direct, OBS_FILE_PREALLOCATE_MB=<size>
+            const char* file_io = getenv("OBS_FILE_IO");
+            const char* preallocate = getenv("OBS_FILE_PREALLOCATE_MB");
+            bool direct = file_io && strcmp(file_io, "direct") == 0;
+            obs_data_set_bool(output_settings, "io_uring", direct || (file_io && strcmp(file_io, "uring") == 0));
+            obs_data_set_bool(output_settings, "direct_io", direct);
+            obs_data_set_int(output_settings, "preallocate_mb", preallocate ? std::atoi(preallocate) : 0);
+        }
+
+        output = obs_output_create(output_id, "Recording", output_settings, nullptr);
         obs_data_release(output_settings);
 
         if (!output) {
@@ -301,6 +535,12 @@ public:
             return false;
         }
 
+        if (segmenting()) {
+            signal_handler_connect(obs_output_get_signal_handler(output), "file_changed", segment_changed, this);
+            std::cout << "Splitting into segments of " << segment_seconds << " s / " << segment_mb << " MB"
+                << (max_segments ? ", keeping the last " + std::to_string(max_segments) : "") << std::endl;
+        }
+
         obs_output_set_video_encoder(output, video_encoder);
         obs_output_set_audio_encoder(output, audio_encoder, 0);
 
@@ -357,7 +597,15 @@ public:
         }
 
         std::cout << "Recording complete!" << std::endl;
-        std::cout << "File saved to: " << output_path << std::endl;
+        if (segmenting()) {
+            std::lock_guard<std::mutex> lock(segment_mutex);
+            std::cout << "Segments saved:" << std::endl;
+            for (const auto& file : segment_files) {
+                std::cout << "  " << file << std::endl;
+            }
+        } else {
+            std::cout << "File saved to: " << output_path << std::endl;
+        }
 
         cleanup();
     }
@@ -379,6 +627,9 @@ private:
 
         // Release in reverse order
         if (output) {
+            if (segmenting()) {
+                signal_handler_disconnect(obs_output_get_signal_handler(output), "file_changed", segment_changed, this);
+            }
             obs_output_release(output);
             output = nullptr;
         }
@@ -420,6 +671,12 @@ private:
 
         std::this_thread::sleep_for(std::chrono::milliseconds(500));
         obs_shutdown();
+
+#ifdef __linux__
+        linux_close_display(display);
+        display = nullptr;
+        linux_profiler_finish();
+#endif
     }
 };
 
@@ -435,15 +692,29 @@ int main(int argc, char* argv[]) {
         output_file = argv[2];
     }
 
+    // Optional segmenting: [segment seconds] [segment MB] [segments to keep]
+    int segment_seconds = argc > 3 ? std::atoi(argv[3]) : 0;
+    int segment_mb = argc > 4 ? std::atoi(argv[4]) : 0;
+    int max_segments = argc > 5 ? std::atoi(argv[5]) : 0;
+
     std::cout << "OBS Screen and Audio Capture" << std::endl;
     std::cout << "=============================" << std::endl;
     std::cout << "Output: " << output_file << std::endl;
     std::cout << "Duration: " << duration << " seconds" << std::endl;
+#ifdef __linux__
+    // Headless runs are scripted (CI / render farm), don't wait for input
+#else
     std::cout << "\nIMPORTANT: Grant necessary permissions if prompted!" << std::endl;
     std::cout << "Press Enter to start..." << std::endl;
     std::cin.get();
+#endif
 
     OBSScreenCapture capture(output_file, duration);
+    capture.set_segmenting(segment_seconds, segment_mb, max_segments);
+    const char* fragmented = getenv("OBS_FRAGMENTED_MP4");
+    if (fragmented && *fragmented) {
+        capture.set_fragmented(std::atof(fragmented));
+    }
     capture.record();
 
     return 0;
@@ -0,0 +1,383 @@
+// stream_metrics.h - Continuous pipeline telemetry for the streaming apps
+//
+// A sampler thread reads the libobs pipeline counters every interval (output
+// bytes/frames/drops/congestion and encode-to-send latency, encoder frames,
+// bitrate, packet copies and video-io input stats, video-io skipped frames,
+// render lag, audio buffering) and a server thread hands the latest sample
+// out in the Prometheus text format to anything that connects:
+//
+//     OBS_METRICS_LISTEN=9464 ./obs_rtmp_streamer ...         # 127.0.0.1:9464
+//     OBS_METRICS_LISTEN=0.0.0.0:9464                         # all interfaces
+//     OBS_METRICS_LISTEN=unix:/run/obs/metrics.sock           # Unix socket
+//     OBS_METRICS_INTERVAL_MS=500                             # default 1000
+//
+//     curl http://127.0.0.1:9464/metrics
+//     curl --unix-socket /run/obs/metrics.sock http://localhost/metrics
+//
+// Frame drops seen between two samples are also logged to stderr.  Send
+// latency, packet copies, video-io input stats and audio buffering need the
+// vendored libobs (HAVE_VENDORED_LIBOBS); a stock libobs does not report them.
+#pragma once
+
+#include <obs.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+class StreamMetrics {
+public:
+    ~StreamMetrics() {
+        stop();
+    }
+
+    // listen is "[host:]port" or "unix:<path>"
+    bool start(const std::string& listen, int interval_ms) {
+        if (running) {
+            return true;
+        }
+
+        listen_fd = open_listener(listen);
+        if (listen_fd < 0) {
+            return false;
+        }
+
+        interval = std::chrono::milliseconds(interval_ms > 0 ? interval_ms : 1000);
+        running = true;
+        sampler = std::thread(&StreamMetrics::sample_loop, this);
+        server = std::thread(&StreamMetrics::serve_loop, this);
+
+        std::cout << "Metrics endpoint listening on " << listen << std::endl;
+        return true;
+    }
+
+    void stop() {
+        if (!running) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            running = false;
+        }
+        wake.notify_all();
+
+        if (sampler.joinable()) {
+            sampler.join();
+        }
+        if (server.joinable()) {
+            server.join();
+        }
+
+        close(listen_fd);
+        listen_fd = -1;
+        if (!unix_path.empty()) {
+            unlink(unix_path.c_str());
+            unix_path.clear();
+        }
+    }
+
+    // Sampling holds the same lock, so once this returns the previous
+    // objects are no longer touched and may be released.
+    void set_output(obs_output_t* output) {
+        std::lock_guard<std::mutex> lock(objects_mutex);
+        this->output = output;
+        last_dropped = 0;
+    }
+
+    void set_encoders(obs_encoder_t* video, obs_encoder_t* audio) {
+        std::lock_guard<std::mutex> lock(objects_mutex);
+        video_encoder = video;
+        audio_encoder = audio;
+    }
+
+private:
+    std::atomic<bool> running{ false };
+    std::chrono::milliseconds interval{ 1000 };
+    std::thread sampler;
+    std::thread server;
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+
+    int listen_fd = -1;
+    std::string unix_path;
+
+    std::mutex objects_mutex;
+    obs_output_t* output = nullptr;
+    obs_encoder_t* video_encoder = nullptr;
+    obs_encoder_t* audio_encoder = nullptr;
+    int last_dropped = 0;
+
+    std::mutex sample_mutex;
+    std::string latest;
+
+    int open_listener(const std::string& listen) {
+        int fd = -1;
+
+        if (listen.rfind("unix:", 0) == 0) {
+            std::string path = listen.substr(5);
+            struct sockaddr_un addr = {};
+            if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+                std::cerr << "Invalid metrics socket path: " << path << std::endl;
+                return -1;
+            }
+
+            addr.sun_family = AF_UNIX;
+            strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+            unlink(path.c_str());
+
+            fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+                std::cerr << "Failed to bind metrics socket " << path << ": " << strerror(errno) << std::endl;
+                if (fd >= 0) {
+                    close(fd);
+                }
+                return -1;
+            }
+            unix_path = path;
+        } else {
+            std::string host = "127.0.0.1";
+            std::string port = listen;
+            size_t colon = listen.rfind(':');
+            if (colon != std::string::npos) {
+                host = listen.substr(0, colon);
+                port = listen.substr(colon + 1);
+            }
+
+            struct sockaddr_in addr = {};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons((uint16_t)atoi(port.c_str()));
+            if (!addr.sin_port || inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+                std::cerr << "Invalid metrics address: " << listen << std::endl;
+                return -1;
+            }
+
+            fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            int reuse = 1;
+            if (fd >= 0) {
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+            }
+            if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+                std::cerr << "Failed to bind metrics address " << listen << ": " << strerror(errno) << std::endl;
+                if (fd >= 0) {
+                    close(fd);
+                }
+                return -1;
+            }
+        }
+
+        if (::listen(fd, 8) != 0) {
+            std::cerr << "Failed to listen for metrics: " << strerror(errno) << std::endl;
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    static void counter(std::ostringstream& out, const char* name, const char* help, const std::string& labels,
+        uint64_t value) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n"
+            << name << labels << " " << value << "\n";
+    }
+
+    static void seconds_counter(std::ostringstream& out, const char* name, const char* help,
+        const std::string& labels, uint64_t ns) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n"
+            << name << labels << " " << ns / 1e9 << "\n";
+    }
+
+    static void gauge(std::ostringstream& out, const char* name, const char* help, const std::string& labels,
+        double value) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " gauge\n"
+            << name << labels << " " << value << "\n";
+    }
+
+    void sample_output(std::ostringstream& out) {
+        const std::string labels = "{output=\"" + std::string(obs_output_get_name(output)) + "\"}";
+        int dropped = obs_output_get_frames_dropped(output);
+
+        gauge(out, "obs_output_active", "Whether the output is running", labels, obs_output_active(output));
+        gauge(out, "obs_output_reconnecting", "Whether the output is reconnecting", labels,
+            obs_output_reconnecting(output));
+        counter(out, "obs_output_bytes_total", "Bytes sent by the output", labels,
+            obs_output_get_total_bytes(output));
+        counter(out, "obs_output_frames_total", "Video frames sent by the output", labels,
+            (uint64_t)obs_output_get_total_frames(output));
+        counter(out, "obs_output_frames_dropped_total", "Video frames dropped by the output", labels,
+            (uint64_t)dropped);
+        gauge(out, "obs_output_congestion", "Output congestion, 0 to 1", labels, obs_output_get_congestion(output));
+        gauge(out, "obs_output_connect_time_seconds", "Time the output took to connect", labels,
+            obs_output_get_connect_time_ms(output) / 1000.0);
+
+#ifdef HAVE_VENDORED_LIBOBS
+        struct obs_output_latency_stats latency = {};
+        if (obs_output_get_latency_stats(output, 0, &latency)) {
+            const char* name = "obs_output_send_latency_seconds";
+            out << "# HELP " << name << " Time from frame composition to the output sending its packet\n"
+                << "# TYPE " << name << " histogram\n";
+
+            // bucket i holds latencies below 2^i ms, the last one the rest
+            uint64_t cumulative = 0;
+            std::string prefix = labels.substr(0, labels.size() - 1);
+            for (size_t i = 0; i < OBS_OUTPUT_LATENCY_BUCKETS; i++) {
+                cumulative += latency.buckets[i];
+                out << name << "_bucket" << prefix << ",le=\"";
+                if (i + 1 == OBS_OUTPUT_LATENCY_BUCKETS) {
+                    out << "+Inf";
+                } else {
+                    out << (double)(1u << i) / 1000.0;
+                }
+                out << "\"} " << cumulative << "\n";
+            }
+            out << name << "_sum" << labels << " " << latency.total_ns / 1e9 << "\n"
+                << name << "_count" << labels << " " << latency.count << "\n";
+        }
+#endif
+
+        if (dropped > last_dropped) {
+            std::cerr << "[metrics] " << obs_output_get_name(output) << " dropped " << (dropped - last_dropped)
+                << " frames (congestion " << (int)(obs_output_get_congestion(output) * 100.0) << "%)" << std::endl;
+        }
+        last_dropped = dropped;
+    }
+
+    static void sample_encoder(std::ostringstream& out, obs_encoder_t* encoder) {
+        const std::string labels = "{encoder=\"" + std::string(obs_encoder_get_name(encoder)) + "\"}";
+
+        if (obs_encoder_get_type(encoder) == OBS_ENCODER_VIDEO) {
+            counter(out, "obs_encoder_frames_total", "Frames encoded", labels,
+                obs_encoder_get_encoded_frames(encoder));
+        }
+
+        // follows the adaptive bitrate controller
+        obs_data_t* settings = obs_encoder_get_settings(encoder);
+        gauge(out, "obs_encoder_bitrate_kbps", "Configured encoder bitrate", labels,
+            (double)obs_data_get_int(settings, "bitrate"));
+        obs_data_release(settings);
+#ifdef HAVE_VENDORED_LIBOBS
+        counter(out, "obs_encoder_packet_bytes_copied_total", "Encoded bytes copied for outputs", labels,
+            obs_encoder_get_packet_bytes_copied(encoder));
+        counter(out, "obs_encoder_packet_bytes_shared_total", "Encoded bytes shared between outputs", labels,
+            obs_encoder_get_packet_bytes_shared(encoder));
+
+        // what video-io does for the encoder before it gets a frame
+        struct video_input_stats input = {};
+        if (obs_encoder_get_video_input_stats(encoder, &input)) {
+            counter(out, "obs_encoder_input_frames_total", "Frames video-io passed to the encoder", labels,
+                input.frames);
+            counter(out, "obs_encoder_input_skipped_frames_total", "Video-io ticks the encoder fell behind on",
+                labels, input.skipped_frames);
+            seconds_counter(out, "obs_encoder_input_scale_seconds_total",
+                "Time video-io spent scaling and converting frames for the encoder", labels, input.scale_time_ns);
+            gauge(out, "obs_encoder_input_max_scale_seconds", "Slowest frame video-io scaled for the encoder",
+                labels, input.max_scale_time_ns / 1e9);
+            seconds_counter(out, "obs_encoder_input_callback_seconds_total",
+                "Time spent handing frames to the encoder", labels, input.callback_time_ns);
+        }
+#endif
+    }
+
+    std::string sample() {
+        std::ostringstream out;
+        video_t* video = obs_get_video();
+
+        if (video) {
+            counter(out, "obs_video_output_frames_total", "Frames produced by video-io", "",
+                video_output_get_total_frames(video));
+            counter(out, "obs_video_output_skipped_frames_total", "Frames video-io skipped", "",
+                video_output_get_skipped_frames(video));
+        }
+        counter(out, "obs_render_frames_total", "Frames rendered", "", obs_get_total_frames());
+        counter(out, "obs_render_lagged_frames_total", "Frames missed due to rendering lag", "",
+            obs_get_lagged_frames());
+        gauge(out, "obs_render_frame_time_seconds", "Average frame render time", "",
+            obs_get_average_frame_time_ns() / 1e9);
+        gauge(out, "obs_render_fps", "Active render frame rate", "", obs_get_active_fps());
+#ifdef HAVE_VENDORED_LIBOBS
+        gauge(out, "obs_audio_buffering_seconds", "Audio buffering added for late sources", "",
+            obs_get_audio_buffering_ms() / 1000.0);
+#endif
+
+        std::lock_guard<std::mutex> lock(objects_mutex);
+        if (output) {
+            sample_output(out);
+        }
+        if (video_encoder) {
+            sample_encoder(out, video_encoder);
+        }
+        if (audio_encoder) {
+            sample_encoder(out, audio_encoder);
+        }
+
+        return out.str();
+    }
+
+    void sample_loop() {
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        while (running) {
+            lock.unlock();
+            std::string text = sample();
+            {
+                std::lock_guard<std::mutex> guard(sample_mutex);
+                latest.swap(text);
+            }
+            lock.lock();
+
+            wake.wait_for(lock, interval, [this] { return !running; });
+        }
+    }
+
+    void serve_loop() {
+        while (running) {
+            struct pollfd pfd = { listen_fd, POLLIN, 0 };
+            if (poll(&pfd, 1, 200) <= 0) {
+                continue;
+            }
+
+            int client = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) {
+                continue;
+            }
+
+            // the request itself does not matter, every path gets the metrics
+            struct pollfd cfd = { client, POLLIN, 0 };
+            char request[1024];
+            if (poll(&cfd, 1, 1000) > 0) {
+                (void)!read(client, request, sizeof(request));
+            }
+
+            std::string body;
+            {
+                std::lock_guard<std::mutex> lock(sample_mutex);
+                body = latest;
+            }
+
+            std::string response = "HTTP/1.0 200 OK\r\n"
+                "Content-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                "Connection: close\r\n\r\n" + body;
+
+            size_t sent = 0;
+            while (sent < response.size()) {
+                ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0) {
+                    break;
+                }
+                sent += (size_t)n;
+            }
+            close(client);
+        }
+    }
+};
@@ -0,0 +1,299 @@
+// synthetic_sources.h - Display-less test sources for headless capture/encode runs
+//
+// Registers two source types with the running libobs core:
+//   "synthetic_video" - async BGRA color bars with a moving marker, stands in
+//                       for monitor_capture when there is no real screen.
+//                       Frames are handed to libobs without a copy from a
+//                       small pool of buffers (obs_source_output_video_external,
+//                       copied with a stock libobs)
+//   "synthetic_audio" - sine tone, stands in for desktop audio / microphone
+//
+// Call register_synthetic_sources() once after obs_startup().
+#pragma once
+
+#include <obs.h>
+#include <obs-module.h>
+#include <util/platform.h>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+struct SyntheticVideo {
+    // One frame buffer libobs may still be reading from; busy until libobs
+    // calls release()
+    struct Slot {
+        std::vector<uint8_t> pixels;
+        int64_t marker_frame = -1;
+        std::atomic<bool> busy{ false };
+
+        static void release(void* param) {
+            static_cast<Slot*>(param)->busy = false;
+        }
+    };
+
+    obs_source_t* source = nullptr;
+    uint32_t width = 1920;
+    uint32_t height = 1080;
+    uint32_t fps = 30;
+    std::vector<uint8_t> pixels;
+    std::atomic<bool> active{ true };
+    std::thread worker;
+
+    static constexpr uint32_t marker_size = 64;
+    static constexpr size_t pool_size = 6;
+    Slot slots[pool_size];
+    uint64_t skipped_frames = 0;
+
+    uint32_t bar_color(uint32_t x) const {
+        static const uint32_t bars[] = {
+            0xFFC0C0C0, 0xFFC0C000, 0xFF00C0C0, 0xFF00C000,
+            0xFFC000C0, 0xFFC00000, 0xFF0000C0, 0xFF101010
+        };
+        const uint32_t bar_count = sizeof(bars) / sizeof(bars[0]);
+        return bars[(uint64_t)x * bar_count / width];
+    }
+
+    void draw_bars() {
+        pixels.resize((size_t)width * height * 4);
+        uint32_t* px = reinterpret_cast<uint32_t*>(pixels.data());
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                px[(size_t)y * width + x] = bar_color(x);
+            }
+        }
+    }
+
+    bool marker_pos(uint64_t frame, uint32_t& mx, uint32_t& my) const {
+        if (width <= marker_size || height <= marker_size)
+            return false;
+
+        mx = (uint32_t)((frame * 8) % (width - marker_size));
+        my = (uint32_t)((frame * 4) % (height - marker_size));
+        return true;
+    }
+
+    // Only the marker area is touched per frame (the slot's previous marker
+    // is restored to the bars underneath, then the new one drawn) so the
+    // generator stays cheap next to the pipeline being measured.
+    void draw_marker(std::vector<uint8_t>& buffer, uint64_t frame, bool erase) {
+        uint32_t mx, my;
+        if (!marker_pos(frame, mx, my))
+            return;
+
+        uint32_t* px = reinterpret_cast<uint32_t*>(buffer.data());
+        for (uint32_t y = my; y < my + marker_size; y++) {
+            for (uint32_t x = mx; x < mx + marker_size; x++) {
+                px[(size_t)y * width + x] = erase ? bar_color(x) : 0xFFFFFFFF;
+            }
+        }
+    }
+
+    Slot* acquire_slot() {
+        for (Slot& slot : slots) {
+            bool expected = false;
+            if (slot.busy.compare_exchange_strong(expected, true)) {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    void run() {
+        const uint64_t interval = 1000000000ULL / fps;
+        uint64_t frame_index = 0;
+#ifdef HAVE_VENDORED_LIBOBS
+        int64_t last_output = -1;
+#endif
+        uint64_t next = os_gettime_ns();
+
+        struct obs_source_frame frame = {};
+        frame.width = width;
+        frame.height = height;
+        frame.format = VIDEO_FORMAT_BGRA;
+        frame.linesize[0] = width * 4;
+
+        while (active) {
+            // every buffer still queued in libobs: the pipeline is behind,
+            // so skip this frame rather than allocate another buffer
+            Slot* slot = acquire_slot();
+            if (slot) {
+                if (slot->marker_frame >= 0) {
+                    draw_marker(slot->pixels, (uint64_t)slot->marker_frame, true);
+                }
+                draw_marker(slot->pixels, frame_index, false);
+                slot->marker_frame = (int64_t)frame_index;
+
+                frame.timestamp = next;
+                frame.data[0] = slot->pixels.data();
+#ifdef HAVE_VENDORED_LIBOBS
+                // against the last frame output, only where the marker
+                // was and is now changed, so libobs only redraws and
+                // converts that part of the canvas
+                uint32_t mx, my;
+                struct video_damage damage = {};
+                if (last_output >= 0 && marker_pos((uint64_t)last_output, mx, my)) {
+                    video_damage_add(&damage, mx, my, marker_size, marker_size);
+                }
+                if (last_output >= 0 && marker_pos(frame_index, mx, my)) {
+                    video_damage_add(&damage, mx, my, marker_size, marker_size);
+                }
+                obs_source_output_video_external_damaged(source, &frame, &damage, Slot::release, slot);
+                last_output = (int64_t)frame_index;
+#else
+                // a stock libobs copies the frame before returning
+                obs_source_output_video(source, &frame);
+                Slot::release(slot);
+#endif
+            } else {
+                skipped_frames++;
+            }
+
+            frame_index++;
+
+            next += interval;
+            os_sleepto_ns(next);
+        }
+    }
+
+    static const char* get_name(void*) {
+        return "Synthetic Video";
+    }
+
+    static void* create(obs_data_t* settings, obs_source_t* source) {
+        SyntheticVideo* ctx = new SyntheticVideo();
+        ctx->source = source;
+        ctx->width = (uint32_t)obs_data_get_int(settings, "width");
+        ctx->height = (uint32_t)obs_data_get_int(settings, "height");
+        ctx->fps = (uint32_t)obs_data_get_int(settings, "fps");
+        ctx->draw_bars();
+        for (Slot& slot : ctx->slots) {
+            slot.pixels = ctx->pixels;
+        }
+#ifdef HAVE_VENDORED_LIBOBS
+        // a late graphics thread costs single frames instead of the queue
+        obs_source_set_async_drop_oldest(source, true);
+#endif
+        ctx->worker = std::thread(&SyntheticVideo::run, ctx);
+        return ctx;
+    }
+
+    static void destroy(void* data) {
+        SyntheticVideo* ctx = static_cast<SyntheticVideo*>(data);
+        ctx->active = false;
+        if (ctx->worker.joinable()) {
+            ctx->worker.join();
+        }
+        // libobs hands back queued frames before calling destroy, so no
+        // slot is referenced any more
+        if (ctx->skipped_frames) {
+            blog(LOG_INFO, "synthetic_video: %llu frames skipped, all buffers were in use",
+                (unsigned long long)ctx->skipped_frames);
+        }
+        delete ctx;
+    }
+
+    static void get_defaults(obs_data_t* settings) {
+        obs_data_set_default_int(settings, "width", 1920);
+        obs_data_set_default_int(settings, "height", 1080);
+        obs_data_set_default_int(settings, "fps", 30);
+    }
+
+    static uint32_t get_width(void* data) {
+        return static_cast<SyntheticVideo*>(data)->width;
+    }
+
+    static uint32_t get_height(void* data) {
+        return static_cast<SyntheticVideo*>(data)->height;
+    }
+};
+
+struct SyntheticAudio {
+    obs_source_t* source = nullptr;
+    double frequency = 440.0;
+    std::atomic<bool> active{ true };
+    std::thread worker;
+
+    static constexpr uint32_t sample_rate = 48000;
+    static constexpr uint32_t frames_per_packet = 480;
+    static constexpr double two_pi = 6.283185307179586;
+
+    void run() {
+        const uint64_t interval = 1000000000ULL * frames_per_packet / sample_rate;
+        const double step = two_pi * frequency / sample_rate;
+        std::vector<float> samples(frames_per_packet);
+        double phase = 0.0;
+        uint64_t next = os_gettime_ns();
+
+        struct obs_source_audio audio = {};
+        audio.frames = frames_per_packet;
+        audio.speakers = SPEAKERS_MONO;
+        audio.format = AUDIO_FORMAT_FLOAT;
+        audio.samples_per_sec = sample_rate;
+        audio.data[0] = reinterpret_cast<const uint8_t*>(samples.data());
+
+        while (active) {
+            for (auto& sample : samples) {
+                sample = (float)(0.25 * std::sin(phase));
+                phase += step;
+            }
+            phase = std::fmod(phase, two_pi);
+
+            audio.timestamp = next;
+            obs_source_output_audio(source, &audio);
+
+            next += interval;
+            os_sleepto_ns(next);
+        }
+    }
+
+    static const char* get_name(void*) {
+        return "Synthetic Audio";
+    }
+
+    static void* create(obs_data_t* settings, obs_source_t* source) {
+        SyntheticAudio* ctx = new SyntheticAudio();
+        ctx->source = source;
+        ctx->frequency = obs_data_get_double(settings, "frequency");
+        ctx->worker = std::thread(&SyntheticAudio::run, ctx);
+        return ctx;
+    }
+
+    static void destroy(void* data) {
+        SyntheticAudio* ctx = static_cast<SyntheticAudio*>(data);
+        ctx->active = false;
+        if (ctx->worker.joinable()) {
+            ctx->worker.join();
+        }
+        delete ctx;
+    }
+
+    static void get_defaults(obs_data_t* settings) {
+        obs_data_set_default_double(settings, "frequency", 440.0);
+    }
+};
+
+inline void register_synthetic_sources() {
+    struct obs_source_info video_info = {};
+    video_info.id = "synthetic_video";
+    video_info.type = OBS_SOURCE_TYPE_INPUT;
+    video_info.output_flags = OBS_SOURCE_ASYNC_VIDEO | OBS_SOURCE_DO_NOT_DUPLICATE;
+    video_info.get_name = SyntheticVideo::get_name;
+    video_info.create = SyntheticVideo::create;
+    video_info.destroy = SyntheticVideo::destroy;
+    video_info.get_defaults = SyntheticVideo::get_defaults;
+    video_info.get_width = SyntheticVideo::get_width;
+    video_info.get_height = SyntheticVideo::get_height;
+    obs_register_source(&video_info);
+
+    struct obs_source_info audio_info = {};
+    audio_info.id = "synthetic_audio";
+    audio_info.type = OBS_SOURCE_TYPE_INPUT;
+    audio_info.output_flags = OBS_SOURCE_AUDIO | OBS_SOURCE_DO_NOT_DUPLICATE;
+    audio_info.get_name = SyntheticAudio::get_name;
+    audio_info.create = SyntheticAudio::create;
+    audio_info.destroy = SyntheticAudio::destroy;
+    audio_info.get_defaults = SyntheticAudio::get_defaults;
+    obs_register_source(&audio_info);
+}